@@ -0,0 +1,693 @@
+#include "gp_algorithms_cpu.hpp"
+#include "gpxpy_c.hpp"
+#include "mkl_cblas.h"
+#include "mkl_lapacke.h"
+#include "tiled_algorithms_cpu.hpp"
+#include "utils_c.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <hpx/future.hpp>
+#include <hpx/include/run_as.hpp>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef GPXPY_DATA_DIR
+#define GPXPY_DATA_DIR "data"
+#endif
+
+// Benchmark of the GP operations: each operation is timed `repetitions`
+// times after `warmup` untimed runs, its input is prepared outside of the
+// timed region. The results are checked against a dense MKL reference so that
+// a faster but wrong build does not pass as an improvement.
+//
+//   gpxpy_bench --n-train=4096 --n-test=1024 --n-tiles=16 --threads=8 \
+//               --format=json --output=bench.json
+
+namespace
+{
+using tile_vector = std::vector<hpx::shared_future<mutable_tile_data<double>>>;
+
+const char *usage =
+    "Usage: gpxpy_bench [options] [--hpx:<option> ...]\n"
+    "\n"
+    "  --n-train=N             training samples (default 1024)\n"
+    "  --n-test=M              test samples (default 1024)\n"
+    "  --n-tiles=T             tiles per dimension (default 16)\n"
+    "  --n-regressors=R        regressors (default 8)\n"
+    "  --threads=P             HPX worker threads (default: all cores)\n"
+    "  --repetitions=K         timed runs per operation (default 5)\n"
+    "  --warmup=W              untimed runs per operation (default 1)\n"
+    "  --opt-iter=I            optimizer iterations per timed run (default 1)\n"
+    "  --operations=a,b,...    operations to time (default all): assembly,\n"
+    "                          cholesky, solve, fit, predict,\n"
+    "                          predict_with_uncertainty, predict_with_full_cov,\n"
+    "                          loss, optimize\n"
+    "  --data-dir=DIR          directory of training/ and test/ (default\n"
+    "                          " GPXPY_DATA_DIR ")\n"
+    "  --format=json|csv       output format (default json)\n"
+    "  --output=FILE           write the results to FILE instead of stdout\n"
+    "  --tolerance=TOL         relative tolerance of the check (default 1e-8)\n"
+    "  --no-check              skip the check against the dense reference\n"
+    "\n"
+    "Options starting with --hpx: are passed to the HPX runtime. Exits with 1\n"
+    "if the check fails.\n";
+
+const std::vector<std::string> all_operations = {
+    "assembly", "cholesky", "solve", "fit", "predict", "predict_with_uncertainty", "predict_with_full_cov", "loss", "optimize"
+};
+
+// Parameters of a benchmark run
+struct options
+{
+    int n_train = 1024;
+    int n_test = 1024;
+    int n_tiles = 16;
+    int n_regressors = 8;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    int repetitions = 5;
+    int warmup = 1;
+    int opt_iter = 1;
+    std::vector<std::string> operations = all_operations;
+    std::string data_dir = GPXPY_DATA_DIR;
+    std::string format = "json";
+    std::string output;
+    double tolerance = 1e-8;
+    bool check = true;
+    std::vector<std::string> hpx_args;
+
+    // hyperparameters of the benchmarked GP
+    double lengthscale = 1.0;
+    double vertical_lengthscale = 1.0;
+    double noise_variance = 0.1;
+};
+
+// Order statistics of the run times of an operation in seconds
+struct timing
+{
+    std::string operation;
+    std::vector<double> samples;
+    double min;
+    double p10;
+    double median;
+    double p90;
+    double max;
+    double mean;
+    double stddev;
+};
+
+// Maximum error of an output of the GP relative to the reference
+struct check_result
+{
+    std::string output;
+    double error;
+    bool passed;
+};
+
+int parse_int(const std::string &key, const std::string &value, int min)
+{
+    std::size_t end = 0;
+    int result = 0;
+    try
+    {
+        result = std::stoi(value, &end);
+    }
+    catch (const std::exception &)
+    {
+        end = 0;
+    }
+    if (end != value.size() || end == 0 || result < min)
+    {
+        throw std::invalid_argument("--" + key + " expects an integer >= " + std::to_string(min) + ", got '" + value + "'");
+    }
+    return result;
+}
+
+std::vector<std::string> split(const std::string &text, char separator)
+{
+    std::vector<std::string> parts;
+    std::istringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator))
+    {
+        if (!part.empty())
+        {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+// Parse `--key=value` and `--key value` arguments, returns false for --help
+bool parse_options(int argc, char **argv, options &opts)
+{
+    for (int a = 1; a < argc; a++)
+    {
+        std::string arg = argv[a];
+        if (arg.rfind("--hpx:", 0) == 0)
+        {
+            opts.hpx_args.push_back(arg);
+            continue;
+        }
+        if (arg == "--help" || arg == "-h")
+        {
+            return false;
+        }
+        if (arg == "--no-check")
+        {
+            opts.check = false;
+            continue;
+        }
+        if (arg.rfind("--", 0) != 0)
+        {
+            throw std::invalid_argument("Unexpected argument '" + arg + "'");
+        }
+        std::string key = arg.substr(2);
+        std::string value;
+        const std::size_t equals = key.find('=');
+        if (equals != std::string::npos)
+        {
+            value = key.substr(equals + 1);
+            key = key.substr(0, equals);
+        }
+        else if (a + 1 < argc)
+        {
+            value = argv[++a];
+        }
+        else
+        {
+            throw std::invalid_argument("--" + key + " expects a value");
+        }
+
+        if (key == "n-train") { opts.n_train = parse_int(key, value, 1); }
+        else if (key == "n-test") { opts.n_test = parse_int(key, value, 1); }
+        else if (key == "n-tiles") { opts.n_tiles = parse_int(key, value, 1); }
+        else if (key == "n-regressors") { opts.n_regressors = parse_int(key, value, 1); }
+        else if (key == "threads") { opts.threads = static_cast<std::size_t>(parse_int(key, value, 1)); }
+        else if (key == "repetitions") { opts.repetitions = parse_int(key, value, 1); }
+        else if (key == "warmup") { opts.warmup = parse_int(key, value, 0); }
+        else if (key == "opt-iter") { opts.opt_iter = parse_int(key, value, 1); }
+        else if (key == "data-dir") { opts.data_dir = value; }
+        else if (key == "output") { opts.output = value; }
+        else if (key == "tolerance") { opts.tolerance = std::stod(value); }
+        else if (key == "format")
+        {
+            if (value != "json" && value != "csv")
+            {
+                throw std::invalid_argument("--format expects json or csv, got '" + value + "'");
+            }
+            opts.format = value;
+        }
+        else if (key == "operations")
+        {
+            opts.operations = split(value, ',');
+            for (const std::string &operation : opts.operations)
+            {
+                if (std::find(all_operations.begin(), all_operations.end(), operation) == all_operations.end())
+                {
+                    throw std::invalid_argument("Unknown operation '" + operation + "'");
+                }
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown option --" + key);
+        }
+    }
+    return true;
+}
+
+// Linear interpolation between the order statistics of sorted samples
+double percentile(const std::vector<double> &sorted, double p)
+{
+    const double position = p * static_cast<double>(sorted.size() - 1);
+    const std::size_t lower = static_cast<std::size_t>(position);
+    const std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (position - static_cast<double>(lower)) * (sorted[upper] - sorted[lower]);
+}
+
+timing summarize(const std::string &operation, const std::vector<double> &samples)
+{
+    timing t;
+    t.operation = operation;
+    t.samples = samples;
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    t.min = sorted.front();
+    t.p10 = percentile(sorted, 0.1);
+    t.median = percentile(sorted, 0.5);
+    t.p90 = percentile(sorted, 0.9);
+    t.max = sorted.back();
+    t.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size());
+    double sum_squares = 0.0;
+    for (double sample : sorted)
+    {
+        sum_squares += (sample - t.mean) * (sample - t.mean);
+    }
+    t.stddev = sorted.size() > 1 ? std::sqrt(sum_squares / static_cast<double>(sorted.size() - 1)) : 0.0;
+    return t;
+}
+
+// Time run() after setup() for the warm-up and timed repetitions
+timing measure(const std::string &operation,
+               const options &opts,
+               const std::function<void()> &setup,
+               const std::function<void()> &run)
+{
+    std::vector<double> samples;
+    for (int r = 0; r < opts.warmup + opts.repetitions; r++)
+    {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (r >= opts.warmup)
+        {
+            samples.push_back(elapsed.count());
+        }
+    }
+    return summarize(operation, samples);
+}
+
+// Tiled stages of GP::fit, run on an HPX thread and waited for ------------
+
+tile_vector assemble_covariance(const std::vector<double> &input, int n_tiles, int n_tile_size, int n_regressors, double *hyperparameters)
+{
+    tile_vector tiles(n_tiles * n_tiles);
+    for (std::size_t i = 0; i < static_cast<std::size_t>(n_tiles); i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            tiles[i * n_tiles + j] = hpx::async(&gen_tile_covariance<double>, i, j, n_tile_size, n_regressors, hyperparameters, kernel_function(), input);
+        }
+    }
+    for (std::size_t i = 0; i < static_cast<std::size_t>(n_tiles); i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            tiles[i * n_tiles + j].wait();
+        }
+    }
+    return tiles;
+}
+
+tile_vector assemble_output(const std::vector<double> &output, int n_tiles, int n_tile_size)
+{
+    tile_vector tiles(n_tiles);
+    for (std::size_t i = 0; i < static_cast<std::size_t>(n_tiles); i++)
+    {
+        tiles[i] = hpx::async(&gen_tile_output<double>, i, n_tile_size, output);
+    }
+    hpx::wait_all(tiles);
+    return tiles;
+}
+
+void wait_lower(const tile_vector &tiles, int n_tiles)
+{
+    for (std::size_t i = 0; i < static_cast<std::size_t>(n_tiles); i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            tiles[i * n_tiles + j].wait();
+        }
+    }
+}
+
+// Dense reference with MKL ------------------------------------------------
+
+// Results of the exact GP on the dense covariance matrix
+struct reference
+{
+    double loss;
+    std::vector<double> mean;
+    std::vector<double> variance;
+};
+
+// Squared exponential covariance of the lagged feature vectors of samples i
+// of a and j of b, samples before the start of a series are zero
+double covariance(const std::vector<double> &a, const std::vector<double> &b, long i, long j, const options &opts)
+{
+    double distance = 0.0;
+    for (long t = 0; t < opts.n_regressors; t++)
+    {
+        const double za = i - t >= 0 ? a[i - t] : 0.0;
+        const double zb = j - t >= 0 ? b[j - t] : 0.0;
+        distance += (za - zb) * (za - zb);
+    }
+    return opts.vertical_lengthscale * std::exp(-distance / (2.0 * opts.lengthscale * opts.lengthscale));
+}
+
+reference compute_reference(const std::vector<double> &x,
+                            const std::vector<double> &y,
+                            const std::vector<double> &x_test,
+                            const options &opts)
+{
+    const long n = opts.n_train;
+    const long m = opts.n_test;
+    std::vector<double> K(n * n, 0.0);
+    for (long i = 0; i < n; i++)
+    {
+        for (long j = 0; j <= i; j++)
+        {
+            K[i * n + j] = covariance(x, x, i, j, opts);
+        }
+        K[i * n + i] += opts.noise_variance;
+    }
+    if (LAPACKE_dpotrf(LAPACK_ROW_MAJOR, 'L', n, K.data(), n) != 0)
+    {
+        throw std::runtime_error("Reference covariance matrix is not positive definite");
+    }
+    std::vector<double> alpha = y;
+    cblas_dtrsv(CblasRowMajor, CblasLower, CblasNoTrans, CblasNonUnit, n, K.data(), n, alpha.data(), 1);
+    cblas_dtrsv(CblasRowMajor, CblasLower, CblasTrans, CblasNonUnit, n, K.data(), n, alpha.data(), 1);
+
+    reference ref;
+    double log_det = 0.0;
+    for (long i = 0; i < n; i++)
+    {
+        log_det += 2.0 * std::log(K[i * n + i]);
+    }
+    const double fit = cblas_ddot(n, y.data(), 1, alpha.data(), 1);
+    ref.loss = 0.5 * (fit + log_det + static_cast<double>(n) * std::log(2.0 * M_PI)) / static_cast<double>(n);
+
+    // V = L^-1 * K_*^T, n x m
+    std::vector<double> V(n * m);
+    for (long i = 0; i < n; i++)
+    {
+        for (long j = 0; j < m; j++)
+        {
+            V[i * m + j] = covariance(x, x_test, i, j, opts);
+        }
+    }
+    ref.mean.assign(m, 0.0);
+    cblas_dgemv(CblasRowMajor, CblasTrans, n, m, 1.0, V.data(), m, alpha.data(), 1, 0.0, ref.mean.data(), 1);
+    cblas_dtrsm(CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, n, m, 1.0, K.data(), n, V.data(), m);
+    ref.variance.assign(m, opts.vertical_lengthscale);
+    for (long i = 0; i < n; i++)
+    {
+        for (long j = 0; j < m; j++)
+        {
+            ref.variance[j] -= V[i * m + j] * V[i * m + j];
+        }
+    }
+    return ref;
+}
+
+check_result compare(const std::string &output, const std::vector<double> &values, const std::vector<double> &expected, double tolerance)
+{
+    double error = values.size() == expected.size() ? 0.0 : INFINITY;
+    double scale = 1.0;
+    for (std::size_t i = 0; i < std::min(values.size(), expected.size()); i++)
+    {
+        error = std::max(error, std::fabs(values[i] - expected[i]));
+        scale = std::max(scale, std::fabs(expected[i]));
+    }
+    error /= scale;
+    return { output, error, error <= tolerance };
+}
+
+// Output ------------------------------------------------------------------
+
+void write_json(std::ostream &out,
+                const options &opts,
+                int n_tile_size,
+                const std::pair<int, int> &test_tiles,
+                const std::vector<timing> &timings,
+                const std::vector<check_result> &checks)
+{
+    out.precision(9);
+    out << "{\n  \"benchmark\": \"gpxpy_bench\",\n  \"config\": {"
+        << "\"n_train\": " << opts.n_train << ", \"n_test\": " << opts.n_test << ", \"n_tiles\": " << opts.n_tiles
+        << ", \"n_tile_size\": " << n_tile_size << ", \"m_tiles\": " << test_tiles.first
+        << ", \"m_tile_size\": " << test_tiles.second << ", \"n_regressors\": " << opts.n_regressors
+        << ", \"threads\": " << opts.threads << ", \"repetitions\": " << opts.repetitions
+        << ", \"warmup\": " << opts.warmup << ", \"opt_iter\": " << opts.opt_iter << "},\n  \"results\": [";
+    for (std::size_t k = 0; k < timings.size(); k++)
+    {
+        const timing &t = timings[k];
+        out << (k ? ",\n" : "\n") << "    {\"operation\": \"" << t.operation << "\", \"min\": " << t.min
+            << ", \"p10\": " << t.p10 << ", \"median\": " << t.median << ", \"p90\": " << t.p90 << ", \"max\": " << t.max
+            << ", \"mean\": " << t.mean << ", \"stddev\": " << t.stddev << ", \"samples\": [";
+        for (std::size_t s = 0; s < t.samples.size(); s++)
+        {
+            out << (s ? ", " : "") << t.samples[s];
+        }
+        out << "]}";
+    }
+    bool passed = true;
+    out << "\n  ],\n  \"check\": {\"enabled\": " << (opts.check ? "true" : "false") << ", \"tolerance\": " << opts.tolerance
+        << ", \"errors\": {";
+    for (std::size_t k = 0; k < checks.size(); k++)
+    {
+        out << (k ? ", " : "") << "\"" << checks[k].output << "\": " << checks[k].error;
+        passed = passed && checks[k].passed;
+    }
+    out << "}, \"passed\": " << (passed ? "true" : "false") << "}\n}\n";
+}
+
+void write_csv(std::ostream &out,
+               const options &opts,
+               int n_tile_size,
+               const std::vector<timing> &timings,
+               bool passed)
+{
+    out.precision(9);
+    out << "operation,n_train,n_test,n_tiles,n_tile_size,n_regressors,threads,repetitions,min,p10,median,p90,max,mean,stddev,check\n";
+    for (const timing &t : timings)
+    {
+        out << t.operation << "," << opts.n_train << "," << opts.n_test << "," << opts.n_tiles << "," << n_tile_size << ","
+            << opts.n_regressors << "," << opts.threads << "," << opts.repetitions << "," << t.min << "," << t.p10 << ","
+            << t.median << "," << t.p90 << "," << t.max << "," << t.mean << "," << t.stddev << ","
+            << (opts.check ? (passed ? "passed" : "failed") : "skipped") << "\n";
+    }
+}
+
+bool selected(const options &opts, const std::string &operation)
+{
+    return std::find(opts.operations.begin(), opts.operations.end(), operation) != opts.operations.end();
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    options opts;
+    try
+    {
+        if (!parse_options(argc, argv, opts))
+        {
+            std::cout << usage;
+            return 0;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "gpxpy_bench: " << e.what() << "\n\n" << usage;
+        return 2;
+    }
+
+    const int n_tile_size = utils::compute_train_tile_size(opts.n_train, opts.n_tiles);
+    const std::pair<int, int> test_tiles = utils::compute_test_tiles(opts.n_test, opts.n_tiles, n_tile_size);
+    const std::vector<double> x = utils::load_data(opts.data_dir + "/training/training_input.txt", opts.n_train);
+    const std::vector<double> y = utils::load_data(opts.data_dir + "/training/training_output.txt", opts.n_train);
+    const std::vector<double> x_test = utils::load_data(opts.data_dir + "/test/test_input.txt", opts.n_test);
+
+    // only the --hpx: options reach the runtime
+    std::vector<std::string> hpx_args = { argv[0], "--hpx:threads=" + std::to_string(opts.threads) };
+    hpx_args.insert(hpx_args.end(), opts.hpx_args.begin(), opts.hpx_args.end());
+    std::vector<char *> hpx_argv;
+    for (std::string &arg : hpx_args)
+    {
+        hpx_argv.push_back(&arg[0]);
+    }
+    hpx_argv.push_back(nullptr);
+    utils::start_hpx_runtime(static_cast<int>(hpx_args.size()), hpx_argv.data());
+
+    const std::vector<bool> trainable = { true, true, true };
+    double hyperparameters[3] = { opts.lengthscale, opts.vertical_lengthscale, opts.noise_variance };
+    gpxpy::GP gp(x, y, opts.n_tiles, n_tile_size, opts.lengthscale, opts.vertical_lengthscale, opts.noise_variance, opts.n_regressors, trainable);
+    gpxpy_hyper::Hyperparameters hpar(0.1, 0.9, 0.999, 1e-8, opts.opt_iter);
+
+    std::vector<timing> timings;
+    std::vector<check_result> checks;
+    std::vector<double> loss;
+    std::vector<double> mean;
+    std::vector<std::vector<double>> uncertainty;
+    std::vector<std::vector<double>> full_cov;
+    std::vector<double> losses;
+    tile_vector K_tiles;
+    tile_vector L_tiles;
+    tile_vector rhs_tiles;
+    const auto no_setup = []() { };
+
+    for (const std::string &operation : all_operations)
+    {
+        if (!selected(opts, operation))
+        {
+            continue;
+        }
+        std::cerr << "gpxpy_bench: " << operation << std::endl;
+        if (operation == "assembly")
+        {
+            timings.push_back(measure(
+                operation, opts, no_setup, [&]()
+                { K_tiles = hpx::run_as_hpx_thread([&]() { return assemble_covariance(x, opts.n_tiles, n_tile_size, opts.n_regressors, hyperparameters); }); }));
+        }
+        else if (operation == "cholesky")
+        {
+            timings.push_back(measure(
+                operation, opts, [&]()
+                { K_tiles = hpx::run_as_hpx_thread([&]() { return assemble_covariance(x, opts.n_tiles, n_tile_size, opts.n_regressors, hyperparameters); }); },
+                [&]()
+                {
+                    hpx::run_as_hpx_thread([&]()
+                                           {
+                                               cholesky_tiled(K_tiles, n_tile_size, opts.n_tiles);
+                                               wait_lower(K_tiles, opts.n_tiles);
+                                           });
+                }));
+        }
+        else if (operation == "solve")
+        {
+            // forward and backward solve for alpha with one factor
+            hpx::run_as_hpx_thread([&]()
+                                   {
+                                       L_tiles = assemble_covariance(x, opts.n_tiles, n_tile_size, opts.n_regressors, hyperparameters);
+                                       cholesky_tiled(L_tiles, n_tile_size, opts.n_tiles);
+                                       wait_lower(L_tiles, opts.n_tiles);
+                                   });
+            timings.push_back(measure(
+                operation, opts, [&]()
+                { rhs_tiles = hpx::run_as_hpx_thread([&]() { return assemble_output(y, opts.n_tiles, n_tile_size); }); },
+                [&]()
+                {
+                    hpx::run_as_hpx_thread([&]()
+                                           {
+                                               forward_solve_tiled(L_tiles, rhs_tiles, n_tile_size, opts.n_tiles);
+                                               backward_solve_tiled(L_tiles, rhs_tiles, n_tile_size, opts.n_tiles);
+                                               hpx::wait_all(rhs_tiles);
+                                           });
+                }));
+            L_tiles.clear();
+        }
+        else if (operation == "fit")
+        {
+            timings.push_back(measure(operation, opts, [&]() { gp.reset_fit(); }, [&]() { gp.fit(); }));
+        }
+        else if (operation == "predict")
+        {
+            gp.fit();
+            timings.push_back(measure(operation, opts, no_setup, [&]()
+                                      { mean = gp.predict(x_test, test_tiles.first, test_tiles.second); }));
+        }
+        else if (operation == "predict_with_uncertainty")
+        {
+            gp.fit();
+            timings.push_back(measure(operation, opts, no_setup, [&]()
+                                      { uncertainty = gp.predict_with_uncertainty(x_test, test_tiles.first, test_tiles.second); }));
+        }
+        else if (operation == "predict_with_full_cov")
+        {
+            gp.fit();
+            timings.push_back(measure(operation, opts, no_setup, [&]()
+                                      { full_cov = gp.predict_with_full_cov(x_test, test_tiles.first, test_tiles.second, CovarianceFormat::Lower); }));
+        }
+        else if (operation == "loss")
+        {
+            gp.fit();
+            timings.push_back(measure(operation, opts, no_setup, [&]()
+                                      { loss = { gp.calculate_loss() }; }));
+        }
+        else if (operation == "optimize")
+        {
+            // each run starts from the initial hyperparameters
+            std::unique_ptr<gpxpy::GP> fresh;
+            timings.push_back(measure(
+                operation, opts, [&]()
+                { fresh = std::make_unique<gpxpy::GP>(x, y, opts.n_tiles, n_tile_size, opts.lengthscale, opts.vertical_lengthscale, opts.noise_variance, opts.n_regressors, trainable); },
+                [&]() { losses = fresh->optimize(hpar); }));
+        }
+    }
+    K_tiles.clear();
+    rhs_tiles.clear();
+
+    bool passed = true;
+    if (opts.check)
+    {
+        std::cerr << "gpxpy_bench: dense reference" << std::endl;
+        const reference ref = compute_reference(x, y, x_test, opts);
+        if (!loss.empty())
+        {
+            checks.push_back(compare("loss", loss, { ref.loss }, opts.tolerance));
+        }
+        if (!mean.empty())
+        {
+            checks.push_back(compare("predict", mean, ref.mean, opts.tolerance));
+        }
+        if (!uncertainty.empty())
+        {
+            checks.push_back(compare("predict_with_uncertainty.mean", uncertainty[0], ref.mean, opts.tolerance));
+            checks.push_back(compare("predict_with_uncertainty.variance", uncertainty[1], ref.variance, opts.tolerance));
+        }
+        if (!full_cov.empty())
+        {
+            checks.push_back(compare("predict_with_full_cov.mean", full_cov[0], ref.mean, opts.tolerance));
+            checks.push_back(compare("predict_with_full_cov.variance", full_cov[1], ref.variance, opts.tolerance));
+            // diagonal of the packed lower triangle
+            std::vector<double> cov_diag(full_cov[1].size());
+            for (std::size_t i = 0; i < cov_diag.size(); i++)
+            {
+                cov_diag[i] = full_cov[2][i * (i + 1) / 2 + i];
+            }
+            checks.push_back(compare("predict_with_full_cov.covariance", cov_diag, ref.variance, opts.tolerance));
+        }
+        if (!losses.empty())
+        {
+            // the first optimizer loss is the loss at the initial hyperparameters
+            checks.push_back(compare("optimize.initial_loss", { losses.front() }, { ref.loss }, opts.tolerance));
+        }
+        for (const check_result &check : checks)
+        {
+            passed = passed && check.passed;
+            if (!check.passed)
+            {
+                std::cerr << "gpxpy_bench: check failed for " << check.output << ", relative error " << check.error << std::endl;
+            }
+        }
+    }
+
+    utils::stop_hpx_runtime();
+
+    std::ofstream file;
+    if (!opts.output.empty())
+    {
+        file.open(opts.output);
+        if (!file)
+        {
+            std::cerr << "gpxpy_bench: cannot write " << opts.output << std::endl;
+            return 2;
+        }
+    }
+    std::ostream &out = opts.output.empty() ? std::cout : file;
+    if (opts.format == "json")
+    {
+        write_json(out, opts, n_tile_size, test_tiles, timings, checks);
+    }
+    else
+    {
+        write_csv(out, opts, n_tile_size, timings, passed);
+    }
+    for (const timing &t : timings)
+    {
+        std::fprintf(stderr, "%-26s median %10.6f s  p10 %10.6f s  p90 %10.6f s\n", t.operation.c_str(), t.median, t.p10, t.p90);
+    }
+    return passed ? 0 : 1;
+}
@@ -1,15 +1,84 @@
 #include "../core/include/gp_functions.hpp"
 #include "../core/include/gpxpy_c.hpp"
+#include "../core/include/tiled_algorithms_cpu.hpp"
+#include "../core/include/utils_c.hpp"
+#include "numpy_buffers.hpp"
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 namespace py = pybind11;
 
 /**
- * @brief Adds classes `GP_data`, `Hyperparameters`, `GP` to Python module.
+ * @brief Wrap a Python callable taking the offset, mean and variance of a
+ * chunk as prediction sink. The sink holds the GIL while it calls back, the
+ * variance is None without uncertainty.
+ */
+gpxpy::prediction_sink python_sink(const py::function &callback)
+{
+    return [&callback](std::size_t offset, const std::vector<double> &mean, const std::vector<double> &variance)
+    {
+        py::gil_scoped_acquire acquire;
+        py::object var = variance.empty() ? py::none() : py::object(to_array(std::vector<double>(variance)));
+        callback(offset, to_array(std::vector<double>(mean)), var);
+    };
+}
+
+/**
+ * @brief Result of a computation scheduled on HPX, returned to Python by the
+ * `*_async` methods
+ */
+template <typename T>
+struct future_handle
+{
+    hpx::shared_future<T> future;
+};
+
+/**
+ * @brief Adds the handle class `name` of results of type T, which `convert`
+ * turns into a Python object, to Python module
+ */
+template <typename T, typename Convert>
+void bind_future_handle(py::module &m, const char *name, Convert convert)
+{
+    py::class_<future_handle<T>>(m, name)
+        .def("done",
+             [](const future_handle<T> &handle)
+             { return handle.future.is_ready(); },
+             "True once the result is computed, does not block")
+        .def("wait",
+             [](const future_handle<T> &handle)
+             { hpx::run_as_hpx_thread([&handle]()
+                                      { handle.future.wait(); }); },
+             py::call_guard<py::gil_scoped_release>(),
+             "Wait for the result")
+        .def("result",
+             [convert](const future_handle<T> &handle)
+             {
+                 T value;
+                 {
+                     py::gil_scoped_release release;
+                     hpx::run_as_hpx_thread([&handle, &value]()
+                                            { value = handle.future.get(); });
+                 }
+                 return convert(std::move(value));
+             },
+             "Wait for and return the result, raises the exception of a failed computation");
+}
+
+/**
+ * @brief Adds classes `GP_data`, `Hyperparameters`, `GP`, `SparseGP`,
+ * `BatchedGP` to Python module.
  */
 void init_gpxpy(py::module &m)
 {
+    // handles of the results of the asynchronous methods
+    bind_future_handle<std::vector<double>>(m, "FutureArray", [](std::vector<double> &&value)
+                                            { return to_array(std::move(value)); });
+    bind_future_handle<std::vector<std::vector<double>>>(m, "FutureArrays", [](std::vector<std::vector<double>> &&value)
+                                                         { return to_arrays(std::move(value)); });
+    bind_future_handle<double>(m, "FutureFloat", [](double value)
+                               { return value; });
+
     // set training data with `GP_data` class
     py::class_<gpxpy::GP_data>(
         m, "GP_data", "Class representing Gaussian Process data.")
@@ -28,8 +97,77 @@ void init_gpxpy(py::module &m)
                       "Number of samples in the GP data")
         .def_readonly(
             "file_path", &gpxpy::GP_data::file_path, "File path to the GP data")
-        .def_readonly(
-            "data", &gpxpy::GP_data::data, "Data in the GP data file");
+        .def_property_readonly(
+            "data",
+            [](py::object self)
+            { return view_array(self.cast<const gpxpy::GP_data &>().data, self); },
+            "Data in the GP data file as a read-only NumPy array without a copy");
+
+    // How the optimizer computes the trace terms of the gradient
+    py::enum_<gpxpy_hyper::TraceMode>(m, "TraceMode")
+        .value("Explicit", gpxpy_hyper::TraceMode::Explicit)
+        .value("Cholesky", gpxpy_hyper::TraceMode::Cholesky)
+        .value("Hutchinson", gpxpy_hyper::TraceMode::Hutchinson);
+
+    // Part of the posterior covariance returned by predict_with_full_cov
+    py::enum_<CovarianceFormat>(m, "CovarianceFormat")
+        .value("Diagonal", CovarianceFormat::Diagonal)
+        .value("Lower", CovarianceFormat::Lower)
+        .value("LowRank", CovarianceFormat::LowRank);
+
+    // Task graph of the tiled Cholesky decomposition
+    py::enum_<CholeskyVariant>(m, "CholeskyVariant")
+        .value("RightLooking", CholeskyVariant::RightLooking)
+        .value("Priority", CholeskyVariant::Priority)
+        .value("Lookahead", CholeskyVariant::Lookahead)
+        .value("LeftLooking", CholeskyVariant::LeftLooking);
+
+    m.def("set_cholesky_variant",
+          &set_cholesky_variant,
+          py::arg("variant"),
+          R"pbdoc(
+          Set the task graph of the tiled Cholesky decomposition.
+
+          Parameters:
+              variant (CholeskyVariant): RightLooking schedules all kernels
+                  with normal priority, Priority runs the panel kernels with
+                  high priority, Lookahead (default) additionally prioritizes
+                  the updates of the next panel, LeftLooking updates each
+                  column just before its factorization.
+          )pbdoc");
+    m.def("get_cholesky_variant",
+          &get_cholesky_variant,
+          "Returns the task graph of the tiled Cholesky decomposition");
+
+    // Device that fits a GP and computes its predictions
+    py::enum_<Backend>(m, "Backend")
+        .value("CPU", Backend::CPU)
+        .value("GPU", Backend::GPU);
+
+    m.def("gpu_backend_available",
+          &gpu_backend_available,
+          "Returns true if GPXPy was built with the GPU backend");
+
+    py::enum_<Precision>(m, "Precision")
+        .value("Double", Precision::Double)
+        .value("Mixed", Precision::Mixed);
+
+    // Solver of the linear systems with the covariance matrix of a GP
+    py::enum_<Solver>(m, "Solver")
+        .value("Cholesky", Solver::Cholesky)
+        .value("Iterative", Solver::Iterative);
+
+    // Covariance function of a GP
+    py::enum_<Kernel>(m, "Kernel")
+        .value("SquaredExponential", Kernel::SquaredExponential)
+        .value("Matern32", Kernel::Matern32)
+        .value("Matern52", Kernel::Matern52)
+        .value("RationalQuadratic", Kernel::RationalQuadratic);
+
+    // Method of GP::optimize
+    py::enum_<gpxpy_hyper::Optimizer>(m, "Optimizer")
+        .value("Adam", gpxpy_hyper::Optimizer::Adam)
+        .value("LBFGS", gpxpy_hyper::Optimizer::LBFGS);
 
     // Set hyperparameters to default values in `Hyperparameters` class, unless
     // specified. Python object has full access to each hyperparameter and a
@@ -41,14 +179,26 @@ void init_gpxpy(py::module &m)
                       double,
                       int,
                       std::vector<double>,
-                      std::vector<double>>(),
+                      std::vector<double>,
+                      gpxpy_hyper::TraceMode,
+                      int,
+                      unsigned,
+                      gpxpy_hyper::Optimizer,
+                      double,
+                      int>(),
              py::arg("learning_rate") = 0.001,
              py::arg("beta1") = 0.9,
              py::arg("beta2") = 0.999,
              py::arg("epsilon") = 1e-8,
              py::arg("opt_iter") = 0,
              py::arg("m_T") = std::vector<double>{ 0.0, 0.0, 0.0 },
-             py::arg("v_T") = std::vector<double>{ 0.0, 0.0, 0.0 })
+             py::arg("v_T") = std::vector<double>{ 0.0, 0.0, 0.0 },
+             py::arg("trace_mode") = gpxpy_hyper::TraceMode::Explicit,
+             py::arg("n_probes") = 32,
+             py::arg("seed") = 0,
+             py::arg("optimizer") = gpxpy_hyper::Optimizer::Adam,
+             py::arg("tolerance") = 1e-6,
+             py::arg("history") = 10)
         .def_readwrite("learning_rate",
                        &gpxpy_hyper::Hyperparameters::learning_rate)
         .def_readwrite("beta1", &gpxpy_hyper::Hyperparameters::beta1)
@@ -57,9 +207,44 @@ void init_gpxpy(py::module &m)
         .def_readwrite("opt_iter", &gpxpy_hyper::Hyperparameters::opt_iter)
         .def_readwrite("m_T", &gpxpy_hyper::Hyperparameters::M_T)
         .def_readwrite("v_T", &gpxpy_hyper::Hyperparameters::V_T)
+        .def_readwrite("trace_mode", &gpxpy_hyper::Hyperparameters::trace_mode)
+        .def_readwrite("n_probes", &gpxpy_hyper::Hyperparameters::n_probes)
+        .def_readwrite("seed", &gpxpy_hyper::Hyperparameters::seed)
+        .def_readwrite("optimizer", &gpxpy_hyper::Hyperparameters::optimizer)
+        .def_readwrite("tolerance", &gpxpy_hyper::Hyperparameters::tolerance)
+        .def_readwrite("history", &gpxpy_hyper::Hyperparameters::history)
         .def("__repr__", &gpxpy_hyper::Hyperparameters::repr);
     ;
 
+    // Settings of Solver::Iterative, defaults unless specified
+    py::class_<iterative_settings>(m, "IterativeSettings")
+        .def(py::init([](int max_iter, double tolerance, int preconditioner_rank, int n_probes, unsigned seed)
+                      { return iterative_settings{ max_iter, tolerance, preconditioner_rank, n_probes, seed }; }),
+             py::arg("max_iter") = 1000,
+             py::arg("tolerance") = 1e-6,
+             py::arg("preconditioner_rank") = 15,
+             py::arg("n_probes") = 16,
+             py::arg("seed") = 0,
+             R"pbdoc(
+             Settings of the preconditioned conjugate gradients of
+             Solver.Iterative.
+
+             Parameters:
+                 max_iter (int): maximum number of iterations.
+                 tolerance (float): relative residual at which the iterations
+                     of a right-hand side stop.
+                 preconditioner_rank (int): rank of the pivoted Cholesky
+                     preconditioner, 0 for the noise variance only.
+                 n_probes (int): probe vectors of the log-determinant
+                     estimate of the loss.
+                 seed (int): seed of the probe vectors.
+             )pbdoc")
+        .def_readwrite("max_iter", &iterative_settings::max_iter)
+        .def_readwrite("tolerance", &iterative_settings::tolerance)
+        .def_readwrite("preconditioner_rank", &iterative_settings::preconditioner_rank)
+        .def_readwrite("n_probes", &iterative_settings::n_probes)
+        .def_readwrite("seed", &iterative_settings::seed);
+
     // Initializes Gaussian Process with `GP` class. Sets default parameters for
     // squared exponential kernel, number of regressors and trainable, unless
     // specified. Instance object has full access to parameters for squared
@@ -67,33 +252,61 @@ void init_gpxpy(py::module &m)
     // functions.
     // GPU support is disabled by default and may only be enabled on
     // initialization.
+    // Placement of the covariance tiles on the HPX localities
+    py::class_<distribution_policy>(m, "DistributionPolicy")
+        .def(py::init<std::size_t, std::size_t>(),
+             py::arg("grid_rows") = 1,
+             py::arg("grid_cols") = 1,
+             R"pbdoc(
+             Distribute the covariance tiles 2D block-cyclically over a
+             grid_rows x grid_cols grid of HPX localities.
+
+             Parameters:
+                 grid_rows (int): Number of rows of the process grid.
+                 grid_cols (int): Number of columns of the process grid.
+             )pbdoc")
+        .def_readwrite("grid_rows", &distribution_policy::grid_rows)
+        .def_readwrite("grid_cols", &distribution_policy::grid_cols)
+        .def("is_distributed", &distribution_policy::is_distributed)
+        .def("__repr__",
+             [](const distribution_policy &policy)
+             {
+                 return "DistributionPolicy(grid_rows=" + std::to_string(policy.grid_rows) + ", grid_cols=" + std::to_string(policy.grid_cols) + ")";
+             });
+
     py::class_<gpxpy::GP>(m, "GP")
-        .def(py::init<std::vector<double>,
-                      std::vector<double>,
-                      int,
-                      int,
-                      double,
-                      double,
-                      double,
-                      int,
-                      std::vector<bool>>(),
+        .def(py::init([](const input_array &input,
+                         const input_array &output,
+                         int n_tiles,
+                         int n_tile_size,
+                         double l,
+                         double v,
+                         double n,
+                         int n_reg,
+                         std::vector<bool> trainable,
+                         distribution_policy policy)
+                      { return std::make_unique<gpxpy::GP>(to_vector(input), to_vector(output), n_tiles, n_tile_size, l, v, n, n_reg, trainable, policy); }),
              py::arg("input_data"),
              py::arg("output_data"),
-             py::arg("n_tiles"),
-             py::arg("n_tile_size"),
+             py::arg("n_tiles") = 0,
+             py::arg("n_tile_size") = 0,
              py::arg("lengthscale") = 1.0,
              py::arg("v_lengthscale") = 1.0,
              py::arg("noise_var") = 0.1,
              py::arg("n_reg") = 100,
              py::arg("trainable") = std::vector<bool>{ true, true, true },
+             py::arg("policy") = distribution_policy(),
              R"pbdoc(
 Create Gaussian Process including its data, hyperparameters.
 
 Parameters:
-    input_data (list): Input data for the GP.
-    output_data (list): Output data for the GP.
-    n_tiles (int): Number of tiles to split the input data.
-    n_tile_size (int): Size of each tile.
+    input_data (numpy.ndarray): Input data for the GP, any one-dimensional
+        buffer or sequence of floats.
+    output_data (numpy.ndarray): Output data for the GP.
+    n_tiles (int): Number of tiles to split the input data. Default is 0,
+        which picks the tiling with the tile tuner if n_tile_size is 0 too
+        and computes it from n_tile_size otherwise.
+    n_tile_size (int): Size of each tile. Default is 0, see n_tiles.
     lengthscale (float): Lengthscale hyperparameter for the squared exponential
         kernel. Default is 1.
     v_lengthscale (float): Vertical lengthscale for the squared exponential
@@ -103,33 +316,655 @@ Parameters:
     n_reg (int): Number of regressors. Default is 100.
     trainable (list): List of booleans for trainable hyperparameters. Default is
         {true, true, true}.
+    policy (DistributionPolicy): Distribution of the covariance tiles over the
+        HPX localities. A distributed GP supports fit, predict, calculate_loss
+        and cholesky, called on the root locality. Default keeps all tiles on
+        the calling locality.
+             )pbdoc")
+        .def(py::init([](const gpxpy::GP_data &input,
+                         const gpxpy::GP_data &output,
+                         int n_tiles,
+                         int n_tile_size,
+                         double l,
+                         double v,
+                         double n,
+                         int n_reg,
+                         std::vector<bool> trainable,
+                         distribution_policy policy)
+                      { return std::make_unique<gpxpy::GP>(input.data, output.data, n_tiles, n_tile_size, l, v, n, n_reg, trainable, policy); }),
+             py::arg("input_data"),
+             py::arg("output_data"),
+             py::arg("n_tiles") = 0,
+             py::arg("n_tile_size") = 0,
+             py::arg("lengthscale") = 1.0,
+             py::arg("v_lengthscale") = 1.0,
+             py::arg("noise_var") = 0.1,
+             py::arg("n_reg") = 100,
+             py::arg("trainable") = std::vector<bool>{ true, true, true },
+             py::arg("policy") = distribution_policy(),
+             R"pbdoc(
+Create Gaussian Process from loaded GP_data, copying the samples in C++.
+
+Parameters are the same as above with GP_data for input_data and output_data.
+             )pbdoc")
+        .def_static(
+            "load",
+            [](const std::string &file_path)
+            {
+                py::gil_scoped_release release;
+                return std::make_unique<gpxpy::GP>(file_path);
+            },
+            py::arg("file_path"),
+            R"pbdoc(
+Load a Gaussian Process from a snapshot file written by save.
+
+If the snapshot holds the Cholesky factor, its tiles are memory-mapped from
+the file and the GP predicts without refitting. The loaded GP is local, on
+the CPU and in double precision.
+            )pbdoc")
+        .def("save",
+             &gpxpy::GP::save,
+             py::arg("file_path"),
+             py::arg("include_factor") = true,
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+Write a snapshot of the GP: hyperparameters, tiling, training data and, with
+include_factor, the Cholesky factor and alpha in their tile layout.
+
+Parameters:
+    file_path (str): Path to the snapshot file, overwritten if it exists.
+    include_factor (bool): Also store the factor, fitting the GP first unless
+        it is cached. Requires a local GP on the CPU in double precision.
+        Default is True.
              )pbdoc")
         .def_readwrite("lengthscale", &gpxpy::GP::lengthscale)
         .def_readwrite("v_lengthscale", &gpxpy::GP::vertical_lengthscale)
         .def_readwrite("noise_var", &gpxpy::GP::noise_variance)
         .def_readwrite("n_reg", &gpxpy::GP::n_regressors)
         .def("__repr__", &gpxpy::GP::repr)
-        .def("get_input_data", &gpxpy::GP::get_training_input)
-        .def("get_output_data", &gpxpy::GP::get_training_output)
+        .def_property_readonly("n_tiles", &gpxpy::GP::n_tiles, "Number of training tiles")
+        .def_property_readonly("n_tile_size", &gpxpy::GP::n_tile_size, "Size of the training tiles")
+        .def("test_tiles",
+             &gpxpy::GP::test_tiles,
+             py::arg("m_samples"),
+             R"pbdoc(
+Number and size of the test tiles for m_samples test samples, with the test
+tile size picked by the tile tuner.
+
+Returns:
+    tuple: m_tiles and m_tile_size for predict.
+             )pbdoc")
+        .def_property_readonly("policy", &gpxpy::GP::policy)
+        .def("get_input_data",
+             [](const gpxpy::GP &gp)
+             { return to_array(gp.get_training_input()); })
+        .def("get_output_data",
+             [](const gpxpy::GP &gp)
+             { return to_array(gp.get_training_output()); })
+        .def("fit",
+             &gpxpy::GP::fit,
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+Compute and cache the Cholesky factor and alpha used by the predictions.
+
+The cache is reused until lengthscale, v_lengthscale or noise_var change.
+Calling this is optional, it is done on the first prediction otherwise.
+             )pbdoc")
+        .def("set_backend",
+             &gpxpy::GP::set_backend,
+             py::arg("backend"),
+             R"pbdoc(
+Select the device that fits the GP and computes predict,
+predict_with_uncertainty and compute_loss. Drops the cached factor if the
+backend changes.
+
+On the GPU the covariance tiles, the Cholesky factor and alpha stay in device
+memory between fit and the predictions. The optimizer always runs on the CPU,
+predict_with_full_cov is not supported on the GPU.
+
+Parameters:
+    backend (Backend): CPU (default) or GPU, which requires a build with
+        GPXPY_WITH_CUDA and a GP that is not distributed.
+             )pbdoc")
+        .def("backend", &gpxpy::GP::backend)
+        .def("set_precision",
+             &gpxpy::GP::set_precision,
+             py::arg("precision"),
+             py::arg("refinement_steps") = 2,
+             R"pbdoc(
+Select the precision of the Cholesky factor used by predict,
+predict_with_uncertainty and compute_loss. Drops the cached factor if the
+precision changes.
+
+Mixed factors the covariance matrix in single precision and refines alpha in
+double precision, see refinement_residuals for its accuracy. The optimizer
+always works in double precision, predict_with_full_cov is not supported in
+mixed precision.
+
+Parameters:
+    precision (Precision): Double (default) or Mixed, which requires the CPU
+        backend and a GP that is not distributed.
+    refinement_steps (int): steps of iterative refinement after the first
+        single precision solve.
+             )pbdoc")
+        .def("precision", &gpxpy::GP::precision)
+        .def("set_kernel",
+             &gpxpy::GP::set_kernel,
+             py::arg("kernel"),
+             py::arg("shape") = 1.0,
+             R"pbdoc(
+Select the covariance function. Drops the cached factor if the kernel changes.
+
+Parameters:
+    kernel (Kernel): SquaredExponential (default), Matern32, Matern52 or
+        RationalQuadratic. Kernels other than SquaredExponential require the
+        CPU backend and a GP that is not distributed.
+    shape (float): shape alpha of the rational quadratic kernel, positive and
+        not optimized. Ignored by the other kernels.
+             )pbdoc")
+        .def("kernel", &gpxpy::GP::kernel)
+        .def("kernel_shape", &gpxpy::GP::kernel_shape)
+        .def("refinement_residuals",
+             &gpxpy::GP::refinement_residuals,
+             py::call_guard<py::gil_scoped_release>(),
+             "Relative residuals ||y - K alpha|| / ||y|| of the mixed precision "
+             "fit after the first solve and each refinement step")
+        .def("set_solver",
+             &gpxpy::GP::set_solver,
+             py::arg("solver"),
+             py::arg("settings") = iterative_settings(),
+             R"pbdoc(
+Select the solver used by predict and compute_loss. Drops the cached factor.
+
+Iterative solves K alpha = y by conjugate gradients preconditioned with a
+pivoted Cholesky factor and estimates the log-determinant of the loss by
+stochastic Lanczos quadrature. The covariance tiles are generated on the fly
+and never stored, alpha and the loss are approximate, see
+iterative_residuals. It supports neither predict_with_uncertainty,
+predict_with_full_cov nor cholesky, the optimizer always uses the Cholesky
+factor.
+
+Parameters:
+    solver (Solver): Cholesky (default) or Iterative, which requires the CPU
+        backend in double precision, a positive noise variance and a GP that
+        is not distributed.
+    settings (IterativeSettings): iterations, preconditioner and probes of
+        Iterative.
+             )pbdoc")
+        .def("solver", &gpxpy::GP::solver)
+        .def("iterative_residuals",
+             &gpxpy::GP::iterative_residuals,
+             py::call_guard<py::gil_scoped_release>(),
+             "Relative residuals ||y - K alpha|| / ||y|| after each conjugate "
+             "gradient iteration of Solver.Iterative")
+        .def("is_fitted", &gpxpy::GP::is_fitted)
+        .def("reset_fit", &gpxpy::GP::reset_fit)
+        .def(
+            "append",
+            [](gpxpy::GP &gp, const input_array &new_input, const input_array &new_output, int max_tiles)
+            {
+                const std::vector<double> input = to_vector(new_input);
+                const std::vector<double> output = to_vector(new_output);
+                py::gil_scoped_release release;
+                gp.append(input, output, max_tiles);
+            },
+            py::arg("new_input"),
+            py::arg("new_output"),
+            py::arg("max_tiles") = 0,
+            R"pbdoc(
+Append new observations to the training data.
+
+A cached factor of the CPU backend in double precision is extended by the new
+tile rows instead of refactored, in O(n^2 k) for k new samples. Other GPs are
+refitted on their next use.
+
+Parameters:
+    new_input (numpy.ndarray): Input data of the new samples, following the
+        training input in time.
+    new_output (numpy.ndarray): Output data of the new samples.
+    max_tiles (int): Sliding window of at most this many training tiles, the
+        oldest tiles are dropped and the cached factor updated. Default is 0,
+        which keeps all samples.
+            )pbdoc")
         .def("predict",
-             &gpxpy::GP::predict,
+             [](gpxpy::GP &gp, const input_array &test_data, int m_tiles, int m_tile_size)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 std::vector<double> prediction;
+                 {
+                     py::gil_scoped_release release;
+                     prediction = gp.predict(test_input, m_tiles, m_tile_size);
+                 }
+                 return to_array(std::move(prediction));
+             },
              py::arg("test_data"),
              py::arg("m_tiles"),
-             py::arg("m_tile_size"))
+             py::arg("m_tile_size"),
+             "Predictions for the test data as a NumPy array")
         .def("predict_with_uncertainty",
-             &gpxpy::GP::predict_with_uncertainty,
+             [](gpxpy::GP &gp, const input_array &test_data, int m_tiles, int m_tile_size)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 std::vector<std::vector<double>> result;
+                 {
+                     py::gil_scoped_release release;
+                     result = gp.predict_with_uncertainty(test_input, m_tiles, m_tile_size);
+                 }
+                 return to_arrays(std::move(result));
+             },
+             py::arg("test_data"),
+             py::arg("m_tiles"),
+             py::arg("m_tile_size"),
+             "Tuple of NumPy arrays with the predictions and their variances")
+        .def("predict_async",
+             [](gpxpy::GP &gp, const input_array &test_data, int m_tiles, int m_tile_size)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 py::gil_scoped_release release;
+                 return future_handle<std::vector<double>>{ gp.predict_async(test_input, m_tiles, m_tile_size) };
+             },
              py::arg("test_data"),
              py::arg("m_tiles"),
-             py::arg("m_tile_size"))
+             py::arg("m_tile_size"),
+             py::keep_alive<0, 1>(),
+             R"pbdoc(
+Schedule the prediction of the test data without waiting for it.
+
+Fits the GP first unless the factor is cached. Predictions scheduled one after
+another, also of different GPs, run concurrently. Do not optimize or append
+to the GP before the result is done.
+
+Returns:
+    FutureArray: handle of the predictions, see done() and result().
+             )pbdoc")
+        .def("predict_with_uncertainty_async",
+             [](gpxpy::GP &gp, const input_array &test_data, int m_tiles, int m_tile_size)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 py::gil_scoped_release release;
+                 return future_handle<std::vector<std::vector<double>>>{ gp.predict_with_uncertainty_async(test_input, m_tiles, m_tile_size) };
+             },
+             py::arg("test_data"),
+             py::arg("m_tiles"),
+             py::arg("m_tile_size"),
+             py::keep_alive<0, 1>(),
+             "FutureArrays handle of the predictions and their variances, see predict_async")
+        .def(
+            "predict_stream",
+            [](gpxpy::GP &gp, const py::iterable &chunks, const py::function &callback, bool uncertainty, int m_tile_size, int max_in_flight)
+            {
+                py::iterator it = py::iter(chunks);
+                const gpxpy::chunk_source source = [&it]()
+                {
+                    py::gil_scoped_acquire acquire;
+                    for (; it != py::iterator::sentinel(); ++it)
+                    {
+                        std::vector<double> chunk = to_vector(py::cast<input_array>(*it));
+                        if (!chunk.empty())
+                        {
+                            ++it;
+                            return chunk;
+                        }
+                    }
+                    return std::vector<double>();
+                };
+                py::gil_scoped_release release;
+                gp.predict_stream(source, python_sink(callback), uncertainty, m_tile_size, max_in_flight);
+            },
+            py::arg("chunks"),
+            py::arg("callback"),
+            py::arg("uncertainty") = true,
+            py::arg("m_tile_size") = 0,
+            py::arg("max_in_flight") = 2,
+            R"pbdoc(
+Predict a stream of test input chunk by chunk with the cached factor.
+
+Only the cross-covariance of the chunks in flight is held in memory, the next
+chunks are solved while the callback processes the current one. Chunks may
+differ in size, the predictions equal those for the concatenated chunks.
+
+Parameters:
+    chunks (iterable): NumPy arrays with consecutive chunks of the test input.
+    callback (callable): called as callback(offset, mean, variance) for each
+        chunk in order, offset is the index of its first sample in the stream
+        and variance is None without uncertainty.
+    uncertainty (bool): also compute the variance. Default is True.
+    m_tile_size (int): size of the test tiles, 0 for the tuned size.
+    max_in_flight (int): number of chunks scheduled ahead of the callback.
+            )pbdoc")
+        .def(
+            "predict_chunked",
+            [](gpxpy::GP &gp, const input_array &test_data, std::size_t chunk_size, const py::function &callback, bool uncertainty, int m_tile_size, int max_in_flight)
+            {
+                const std::vector<double> test_input = to_vector(test_data);
+                py::gil_scoped_release release;
+                gp.predict_chunked(test_input, chunk_size, python_sink(callback), uncertainty, m_tile_size, max_in_flight);
+            },
+            py::arg("test_data"),
+            py::arg("chunk_size"),
+            py::arg("callback"),
+            py::arg("uncertainty") = true,
+            py::arg("m_tile_size") = 0,
+            py::arg("max_in_flight") = 2,
+            "Predict the test data in chunks of chunk_size samples, see predict_stream")
         .def("predict_with_full_cov",
-             &gpxpy::GP::predict_with_full_cov,
+             [](gpxpy::GP &gp, const input_array &test_data, int m_tiles, int m_tile_size, CovarianceFormat format)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 std::vector<std::vector<double>> result;
+                 {
+                     py::gil_scoped_release release;
+                     result = gp.predict_with_full_cov(test_input, m_tiles, m_tile_size, format);
+                 }
+                 if (format != CovarianceFormat::LowRank)
+                 {
+                     return to_arrays(std::move(result));
+                 }
+                 // V as training size x M array
+                 py::array_t<double> V = to_matrix(std::move(result[3]), test_input.size());
+                 result.pop_back();
+                 py::tuple arrays = to_arrays(std::move(result));
+                 return py::make_tuple(arrays[0], arrays[1], arrays[2], V);
+             },
              py::arg("test_data"),
              py::arg("m_tiles"),
-             py::arg("m_tile_size"))
-        .def("optimize", &gpxpy::GP::optimize, py::arg("hyperparams"))
+             py::arg("m_tile_size"),
+             py::arg("format") = CovarianceFormat::Diagonal,
+             R"pbdoc(
+Predict the test data with the posterior covariance in `format`. The dense
+M x M covariance is never formed.
+
+Parameters:
+    test_data (array): test input.
+    m_tiles (int): number of test tiles.
+    m_tile_size (int): size of the test tiles.
+    format (CovarianceFormat): Diagonal (default) returns the predictions and
+        their variances. Lower also returns the lower triangle of the
+        posterior covariance packed row by row, element (i, j) with j <= i at
+        i * (i + 1) / 2 + j. LowRank instead returns the packed lower triangle
+        of the prior covariance K and the training size x M array V with
+        covariance K - V^T V.
+
+Returns:
+    Tuple of NumPy arrays (mean, variance[, covariance | K, V]).
+             )pbdoc")
+        .def("optimize",
+             &gpxpy::GP::optimize,
+             py::arg("hyperparams"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("optimize_async",
+             [](gpxpy::GP &gp, const gpxpy_hyper::Hyperparameters &hyperparams)
+             { return future_handle<std::vector<double>>{ gp.optimize_async(hyperparams) }; },
+             py::arg("hyperparams"),
+             py::keep_alive<0, 1>(),
+             py::call_guard<py::gil_scoped_release>(),
+             "Run the optimizer in the background, returns a FutureArray handle of the losses. "
+             "Do not use the GP before the result is done.")
         .def("optimize_step",
              &gpxpy::GP::optimize_step,
              py::arg("hyperparams"),
-             py::arg("iter"))
-        .def("compute_loss", &gpxpy::GP::calculate_loss);
+             py::arg("iter"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("set_distance_cache_budget",
+             &gpxpy::GP::set_distance_cache_budget,
+             py::arg("bytes"),
+             R"pbdoc(
+Set the memory budget of the distance tile cache in bytes.
+
+The optimizer keeps the squared distance tiles of the training input that fit
+into the budget across optimize and optimize_step calls and recomputes the
+others on every iteration. A budget of 0 recomputes all of them.
+             )pbdoc")
+        .def("distance_cache_budget", &gpxpy::GP::distance_cache_budget)
+        .def("clear_distance_cache", &gpxpy::GP::clear_distance_cache)
+        .def("compute_loss",
+             &gpxpy::GP::calculate_loss,
+             py::call_guard<py::gil_scoped_release>())
+        .def("compute_loss_async",
+             [](gpxpy::GP &gp)
+             { return future_handle<double>{ gp.calculate_loss_async() }; },
+             py::keep_alive<0, 1>(),
+             py::call_guard<py::gil_scoped_release>(),
+             "FutureFloat handle of the loss, see predict_async");
+
+    // Optimizer session that keeps tiles and Adam state between steps. The
+    // session refers to the GP, which is kept alive as long as the session.
+    py::class_<gpxpy::OptimizerSession>(m, "OptimizerSession")
+        .def(py::init<gpxpy::GP &, const gpxpy_hyper::Hyperparameters &>(),
+             py::arg("gp"),
+             py::arg("hyperparams"),
+             py::keep_alive<1, 2>(),
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+Start an optimizer session at the current hyperparameters of a GP.
+
+Each step updates the hyperparameters of the GP and returns the loss. The
+assembly of the next step is scheduled before a step returns and overlaps with
+the caller processing the loss.
+
+Parameters:
+    gp (GP): Gaussian process to optimize.
+    hyperparams (Hyperparameters): Optimizer settings, m_T and v_T are the
+        initial moments.
+             )pbdoc")
+        .def("step",
+             &gpxpy::OptimizerSession::step,
+             py::call_guard<py::gil_scoped_release>())
+        .def("iteration", &gpxpy::OptimizerSession::iteration)
+        .def("hyperparameters", &gpxpy::OptimizerSession::hyperparameters);
+
+    // Sparse GP with inducing points
+    py::class_<gpxpy::SparseGP>(m, "SparseGP")
+        .def(py::init([](const input_array &input,
+                         const input_array &output,
+                         const input_array &inducing_input,
+                         int n_tiles,
+                         int n_tile_size,
+                         double l,
+                         double v,
+                         double n,
+                         int n_reg,
+                         std::vector<bool> trainable)
+                      { return std::make_unique<gpxpy::SparseGP>(to_vector(input), to_vector(output), to_vector(inducing_input), n_tiles, n_tile_size, l, v, n, n_reg, trainable); }),
+             py::arg("input_data"),
+             py::arg("output_data"),
+             py::arg("inducing_data"),
+             py::arg("n_tiles"),
+             py::arg("n_tile_size"),
+             py::arg("lengthscale") = 1.0,
+             py::arg("v_lengthscale") = 1.0,
+             py::arg("noise_var") = 0.1,
+             py::arg("n_reg") = 100,
+             py::arg("trainable") = std::vector<bool>{ true, true, true },
+             R"pbdoc(
+Create a sparse Gaussian Process with inducing points.
+
+Fit, loss, optimizer and predictions take O(N m^2) time and O(N m) memory for
+N training samples and m inducing points. The predictions are those of the
+deterministic training conditional, the loss is the variational free energy.
+
+Parameters:
+    input_data (numpy.ndarray): Input data for the GP.
+    output_data (numpy.ndarray): Output data for the GP.
+    inducing_data (numpy.ndarray): Input series whose lagged feature vectors
+        are the inducing points, for example a subsample of input_data.
+    n_tiles (int): Number of tiles to split the input data.
+    n_tile_size (int): Size of each tile.
+    lengthscale (float): Lengthscale hyperparameter for the squared exponential
+        kernel. Default is 1.
+    v_lengthscale (float): Vertical lengthscale for the squared exponential
+        kernel. Default is 1.
+    noise_var (float): Noise variance for the squared exponential kernel.
+        Default is 0.1.
+    n_reg (int): Number of regressors. Default is 100.
+    trainable (list): List of booleans for trainable hyperparameters. Default is
+        {true, true, true}.
+             )pbdoc")
+        .def_readwrite("lengthscale", &gpxpy::SparseGP::lengthscale)
+        .def_readwrite("v_lengthscale", &gpxpy::SparseGP::vertical_lengthscale)
+        .def_readwrite("noise_var", &gpxpy::SparseGP::noise_variance)
+        .def_readwrite("n_reg", &gpxpy::SparseGP::n_regressors)
+        .def_readwrite("jitter", &gpxpy::SparseGP::jitter, "Added to the diagonal of the inducing covariance matrix")
+        .def("__repr__", &gpxpy::SparseGP::repr)
+        .def("get_input_data",
+             [](const gpxpy::SparseGP &gp)
+             { return to_array(gp.get_training_input()); })
+        .def("get_output_data",
+             [](const gpxpy::SparseGP &gp)
+             { return to_array(gp.get_training_output()); })
+        .def("get_inducing_data",
+             [](const gpxpy::SparseGP &gp)
+             { return to_array(gp.get_inducing_input()); })
+        .def("fit",
+             &gpxpy::SparseGP::fit,
+             py::call_guard<py::gil_scoped_release>(),
+             "Compute and cache the factorization used by the predictions and the loss")
+        .def("is_fitted", &gpxpy::SparseGP::is_fitted)
+        .def("predict",
+             [](gpxpy::SparseGP &gp, const input_array &test_data, int m_tiles, int m_tile_size)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 std::vector<double> prediction;
+                 {
+                     py::gil_scoped_release release;
+                     prediction = gp.predict(test_input, m_tiles, m_tile_size);
+                 }
+                 return to_array(std::move(prediction));
+             },
+             py::arg("test_data"),
+             py::arg("m_tiles"),
+             py::arg("m_tile_size"),
+             "Predictions for the test data as a NumPy array")
+        .def("predict_with_uncertainty",
+             [](gpxpy::SparseGP &gp, const input_array &test_data, int m_tiles, int m_tile_size)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 std::vector<std::vector<double>> result;
+                 {
+                     py::gil_scoped_release release;
+                     result = gp.predict_with_uncertainty(test_input, m_tiles, m_tile_size);
+                 }
+                 return to_arrays(std::move(result));
+             },
+             py::arg("test_data"),
+             py::arg("m_tiles"),
+             py::arg("m_tile_size"),
+             "Tuple of NumPy arrays with the predictions and their variances")
+        .def("optimize",
+             &gpxpy::SparseGP::optimize,
+             py::arg("hyperparams"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("compute_loss",
+             &gpxpy::SparseGP::calculate_loss,
+             py::call_guard<py::gil_scoped_release>());
+
+    // Batch of GPs sharing the training input
+    py::class_<gpxpy::BatchedGP>(m, "BatchedGP")
+        .def(py::init([](const input_array &input,
+                         const std::vector<input_array> &outputs,
+                         int n_tiles,
+                         int n_tile_size,
+                         const std::vector<std::array<double, 3>> &hyperparameter_sets,
+                         int n_reg,
+                         std::vector<bool> trainable)
+                      {
+                          std::vector<std::vector<double>> training_outputs;
+                          training_outputs.reserve(outputs.size());
+                          for (const input_array &output : outputs)
+                          {
+                              training_outputs.push_back(to_vector(output));
+                          }
+                          return std::make_unique<gpxpy::BatchedGP>(to_vector(input), std::move(training_outputs), n_tiles, n_tile_size, hyperparameter_sets, n_reg, trainable);
+                      }),
+             py::arg("input_data"),
+             py::arg("output_data"),
+             py::arg("n_tiles"),
+             py::arg("n_tile_size"),
+             py::arg("hyperparameters") = std::vector<std::array<double, 3>>{ { 1.0, 1.0, 0.1 } },
+             py::arg("n_reg") = 100,
+             py::arg("trainable") = std::vector<bool>{ true, true, true },
+             R"pbdoc(
+Create a batch of Gaussian Processes on the same training input.
+
+The batch has one member per hyperparameter set and output: member
+h * n_outputs() + o uses hyperparameter set h and output o. The squared
+distances of the training input are computed once for all members, members
+with the same hyperparameters share their Cholesky factor.
+
+Parameters:
+    input_data (numpy.ndarray): Input data for the GPs.
+    output_data (list): Output data, one numpy.ndarray per output.
+    n_tiles (int): Number of tiles to split the input data.
+    n_tile_size (int): Size of each tile.
+    hyperparameters (list): Tuples of lengthscale, vertical lengthscale and
+        noise variance, one per hyperparameter set. Default is [(1, 1, 0.1)].
+    n_reg (int): Number of regressors. Default is 100.
+    trainable (list): List of booleans for trainable hyperparameters. Default is
+        {true, true, true}.
+             )pbdoc")
+        .def_readwrite("hyperparameters", &gpxpy::BatchedGP::hyperparameters, "Lengthscale, vertical lengthscale and noise variance of each member")
+        .def_readwrite("n_reg", &gpxpy::BatchedGP::n_regressors)
+        .def("__repr__", &gpxpy::BatchedGP::repr)
+        .def("n_outputs", &gpxpy::BatchedGP::n_outputs)
+        .def("n_members", &gpxpy::BatchedGP::n_members)
+        .def("member_output", &gpxpy::BatchedGP::member_output, py::arg("member"))
+        .def("get_input_data",
+             [](const gpxpy::BatchedGP &gp)
+             { return to_array(gp.get_training_input()); })
+        .def("get_output_data",
+             [](const gpxpy::BatchedGP &gp)
+             { return to_arrays(gp.get_training_outputs()); })
+        .def("fit",
+             &gpxpy::BatchedGP::fit,
+             py::call_guard<py::gil_scoped_release>(),
+             "Compute and cache the factors used by the predictions and the losses")
+        .def("is_fitted", &gpxpy::BatchedGP::is_fitted)
+        .def("predict",
+             [](gpxpy::BatchedGP &gp, const input_array &test_data, int m_tiles, int m_tile_size)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 std::vector<std::vector<double>> predictions;
+                 {
+                     py::gil_scoped_release release;
+                     predictions = gp.predict(test_input, m_tiles, m_tile_size);
+                 }
+                 return to_arrays(std::move(predictions));
+             },
+             py::arg("test_data"),
+             py::arg("m_tiles"),
+             py::arg("m_tile_size"),
+             "Tuple of NumPy arrays with the predictions of each member")
+        .def("predict_with_uncertainty",
+             [](gpxpy::BatchedGP &gp, const input_array &test_data, int m_tiles, int m_tile_size)
+             {
+                 const std::vector<double> test_input = to_vector(test_data);
+                 std::vector<std::vector<std::vector<double>>> results;
+                 {
+                     py::gil_scoped_release release;
+                     results = gp.predict_with_uncertainty(test_input, m_tiles, m_tile_size);
+                 }
+                 py::tuple members(results.size());
+                 for (std::size_t i = 0; i < results.size(); i++)
+                 {
+                     members[i] = to_arrays(std::move(results[i]));
+                 }
+                 return members;
+             },
+             py::arg("test_data"),
+             py::arg("m_tiles"),
+             py::arg("m_tile_size"),
+             "Tuple with the predictions and their variances of each member")
+        .def("optimize",
+             &gpxpy::BatchedGP::optimize,
+             py::arg("hyperparams"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Optimize the hyperparameters of all members, returns the losses of each member")
+        .def("compute_loss",
+             &gpxpy::BatchedGP::calculate_loss,
+             py::call_guard<py::gil_scoped_release>())
+        .def("set_distance_cache_budget",
+             &gpxpy::BatchedGP::set_distance_cache_budget,
+             py::arg("bytes"))
+        .def("distance_cache_budget", &gpxpy::BatchedGP::distance_cache_budget)
+        .def("clear_distance_cache", &gpxpy::BatchedGP::clear_distance_cache);
 }
@@ -0,0 +1,92 @@
+#ifndef NUMPY_BUFFERS_H
+#define NUMPY_BUFFERS_H
+
+#include <memory>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+/**
+ * @brief Array of doubles accepted from Python.
+ *
+ * Contiguous float64 NumPy arrays and other objects with the buffer protocol
+ * are passed through as is, anything else, e.g. a list, is converted once.
+ */
+using input_array = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+/**
+ * @brief Copy a one-dimensional input array into a vector with one memcpy
+ */
+inline std::vector<double> to_vector(const input_array &array)
+{
+    if (array.ndim() != 1)
+    {
+        throw std::invalid_argument("Expected a one-dimensional array, got "
+                                    + std::to_string(array.ndim())
+                                    + " dimensions");
+    }
+    return std::vector<double>(array.data(), array.data() + array.size());
+}
+
+/**
+ * @brief NumPy array backed by the buffer of `data`
+ *
+ * The vector is moved to the heap and freed by a capsule once Python drops
+ * the array, its elements are not copied.
+ */
+inline py::array_t<double> to_array(std::vector<double> &&data)
+{
+    auto owned = std::make_unique<std::vector<double>>(std::move(data));
+    const py::ssize_t size = static_cast<py::ssize_t>(owned->size());
+    double *buffer = owned->data();
+    py::capsule owner(owned.release(),
+                      [](void *vector)
+                      { delete static_cast<std::vector<double> *>(vector); });
+    return py::array_t<double>({ size }, { static_cast<py::ssize_t>(sizeof(double)) }, buffer, owner);
+}
+
+/**
+ * @brief Two-dimensional NumPy array backed by the row-major buffer of `data`
+ */
+inline py::array_t<double> to_matrix(std::vector<double> &&data, std::size_t cols)
+{
+    auto owned = std::make_unique<std::vector<double>>(std::move(data));
+    const py::ssize_t n_cols = static_cast<py::ssize_t>(cols);
+    const py::ssize_t n_rows = cols == 0 ? 0 : static_cast<py::ssize_t>(owned->size() / cols);
+    double *buffer = owned->data();
+    py::capsule owner(owned.release(),
+                      [](void *vector)
+                      { delete static_cast<std::vector<double> *>(vector); });
+    return py::array_t<double>({ n_rows, n_cols }, { n_cols * static_cast<py::ssize_t>(sizeof(double)), static_cast<py::ssize_t>(sizeof(double)) }, buffer, owner);
+}
+
+/**
+ * @brief Tuple of NumPy arrays backed by the buffers of the vectors in `data`
+ */
+inline py::tuple to_arrays(std::vector<std::vector<double>> &&data)
+{
+    py::tuple arrays(data.size());
+    for (std::size_t i = 0; i < data.size(); i++)
+    {
+        arrays[i] = to_array(std::move(data[i]));
+    }
+    return arrays;
+}
+
+/**
+ * @brief Read-only NumPy view of `data`, which must be owned by `owner`
+ *
+ * Python keeps `owner` alive as long as the view.
+ */
+inline py::array_t<double> view_array(const std::vector<double> &data, py::handle owner)
+{
+    py::array_t<double> view({ static_cast<py::ssize_t>(data.size()) }, { static_cast<py::ssize_t>(sizeof(double)) }, data.data(), owner);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
+#endif  // end of NUMPY_BUFFERS_H
@@ -1,4 +1,7 @@
+#include "../core/include/profiling.hpp"
+#include "../core/include/tile_tuner.hpp"
 #include "../core/include/utils_c.hpp"
+#include "numpy_buffers.hpp"
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
@@ -28,16 +31,36 @@ void start_hpx_wrapper(std::vector<std::string> args, std::size_t n_cores)
     utils::start_hpx_runtime(argc, argv.data());
 }
 
+/**
+ * @brief Convert the totals of a kernel or phase to a Python dict
+ *
+ * @param stats totals of the kernel or phase
+ */
+py::dict to_dict(const profiling::kernel_stats &stats)
+{
+    py::dict result;
+    result["name"] = stats.name;
+    result["phase"] = profiling::phase_name(stats.phase);
+    result["count"] = stats.count;
+    result["time"] = stats.time;
+    result["flops"] = stats.flops;
+    result["gflops"] = stats.gflops();
+    return result;
+}
+
 /**
  * @brief Add utility functions `compute_train_tiles`,
- * `compute_train_tile_size`, `compute_test_tiles`, `print`, `start_hpx`,
- * `resume_hpx`, `suspend_hpx`, `stop_hpx` to the module
+ * `compute_train_tile_size`, `compute_test_tiles`, `tune_tiles`, `load_data`,
+ * `save_data`, `convert_data`, `print`, `start_hpx`, `set_kernel_threads`,
+ * `kernel_threads`, `resume_hpx`, `suspend_hpx`, `stop_hpx`, `locality_id`,
+ * `n_localities`, `start_profiling`, `stop_profiling`, `profiling_report`,
+ * `write_trace` to the module
  */
 void init_utils(py::module &m)
 {
     m.def("compute_train_tiles", &utils::compute_train_tiles, py::arg("n_samples"), py::arg("n_tile_size"),
           R"pbdoc(
-          Compute the number of tiles for training data.
+          Compute the number of tiles for training data, the last tile is zero-padded.
 
           Parameters:
               n_samples (int): The number of samples.
@@ -49,7 +72,7 @@ void init_utils(py::module &m)
 
     m.def("compute_train_tile_size", &utils::compute_train_tile_size, py::arg("n_samples"), py::arg("n_tiles"),
           R"pbdoc(
-          Compute the tile size for training data.
+          Compute the tile size for training data, the last tile is zero-padded.
 
           Parameters:
               n_samples (int): Number of samples.
@@ -62,6 +85,7 @@ void init_utils(py::module &m)
     m.def("compute_test_tiles", &utils::compute_test_tiles, py::arg("m_samples"), py::arg("n_tiles"), py::arg("n_tile_size"),
           R"pbdoc(
           Compute the number of tiles for test data and the respective size of test tiles.
+          Test tiles have the size of the training tiles, the last tile is zero-padded.
 
           Parameters:
               n_test (int): The number of test samples.
@@ -69,13 +93,175 @@ void init_utils(py::module &m)
               n_tile_size (int): The size of each tile.
 
           Returns:
-              tuple: A tuple containing the number of test tiles and the adjusted tile size.
+              tuple: A tuple containing the number of test tiles and the tile size.
+          )pbdoc");
+
+    m.def(
+        "tune_tiles",
+        [](std::size_t n_train, std::size_t n_test, int n_regressors, bool optimize, std::size_t n_threads, const std::string &cache_path)
+        {
+            const tile_tuner::tile_config tiles = tile_tuner::tune(n_train, n_test, n_regressors, optimize ? tile_tuner::Workload::Optimize : tile_tuner::Workload::Predict, n_threads, cache_path);
+            return py::make_tuple(tiles.n_tiles, tiles.n_tile_size, tiles.m_tiles, tiles.m_tile_size);
+        },
+        py::arg("n_train"),
+        py::arg("n_test"),
+        py::arg("n_regressors"),
+        py::arg("optimize") = false,
+        py::arg("n_threads") = 0,
+        py::arg("cache_path") = "",
+        py::call_guard<py::gil_scoped_release>(),
+        R"pbdoc(
+        Pick the tiling from micro-benchmarks of the tile kernels on this machine.
+
+        Kernel timings are cached per host, see GPXPY_TUNING_CACHE.
+
+        Parameters:
+            n_train (int): Number of training samples.
+            n_test (int): Number of test samples.
+            n_regressors (int): Number of regressors.
+            optimize (bool): Tune for the optimizer instead of predictions. Default is False.
+            n_threads (int): Number of HPX threads, 0 for the running runtime. Default is 0.
+            cache_path (str): Timing cache file, empty for the per-host default.
+
+        Returns:
+            tuple: n_tiles, n_tile_size, m_tiles and m_tile_size.
+        )pbdoc");
+
+    m.def(
+        "load_data",
+        [](const std::string &file_path, int n_samples)
+        {
+            std::vector<double> data;
+            {
+                py::gil_scoped_release release;
+                data = utils::load_data(file_path, n_samples);
+            }
+            return to_array(std::move(data));
+        },
+        py::arg("file_path"),
+        py::arg("n_samples"),
+        R"pbdoc(
+        Load samples from a text or binary data file.
+
+        Parameters:
+            file_path (str): Path to the file, binary files are recognized by their header.
+            n_samples (int): Number of samples to load.
+
+        Returns:
+            numpy.ndarray: The first n_samples samples of the file.
+        )pbdoc");
+
+    m.def(
+        "save_data",
+        [](const std::string &file_path, const input_array &data, bool binary, bool single_precision)
+        { utils::save_data(file_path, to_vector(data), binary, single_precision); },
+        py::arg("file_path"),
+        py::arg("data"),
+        py::arg("binary") = true,
+        py::arg("single_precision") = false,
+        R"pbdoc(
+        Write samples to a data file.
+
+        Parameters:
+            file_path (str): Path to the file, overwritten if it exists.
+            data (numpy.ndarray): Samples to write.
+            binary (bool): Write the memory-mappable binary format instead of text. Default is True.
+            single_precision (bool): Store the samples of a binary file as floats. Default is False.
+        )pbdoc");
+
+    m.def("convert_data", &utils::convert_data, py::arg("source_path"), py::arg("target_path"), py::arg("single_precision") = false, py::call_guard<py::gil_scoped_release>(),
+          R"pbdoc(
+          Convert a text data file to the binary format or a binary data file to text.
+
+          Parameters:
+              source_path (str): Path to the file to convert.
+              target_path (str): Path to the converted file, overwritten if it exists.
+              single_precision (bool): Store the samples of a binary target as floats. Default is False.
           )pbdoc");
 
     m.def("print", &utils::print, py::arg("vec"), py::arg("start") = 0, py::arg("end") = -1, py::arg("separator") = " ", "Print elements of a vector with optional start, end, and separator parameters");
 
     m.def("start_hpx", &start_hpx_wrapper, py::arg("args"), py::arg("n_cores"));  // Using the wrapper function
+    m.def("set_kernel_threads", &utils::set_kernel_threads, py::arg("n_threads"), py::arg("min_tile_size") = 512,
+          R"pbdoc(
+          Split the diagonal POTRF and panel TRSM kernels of large tiles over several HPX threads.
+
+          Shortens the critical path of the tiled Cholesky when there are fewer tiles than cores.
+
+          Parameters:
+              n_threads (int): Maximum number of HPX threads of a split kernel, 1 runs all kernels sequentially.
+              min_tile_size (int): Smallest tile size whose kernels are split. Default is 512.
+          )pbdoc");
+    m.def("kernel_threads", &utils::kernel_threads, "Maximum number of HPX threads of a split kernel");
+    m.def("set_tile_cache_limit", &utils::set_tile_cache_limit, py::arg("bytes"),
+          R"pbdoc(
+          Limit the bytes of freed tile buffers kept for reuse by later tiles of the same size.
+
+          Cached buffers beyond the new limit are freed.
+
+          Parameters:
+              bytes (int): Limit over all HPX workers, 0 disables the reuse. Default is 1 GiB.
+          )pbdoc");
+    m.def("tile_cache_limit", &utils::tile_cache_limit, "Limit of the bytes of freed tile buffers kept for reuse");
+    m.def("tile_cache_bytes", &utils::tile_cache_bytes, "Bytes of freed tile buffers currently kept for reuse");
+    m.def("release_tile_cache", &utils::release_tile_cache, "Return the freed tile buffers kept for reuse to the system");
     m.def("resume_hpx", &utils::resume_hpx_runtime);
     m.def("suspend_hpx", &utils::suspend_hpx_runtime);
     m.def("stop_hpx", &utils::stop_hpx_runtime);
+    m.def("locality_id", &utils::locality_id, "Index of the calling HPX locality, 0 on the root locality");
+    m.def("n_localities", &utils::n_localities, "Number of HPX localities");
+
+    m.def("start_profiling", &profiling::start, py::arg("trace") = false,
+          R"pbdoc(
+          Clear the kernel counters and start recording the tile kernels.
+
+          Parameters:
+              trace (bool): Also record every task for write_trace. Default is False.
+          )pbdoc");
+    m.def("stop_profiling", &profiling::stop, "Stop recording the tile kernels, the counters are kept");
+
+    m.def(
+        "profiling_report",
+        []()
+        {
+            const profiling::report report = profiling::get_report();
+            py::list kernels;
+            for (const profiling::kernel_stats &kernel : report.kernels)
+            {
+                kernels.append(to_dict(kernel));
+            }
+            py::dict phases;
+            for (const profiling::kernel_stats &phase : report.phases)
+            {
+                phases[phase.name.c_str()] = to_dict(phase);
+            }
+            py::dict result;
+            result["kernels"] = kernels;
+            result["phases"] = phases;
+            result["wall_time"] = report.wall_time;
+            result["n_threads"] = report.n_threads;
+            result["busy_time"] = report.busy_time;
+            result["idle_rate"] = report.idle_rate;
+            result["flops"] = report.flops;
+            return result;
+        },
+        R"pbdoc(
+        Counters of the tile kernels recorded since start_profiling.
+
+        Returns:
+            dict: "kernels", a list of dicts with name, phase, count, time [s], flops and gflops
+            sorted by time, "phases", the same per phase (assembly, cholesky, solve, predict,
+            gradient), and the totals "wall_time" [s], "n_threads", "busy_time" [s], "idle_rate"
+            and "flops".
+        )pbdoc");
+
+    m.def("write_trace", &profiling::write_trace, py::arg("file_path"),
+          R"pbdoc(
+          Write the tasks recorded with start_profiling(trace=True) as a Chrome trace.
+
+          Open the file in chrome://tracing or Perfetto, each HPX worker thread is one row.
+
+          Parameters:
+              file_path (str): Path of the JSON file, overwritten if it exists.
+          )pbdoc");
 }
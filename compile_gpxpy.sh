@@ -29,6 +29,10 @@ export INSTALL_DIR=$(pwd)/examples/gpxpy_python
 # export BINDINGS=OFF
 # export INSTALL_DIR=$(pwd)/examples/gpxpy_cpp
 
+# GPU backend, requires the gpxpy_gpu_clang environment
+export CUDA=OFF
+# export CUDA=ON
+
 # Release:	ci-ubuntu
 # Debug:	dev-linux
 export PRESET=ci-ubuntu
@@ -36,7 +40,7 @@ export PRESET=ci-ubuntu
 ################################################################################
 # Compile code
 ################################################################################
-cmake --preset $PRESET -DGPXPY_BUILD_BINDINGS=$BINDINGS -DCMAKE_INSTALL_PREFIX=$INSTALL_DIR
+cmake --preset $PRESET -DGPXPY_BUILD_BINDINGS=$BINDINGS -DGPXPY_WITH_CUDA=$CUDA -DCMAKE_INSTALL_PREFIX=$INSTALL_DIR
 cmake --build --preset $PRESET
 cmake --install build/$PRESET
 # ctest --preset $PRESET
@@ -0,0 +1,170 @@
+#ifndef ADAPTER_CUBLAS_H
+#define ADAPTER_CUBLAS_H
+
+#include "device_tile_data.hpp"
+
+// =============================================================================
+// BLAS operations on GPU with cuBLAS and cuSOLVER
+// =============================================================================
+
+// The kernels mirror adapter_mkl.hpp on row-major device tiles. Each one
+// enqueues its work on the stream of the calling worker and suspends the
+// calling HPX thread until the stream has finished it.
+
+namespace gpu
+{
+
+// BLAS operations for tiled cholkesy -------------------------------------- {{{
+
+/**
+ * @brief In-place Cholesky decomposition of A
+ *
+ * @param A matrix to be factorized
+ * @param N size of the matrix
+ * @return factorized, lower triangular matrix L
+ */
+device_tile_data<double> potrf(const device_tile_data<double> &A, std::size_t N);
+
+// in-place solve X * L^T = A where L lower triangular
+device_tile_data<double>
+trsm(const device_tile_data<double> &L, const device_tile_data<double> &A, std::size_t N);
+
+// A = A - B * B^T
+device_tile_data<double>
+syrk(const device_tile_data<double> &A, const device_tile_data<double> &B, std::size_t N);
+
+// C = C - A * B^T
+device_tile_data<double> gemm(const device_tile_data<double> &A,
+                              const device_tile_data<double> &B,
+                              const device_tile_data<double> &C,
+                              std::size_t N);
+
+// in-place solve L * x = a where L lower triangular
+device_tile_data<double>
+trsv_l(const device_tile_data<double> &L, const device_tile_data<double> &a, std::size_t N);
+
+// b = b - A * a
+device_tile_data<double> gemv_l(const device_tile_data<double> &A,
+                                const device_tile_data<double> &a,
+                                const device_tile_data<double> &b,
+                                std::size_t N);
+
+// in-place solve L^T * x = a where L lower triangular
+device_tile_data<double>
+trsv_u(const device_tile_data<double> &L, const device_tile_data<double> &a, std::size_t N);
+
+// b = b - A^T * a
+device_tile_data<double> gemv_u(const device_tile_data<double> &A,
+                                const device_tile_data<double> &a,
+                                const device_tile_data<double> &b,
+                                std::size_t N);
+
+// A = A - x * y^T
+device_tile_data<double> ger(const device_tile_data<double> &A,
+                             const device_tile_data<double> &x,
+                             const device_tile_data<double> &y,
+                             std::size_t N);
+
+// C = C + A * B
+device_tile_data<double> gemm_diag(const device_tile_data<double> &A,
+                                   const device_tile_data<double> &B,
+                                   const device_tile_data<double> &C,
+                                   std::size_t N);
+
+// BLAS operations for tiled prediction
+// b = b + A * a where A(N_row, N_col), a(N_col) and b(N_row)
+device_tile_data<double> gemv_p(const device_tile_data<double> &A,
+                                const device_tile_data<double> &a,
+                                const device_tile_data<double> &b,
+                                std::size_t N_row,
+                                std::size_t N_col);
+
+// }}} ------------------------------- end of BLAS operations for tiled cholkesy
+
+// BLAS operations used in uncertainty computation ------------------------- {{{
+
+// in-place solve L * X = A where L lower triangular
+device_tile_data<double> trsm_l_KcK(const device_tile_data<double> &L,
+                                    const device_tile_data<double> &A,
+                                    std::size_t N,
+                                    std::size_t M);
+
+// C = C - A * B
+device_tile_data<double> gemm_l_KcK(const device_tile_data<double> &A,
+                                    const device_tile_data<double> &B,
+                                    const device_tile_data<double> &C,
+                                    std::size_t N,
+                                    std::size_t M);
+
+// C = C - A^T * B
+device_tile_data<double> gemm_cross_tcross_matrix(const device_tile_data<double> &A,
+                                                  const device_tile_data<double> &B,
+                                                  const device_tile_data<double> &C,
+                                                  std::size_t N,
+                                                  std::size_t M);
+
+// }}} --------------------------------- end of BLAS for uncertainty computation
+
+// BLAS operations used in optimization step ------------------------------- {{{
+
+// in-place solve L * X = A where L lower triangular
+device_tile_data<double> trsm_l_matrix(const device_tile_data<double> &L,
+                                       const device_tile_data<double> &A,
+                                       std::size_t N,
+                                       std::size_t M);
+
+// C = C - A * B
+device_tile_data<double> gemm_l_matrix(const device_tile_data<double> &A,
+                                       const device_tile_data<double> &B,
+                                       const device_tile_data<double> &C,
+                                       std::size_t N,
+                                       std::size_t M);
+
+// in-place solve L^T * X = A where L upper triangular
+device_tile_data<double> trsm_u_matrix(const device_tile_data<double> &L,
+                                       const device_tile_data<double> &A,
+                                       std::size_t N,
+                                       std::size_t M);
+
+// C = C - A^T * B
+device_tile_data<double> gemm_u_matrix(const device_tile_data<double> &A,
+                                       const device_tile_data<double> &B,
+                                       const device_tile_data<double> &C,
+                                       std::size_t N,
+                                       std::size_t M);
+
+// inverse of lower triangular L, upper triangle of the result set to zero
+device_tile_data<double> trtri(const device_tile_data<double> &L, std::size_t N);
+
+// C = C + A * B
+device_tile_data<double> gemm_nn_add(const device_tile_data<double> &A,
+                                     const device_tile_data<double> &B,
+                                     const device_tile_data<double> &C,
+                                     std::size_t N,
+                                     std::size_t M);
+
+// C = C + A^T * B
+device_tile_data<double> gemm_tn_add(const device_tile_data<double> &A,
+                                     const device_tile_data<double> &B,
+                                     const device_tile_data<double> &C,
+                                     std::size_t N,
+                                     std::size_t M);
+
+// R = R + diag(A^T * A)
+device_tile_data<double> dot_uncertainty(const device_tile_data<double> &A,
+                                         const device_tile_data<double> &R,
+                                         std::size_t N,
+                                         std::size_t M);
+
+// R = R + diag(A * B)
+device_tile_data<double> gemm_grad(const device_tile_data<double> &A,
+                                   const device_tile_data<double> &B,
+                                   const device_tile_data<double> &R,
+                                   std::size_t N,
+                                   std::size_t M);
+
+// }}} --------------------------------------- end of BLAS for optimization step
+
+}  // namespace gpu
+
+#endif  // end of ADAPTER_CUBLAS_H
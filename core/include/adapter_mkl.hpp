@@ -1,12 +1,48 @@
 #ifndef ADAPTER_MKL_H
 #define ADAPTER_MKL_H
 
-#include <vector>
+#include "tile_data.hpp"
+#include <cstddef>
 
 // =============================================================================
 // BLAS operations on CPU with MKL
 // =============================================================================
 
+// The kernels are templates over the element type of the tiles and are
+// instantiated for float and double in adapter_mkl.cpp.
+
+// Parallel kernels -------------------------------------------------------- {{{
+
+/**
+ * @brief Split of the large kernels on the critical path of the tiled
+ *        Cholesky, the diagonal POTRF and the panel TRSM, over HPX threads
+ *
+ * MKL is linked sequentially, its threads would compete with the HPX workers.
+ * Instead, potrf and trsm of tiles of at least `min_tile_size` rows split
+ * themselves into up to `n_threads` high priority HPX tasks of sequential MKL
+ * calls: a blocked right-looking POTRF and row blocks of the TRSM. This
+ * shortens the critical path when there are fewer tiles than cores.
+ */
+struct kernel_parallelism
+{
+    /** @brief Maximum number of HPX threads of a split kernel, 1 for none */
+    std::size_t n_threads = 1;
+
+    /** @brief Smallest tile size whose kernels are split */
+    std::size_t min_tile_size = 512;
+
+    /** @brief Block size of the split POTRF */
+    std::size_t block_size = 128;
+};
+
+// Set the split of large kernels for this process, sequential by default
+void set_kernel_parallelism(const kernel_parallelism &policy);
+
+// Returns the split of large kernels
+kernel_parallelism get_kernel_parallelism();
+
+// }}} ------------------------------------------------- end of Parallel kernels
+
 // BLAS operations for tiled cholkesy -------------------------------------- {{{
 
 /**
@@ -16,132 +52,244 @@
  * @param N size of the matrix
  * @return factorized, lower triangular matrix L
  */
-std::vector<double> potrf(std::vector<double> A, std::size_t N);
+template <typename T>
+mutable_tile_data<T> potrf(const mutable_tile_data<T> &A, std::size_t N);
 
 // in-place solve X * L^T = A where L lower triangular
-std::vector<double>
-trsm(std::vector<double> L, std::vector<double> A, std::size_t N);
+template <typename T>
+mutable_tile_data<T>
+trsm(const const_tile_data<T> &L, const mutable_tile_data<T> &A, std::size_t N);
 
 // A = A - B * B^T
-std::vector<double>
-syrk(std::vector<double> A, std::vector<double> B, std::size_t N);
+template <typename T>
+mutable_tile_data<T>
+syrk(const mutable_tile_data<T> &A, const const_tile_data<T> &B, std::size_t N);
 
 // C = C - A * B^T
-std::vector<double> gemm(std::vector<double> A,
-                         std::vector<double> B,
-                         std::vector<double> C,
-                         std::size_t N);
+template <typename T>
+mutable_tile_data<T> gemm(const const_tile_data<T> &A,
+                          const const_tile_data<T> &B,
+                          const mutable_tile_data<T> &C,
+                          std::size_t N);
 
 // in-place solve L * x = a where L lower triangular
-std::vector<double>
-trsv_l(std::vector<double> L, std::vector<double> a, std::size_t N);
+template <typename T>
+mutable_tile_data<T>
+trsv_l(const const_tile_data<T> &L, const mutable_tile_data<T> &a, std::size_t N);
 
 // b = b - A * a
-std::vector<double> gemv_l(std::vector<double> A,
-                           std::vector<double> a,
-                           std::vector<double> b,
-                           std::size_t N);
+template <typename T>
+mutable_tile_data<T> gemv_l(const const_tile_data<T> &A,
+                            const const_tile_data<T> &a,
+                            const mutable_tile_data<T> &b,
+                            std::size_t N);
 
 // in-place solve L^T * x = a where L lower triangular
-std::vector<double>
-trsv_u(std::vector<double> L, std::vector<double> a, std::size_t N);
+template <typename T>
+mutable_tile_data<T>
+trsv_u(const const_tile_data<T> &L, const mutable_tile_data<T> &a, std::size_t N);
 
 // b = b - A^T * a
-std::vector<double> gemv_u(std::vector<double> A,
-                           std::vector<double> a,
-                           std::vector<double> b,
-                           std::size_t N);
+template <typename T>
+mutable_tile_data<T> gemv_u(const const_tile_data<T> &A,
+                            const const_tile_data<T> &a,
+                            const mutable_tile_data<T> &b,
+                            std::size_t N);
 
 // A = y*beta^T + A
-std::vector<double> ger(std::vector<double> A,
-                        std::vector<double> x,
-                        std::vector<double> y,
-                        std::size_t N);
+template <typename T>
+mutable_tile_data<T> ger(const mutable_tile_data<T> &A,
+                         const const_tile_data<T> &x,
+                         const const_tile_data<T> &y,
+                         std::size_t N);
 
 // C = C + A * B^T
-std::vector<double> gemm_diag(std::vector<double> A,
-                              std::vector<double> B,
-                              std::vector<double> C,
-                              std::size_t N);
+template <typename T>
+mutable_tile_data<T> gemm_diag(const const_tile_data<T> &A,
+                               const const_tile_data<T> &B,
+                               const mutable_tile_data<T> &C,
+                               std::size_t N);
 
 // BLAS operations for tiled prediction
 // b = b + A * a where A(N_row, N_col), a(N_col) and b(N_row)
-std::vector<double> gemv_p(std::vector<double> A,
-                           std::vector<double> a,
-                           std::vector<double> b,
-                           std::size_t N_row,
-                           std::size_t N_col);
+template <typename T>
+mutable_tile_data<T> gemv_p(const const_tile_data<T> &A,
+                            const const_tile_data<T> &a,
+                            const mutable_tile_data<T> &b,
+                            std::size_t N_row,
+                            std::size_t N_col);
+
+// C = C + A * B where A(N_row, N_col), B(N_col, M) and C(N_row, M)
+template <typename T>
+mutable_tile_data<T> gemm_p(const const_tile_data<T> &A,
+                            const const_tile_data<T> &B,
+                            const mutable_tile_data<T> &C,
+                            std::size_t N_row,
+                            std::size_t N_col,
+                            std::size_t M);
 
 // }}} ------------------------------- end of BLAS operations for tiled cholkesy
 
 // BLAS operations used in uncertainty computation ------------------------- {{{
 
 // in-place solve X * L = A where L lower triangular
-std::vector<double> trsm_l_KcK(std::vector<double> L,
-                               std::vector<double> A,
-                               std::size_t N,
-                               std::size_t M);
+template <typename T>
+mutable_tile_data<T> trsm_l_KcK(const const_tile_data<T> &L,
+                                const mutable_tile_data<T> &A,
+                                std::size_t N,
+                                std::size_t M);
 
 // C = C - A * B
-std::vector<double> gemm_l_KcK(std::vector<double> A,
-                               std::vector<double> B,
-                               std::vector<double> C,
-                               std::size_t N,
-                               std::size_t M);
+template <typename T>
+mutable_tile_data<T> gemm_l_KcK(const const_tile_data<T> &A,
+                                const const_tile_data<T> &B,
+                                const mutable_tile_data<T> &C,
+                                std::size_t N,
+                                std::size_t M);
 
 // C = C - A^T * B
-std::vector<double> gemm_cross_tcross_matrix(std::vector<double> A,
-                                             std::vector<double> B,
-                                             std::vector<double> C,
-                                             std::size_t N,
-                                             std::size_t M);
+template <typename T>
+mutable_tile_data<T> gemm_cross_tcross_matrix(const const_tile_data<T> &A,
+                                              const const_tile_data<T> &B,
+                                              const mutable_tile_data<T> &C,
+                                              std::size_t N,
+                                              std::size_t M);
+
+// C = C - A^T * A on the lower triangle of C(M, M) where A(N, M)
+template <typename T>
+mutable_tile_data<T> syrk_tcross_matrix(const const_tile_data<T> &A,
+                                        const mutable_tile_data<T> &C,
+                                        std::size_t N,
+                                        std::size_t M);
 
 // }}} --------------------------------- end of BLAS for uncertainty computation
 
 // BLAS operations used in optimization step ------------------------------- {{{
 
 // in-place solve L * X = A where L lower triangular
-std::vector<double> trsm_l_matrix(std::vector<double> L,
-                                  std::vector<double> A,
-                                  std::size_t N,
-                                  std::size_t M);
+template <typename T>
+mutable_tile_data<T> trsm_l_matrix(const const_tile_data<T> &L,
+                                   const mutable_tile_data<T> &A,
+                                   std::size_t N,
+                                   std::size_t M);
 
 // C = C - A * B
-std::vector<double> gemm_l_matrix(std::vector<double> A,
-                                  std::vector<double> B,
-                                  std::vector<double> C,
-                                  std::size_t N,
-                                  std::size_t M);
+template <typename T>
+mutable_tile_data<T> gemm_l_matrix(const const_tile_data<T> &A,
+                                   const const_tile_data<T> &B,
+                                   const mutable_tile_data<T> &C,
+                                   std::size_t N,
+                                   std::size_t M);
 
 // in-place solve L^T * X = A where L upper triangular
-std::vector<double> trsm_u_matrix(std::vector<double> L,
-                                  std::vector<double> A,
-                                  std::size_t N,
-                                  std::size_t M);
+template <typename T>
+mutable_tile_data<T> trsm_u_matrix(const const_tile_data<T> &L,
+                                   const mutable_tile_data<T> &A,
+                                   std::size_t N,
+                                   std::size_t M);
 
 // C = C - A^T * B
-std::vector<double> gemm_u_matrix(std::vector<double> A,
-                                  std::vector<double> B,
-                                  std::vector<double> C,
-                                  std::size_t N,
-                                  std::size_t M);
+template <typename T>
+mutable_tile_data<T> gemm_u_matrix(const const_tile_data<T> &A,
+                                   const const_tile_data<T> &B,
+                                   const mutable_tile_data<T> &C,
+                                   std::size_t N,
+                                   std::size_t M);
+
+// inverse of lower triangular L, upper triangle of the result set to zero
+template <typename T>
+mutable_tile_data<T> trtri(const const_tile_data<T> &L, std::size_t N);
+
+// C = C + A * B
+template <typename T>
+mutable_tile_data<T> gemm_nn_add(const const_tile_data<T> &A,
+                                 const const_tile_data<T> &B,
+                                 const mutable_tile_data<T> &C,
+                                 std::size_t N,
+                                 std::size_t M);
+
+// C = C + A^T * B
+template <typename T>
+mutable_tile_data<T> gemm_tn_add(const const_tile_data<T> &A,
+                                 const const_tile_data<T> &B,
+                                 const mutable_tile_data<T> &C,
+                                 std::size_t N,
+                                 std::size_t M);
 
 // Dot product used in dot calculation
-double dot(std::size_t N, std::vector<double> A, std::vector<double> B);
+template <typename T>
+T dot(std::size_t N, const const_tile_data<T> &A, const const_tile_data<T> &B);
 
 // C = C - A * B
-std::vector<double> dot_uncertainty(std::vector<double> A,
-                                    std::vector<double> R,
-                                    std::size_t N,
-                                    std::size_t M);
+template <typename T>
+mutable_tile_data<T> dot_uncertainty(const const_tile_data<T> &A,
+                                     const mutable_tile_data<T> &R,
+                                     std::size_t N,
+                                     std::size_t M);
 
 // C = C - A * B
-std::vector<double> gemm_grad(std::vector<double> A,
-                              std::vector<double> B,
-                              std::vector<double> R,
-                              std::size_t N,
-                              std::size_t M);
+template <typename T>
+mutable_tile_data<T> gemm_grad(const const_tile_data<T> &A,
+                               const const_tile_data<T> &B,
+                               const mutable_tile_data<T> &R,
+                               std::size_t N,
+                               std::size_t M);
 
 // }}} --------------------------------------- end of BLAS for optimization step
 
+// BLAS operations for sparse approximations ------------------------------- {{{
+
+// in-place solve X * L^T = A where L(N, N) lower triangular and A(N_row, N)
+template <typename T>
+mutable_tile_data<T> trsm_rect(const const_tile_data<T> &L,
+                               const mutable_tile_data<T> &A,
+                               std::size_t N_row,
+                               std::size_t N);
+
+// C = C + A^T * B where A(N_row, N), B(N_row, N) and C(N, N)
+template <typename T>
+mutable_tile_data<T> gemm_tn_rect(const const_tile_data<T> &A,
+                                  const const_tile_data<T> &B,
+                                  const mutable_tile_data<T> &C,
+                                  std::size_t N_row,
+                                  std::size_t N);
+
+// C = A * B where A(N_row, N) and B(N, N)
+template <typename T>
+mutable_tile_data<T> gemm_nn_rect(const const_tile_data<T> &A,
+                                  const const_tile_data<T> &B,
+                                  std::size_t N_row,
+                                  std::size_t N);
+
+// b = b + A^T * a where A(N_row, N_col), a(N_row) and b(N_col)
+template <typename T>
+mutable_tile_data<T> gemv_t(const const_tile_data<T> &A,
+                            const const_tile_data<T> &a,
+                            const mutable_tile_data<T> &b,
+                            std::size_t N_row,
+                            std::size_t N_col);
+
+// }}} ------------------------ end of BLAS operations for sparse approximations
+
+// BLAS operations for iterative solvers ----------------------------------- {{{
+
+// C = C + A^T * B where A(N_row, N_col), B(N_row, M) and C(N_col, M)
+template <typename T>
+mutable_tile_data<T> gemm_tn_p(const const_tile_data<T> &A,
+                               const const_tile_data<T> &B,
+                               const mutable_tile_data<T> &C,
+                               std::size_t N_row,
+                               std::size_t N_col,
+                               std::size_t M);
+
+// eigenvalues of the symmetric tridiagonal matrix with diagonal d(N) and
+// off-diagonal e(N - 1) in ascending order, followed by the first entries of
+// the corresponding eigenvectors, 2 * N elements
+template <typename T>
+mutable_tile_data<T> stev(const const_tile_data<T> &d,
+                          const const_tile_data<T> &e,
+                          std::size_t N);
+
+// }}} ---------------------------- end of BLAS operations for iterative solvers
+
 #endif  // end of ADAPTER_MKL_H
@@ -0,0 +1,22 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+/**
+ * @brief Device that fits a GP and computes its predictions.
+ *
+ * CPU runs the tile kernels with MKL. GPU keeps the covariance tiles, the
+ * Cholesky factor and alpha in device memory and runs the kernels with cuBLAS
+ * and cuSOLVER; it requires a build with GPXPY_WITH_CUDA.
+ */
+enum class Backend
+{
+    CPU,
+    GPU
+};
+
+/**
+ * @brief Returns true if GPXPy was built with the GPU backend
+ */
+bool gpu_backend_available();
+
+#endif  // end of BACKEND_H
@@ -0,0 +1,117 @@
+#ifndef COVARIANCE_ASSEMBLY_H
+#define COVARIANCE_ASSEMBLY_H
+
+#include <cstddef>
+#include <vector>
+
+// Multiversioned kernels: the loader picks the AVX-512 or AVX2 build if the
+// CPU supports it. Define GPXPY_NO_TARGET_CLONES to build the default only.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(GPXPY_NO_TARGET_CLONES)
+#define GPXPY_TARGET_CLONES __attribute__((target_clones("arch=skylake-avx512", "arch=haswell", "default")))
+#else
+#define GPXPY_TARGET_CLONES
+#endif
+
+/**
+ * @brief Compute the squared distances of the lagged feature vectors of a
+ *        N_row x N_col tile.
+ *
+ * The feature vector of sample i holds the n_regressors inputs up to and
+ * including i, zero-padded at the start of the series and past its last
+ * sample. Consecutive samples
+ * share all but one input, such that
+ * d(i+1, j+1) = d(i, j) + (x_{i+1} - x_{j+1})^2 - (x_{i+1-R} - x_{j+1-R})^2.
+ * A tile thus costs O(N_row * N_col) instead of O(N_row * N_col * R). The
+ * recurrence is reseeded with the direct sum every n_regressors rows to
+ * bound the accumulated rounding error.
+ *
+ * @param distances output, N_row * N_col elements in row-major order
+ * @param row_start global index of the first row
+ * @param col_start global index of the first column
+ * @param N_row number of rows
+ * @param N_col number of columns
+ * @param n_regressors number of regressors
+ * @param row_input input data of the rows
+ * @param col_input input data of the columns
+ */
+void compute_lagged_distances(double *distances,
+                              std::size_t row_start,
+                              std::size_t col_start,
+                              std::size_t N_row,
+                              std::size_t N_col,
+                              std::size_t n_regressors,
+                              const std::vector<double> &row_input,
+                              const std::vector<double> &col_input);
+
+/**
+ * @brief Compute the squared distances d(row_start + i, col_start + i) of the
+ *        lagged feature vectors for i < N, with the same recurrence as
+ *        compute_lagged_distances.
+ *
+ * @param distances output, N elements
+ * @param row_start global index of the first row
+ * @param col_start global index of the first column
+ * @param N number of elements
+ * @param n_regressors number of regressors
+ * @param row_input input data of the rows
+ * @param col_input input data of the columns
+ */
+void compute_lagged_distances_diag(double *distances,
+                                   std::size_t row_start,
+                                   std::size_t col_start,
+                                   std::size_t N,
+                                   std::size_t n_regressors,
+                                   const std::vector<double> &row_input,
+                                   const std::vector<double> &col_input);
+
+/**
+ * @brief Returns the number of samples among the N global indices starting
+ *        at `start`, i.e. the rows of a tile that are not padding
+ *
+ * @param start global index of the first row
+ * @param N number of rows
+ * @param n_samples number of samples of the series
+ */
+std::size_t n_valid_samples(std::size_t start, std::size_t N, std::size_t n_samples);
+
+/**
+ * @brief Overwrite the entries of a N_row x N_col tile that lie in a row or
+ *        column past the last sample with `diagonal` on the global diagonal
+ *        and zero elsewhere.
+ *
+ * Series whose length is not a multiple of the tile size are zero-padded to
+ * whole tiles. The padded rows and columns of the covariance matrix are
+ * those of the identity, which decouples them from the samples: they leave
+ * the Cholesky factor of the samples, alpha and the loss unchanged, and the
+ * padded entries of alpha are zero.
+ *
+ * @param tile N_row * N_col elements in row-major order
+ * @param row_start global index of the first row
+ * @param col_start global index of the first column
+ * @param N_row number of rows
+ * @param N_col number of columns
+ * @param n_row_samples number of samples of the rows
+ * @param n_col_samples number of samples of the columns
+ * @param diagonal value of the padded entries on the global diagonal
+ */
+void mask_padding(double *tile,
+                  std::size_t row_start,
+                  std::size_t col_start,
+                  std::size_t N_row,
+                  std::size_t N_col,
+                  std::size_t n_row_samples,
+                  std::size_t n_col_samples,
+                  double diagonal);
+
+/**
+ * @brief In-place x[i] = factor * exp(scale * x[i]) with a vectorizable,
+ *        polynomial exp accurate to a few ulp.
+ *
+ * @param x values, overwritten by the result
+ * @param n number of values
+ * @param scale factor applied to the argument
+ * @param factor factor applied to the result
+ */
+void scaled_exp(double *x, std::size_t n, double scale, double factor);
+
+#endif  // end of COVARIANCE_ASSEMBLY_H
@@ -0,0 +1,22 @@
+#ifndef COVARIANCE_FORMAT_H
+#define COVARIANCE_FORMAT_H
+
+/**
+ * @brief What predict_with_full_cov returns besides the predictions and the
+ * variances.
+ *
+ * The posterior covariance is symmetric, so neither format forms the dense
+ * M x M matrix. Lower returns its lower triangle packed row by row: element
+ * (i, j) with j <= i at i * (i + 1) / 2 + j. LowRank skips the M x M update
+ * and returns the packed lower triangle of the prior covariance K_MxM and
+ * V = L^-1 * K_NxM, a training size x M matrix in row-major order, with
+ * Sigma = K_MxM - V^T * V.
+ */
+enum class CovarianceFormat
+{
+    Diagonal,
+    Lower,
+    LowRank
+};
+
+#endif  // end of COVARIANCE_FORMAT_H
@@ -0,0 +1,100 @@
+#ifndef DATA_FILE_H
+#define DATA_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Reading and writing of data files with one column of samples.
+ *
+ * Two formats are supported: text files with one value per whitespace
+ * separated token, like the text files under data/training/, and binary
+ * files made of a 32 byte header followed by the raw little-endian samples:
+ *
+ *     offset  size  field
+ *          0     8  magic "GPXPYBIN"
+ *          8     4  format version, currently 1
+ *         12     4  element type, see data_type
+ *         16     8  number of samples
+ *         24     8  reserved, zero
+ *
+ * Binary files are memory-mapped, text files are parsed in parallel chunks.
+ */
+namespace data_file
+{
+/** @brief Sample count that makes the readers return all samples of a file */
+constexpr std::size_t all_samples = static_cast<std::size_t>(-1);
+
+/** @brief Element type of the samples in a binary data file */
+enum class data_type : std::uint32_t
+{
+    Float64 = 1,
+    Float32 = 2
+};
+
+/** @brief Header of a binary data file */
+struct header
+{
+    /** @brief Element type of the samples */
+    data_type type;
+
+    /** @brief Number of samples in the file */
+    std::size_t count;
+};
+
+/**
+ * @brief Returns true if the file starts with the magic of a binary data file
+ *
+ * @param file_path path to the file
+ */
+bool is_binary(const std::string &file_path);
+
+/**
+ * @brief Read and validate the header of a binary data file
+ *
+ * @param file_path path to the file
+ */
+header read_header(const std::string &file_path);
+
+/**
+ * @brief Read the first `n_samples` samples of a binary data file, converted
+ * to double precision
+ *
+ * @param file_path path to the file
+ * @param n_samples number of samples to read, at most the count of the
+ *        header, or all_samples
+ */
+std::vector<double> read_binary(const std::string &file_path, std::size_t n_samples);
+
+/**
+ * @brief Write samples to a binary data file
+ *
+ * @param file_path path to the file, overwritten if it exists
+ * @param data samples to write
+ * @param type element type, Float32 rounds the samples to single precision
+ */
+void write_binary(const std::string &file_path,
+                  const std::vector<double> &data,
+                  data_type type = data_type::Float64);
+
+/**
+ * @brief Parse the first `n_samples` values of a text data file
+ *
+ * @param file_path path to the file
+ * @param n_samples number of values to parse, or all_samples
+ */
+std::vector<double> read_text(const std::string &file_path, std::size_t n_samples);
+
+/**
+ * @brief Write samples to a text data file, one value per line with enough
+ * digits to read back the same doubles
+ *
+ * @param file_path path to the file, overwritten if it exists
+ * @param data samples to write
+ */
+void write_text(const std::string &file_path, const std::vector<double> &data);
+}  // namespace data_file
+
+#endif  // end of DATA_FILE_H
@@ -0,0 +1,146 @@
+#ifndef DEVICE_TILE_DATA_H
+#define DEVICE_TILE_DATA_H
+
+#include "gpu_context.hpp"
+#include "tile_data.hpp"
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace gpu
+{
+
+/**
+ * @brief Reference-counted tile buffer in device memory.
+ *
+ * The device counterpart of `mutable_tile_data`: copying a tile copies the
+ * handle, constness is shallow and each kernel writes its output tile via
+ * `writable()`. The buffer is allocated and freed in stream order on the
+ * stream of the calling worker. A tile handed out by a kernel is complete,
+ * since every GPU kernel waits for its stream before it returns.
+ *
+ * @tparam T element type of the tile
+ */
+template <typename T>
+class device_tile_data
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "tile elements must be trivially copyable");
+
+  private:
+    /** @brief Shared device buffer */
+    std::shared_ptr<T> _data;
+
+    /** @brief Number of elements in the buffer */
+    std::size_t _size;
+
+  public:
+    /**
+     * @brief Construct an empty tile
+     */
+    device_tile_data() :
+        _data(),
+        _size(0)
+    { }
+
+    /**
+     * @brief Allocate an uninitialized tile of `size` elements
+     *
+     * @param size number of elements
+     */
+    explicit device_tile_data(std::size_t size) :
+        _data(),
+        _size(size)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+        _data = std::shared_ptr<T>(static_cast<T *>(allocate(size * sizeof(T))), [](T *p)
+                                   { deallocate(p); });
+    }
+
+    /**
+     * @brief Returns the number of elements
+     */
+    std::size_t size() const { return _size; }
+
+    /**
+     * @brief Returns a device pointer to the first element
+     */
+    T *data() const { return _data.get(); }
+
+    /**
+     * @brief Returns the number of handles sharing the buffer
+     */
+    long use_count() const { return _data.use_count(); }
+
+    /**
+     * @brief Returns a handle whose buffer may be written to
+     *
+     * That is this tile itself if no other handle shares its buffer, or a deep
+     * copy otherwise. The copy is enqueued on the stream of the calling
+     * worker.
+     */
+    device_tile_data writable() const
+    {
+        if (use_count() <= 1)
+        {
+            return *this;
+        }
+        return copy();
+    }
+
+    /**
+     * @brief Returns a deep copy of the tile, enqueued on the stream of the
+     *        calling worker
+     */
+    device_tile_data copy() const
+    {
+        device_tile_data result(_size);
+        if (_size > 0)
+        {
+            check(cudaMemcpyAsync(result.data(), data(), _size * sizeof(T), cudaMemcpyDeviceToDevice, local_context().stream), "cudaMemcpyAsync");
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Copy `size` host elements to a new device tile
+ *
+ * @param data first host element
+ * @param size number of elements
+ */
+template <typename T>
+device_tile_data<T> upload(const T *data, std::size_t size)
+{
+    gpu_context &context = local_context();
+    device_tile_data<T> tile(size);
+    if (size > 0)
+    {
+        check(cudaMemcpyAsync(tile.data(), data, size * sizeof(T), cudaMemcpyHostToDevice, context.stream), "cudaMemcpyAsync");
+    }
+    synchronize(context);
+    return tile;
+}
+
+/**
+ * @brief Copy a device tile to a new host tile
+ */
+template <typename T>
+mutable_tile_data<T> download(const device_tile_data<T> &tile)
+{
+    gpu_context &context = local_context();
+    mutable_tile_data<T> result(tile.size());
+    if (tile.size() > 0)
+    {
+        check(cudaMemcpyAsync(result.data(), tile.data(), tile.size() * sizeof(T), cudaMemcpyDeviceToHost, context.stream), "cudaMemcpyAsync");
+    }
+    synchronize(context);
+    return result;
+}
+
+}  // namespace gpu
+
+#endif  // end of DEVICE_TILE_DATA_H
@@ -0,0 +1,97 @@
+#ifndef DISTANCE_CACHE_H
+#define DISTANCE_CACHE_H
+
+#include "tile_data.hpp"
+#include <cstddef>
+#include <hpx/future.hpp>
+#include <vector>
+
+/**
+ * @brief Cache of the lower tiles of squared lag distances of the training
+ *        input.
+ *
+ * The distances do not depend on the hyperparameters, so the optimizer
+ * computes them once and every iteration only rescales them. Tiles are
+ * cached in the order they are requested while they fit into the memory
+ * budget. Tiles beyond the budget are recomputed on every request. A budget
+ * of zero thus disables caching.
+ *
+ * The cache is not thread-safe; it is meant to be used by the thread that
+ * schedules the task graph.
+ */
+class distance_tile_cache
+{
+  private:
+    /** @brief Memory budget in bytes */
+    std::size_t _budget;
+
+    /** @brief Bytes held by cached tiles */
+    std::size_t _cached_bytes;
+
+    /** @brief Tiling the cached tiles were computed for */
+    std::size_t _n_tiles;
+
+    std::size_t _n_tile_size;
+
+    std::size_t _n_regressors;
+
+    /** @brief Row-major n_tiles x n_tiles, only lower tiles are used */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> _tiles;
+
+  public:
+    /** @brief Default memory budget: 1 GiB */
+    static constexpr std::size_t default_budget = std::size_t(1) << 30;
+
+    /**
+     * @brief Construct an empty cache
+     *
+     * @param budget memory budget in bytes
+     */
+    explicit distance_tile_cache(std::size_t budget = default_budget);
+
+    /**
+     * @brief Returns the squared distances of tile (row, col), row >= col
+     *
+     * Drops all cached tiles if n_tiles, n_tile_size or n_regressors differ
+     * from the previous request.
+     *
+     * @param row row index of the tile
+     * @param col column index of the tile
+     * @param n_tiles number of tiles
+     * @param n_tile_size size of each tile
+     * @param n_regressors number of regressors
+     * @param input training input data
+     *
+     * @return future of the tile, shared with later requests and thus only
+     *         to be read
+     */
+    hpx::shared_future<mutable_tile_data<double>>
+    tile(std::size_t row,
+         std::size_t col,
+         std::size_t n_tiles,
+         std::size_t n_tile_size,
+         std::size_t n_regressors,
+         const std::vector<double> &input);
+
+    /**
+     * @brief Drop all cached tiles. Needed when the training input changes.
+     */
+    void clear();
+
+    /**
+     * @brief Set the memory budget in bytes, dropping the cache if it shrinks
+     */
+    void set_budget(std::size_t budget);
+
+    /**
+     * @brief Returns the memory budget in bytes
+     */
+    std::size_t budget() const;
+
+    /**
+     * @brief Returns the number of bytes held by cached tiles
+     */
+    std::size_t cached_bytes() const;
+};
+
+#endif  // end of DISTANCE_CACHE_H
@@ -0,0 +1,53 @@
+#ifndef DISTRIBUTION_POLICY_H
+#define DISTRIBUTION_POLICY_H
+
+#include <cstddef>
+
+/**
+ * @brief Placement of the covariance tiles on the HPX localities.
+ *
+ * The localities form a grid_rows x grid_cols process grid and tile (i, j)
+ * lives on grid position (i % grid_rows, j % grid_cols), i.e. the tiles are
+ * distributed 2D block-cyclically. Locality `p` is grid position
+ * (p / grid_cols, p % grid_cols). A 1 x 1 grid keeps all tiles in the
+ * address space of the calling locality and is the default.
+ */
+struct distribution_policy
+{
+    /** @brief Number of rows of the process grid */
+    std::size_t grid_rows;
+
+    /** @brief Number of columns of the process grid */
+    std::size_t grid_cols;
+
+    /**
+     * @brief Construct a block-cyclic distribution
+     *
+     * @param grid_rows Number of rows of the process grid
+     * @param grid_cols Number of columns of the process grid
+     */
+    distribution_policy(std::size_t grid_rows = 1, std::size_t grid_cols = 1) :
+        grid_rows(grid_rows),
+        grid_cols(grid_cols)
+    { }
+
+    /**
+     * @brief Returns the number of localities of the process grid
+     */
+    std::size_t n_localities() const { return grid_rows * grid_cols; }
+
+    /**
+     * @brief Returns true if the tiles are spread over several localities
+     */
+    bool is_distributed() const { return n_localities() > 1; }
+
+    /**
+     * @brief Returns the index of the locality that owns tile (row, col)
+     */
+    std::size_t owner(std::size_t row, std::size_t col) const
+    {
+        return (row % grid_rows) * grid_cols + col % grid_cols;
+    }
+};
+
+#endif  // end of DISTRIBUTION_POLICY_H
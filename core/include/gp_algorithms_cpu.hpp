@@ -1,11 +1,18 @@
 #ifndef GP_ALGORITHMS_CPU_H
 #define GP_ALGORITHMS_CPU_H
 
+#include "kernels.hpp"
+#include "tile_data.hpp"
 #include <cmath>
 #include <vector>
 
-// compute the squared exponential kernel of two feature vectors
-double compute_covariance_function(std::size_t i_global, std::size_t j_global, std::size_t n_regressors, double *hyperparameters, const std::vector<double> &i_input, const std::vector<double> &j_input);
+// The tile generators are templates over the element type of the tiles and
+// are instantiated for float and double in gp_algorithms_mkl.cpp. The
+// covariance function is evaluated in double precision either way, with the
+// loops of the kernel selected once per tile, see kernels.hpp.
+
+// compute the kernel of two feature vectors
+double compute_covariance_function(std::size_t i_global, std::size_t j_global, std::size_t n_regressors, double *hyperparameters, const kernel_function &kernel, const std::vector<double> &i_input, const std::vector<double> &j_input);
 
 /**
  * @brief Generate a tile of the covariance matrix
@@ -15,32 +22,47 @@ double compute_covariance_function(std::size_t i_global, std::size_t j_global, s
  * @param N size of the tile
  * @param n_regressors number of regressors
  * @param hyperparameters hyperparameters of the covariance function
+ * @param kernel covariance function
  * @param input input data
  */
-std::vector<double> gen_tile_covariance(std::size_t row, std::size_t col, std::size_t N, std::size_t n_regressors, double *hyperparameters, const std::vector<double> &input);
+template <typename T>
+mutable_tile_data<T> gen_tile_covariance(std::size_t row, std::size_t col, std::size_t N, std::size_t n_regressors, double *hyperparameters, const kernel_function &kernel, const std::vector<double> &input);
 
 // generate a tile of the prior covariance matrix
-std::vector<double> gen_tile_full_prior_covariance(
-    std::size_t row, std::size_t col, std::size_t N, std::size_t n_regressors, double *hyperparameters, const std::vector<double> &input);
+template <typename T>
+mutable_tile_data<T> gen_tile_full_prior_covariance(
+    std::size_t row, std::size_t col, std::size_t N, std::size_t n_regressors, double *hyperparameters, const kernel_function &kernel, const std::vector<double> &input);
 
 // generate a tile of the prior covariance matrix
-std::vector<double> gen_tile_prior_covariance(std::size_t row, std::size_t col, std::size_t N, std::size_t n_regressors, double *hyperparameters, const std::vector<double> &input);
+template <typename T>
+mutable_tile_data<T> gen_tile_prior_covariance(std::size_t row, std::size_t col, std::size_t N, std::size_t n_regressors, double *hyperparameters, const kernel_function &kernel, const std::vector<double> &input);
 
 // generate a tile of the cross-covariance matrix
-std::vector<double> gen_tile_cross_covariance(
-    std::size_t row, std::size_t col, std::size_t N_row, std::size_t N_col, std::size_t n_regressors, double *hyperparameters, const std::vector<double> &row_input, const std::vector<double> &col_input);
+template <typename T>
+mutable_tile_data<T> gen_tile_cross_covariance(
+    std::size_t row, std::size_t col, std::size_t N_row, std::size_t N_col, std::size_t n_regressors, double *hyperparameters, const kernel_function &kernel, const std::vector<double> &row_input, const std::vector<double> &col_input);
 
 // generate a tile of the cross-covariance matrix
-std::vector<double>
-gen_tile_cross_cov_T(std::size_t N_row, std::size_t N_col, const std::vector<double> &cross_covariance_tile);
+template <typename T>
+mutable_tile_data<T>
+gen_tile_cross_cov_T(std::size_t N_row, std::size_t N_col, const const_tile_data<T> &cross_covariance_tile);
 
 // generate a tile containing the output observations
-std::vector<double> gen_tile_output(std::size_t row, std::size_t N, const std::vector<double> &output);
+template <typename T>
+mutable_tile_data<T> gen_tile_output(std::size_t row, std::size_t N, const std::vector<double> &output);
 
 // compute the total 2-norm error
 double compute_error_norm(std::size_t n_tiles, std::size_t tile_size, const std::vector<double> &b, const std::vector<std::vector<double>> &tiles);
 
 // generate an empty tile
-std::vector<double> gen_tile_zeros(std::size_t N);
+template <typename T>
+mutable_tile_data<T> gen_tile_zeros(std::size_t N);
+
+// round a tile to the element type T
+template <typename T, typename S>
+mutable_tile_data<T> convert_tile(const const_tile_data<S> &tile);
+
+// x + d for a double precision tile x and a single precision correction d
+mutable_tile_data<double> add_correction(const mutable_tile_data<double> &x, const const_tile_data<float> &d, std::size_t N);
 
 #endif  // end of GP_ALGORITHMS_CPU_H
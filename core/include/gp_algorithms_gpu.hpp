@@ -0,0 +1,44 @@
+#ifndef GP_ALGORITHMS_GPU_H
+#define GP_ALGORITHMS_GPU_H
+
+#include "device_tile_data.hpp"
+#include <vector>
+
+// Tile assembly on the GPU, the counterparts of gp_algorithms_cpu.hpp and
+// gp_uncertainty.hpp. The input data are device tiles holding the whole
+// training or test input, uploaded once per fit or prediction.
+
+namespace gpu
+{
+
+// generate a tile of the covariance matrix
+device_tile_data<double> gen_tile_covariance(std::size_t row, std::size_t col, std::size_t N, std::size_t n_regressors, double *hyperparameters, const device_tile_data<double> &input);
+
+// generate the diagonal of a tile of the prior covariance matrix
+device_tile_data<double> gen_tile_prior_covariance(std::size_t row, std::size_t col, std::size_t N, std::size_t n_regressors, double *hyperparameters, const device_tile_data<double> &input);
+
+// generate a tile of the cross-covariance matrix
+device_tile_data<double> gen_tile_cross_covariance(
+    std::size_t row, std::size_t col, std::size_t N_row, std::size_t N_col, std::size_t n_regressors, double *hyperparameters, const device_tile_data<double> &row_input, const device_tile_data<double> &col_input);
+
+// generate the transpose of a tile of the cross-covariance matrix
+device_tile_data<double>
+gen_tile_cross_cov_T(std::size_t N_row, std::size_t N_col, const device_tile_data<double> &cross_covariance_tile);
+
+// generate a tile containing the output observations
+device_tile_data<double> gen_tile_output(std::size_t row, std::size_t N, const std::vector<double> &output);
+
+// generate an empty tile
+device_tile_data<double> gen_tile_zeros(std::size_t N);
+
+// generate an N x N identity tile
+device_tile_data<double> gen_tile_identity(std::size_t N);
+
+// A - B for the diagonals A and B of the prior and the subtracted covariance
+device_tile_data<double> diag_posterior(const device_tile_data<double> &A,
+                                        const device_tile_data<double> &B,
+                                        std::size_t M);
+
+}  // namespace gpu
+
+#endif  // end of GP_ALGORITHMS_GPU_H
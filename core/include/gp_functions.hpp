@@ -1,11 +1,42 @@
 #ifndef GP_FUNCTIONS_H
 #define GP_FUNCTIONS_H
 
+#include "covariance_format.hpp"
+#include "distance_cache.hpp"
+#include "distribution_policy.hpp"
+#include "gp_optimizer.hpp"
+#include "solver.hpp"
+#include "tile_data.hpp"
+#include <array>
 #include <hpx/future.hpp>
+#include <memory>
+#include <string>
 #include <vector>
 
+class distributed_tiles;
+
 namespace gpxpy_hyper
 {
+// How the optimizer computes trace(inv(K) * del(K)/del(hyperparam))
+enum class TraceMode
+{
+    // form K^-1 explicitly by solving L * L^T * X = I
+    Explicit,
+    // lower tiles of K^-1 from the Cholesky factor, symmetric gradient tiles
+    Cholesky,
+    // stochastic estimate from Rademacher probes, no K^-1 at all
+    Hutchinson
+};
+
+// Update rule of the optimizer
+enum class Optimizer
+{
+    // fixed number of Adam steps with the learning rate
+    Adam,
+    // L-BFGS with a backtracking line search, stops early at convergence
+    LBFGS
+};
+
 struct Hyperparameters
 {
     double learning_rate;
@@ -15,15 +46,94 @@ struct Hyperparameters
     int opt_iter;
     std::vector<double> M_T;
     std::vector<double> V_T;
+    TraceMode trace_mode;
+    int n_probes;
+    unsigned seed;
+    Optimizer optimizer;
+    double tolerance;
+    int history;
 
     // Initialize Hyperparameter constructor
-    Hyperparameters(double lr = 0.001, double b1 = 0.9, double b2 = 0.999, double eps = 1e-8, int opt_i = 0, std::vector<double> M_T = { 0.0, 0.0, 0.0 }, std::vector<double> V_T = { 0.0, 0.0, 0.0 });
+    Hyperparameters(double lr = 0.001, double b1 = 0.9, double b2 = 0.999, double eps = 1e-8, int opt_i = 0, std::vector<double> M_T = { 0.0, 0.0, 0.0 }, std::vector<double> V_T = { 0.0, 0.0, 0.0 }, TraceMode trace_mode = TraceMode::Explicit, int n_probes = 32, unsigned seed = 0,
+                    Optimizer optimizer = Optimizer::Adam, double tolerance = 1e-6, int history = 10);
 
     // Print Hyperparameter attributes
     std::string repr() const;
 };
+
+// Name of a trace mode
+std::string trace_mode_name(TraceMode mode);
+
+// Name of an optimizer
+std::string optimizer_name(Optimizer optimizer);
 }  // namespace gpxpy_hyper
 
+// Compute Cholesky factor and alpha = K^-1 * y used by the predictions
+void fit_hpx(const std::vector<double> &training_input,
+             const std::vector<double> &training_output,
+             int n_tiles,
+             int n_tile_size,
+             double lengthscale,
+             double vertical_lengthscale,
+             double noise_variance,
+             int n_regressors,
+             const kernel_function &kernel,
+             std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+             std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles);
+
+// Compute the Cholesky factor on the localities of `policy` and alpha = K^-1 * y
+// on the calling locality. `diag_tiles` receives local copies of the diagonal
+// tiles of L, as used by the loss, at their n_tiles x n_tiles positions.
+void fit_distributed_hpx(const std::vector<double> &training_input,
+                         const std::vector<double> &training_output,
+                         int n_tiles,
+                         int n_tile_size,
+                         double lengthscale,
+                         double vertical_lengthscale,
+                         double noise_variance,
+                         int n_regressors,
+                         const distribution_policy &policy,
+                         std::shared_ptr<distributed_tiles> &K_tiles,
+                         std::vector<hpx::shared_future<mutable_tile_data<double>>> &diag_tiles,
+                         std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles);
+
+// Compute the Cholesky factor in single precision and alpha = K^-1 * y in
+// double precision by `refinement_steps` steps of iterative refinement.
+// `diag_tiles` receives double precision copies of the diagonal tiles of L, as
+// used by the loss, at their n_tiles x n_tiles positions, `residuals` the
+// relative residual ||y - K * alpha|| / ||y|| after the first solve and after
+// each refinement step.
+void fit_mixed_hpx(const std::vector<double> &training_input,
+                   const std::vector<double> &training_output,
+                   int n_tiles,
+                   int n_tile_size,
+                   double lengthscale,
+                   double vertical_lengthscale,
+                   double noise_variance,
+                   int n_regressors,
+                   const kernel_function &kernel,
+                   int refinement_steps,
+                   std::vector<hpx::shared_future<mutable_tile_data<float>>> &L_tiles,
+                   std::vector<hpx::shared_future<mutable_tile_data<double>>> &diag_tiles,
+                   std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+                   std::vector<double> &residuals);
+
+// Extend the Cholesky factor and alpha of a fitted GP by the samples appended
+// to the training data after the first n_old_samples and drop its leading
+// n_dropped_tiles tiles, without refactoring the covariance matrix
+void append_fitted_hpx(const std::vector<double> &training_input,
+                       const std::vector<double> &training_output,
+                       std::size_t n_old_samples,
+                       int n_dropped_tiles,
+                       int n_tile_size,
+                       double lengthscale,
+                       double vertical_lengthscale,
+                       double noise_variance,
+                       int n_regressors,
+                       const kernel_function &kernel,
+                       std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+                       std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles);
+
 // Compute the predictions
 hpx::shared_future<std::vector<double>>
 predict_hpx(const std::vector<double> &training_input,
@@ -36,7 +146,57 @@ predict_hpx(const std::vector<double> &training_input,
             double lengthscale,
             double vertical_lengthscale,
             double noise_variance,
-            int n_regressors);
+            int n_regressors,
+            const kernel_function &kernel);
+
+// Compute the predictions with the squared exponential kernel and the
+// covariance matrix distributed by `policy`
+hpx::shared_future<std::vector<double>>
+predict_hpx(const std::vector<double> &training_input,
+            const std::vector<double> &training_output,
+            const std::vector<double> &test_data,
+            int n_tiles,
+            int n_tile_size,
+            int m_tiles,
+            int m_tile_size,
+            double lengthscale,
+            double vertical_lengthscale,
+            double noise_variance,
+            int n_regressors,
+            const distribution_policy &policy);
+
+// Compute the predictions with alpha = K^-1 * y from the conjugate gradients
+// of Solver::Iterative, without storing the covariance matrix
+hpx::shared_future<std::vector<double>>
+predict_hpx(const std::vector<double> &training_input,
+            const std::vector<double> &training_output,
+            const std::vector<double> &test_data,
+            int n_tiles,
+            int n_tile_size,
+            int m_tiles,
+            int m_tile_size,
+            double lengthscale,
+            double vertical_lengthscale,
+            double noise_variance,
+            int n_regressors,
+            const kernel_function &kernel,
+            const iterative_settings &settings);
+
+// Compute the predictions from a precomputed Cholesky factor and alpha
+hpx::shared_future<std::vector<double>>
+predict_fitted_hpx(const std::vector<double> &training_input,
+                   const std::vector<double> &test_input,
+                   const std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+                   const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+                   int n_tiles,
+                   int n_tile_size,
+                   int m_tiles,
+                   int m_tile_size,
+                   double lengthscale,
+                   double vertical_lengthscale,
+                   double noise_variance,
+                   int n_regressors,
+                   const kernel_function &kernel);
 
 // Compute the predictions and uncertainties
 hpx::shared_future<std::vector<std::vector<double>>>
@@ -50,9 +210,46 @@ predict_with_uncertainty_hpx(const std::vector<double> &training_input,
                              double lengthscale,
                              double vertical_lengthscale,
                              double noise_variance,
-                             int n_regressors);
+                             int n_regressors,
+                             const kernel_function &kernel);
+
+// Compute the predictions and uncertainties from a precomputed Cholesky
+// factor and alpha
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_uncertainty_fitted_hpx(
+    const std::vector<double> &training_input,
+    const std::vector<double> &test_input,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+    int n_tiles,
+    int n_tile_size,
+    int m_tiles,
+    int m_tile_size,
+    double lengthscale,
+    double vertical_lengthscale,
+    double noise_variance,
+    int n_regressors,
+    const kernel_function &kernel);
+
+// Compute the predictions and uncertainties from a single precision Cholesky
+// factor and a double precision alpha, see `fit_mixed_hpx`
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_uncertainty_mixed_hpx(
+    const std::vector<double> &training_input,
+    const std::vector<double> &test_input,
+    const std::vector<hpx::shared_future<mutable_tile_data<float>>> &L_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+    int n_tiles,
+    int n_tile_size,
+    int m_tiles,
+    int m_tile_size,
+    double lengthscale,
+    double vertical_lengthscale,
+    double noise_variance,
+    int n_regressors,
+    const kernel_function &kernel);
 
-// Compute the predictions and full covariance matrix
+// Compute the predictions and the posterior covariance in `format`
 hpx::shared_future<std::vector<std::vector<double>>>
 predict_with_full_cov_hpx(const std::vector<double> &training_input,
                           const std::vector<double> &training_output,
@@ -64,7 +261,31 @@ predict_with_full_cov_hpx(const std::vector<double> &training_input,
                           double lengthscale,
                           double vertical_lengthscale,
                           double noise_variance,
-                          int n_regressors);
+                          int n_regressors,
+                          const kernel_function &kernel,
+                          CovarianceFormat format);
+
+// Compute the predictions and the posterior covariance in `format` from a
+// precomputed Cholesky factor and alpha: {mean, variance} followed by the
+// packed lower triangle of the posterior covariance for
+// CovarianceFormat::Lower or by the packed lower triangle of K_MxM and V for
+// CovarianceFormat::LowRank
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_full_cov_fitted_hpx(
+    const std::vector<double> &training_input,
+    const std::vector<double> &test_input,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+    int n_tiles,
+    int n_tile_size,
+    int m_tiles,
+    int m_tile_size,
+    double lengthscale,
+    double vertical_lengthscale,
+    double noise_variance,
+    int n_regressors,
+    const kernel_function &kernel,
+    CovarianceFormat format);
 
 // Compute loss for given data and Gaussian process model
 hpx::shared_future<double>
@@ -73,9 +294,138 @@ compute_loss_hpx(const std::vector<double> &training_input,
                  int n_tiles,
                  int n_tile_size,
                  int n_regressors,
-                 double *hyperparameters);
+                 double *hyperparameters,
+                 const kernel_function &kernel);
+
+// Estimate the loss by the conjugate gradients and stochastic Lanczos
+// quadrature of Solver::Iterative, without storing the covariance matrix
+hpx::shared_future<double>
+compute_loss_hpx(const std::vector<double> &training_input,
+                 const std::vector<double> &training_output,
+                 int n_tiles,
+                 int n_tile_size,
+                 int n_regressors,
+                 double *hyperparameters,
+                 const kernel_function &kernel,
+                 const iterative_settings &settings);
+
+// Compute loss from a precomputed Cholesky factor and alpha
+hpx::shared_future<double>
+compute_loss_fitted_hpx(
+    const std::vector<double> &training_output,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+    int n_tiles,
+    int n_tile_size);
+
+/**
+ * @brief Covariance tiles and their derivatives assembled for one optimizer
+ * iteration
+ */
+struct optimizer_tiles
+{
+    /** @brief Tiles of K, replaced by its Cholesky factor */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> K_tiles;
+
+    /** @brief Tiles of dK / dlengthscale, empty if not trainable */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> grad_l_tiles;
+
+    /** @brief Tiles of dK / dvertical_lengthscale, empty if not trainable */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> grad_v_tiles;
+};
+
+/**
+ * @brief State of an optimizer session that is kept between steps
+ */
+struct optimizer_session_state
+{
+    /** @brief Kernel and Adam hyperparameters after the last step */
+    hpx::shared_future<optimizer_parameters> hyperparameters;
+
+    /** @brief Tiles of the training output */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles;
+
+    /** @brief Tiling of y_tiles and next_tiles */
+    int n_tiles;
+
+    int n_tile_size;
+
+    /**
+     * @brief Generation of the training data of y_tiles, see
+     * GP::_data_generation
+     */
+    std::size_t data_generation;
+
+    /** @brief First and second moments of Adam */
+    std::vector<hpx::shared_future<double>> m_T;
+
+    std::vector<hpx::shared_future<double>> v_T;
+
+    /** @brief Number of steps taken */
+    int iter;
 
-// Perform optimization for a given number of iterations
+    /** @brief Tiles of the next step, scheduled at the end of the previous one */
+    optimizer_tiles next_tiles;
+
+    /** @brief True if next_tiles was scheduled for the current hyperparameters */
+    bool assembled;
+
+    /**
+     * @brief Trainable parameters and number of regressors next_tiles was
+     * scheduled with, the derivative tiles only exist for trainable ones
+     */
+    std::vector<bool> trainable_params;
+
+    int n_regressors;
+};
+
+// Initialize an optimizer session for the given hyperparameters. M_T and V_T
+// of hyperparams are the initial moments.
+void init_optimizer_session_hpx(optimizer_session_state &state,
+                                const std::vector<double> &training_output,
+                                int n_tiles,
+                                int n_tile_size,
+                                double lengthscale,
+                                double vertical_lengthscale,
+                                double noise_variance,
+                                const kernel_function &kernel,
+                                const gpxpy_hyper::Hyperparameters &hyperparams);
+
+// Perform one optimization step of a session and schedule the assembly of the
+// next step. Does not block.
+hpx::shared_future<double> optimizer_session_step_hpx(optimizer_session_state &state,
+                                  const std::vector<double> &training_input,
+                                  const std::vector<double> &training_output,
+                                  int n_tiles,
+                                  int n_tile_size,
+                                  int n_regressors,
+                                  const gpxpy_hyper::Hyperparameters &hyperparams,
+                                  const std::vector<bool> &trainable_params,
+                                  distance_tile_cache &distance_cache);
+
+// Drop the tiles scheduled ahead by a session step
+void discard_optimizer_session_tiles(optimizer_session_state &state);
+
+// Reassemble the output tiles of a session for changed training data or
+// tiling and drop the tiles scheduled ahead
+void update_optimizer_session_data(optimizer_session_state &state,
+                                   const std::vector<double> &training_output,
+                                   int n_tiles,
+                                   int n_tile_size);
+
+// Optimizer parameters for the given kernel, its hyperparameters and Adam
+// settings
+optimizer_parameters
+make_optimizer_parameters(double lengthscale,
+                          double vertical_lengthscale,
+                          double noise_variance,
+                          const kernel_function &kernel,
+                          const gpxpy_hyper::Hyperparameters &hyperparams);
+
+// Perform optimization for a given number of iterations, reusing the
+// squared distance tiles held by distance_cache. With Optimizer::LBFGS
+// opt_iter bounds the number of iterations, which stop once converged, and
+// the losses are those of the initial hyperparameters and of each iterate.
 hpx::shared_future<std::vector<double>>
 optimize_hpx(const std::vector<double> &training_input,
              const std::vector<double> &training_output,
@@ -85,10 +435,13 @@ optimize_hpx(const std::vector<double> &training_input,
              double &vertical_lengthscale,
              double &noise_variance,
              int n_regressors,
+             const kernel_function &kernel,
              const gpxpy_hyper::Hyperparameters &hyperparams,
-             std::vector<bool> trainable_params);
+             std::vector<bool> trainable_params,
+             distance_tile_cache &distance_cache);
 
-// Perform a single optimization step
+// Perform a single optimization step, reusing the squared distance tiles
+// held by distance_cache
 hpx::shared_future<double>
 optimize_step_hpx(const std::vector<double> &training_input,
                   const std::vector<double> &training_output,
@@ -98,9 +451,83 @@ optimize_step_hpx(const std::vector<double> &training_input,
                   double &vertical_lengthscale,
                   double &noise_variance,
                   int n_regressors,
+                  const kernel_function &kernel,
                   gpxpy_hyper::Hyperparameters &hyperparams,
                   std::vector<bool> trainable_params,
-                  int iter);
+                  int iter,
+                  distance_tile_cache &distance_cache);
+
+/**
+ * @brief Cholesky factor and alpha of the members of a batch of GPs on the
+ * same training input that share their hyperparameters
+ */
+struct batched_fit
+{
+    /** @brief Lengthscale, vertical lengthscale and noise variance */
+    std::array<double, 3> params;
+
+    /** @brief Indices of the training outputs of the members */
+    std::vector<std::size_t> outputs;
+
+    /** @brief Lower tiles of the Cholesky factor */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> K_tiles;
+
+    /**
+     * @brief Tiles of alpha = K^-1 * Y, n_tile_size x outputs.size() each,
+     * with one column per member
+     */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha_tiles;
+};
+
+// Compute the Cholesky factor and alpha of every fit in one task graph. The
+// squared distance tiles held by distance_cache are shared by all fits, the
+// outputs of a fit are solved as one multi-column right-hand side.
+void fit_batched_hpx(const std::vector<double> &training_input,
+                     const std::vector<std::vector<double>> &training_outputs,
+                     int n_tiles,
+                     int n_tile_size,
+                     int n_regressors,
+                     distance_tile_cache &distance_cache,
+                     std::vector<batched_fit> &fits);
+
+// Compute the predictions of every member of the fits: one entry per output
+// of each fit, in order, holding the mean and, if `uncertainty` is set, the
+// variance
+hpx::shared_future<std::vector<std::vector<std::vector<double>>>>
+predict_batched_hpx(const std::vector<double> &training_input,
+                    const std::vector<double> &test_input,
+                    const std::vector<batched_fit> &fits,
+                    int n_tiles,
+                    int n_tile_size,
+                    int m_tiles,
+                    int m_tile_size,
+                    int n_regressors,
+                    bool uncertainty);
+
+// Compute the loss of every member of the fits: result[f][o] is the loss of
+// output o of fit f
+hpx::shared_future<std::vector<std::vector<double>>>
+compute_loss_batched_hpx(const std::vector<std::vector<double>> &training_outputs,
+                         const std::vector<batched_fit> &fits,
+                         int n_tiles,
+                         int n_tile_size);
+
+// Optimize the hyperparameters of every member of a batch for
+// hyperparams.opt_iter iterations in one task graph, reusing the squared
+// distance tiles held by distance_cache. Member m is trained on
+// training_outputs[member_outputs[m]] starting from member_params[m], which is
+// updated. Returns the losses of each member.
+hpx::shared_future<std::vector<std::vector<double>>>
+optimize_batched_hpx(const std::vector<double> &training_input,
+                     const std::vector<std::vector<double>> &training_outputs,
+                     const std::vector<std::size_t> &member_outputs,
+                     int n_tiles,
+                     int n_tile_size,
+                     std::vector<std::array<double, 3>> &member_params,
+                     int n_regressors,
+                     const gpxpy_hyper::Hyperparameters &hyperparams,
+                     const std::vector<bool> &trainable_params,
+                     distance_tile_cache &distance_cache);
 
 // Compute Cholesky decomposition
 hpx::shared_future<std::vector<std::vector<double>>>
@@ -111,6 +538,7 @@ cholesky_hpx(const std::vector<double> &training_input,
              double lengthscale,
              double vertical_lengthscale,
              double noise_variance,
-             int n_regressors);
+             int n_regressors,
+             const kernel_function &kernel);
 
 #endif
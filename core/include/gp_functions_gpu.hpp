@@ -0,0 +1,73 @@
+#ifndef GP_FUNCTIONS_GPU_H
+#define GP_FUNCTIONS_GPU_H
+
+#include "device_tile_data.hpp"
+#include <hpx/future.hpp>
+#include <vector>
+
+namespace gpu
+{
+
+/**
+ * @brief Device-resident state of a GP fitted on the GPU
+ *
+ * The training input is uploaded once per fit, the Cholesky factor and alpha
+ * stay on the device for all predictions.
+ */
+struct fit_state
+{
+    /** @brief Training input data */
+    device_tile_data<double> training_input;
+
+    /** @brief Lower tiles of the Cholesky factor L */
+    std::vector<hpx::shared_future<device_tile_data<double>>> L_tiles;
+
+    /** @brief Tiles of alpha = K^-1 * y */
+    std::vector<hpx::shared_future<device_tile_data<double>>> alpha_tiles;
+};
+
+// Compute Cholesky factor and alpha = K^-1 * y on the GPU. `diag_tiles`
+// receives host copies of the diagonal tiles of L, as used by the loss, at
+// their n_tiles x n_tiles positions, `alpha_tiles` host copies of alpha.
+void fit_hpx(const std::vector<double> &training_input,
+             const std::vector<double> &training_output,
+             int n_tiles,
+             int n_tile_size,
+             double lengthscale,
+             double vertical_lengthscale,
+             double noise_variance,
+             int n_regressors,
+             fit_state &state,
+             std::vector<hpx::shared_future<mutable_tile_data<double>>> &diag_tiles,
+             std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles);
+
+// Compute the predictions from a Cholesky factor and alpha on the GPU
+hpx::shared_future<std::vector<double>>
+predict_fitted_hpx(const fit_state &state,
+                   const std::vector<double> &test_input,
+                   int n_tiles,
+                   int n_tile_size,
+                   int m_tiles,
+                   int m_tile_size,
+                   double lengthscale,
+                   double vertical_lengthscale,
+                   double noise_variance,
+                   int n_regressors);
+
+// Compute the predictions and uncertainties from a Cholesky factor and alpha
+// on the GPU
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_uncertainty_fitted_hpx(const fit_state &state,
+                                    const std::vector<double> &test_input,
+                                    int n_tiles,
+                                    int n_tile_size,
+                                    int m_tiles,
+                                    int m_tile_size,
+                                    double lengthscale,
+                                    double vertical_lengthscale,
+                                    double noise_variance,
+                                    int n_regressors);
+
+}  // namespace gpu
+
+#endif  // end of GP_FUNCTIONS_GPU_H
@@ -0,0 +1,82 @@
+#ifndef GP_ITERATIVE_H
+#define GP_ITERATIVE_H
+
+#include "kernels.hpp"
+#include "solver.hpp"
+#include "tile_data.hpp"
+#include <hpx/future.hpp>
+#include <vector>
+
+/**
+ * @brief Iterative inference without the covariance matrix, Solver::Iterative
+ *
+ * K * alpha = y is solved by conjugate gradients preconditioned with
+ * P = L_k * L_k^T + noise_variance * I, where L_k is the rank k pivoted
+ * Cholesky factor of the noise-free covariance matrix. P^-1 and log det P
+ * follow from the k x k matrix noise_variance * I + L_k^T * L_k by the
+ * Woodbury identity and the matrix determinant lemma.
+ *
+ * For the loss, the conjugate gradients run batched on [y, z_1, ..., z_t]
+ * with probe vectors z_i ~ N(0, P). The step lengths and directions of each
+ * probe define the Lanczos tridiagonal matrix T_i of P^-1/2 * K * P^-1/2, of
+ * which stochastic Lanczos quadrature estimates
+ * log det K = log det P + 1/t * sum_i z_i^T * P^-1 * z_i * e_1^T * log(T_i) * e_1.
+ *
+ * The right-hand sides are held as one tile of n_tile_size x (1 + t) per
+ * training tile. Each product with K is a dataflow graph over the tile pairs,
+ * whose tasks generate their covariance tile, multiply with it and drop it,
+ * such that K is never stored. The iterations only synchronize on the
+ * scalars of the conjugate gradients, once per iteration.
+ */
+namespace iterative
+{
+/** @brief Solution of the conjugate gradients for a GP */
+struct fit_state
+{
+    /** @brief Tiles of alpha = K^-1 * y */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha_tiles;
+
+    /**
+     * @brief Negative log marginal likelihood per sample with the estimated
+     * log det K, NaN if the loss was not requested
+     */
+    double loss;
+
+    /**
+     * @brief Relative residual ||y - K * alpha|| / ||y|| after each
+     * iteration
+     */
+    std::vector<double> residuals;
+};
+
+// Solve K * alpha = y by preconditioned conjugate gradients and, if
+// `with_loss` is set, estimate the loss from the same iterations. Blocks.
+fit_state fit_hpx(const std::vector<double> &training_input,
+                  const std::vector<double> &training_output,
+                  int n_tiles,
+                  int n_tile_size,
+                  double lengthscale,
+                  double vertical_lengthscale,
+                  double noise_variance,
+                  int n_regressors,
+                  const kernel_function &kernel,
+                  const iterative_settings &settings,
+                  bool with_loss);
+
+// Compute the predictions from alpha, generating the cross-covariance tiles
+// in the tasks that multiply with them. Does not block.
+hpx::shared_future<std::vector<double>>
+predict_fitted_hpx(const std::vector<double> &training_input,
+                   const std::vector<double> &test_input,
+                   const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+                   int n_tiles,
+                   int n_tile_size,
+                   int m_tiles,
+                   int m_tile_size,
+                   double lengthscale,
+                   double vertical_lengthscale,
+                   int n_regressors,
+                   const kernel_function &kernel);
+}  // namespace iterative
+
+#endif  // end of GP_ITERATIVE_H
@@ -1,9 +1,27 @@
 #ifndef GP_OPTIMIZER_H
 #define GP_OPTIMIZER_H
 
+#include "kernels.hpp"
+#include "tile_data.hpp"
 #include <cmath>
 #include <vector>
 
+/**
+ * @brief Hyperparameters of one optimizer iteration, passed between tasks by
+ *        value: lengthscale, vertical lengthscale, noise variance, learning
+ *        rate, beta1, beta2 and epsilon, and the kernel they parametrize.
+ */
+struct optimizer_parameters
+{
+    double values[7];
+
+    kernel_function kernel;
+
+    double operator[](std::size_t i) const { return values[i]; }
+
+    double &operator[](std::size_t i) { return values[i]; }
+};
+
 /**
  * @brief Transform hyperparameter to enforce constraints using softplus.
  */
@@ -22,86 +40,76 @@ double to_unconstrained(const double &parameter, bool noise);
 double compute_sigmoid(const double &parameter);
 
 /**
- * @brief Compute the distance divided by the lengthscale.
+ * @brief Compute the squared distance of the lagged feature vectors.
  */
 double compute_covariance_dist_func(std::size_t i_global,
                                     std::size_t j_global,
                                     std::size_t n_regressors,
-                                    double *hyperparameters,
                                     const std::vector<double> &i_input,
                                     const std::vector<double> &j_input);
 
 /**
- * @brief Compute vector of distances devided by the lengthscale.
+ * @brief Compute a tile of squared distances. They do not depend on the
+ *        hyperparameters and may be reused across optimizer iterations.
  */
-std::vector<double> compute_cov_dist_vec(std::size_t row,
-                                         std::size_t col,
-                                         std::size_t N,
-                                         std::size_t n_regressors,
-                                         double *hyperparameters,
-                                         const std::vector<double> &input);
+mutable_tile_data<double> compute_cov_dist_vec(std::size_t row,
+                                               std::size_t col,
+                                               std::size_t N,
+                                               std::size_t n_regressors,
+                                               const std::vector<double> &input);
 
 /**
  * @brief Generate a tile of the covariance matrix.
  */
-std::vector<double>
+mutable_tile_data<double>
 gen_tile_covariance_opt(std::size_t row,
                         std::size_t col,
                         std::size_t N,
                         std::size_t n_regressors,
-                        double *hyperparameters,
-                        const std::vector<double> &cov_dists);
+                        std::size_t n_samples,
+                        const optimizer_parameters &hyperparameters,
+                        const const_tile_data<double> &cov_dists);
 
 /**
  * @brief Generate a derivative tile w.r.t. vertical_lengthscale.
  */
-std::vector<double> gen_tile_grad_v(std::size_t row,
-                                    std::size_t col,
-                                    std::size_t N,
-                                    std::size_t n_regressors,
-                                    double *hyperparameters,
-                                    const std::vector<double> &cov_dists);
+mutable_tile_data<double> gen_tile_grad_v(std::size_t row,
+                                          std::size_t col,
+                                          std::size_t N,
+                                          std::size_t n_regressors,
+                                          std::size_t n_samples,
+                                          const optimizer_parameters &hyperparameters,
+                                          const const_tile_data<double> &cov_dists);
 
 /**
  * @brief Generate a derivative tile w.r.t. lengthscale.
  */
-std::vector<double> gen_tile_grad_l(std::size_t row,
-                                    std::size_t col,
-                                    std::size_t N,
-                                    std::size_t n_regressors,
-                                    double *hyperparameters,
-                                    const std::vector<double> &cov_dists);
-
-/**
- * @brief Generate a derivative tile w.r.t. lengthscale.
- */
-std::vector<double>
-gen_tile_grad_v_trans(std::size_t N, const std::vector<double> &grad_l_tile);
-
-/**
- * @brief Generate a derivative tile w.r.t. lengthscale.
- */
-std::vector<double>
-gen_tile_grad_l_trans(std::size_t N, const std::vector<double> &grad_l_tile);
+mutable_tile_data<double> gen_tile_grad_l(std::size_t row,
+                                          std::size_t col,
+                                          std::size_t N,
+                                          std::size_t n_regressors,
+                                          std::size_t n_samples,
+                                          const optimizer_parameters &hyperparameters,
+                                          const const_tile_data<double> &cov_dists);
 
 /**
  * @brief Compute hyper-parameter beta_1 or beta_2 to power t.
  */
-double gen_beta_T(int t, double *hyperparameters, int param_idx);
+double gen_beta_T(int t, const optimizer_parameters &hyperparameters, int param_idx);
 
 /**
  * @brief Compute negative-log likelihood tiled.
  */
-double compute_loss(const std::vector<double> &K_diag_tile,
-                    const std::vector<double> &alpha_tile,
-                    const std::vector<double> &y_tile,
+double compute_loss(const const_tile_data<double> &K_diag_tile,
+                    const const_tile_data<double> &alpha_tile,
+                    const const_tile_data<double> &y_tile,
                     std::size_t N);
 
 /**
  * @brief Compute negative-log likelihood.
  */
 double
-add_losses(const std::vector<double> &losses, std::size_t N, std::size_t n);
+add_losses(const std::vector<double> &losses, std::size_t n_samples);
 
 /**
  * @brief Compute trace of (K^-1 - K^-1*y*y^T*K^-1)* del(K)/del(hyperparam) =
@@ -109,8 +117,7 @@ add_losses(const std::vector<double> &losses, std::size_t N, std::size_t n);
  */
 double compute_gradient(const double &grad_l,
                         const double &grad_r,
-                        std::size_t N,
-                        std::size_t n_tiles);
+                        std::size_t n_samples);
 
 /**
  * @brief Compute trace for noise variance.
@@ -119,27 +126,51 @@ double compute_gradient(const double &grad_l,
  * diag tiles multiplied by derivative of noise_variance.
  */
 double compute_gradient_noise(const std::vector<std::vector<double>> &ft_tiles,
-                              double *hyperparameters,
+                              const optimizer_parameters &hyperparameters,
                               std::size_t N,
                               std::size_t n_tiles);
 
 /**
  * @brief Update biased first raw moment estimate.
  */
-double
-update_first_moment(const double &gradient, double m_T, const double &beta_1);
+double update_first_moment(const double &gradient,
+                           double m_T,
+                           const optimizer_parameters &hyperparameters);
 
 /**
  * @brief Update biased second raw moment estimate.
  */
-double
-update_second_moment(const double &gradient, double v_T, const double &beta_2);
+double update_second_moment(const double &gradient,
+                            double v_T,
+                            const optimizer_parameters &hyperparameters);
+
+/**
+ * @brief Returns hyperparameter param_idx transformed to the entire real line.
+ */
+double gen_unconstrained_param(const optimizer_parameters &hyperparameters,
+                               int param_idx);
+
+/**
+ * @brief Returns hyperparameter param_idx.
+ */
+double get_kernel_param(const optimizer_parameters &hyperparameters,
+                        int param_idx);
+
+/**
+ * @brief Returns hyperparameters with lengthscale, vertical lengthscale and
+ *        noise variance replaced.
+ */
+optimizer_parameters
+update_kernel_params(const optimizer_parameters &hyperparameters,
+                     double lengthscale,
+                     double vertical_lengthscale,
+                     double noise_variance);
 
 /**
  * @brief Update hyperparameter using gradient decent.
  */
 double update_param(const double &unconstrained_hyperparam,
-                    double *hyperparameters,
+                    const optimizer_parameters &hyperparameters,
                     const double &gradient,
                     double m_T,
                     double v_T,
@@ -148,37 +179,83 @@ double update_param(const double &unconstrained_hyperparam,
                     int iter);
 
 /**
- * @brief Generate an identity tile if i==j.
+ * @brief L-BFGS search direction -H * gradient by the two-loop recursion over
+ *        the stored steps and gradient changes, oldest first. Without history
+ *        it is -gradient, scaled down to a largest entry of at most one.
  */
 std::vector<double>
+lbfgs_direction(const std::vector<double> &gradient,
+                const std::vector<std::vector<double>> &steps,
+                const std::vector<std::vector<double>> &gradient_changes);
+
+/**
+ * @brief Store the step and gradient change of an accepted L-BFGS iteration,
+ *        keeping the last `history` pairs. Pairs that violate the curvature
+ *        condition step^T * gradient_change > 0 are skipped.
+ */
+void lbfgs_push(std::vector<std::vector<double>> &steps,
+                std::vector<std::vector<double>> &gradient_changes,
+                std::vector<double> step,
+                std::vector<double> gradient_change,
+                std::size_t history);
+
+/**
+ * @brief Generate an identity tile if i==j.
+ */
+mutable_tile_data<double>
 gen_tile_identity(std::size_t row, std::size_t col, std::size_t N);
 
 /**
  * @brief Generate an empty tile NxN.
  */
-std::vector<double> gen_tile_zeros_diag(std::size_t N);
+mutable_tile_data<double> gen_tile_zeros_diag(std::size_t N);
 
 /**
  * @brief return zero - used to initialize moment vectors
  */
 double gen_zero();
 
-double sum_gradleft(const std::vector<double> &diagonal, double grad);
+double sum_gradleft(const const_tile_data<double> &diagonal, double grad);
 
-double sum_gradright(const std::vector<double> &inter_alpha,
-                     const std::vector<double> &alpha,
+double sum_gradright(const const_tile_data<double> &inter_alpha,
+                     const const_tile_data<double> &alpha,
                      double grad,
                      std::size_t N);
 
-double sum_noise_gradleft(const std::vector<double> &ft_invK,
+double sum_noise_gradleft(const const_tile_data<double> &ft_invK,
                           double grad,
-                          double *hyperparameters,
+                          const optimizer_parameters &hyperparameters,
                           std::size_t N,
-                          std::size_t n_tiles);
+                          std::size_t n_valid);
 
-double sum_noise_gradright(const std::vector<double> &alpha,
+double sum_noise_gradright(const const_tile_data<double> &alpha,
                            double grad,
-                           double *hyperparameters,
+                           const optimizer_parameters &hyperparameters,
                            std::size_t N);
 
+/**
+ * @brief Generate a tile of n_probes Rademacher probe vectors scaled by
+ *        1/sqrt(n_probes), N x n_probes in row-major order. Rows past the
+ *        last of the n_samples samples are zero.
+ */
+mutable_tile_data<double> gen_tile_probes(std::size_t row,
+                                          std::size_t N,
+                                          std::size_t n_probes,
+                                          std::size_t n_samples,
+                                          unsigned seed);
+
+// add the contribution of a lower tile to trace(A * B) for symmetric A, B
+double sum_gradleft_lower(const const_tile_data<double> &A,
+                          const const_tile_data<double> &B,
+                          double grad,
+                          std::size_t N,
+                          bool diagonal);
+
+// add the contribution of a probe tile to the estimate of trace(inv(K))
+double sum_noise_gradleft_probes(const const_tile_data<double> &W,
+                                 const const_tile_data<double> &Z,
+                                 double grad,
+                                 const optimizer_parameters &hyperparameters,
+                                 std::size_t N);
+
 #endif  // end of GP_OPTIMIZER_H
@@ -0,0 +1,95 @@
+#ifndef GP_SPARSE_H
+#define GP_SPARSE_H
+
+#include "gp_functions.hpp"
+#include "tile_data.hpp"
+#include <hpx/future.hpp>
+#include <vector>
+
+/**
+ * @brief Sparse approximation of the GP with m inducing points
+ *
+ * The inducing points are the lagged feature vectors of an inducing input
+ * series of m samples, the same way the test points are those of the test
+ * input. The covariance matrix is replaced by
+ * Q = K_fu * K_uu^-1 * K_uf + noise_variance * I, where K_fu is the training x
+ * inducing cross-covariance. The predictions are those of the deterministic
+ * training conditional (DTC), the loss is the variational free energy (VFE)
+ * of Titsias, the DTC loss plus trace(K_ff - Q) / (2 * noise_variance), which
+ * keeps the optimizer from overfitting the inducing points.
+ *
+ * K_fu is held as one tile row of n_tile_size x m per training tile, the
+ * inducing points as a single m x m tile. With V = L_uu^-1 * K_uf, all terms
+ * reduce to the m x m matrix A = I + V * V^T / noise_variance, which is summed
+ * over the training tiles. Fit, loss, gradient and predictions thus run in
+ * O(N * m^2) time and O(N * m) memory.
+ */
+namespace sparse
+{
+/** @brief Factorization of the sparse GP used by its predictions */
+struct fit_state
+{
+    /** @brief Number of inducing points m */
+    std::size_t n_inducing;
+
+    /** @brief Cholesky factor of K_uu plus jitter on the diagonal */
+    mutable_tile_data<double> L_uu;
+
+    /** @brief Cholesky factor of A = I + V * V^T / noise_variance */
+    mutable_tile_data<double> L_A;
+
+    /** @brief A^-1 * V * y */
+    mutable_tile_data<double> beta;
+
+    /** @brief Weights of the predictive mean, mean = K_*u * weights */
+    mutable_tile_data<double> weights;
+
+    /** @brief Variational free energy per training sample */
+    double loss;
+};
+
+// Factor the sparse GP for the given hyperparameters
+hpx::shared_future<fit_state>
+fit_hpx(const std::vector<double> &training_input,
+        const std::vector<double> &training_output,
+        const std::vector<double> &inducing_input,
+        int n_tiles,
+        int n_tile_size,
+        double lengthscale,
+        double vertical_lengthscale,
+        double noise_variance,
+        double jitter,
+        int n_regressors);
+
+// Predict the mean and, if `uncertainty` is set, the latent variance of the
+// test input from a fitted state
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_hpx(const fit_state &state,
+            const std::vector<double> &inducing_input,
+            const std::vector<double> &test_input,
+            int m_tiles,
+            int m_tile_size,
+            double lengthscale,
+            double vertical_lengthscale,
+            int n_regressors,
+            bool uncertainty);
+
+// Minimize the variational free energy with Adam for hyperparams.opt_iter
+// iterations, updates the hyperparameters and returns the loss of each
+// iteration
+hpx::shared_future<std::vector<double>>
+optimize_hpx(const std::vector<double> &training_input,
+             const std::vector<double> &training_output,
+             const std::vector<double> &inducing_input,
+             int n_tiles,
+             int n_tile_size,
+             double &lengthscale,
+             double &vertical_lengthscale,
+             double &noise_variance,
+             double jitter,
+             int n_regressors,
+             const gpxpy_hyper::Hyperparameters &hyperparams,
+             const std::vector<bool> &trainable_params);
+}  // namespace sparse
+
+#endif  // end of GP_SPARSE_H
@@ -1,6 +1,7 @@
 #ifndef GP_UNCERTAINTY_H
 #define GP_UNCERTAINTY_H
 #pragma once
+#include "tile_data.hpp"
 #include <cmath>
 #include <vector>
 
@@ -13,9 +14,9 @@
  *
  * @return Diagonal elements of posterior covariance matrix
  */
-std::vector<double> diag_posterior(const std::vector<double> &A,
-                                   const std::vector<double> &B,
-                                   std::size_t M);
+mutable_tile_data<double> diag_posterior(const const_tile_data<double> &A,
+                                         const const_tile_data<double> &B,
+                                         std::size_t M);
 
 /**
  * @brief Retrieve diagonal elements of posterior covariance matrix.
@@ -25,6 +26,6 @@ std::vector<double> diag_posterior(const std::vector<double> &A,
  *
  * @return Diagonal elements of posterior covariance matrix
  */
-std::vector<double> diag_tile(const std::vector<double> &A, std::size_t M);
+mutable_tile_data<double> diag_tile(const const_tile_data<double> &A, std::size_t M);
 
 #endif  // GP_UNCERTAINTY_H
@@ -0,0 +1,78 @@
+#ifndef GPU_CONTEXT_H
+#define GPU_CONTEXT_H
+
+#include <cstddef>
+#include <cublas_v2.h>
+#include <cuda_runtime.h>
+#include <cusolverDn.h>
+
+namespace gpu
+{
+
+/**
+ * @brief Stream and library handles of one HPX worker thread.
+ *
+ * The GPU kernels enqueue all their work on the stream of the worker that
+ * runs them and then suspend until the stream reaches that point, see
+ * `synchronize`. Work of different workers thus overlaps on the device,
+ * while work of one worker is ordered by its stream. A kernel enqueues
+ * everything before it suspends, such that no two workers use a context at
+ * the same time.
+ */
+struct gpu_context
+{
+    cudaStream_t stream;
+
+    cublasHandle_t cublas;
+
+    cusolverDnHandle_t cusolver;
+
+    /** @brief Device workspace of potrf, grown on demand */
+    double *workspace;
+
+    /** @brief Number of doubles in the workspace */
+    int workspace_size;
+
+    /** @brief Device status of potrf */
+    int *info;
+};
+
+/**
+ * @brief Returns the context of the calling HPX worker thread, created on
+ *        first use. Uses CUDA device 0.
+ */
+gpu_context &local_context();
+
+/**
+ * @brief Suspend the calling HPX thread until all work enqueued on the stream
+ *        of `context` so far has finished
+ */
+void synchronize(gpu_context &context);
+
+/**
+ * @brief Returns `bytes` of device memory, allocated in stream order on the
+ *        stream of the calling worker
+ */
+void *allocate(std::size_t bytes);
+
+/**
+ * @brief Free device memory returned by `allocate`. The memory must not be
+ *        in use by pending work.
+ */
+void deallocate(void *pointer);
+
+/**
+ * @brief Destroy all contexts. Called when the HPX runtime stops.
+ */
+void release_contexts();
+
+// Throw std::runtime_error naming `what` if status is not a success
+void check(cudaError_t status, const char *what);
+
+void check(cublasStatus_t status, const char *what);
+
+void check(cusolverStatus_t status, const char *what);
+
+}  // namespace gpu
+
+#endif  // end of GPU_CONTEXT_H
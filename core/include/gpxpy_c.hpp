@@ -1,10 +1,33 @@
 #ifndef gpxpy_C_H
 #define gpxpy_C_H
 
+#include "backend.hpp"
 #include "gp_functions.hpp"
+#include "kernels.hpp"
+#include "precision.hpp"
+#include "solver.hpp"
+#include <array>
+#include <functional>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+namespace gpu
+{
+struct fit_state;
+}
+
+namespace sparse
+{
+struct fit_state;
+}
+
+namespace model_file
+{
+struct snapshot;
+}
+
 // namespace for GPXPy library entities
 namespace gpxpy
 {
@@ -30,7 +53,8 @@ struct GP_data
      * @brief Initialize of Gaussian process data by loading data from a
      * file.
      *
-     * The file specified by `f_path` must contain `n` samples.
+     * The file specified by `f_path` must contain `n` samples, as text or in
+     * the binary format of data_file.hpp.
      *
      * @param f_path Path to the file
      * @param n Number of samples
@@ -38,6 +62,21 @@ struct GP_data
     GP_data(const std::string &file_path, int n);
 };
 
+class OptimizerSession;
+
+/**
+ * @brief Provides the next chunk of a stream of test input, an empty chunk
+ * ends the stream
+ */
+using chunk_source = std::function<std::vector<double>()>;
+
+/**
+ * @brief Receives the predictions of one chunk of a stream: the offset of
+ * its first sample in the stream, the predicted mean and the variance,
+ * which is empty if the uncertainty is not computed
+ */
+using prediction_sink = std::function<void(std::size_t, const std::vector<double> &, const std::vector<double> &)>;
+
 /**
  * @brief Gaussian Process class for regression tasks
  *
@@ -60,20 +99,148 @@ class GP
     /** @brief Size of each tile in each dimension */
     int _n_tile_size;
 
-  public:
-    /** @brief Lengthscale parameter `l` of squared exponential kernel */
-    double lengthscale;
+    /**
+     * @brief Size of the test tiles picked by the tile tuner, n_tile_size if
+     * the tiling was given
+     */
+    int _m_tile_size;
 
     /**
-     * @brief Vertical lengthscale parameter `v` of squared exponential
-     * kernel
+     * @brief Lower tiles of the Cholesky factor of the covariance matrix,
+     * empty if the GP is not fitted. Shared with copies of the GP and pending
+     * predictions, updates work on copies of the tiles.
      */
-    double vertical_lengthscale;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> _K_tiles;
 
     /**
-     * @brief Noise variance parameter `sigma` / `n` of squared exponential
-     * kernel
+     * @brief Distribution of the covariance tiles over the localities
+     */
+    distribution_policy _policy;
+
+    /**
+     * @brief Cholesky factor on the localities of `_policy` if it is
+     * distributed, in which case `_K_tiles` only holds its diagonal tiles
+     */
+    std::shared_ptr<distributed_tiles> _distributed_K;
+
+    /** @brief Device that fits the GP and computes its predictions */
+    Backend _backend;
+
+    /**
+     * @brief Cholesky factor and alpha in device memory if fitted on the GPU,
+     * in which case `_K_tiles` only holds host copies of its diagonal tiles
+     */
+    std::shared_ptr<gpu::fit_state> _gpu_state;
+
+    /** @brief Precision of the Cholesky factor */
+    Precision _precision;
+
+    /** @brief Number of refinement steps of a mixed precision fit */
+    int _refinement_steps;
+
+    /** @brief Covariance function */
+    kernel_function _kernel;
+
+    /**
+     * @brief Single precision Cholesky factor if fitted in mixed precision,
+     * in which case `_K_tiles` only holds double precision copies of its
+     * diagonal tiles
+     */
+    std::vector<hpx::shared_future<mutable_tile_data<float>>> _single_K_tiles;
+
+    /** @brief Relative residuals of the last mixed precision fit */
+    std::vector<double> _refinement_residuals;
+
+    /** @brief Solver of the linear systems with the covariance matrix */
+    Solver _solver;
+
+    /** @brief Settings of Solver::Iterative */
+    iterative_settings _iterative_settings;
+
+    /**
+     * @brief Loss estimated by the last fit with Solver::Iterative, NaN if
+     * it was fitted without the loss
+     */
+    double _iterative_loss;
+
+    /** @brief Relative residuals of the last fit with Solver::Iterative */
+    std::vector<double> _iterative_residuals;
+
+    /** @brief Tiles of alpha = K^-1 * y */
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> _alpha_tiles;
+
+    /**
+     * @brief Lengthscale, vertical lengthscale and noise variance the
+     * cached factor was computed with
+     */
+    std::array<double, 3> _fitted_params;
+
+    /** @brief Number of regressors the cached factor was computed with */
+    int _fitted_n_regressors;
+
+    /**
+     * @brief Squared distance tiles of the training input, reused by all
+     * optimizer iterations and steps
+     */
+    distance_tile_cache _distance_cache;
+
+    /**
+     * @brief Incremented whenever the training data or its tiling changes,
+     * such that optimizer sessions notice outdated tiles
      */
+    std::size_t _data_generation;
+
+    /**
+     * @brief Compute the Cholesky factor and alpha unless they are cached for
+     * the current hyperparameters. Must be called on an HPX thread.
+     */
+    void ensure_fitted();
+
+    /**
+     * @brief Throw std::runtime_error naming `operation` if the GP is
+     * distributed, for operations that need the factor on one locality
+     */
+    void require_local(const char *operation) const;
+
+    /**
+     * @brief Throw std::runtime_error naming `operation` with
+     * Solver::Iterative, for operations that need the Cholesky factor
+     */
+    void require_direct(const char *operation) const;
+
+    /**
+     * @brief Fit the GP with Solver::Iterative including the loss estimate
+     * unless it is cached. Must be called on an HPX thread.
+     */
+    void ensure_iterative_loss();
+
+    /**
+     * @brief Schedule the prediction of the test input with the cached
+     * factor, which must be fitted. The result holds the mean and, if
+     * `uncertainty` is set, the variance. Must be called on an HPX thread.
+     */
+    hpx::shared_future<std::vector<std::vector<double>>>
+    schedule_prediction(const std::vector<double> &test_input,
+                        int m_tiles,
+                        int m_tile_size,
+                        bool uncertainty);
+
+    /**
+     * @brief Constructs a Gaussian process from the contents of a snapshot
+     * file, fitted if the snapshot holds the factor
+     */
+    explicit GP(model_file::snapshot &&model);
+
+    friend class OptimizerSession;
+
+  public:
+    /** @brief Lengthscale parameter `l` of the kernel */
+    double lengthscale;
+
+    /** @brief Vertical lengthscale parameter `v` of the kernel */
+    double vertical_lengthscale;
+
+    /** @brief Noise variance parameter `sigma` / `n` of the kernel */
     double noise_variance;
 
     /** @brief Number of regressors */
@@ -88,8 +255,16 @@ class GP
     /**
      * @brief Constructs a Gaussian Process (GP)
      *
+     * The training data is moved into the GP, pass `std::move(data.data)` of
+     * a GP_data that is not needed anymore to avoid copying it.
+     *
      * @param input Input data for training of the GP
      * @param output Expected output data for training of the GP
+     * Pass 0 for n_tiles and n_tile_size to let tile_tuner::tune pick the
+     * tiling for the current machine, tuned for the optimizer if any
+     * parameter is trainable and for predictions otherwise. If only one of
+     * them is 0, it is computed from the other one.
+     *
      * @param n_tiles Number of tiles
      * @param n_tile_size Size of each tile in each dimension
      * @param l Lengthscale Parameter of squared exponential kernel: l
@@ -99,6 +274,10 @@ class GP
      * @param n_regressors Number of regressors
      * @param trainable_bool Vector indicating which parameters are
      *     trainable
+     * @param policy Distribution of the covariance tiles over the HPX
+     *     localities. Distributed GPs support fit, predict, calculate_loss
+     *     and cholesky, which must be called on the root locality. The
+     *     default keeps all tiles on the calling locality.
      */
     GP(std::vector<double> input,
        std::vector<double> output,
@@ -108,7 +287,29 @@ class GP
        double v,
        double n,
        int n_regressors,
-       std::vector<bool> trainable_bool);
+       std::vector<bool> trainable_bool,
+       distribution_policy policy = distribution_policy());
+
+    /**
+     * @brief Load a Gaussian process from a snapshot file written by save
+     *
+     * If the snapshot holds the Cholesky factor, its tiles are mapped from
+     * the file and the GP predicts without refitting. The GP is local, on the
+     * CPU and in double precision.
+     *
+     * @param snapshot_path Path to the snapshot file
+     */
+    explicit GP(const std::string &snapshot_path);
+
+    /**
+     * @brief Write a snapshot of the GP to a file, see model_file.hpp
+     *
+     * @param file_path Path to the snapshot file, overwritten if it exists
+     * @param include_factor Also store the Cholesky factor and alpha, the GP
+     *        is fitted first unless they are cached. Requires a local GP on
+     *        the CPU in double precision.
+     */
+    void save(const std::string &file_path, bool include_factor = true);
 
     /**
      * Returns Gaussian process attributes as string.
@@ -125,6 +326,154 @@ class GP
      */
     std::vector<double> get_training_output() const;
 
+    /**
+     * @brief Returns the distribution of the covariance tiles
+     */
+    const distribution_policy &policy() const;
+
+    /**
+     * @brief Returns the number of training tiles
+     */
+    int n_tiles() const;
+
+    /**
+     * @brief Returns the size of the training tiles
+     */
+    int n_tile_size() const;
+
+    /**
+     * @brief Returns the number and size of the test tiles for m_samples test
+     * samples, with the test tile size picked by the tile tuner
+     */
+    std::pair<int, int> test_tiles(int m_samples) const;
+
+    /**
+     * @brief Select the device that fits the GP and computes predict,
+     * predict_with_uncertainty and calculate_loss. Drops the cached factor if
+     * the backend changes.
+     *
+     * The optimizer always runs on the CPU, predict_with_full_cov is not
+     * supported on the GPU. The GPU backend requires a build with
+     * GPXPY_WITH_CUDA and a GP that is not distributed.
+     */
+    void set_backend(Backend backend);
+
+    /**
+     * @brief Returns the device that fits the GP
+     */
+    Backend backend() const;
+
+    /**
+     * @brief Select the precision of the Cholesky factor used by predict,
+     * predict_with_uncertainty and calculate_loss. Drops the cached factor if
+     * the precision changes.
+     *
+     * Precision::Mixed factors K in single precision and refines alpha in
+     * double precision with `refinement_steps` steps of iterative refinement.
+     * The optimizer always works in double precision, predict_with_full_cov
+     * is not supported in mixed precision. Mixed precision requires the CPU
+     * backend and a GP that is not distributed.
+     */
+    void set_precision(Precision precision, int refinement_steps = 2);
+
+    /**
+     * @brief Returns the precision of the Cholesky factor
+     */
+    Precision precision() const;
+
+    /**
+     * @brief Select the covariance function, see kernels.hpp. Drops the
+     * cached factor if the kernel changes.
+     *
+     * `shape` is the shape alpha of Kernel::RationalQuadratic and must be
+     * positive, the other kernels ignore it. Kernels other than
+     * Kernel::SquaredExponential require the CPU backend and a GP that is
+     * not distributed.
+     */
+    void set_kernel(Kernel kernel, double shape = 1.0);
+
+    /**
+     * @brief Returns the covariance function
+     */
+    Kernel kernel() const;
+
+    /**
+     * @brief Returns the shape alpha of the rational quadratic kernel
+     */
+    double kernel_shape() const;
+
+    /**
+     * @brief Returns the relative residuals ||y - K * alpha|| / ||y|| of the
+     * mixed precision fit after the first solve and after each refinement
+     * step. Fits the GP if needed, empty in double precision.
+     */
+    std::vector<double> refinement_residuals();
+
+    /**
+     * @brief Select the solver used by predict and calculate_loss. Drops the
+     * cached factor.
+     *
+     * Solver::Iterative replaces the Cholesky factor by preconditioned
+     * conjugate gradients and the exact loss by a stochastic estimate, see
+     * solver.hpp. It does not compute uncertainties, supports neither
+     * predict_with_uncertainty, predict_with_full_cov nor cholesky, and
+     * requires the CPU backend in double precision and a GP that is not
+     * distributed. The optimizer always uses the Cholesky factor.
+     */
+    void set_solver(Solver solver, const iterative_settings &settings = iterative_settings());
+
+    /**
+     * @brief Returns the solver of the linear systems
+     */
+    Solver solver() const;
+
+    /**
+     * @brief Returns the relative residuals ||y - K * alpha|| / ||y|| after
+     * each conjugate gradient iteration of Solver::Iterative. Fits the GP if
+     * needed, empty with Solver::Cholesky.
+     */
+    std::vector<double> iterative_residuals();
+
+    /**
+     * @brief Compute and cache the Cholesky factor and alpha
+     *
+     * The cached state is reused by all predictions and the loss until
+     * lengthscale, vertical_lengthscale, noise_variance or n_regressors
+     * change, in which case it is recomputed on the next call.
+     */
+    void fit();
+
+    /**
+     * @brief Returns true if the cached Cholesky factor and alpha match the
+     * current hyperparameters and number of regressors
+     */
+    bool is_fitted() const;
+
+    /**
+     * @brief Drop the cached Cholesky factor and alpha
+     */
+    void reset_fit();
+
+    /**
+     * @brief Append new observations to the training data
+     *
+     * A cached double precision factor on the CPU is extended by the new tile
+     * rows instead of refactored, and alpha is solved again with it. With
+     * `max_tiles` > 0 the oldest tiles are dropped while the GP has more
+     * tiles, the cached factor is updated to the remaining samples. In all
+     * other cases the GP is refitted on its next use. Clears the distance
+     * tile cache. A live OptimizerSession reassembles its output tiles and
+     * drops the tiles it scheduled ahead on its next step.
+     *
+     * @param new_input Input data of the new samples, following the training
+     *        input in time
+     * @param new_output Output data of the new samples
+     * @param max_tiles Maximum number of training tiles, 0 for no limit
+     */
+    void append(const std::vector<double> &new_input,
+                const std::vector<double> &new_output,
+                int max_tiles = 0);
+
     /**
      * @brief Predict output for test input
      */
@@ -140,17 +489,80 @@ class GP
         const std::vector<double> &test_data, int m_tiles, int m_tile_size);
 
     /**
-     * @brief Predict output for test input and additionally compute full
-     * posterior covariance matrix.
+     * @brief Schedule the prediction of the test input without waiting for it
+     *
+     * Fits the GP first unless the factor is cached, the prediction itself
+     * runs in the background. Several predictions, also of different GPs,
+     * thus run concurrently in one HPX graph. The GP must outlive the future
+     * and must not be optimized, appended to or changed in precision or
+     * backend before it is ready.
+     */
+    hpx::shared_future<std::vector<double>>
+    predict_async(const std::vector<double> &test_data,
+                  int m_tiles,
+                  int m_tile_size);
+
+    /**
+     * @brief Schedule the prediction of the test input and its variance
+     * without waiting for them, see predict_async
+     */
+    hpx::shared_future<std::vector<std::vector<double>>>
+    predict_with_uncertainty_async(const std::vector<double> &test_data,
+                                   int m_tiles,
+                                   int m_tile_size);
+
+    /**
+     * @brief Predict a stream of test input chunk by chunk with the cached
+     * factor
+     *
+     * Only the cross-covariance of the chunks in flight is held in memory.
+     * While the sink processes the predictions of a chunk, the next chunks
+     * are assembled and solved. Chunks may differ in size, predictions are
+     * the same as for the whole stream at once.
+     *
+     * @param next_chunk source of the test input chunks
+     * @param sink receives the predictions of each chunk, in stream order
+     * @param uncertainty also compute the variance
+     * @param m_tile_size size of the test tiles, 0 for the tuned size or
+     *        n_tile_size
+     * @param max_in_flight number of chunks scheduled ahead of the sink
+     */
+    void predict_stream(const chunk_source &next_chunk,
+                        const prediction_sink &sink,
+                        bool uncertainty = true,
+                        int m_tile_size = 0,
+                        int max_in_flight = 2);
+
+    /**
+     * @brief Predict the test input in chunks of chunk_size samples, see
+     * predict_stream
+     */
+    void predict_chunked(const std::vector<double> &test_input,
+                         std::size_t chunk_size,
+                         const prediction_sink &sink,
+                         bool uncertainty = true,
+                         int m_tile_size = 0,
+                         int max_in_flight = 2);
+
+    /**
+     * @brief Predict output for test input and additionally compute the
+     * posterior covariance matrix in `format`, see CovarianceFormat.
      *
      * @param test_input Test input data
      * @param m_tiles Number of tiles
      * @param m_tile_size Size of each tile
+     * @param format Part of the posterior covariance to return
      *
-     * @return Full covariance matrix
+     * @return Predictions and variances, followed by the packed lower
+     *         triangle of the posterior covariance for
+     *         CovarianceFormat::Lower or by the packed lower triangle of the
+     *         prior covariance and V for CovarianceFormat::LowRank
      */
     std::vector<std::vector<double>> predict_with_full_cov(
-        const std::vector<double> &test_data, int m_tiles, int m_tile_size);
+        const std::vector<double> &test_data,
+        int m_tiles,
+        int m_tile_size,
+        CovarianceFormat format = CovarianceFormat::Diagonal);
 
     /**
      * @brief Optimize hyperparameters
@@ -163,6 +575,19 @@ class GP
     std::vector<double>
     optimize(const gpxpy_hyper::Hyperparameters &hyperparams);
 
+    /**
+     * @brief Run the optimizer as a background task, see optimize
+     *
+     * The hyperparameters of the GP are updated by the task. The GP must
+     * outlive the future and must not be used before it is ready.
+     *
+     * @param hyperparams Optimizer settings
+     *
+     * @return losses
+     */
+    hpx::shared_future<std::vector<double>>
+    optimize_async(const gpxpy_hyper::Hyperparameters &hyperparams);
+
     /**
      * @brief Perform a single optimization step
      *
@@ -175,16 +600,441 @@ class GP
     double optimize_step(gpxpy_hyper::Hyperparameters &hyperparams,
                          int iter);
 
+    /**
+     * @brief Set the memory budget of the distance tile cache in bytes
+     *
+     * The optimizer keeps the squared distance tiles of the training input
+     * that fit into the budget and recomputes the others on every iteration.
+     * A budget of zero recomputes all of them.
+     */
+    void set_distance_cache_budget(std::size_t bytes);
+
+    /**
+     * @brief Returns the memory budget of the distance tile cache in bytes
+     */
+    std::size_t distance_cache_budget() const;
+
+    /**
+     * @brief Drop the cached distance tiles
+     */
+    void clear_distance_cache();
+
     /**
      * @brief Calculate loss for given data and Gaussian process model
      */
     double calculate_loss();
 
+    /**
+     * @brief Schedule the loss computation without waiting for it, see
+     * predict_async
+     */
+    hpx::shared_future<double> calculate_loss_async();
+
     /**
      * @brief Computes & returns cholesky decomposition
      */
     std::vector<std::vector<double>> cholesky();
 };
+
+/**
+ * @brief Optimizer of the hyperparameters of a GP that keeps its state
+ * between steps
+ *
+ * The session owns the output tiles, the Adam moments and the tiles of the
+ * next step, and uses the distance tile cache of the GP. A step only does the
+ * numeric work of one iteration. Before it returns, it schedules the
+ * assembly of the next step, which thus overlaps with the caller processing
+ * the loss. The GP must outlive the session.
+ */
+class OptimizerSession
+{
+  private:
+    /** @brief Optimized Gaussian process */
+    GP &_gp;
+
+    /** @brief Optimizer settings */
+    gpxpy_hyper::Hyperparameters _hyperparams;
+
+    /** @brief State kept between steps */
+    std::unique_ptr<optimizer_session_state> _state;
+
+  public:
+    /**
+     * @brief Start a session at the current GP hyperparameters
+     *
+     * @param gp Gaussian process to optimize
+     * @param hyperparams Optimizer settings, M_T and V_T are the initial
+     *        moments
+     */
+    OptimizerSession(GP &gp, const gpxpy_hyper::Hyperparameters &hyperparams);
+
+    OptimizerSession(const OptimizerSession &) = delete;
+
+    OptimizerSession &operator=(const OptimizerSession &) = delete;
+
+    /**
+     * @brief Perform one optimization step and update the GP hyperparameters
+     *
+     * If the GP hyperparameters were changed since the last step, the session
+     * continues from the new values.
+     *
+     * @return loss before the step
+     */
+    double step();
+
+    /**
+     * @brief Returns the number of steps taken
+     */
+    int iteration() const;
+
+    /**
+     * @brief Returns the optimizer settings with the current Adam moments
+     */
+    gpxpy_hyper::Hyperparameters hyperparameters() const;
+};
+
+/**
+ * @brief Sparse Gaussian process with inducing points for regression tasks
+ *
+ * The inducing points are the lagged feature vectors of an inducing input
+ * series, for example a subsample of the training input. Fit, loss,
+ * optimizer and predictions run in O(N * m^2) time and O(N * m) memory for N
+ * training samples and m inducing points, see gp_sparse.hpp. The loss is the
+ * variational free energy, an upper bound of the loss of the exact GP.
+ */
+class SparseGP
+{
+  private:
+    /** @brief Input data for training */
+    std::vector<double> _training_input;
+
+    /** @brief Output data for given input data */
+    std::vector<double> _training_output;
+
+    /** @brief Input series of the inducing points */
+    std::vector<double> _inducing_input;
+
+    /** @brief Number of tiles */
+    int _n_tiles;
+
+    /** @brief Size of each tile */
+    int _n_tile_size;
+
+    /** @brief Factorization of the sparse GP, null if not fitted */
+    std::shared_ptr<sparse::fit_state> _state;
+
+    /**
+     * @brief Lengthscale, vertical lengthscale, noise variance and jitter the
+     * cached factorization was computed with
+     */
+    std::array<double, 4> _fitted_params;
+
+    /** @brief Number of regressors the cached factorization was computed with */
+    int _fitted_n_regressors;
+
+    /**
+     * @brief Compute the factorization unless it is cached for the current
+     * hyperparameters. Must be called on an HPX thread.
+     */
+    void ensure_fitted();
+
+  public:
+    /** @brief Lengthscale parameter `l` of squared exponential kernel */
+    double lengthscale;
+
+    /**
+     * @brief Vertical lengthscale parameter `v` of squared exponential
+     * kernel
+     */
+    double vertical_lengthscale;
+
+    /**
+     * @brief Noise variance parameter `sigma` / `n` of squared exponential
+     * kernel
+     */
+    double noise_variance;
+
+    /** @brief Number of regressors */
+    int n_regressors;
+
+    /**
+     * @brief List of bools indicating trainable parameters: lengthscale,
+     * vertical lengthscale, noise variance
+     */
+    std::vector<bool> trainable_params;
+
+    /** @brief Added to the diagonal of the inducing covariance matrix */
+    double jitter;
+
+    /**
+     * @brief Constructs a sparse Gaussian process
+     *
+     * @param input Input data for training of the GP
+     * @param output Expected output data for training of the GP
+     * @param inducing_input Input series whose lagged features are the
+     *     inducing points
+     * @param n_tiles Number of training tiles
+     * @param n_tile_size Size of each training tile
+     * @param l Lengthscale Parameter of squared exponential kernel: l
+     * @param v Vertical Lengthscale parameter of squared exponential
+     *     kernel: v
+     * @param n Noise Variance parameter of squared exponential kernel: n
+     * @param n_regressors Number of regressors
+     * @param trainable_bool Vector indicating which parameters are
+     *     trainable
+     */
+    SparseGP(std::vector<double> input,
+             std::vector<double> output,
+             std::vector<double> inducing_input,
+             int n_tiles,
+             int n_tile_size,
+             double l,
+             double v,
+             double n,
+             int n_regressors,
+             std::vector<bool> trainable_bool);
+
+    /**
+     * Returns sparse Gaussian process attributes as string.
+     */
+    std::string repr() const;
+
+    /**
+     * @brief Returns training input data
+     */
+    std::vector<double> get_training_input() const;
+
+    /**
+     * @brief Returns training output data
+     */
+    std::vector<double> get_training_output() const;
+
+    /**
+     * @brief Returns the input series of the inducing points
+     */
+    std::vector<double> get_inducing_input() const;
+
+    /**
+     * @brief Compute and cache the factorization of the sparse GP
+     *
+     * The cached state is reused by all predictions and the loss until a
+     * hyperparameter, the jitter or n_regressors changes.
+     */
+    void fit();
+
+    /**
+     * @brief Returns true if the cached factorization matches the current
+     * hyperparameters and number of regressors
+     */
+    bool is_fitted() const;
+
+    /**
+     * @brief Predict output for test input
+     */
+    std::vector<double> predict(const std::vector<double> &test_data,
+                                int m_tiles,
+                                int m_tile_size);
+
+    /**
+     * @brief Predict output for test input and additionally provide the
+     * variance of the predictions
+     */
+    std::vector<std::vector<double>> predict_with_uncertainty(
+        const std::vector<double> &test_data, int m_tiles, int m_tile_size);
+
+    /**
+     * @brief Optimize hyperparameters by minimizing the variational free
+     * energy with Adam
+     *
+     * @param hyperparams Optimizer settings
+     *
+     * @return losses
+     */
+    std::vector<double>
+    optimize(const gpxpy_hyper::Hyperparameters &hyperparams);
+
+    /**
+     * @brief Calculate the variational free energy per training sample
+     */
+    double calculate_loss();
+};
+
+/**
+ * @brief Batch of Gaussian processes on the same training input
+ *
+ * A member of the batch is one hyperparameter set trained on one training
+ * output: member h * n_outputs() + o uses hyperparameter set h and output o.
+ * All members share the squared distance tiles of the training input.
+ * Members with the same hyperparameters share their Cholesky factor, their
+ * outputs are solved as one multi-column right-hand side. The factorizations
+ * of all members and their optimizer iterations run in one task graph.
+ */
+class BatchedGP
+{
+  private:
+    /** @brief Input data for training */
+    std::vector<double> _training_input;
+
+    /** @brief Output data for given input data, one vector per output */
+    std::vector<std::vector<double>> _training_outputs;
+
+    /** @brief Number of tiles */
+    int _n_tiles;
+
+    /** @brief Size of each tile */
+    int _n_tile_size;
+
+    /** @brief Factors of the distinct hyperparameters, empty if not fitted */
+    std::vector<batched_fit> _fits;
+
+    /** @brief Hyperparameters of the members the factors were computed with */
+    std::vector<std::array<double, 3>> _fitted_params;
+
+    /** @brief Number of regressors the factors were computed with */
+    int _fitted_n_regressors;
+
+    /**
+     * @brief Squared distance tiles of the training input, shared by all
+     * members
+     */
+    distance_tile_cache _distance_cache;
+
+    /**
+     * @brief Compute the factors unless they are cached for the current
+     * hyperparameters. Must be called on an HPX thread.
+     */
+    void ensure_fitted();
+
+    /**
+     * @brief Returns the index of each member in the results of the fits,
+     * which are ordered by fit and by output within a fit
+     */
+    std::vector<std::size_t> member_slots() const;
+
+  public:
+    /**
+     * @brief Lengthscale, vertical lengthscale and noise variance of each
+     * member
+     */
+    std::vector<std::array<double, 3>> hyperparameters;
+
+    /** @brief Number of regressors */
+    int n_regressors;
+
+    /**
+     * @brief List of bools indicating trainable parameters: lengthscale,
+     * vertical lengthscale, noise variance
+     */
+    std::vector<bool> trainable_params;
+
+    /**
+     * @brief Constructs a batch of Gaussian processes
+     *
+     * @param input Input data for training of the GPs
+     * @param outputs Training outputs, all with as many samples as the input
+     * @param n_tiles Number of training tiles
+     * @param n_tile_size Size of each training tile
+     * @param hyperparameter_sets Lengthscale, vertical lengthscale and noise
+     *     variance of each hyperparameter set
+     * @param n_regressors Number of regressors
+     * @param trainable_bool Vector indicating which parameters are
+     *     trainable
+     */
+    BatchedGP(std::vector<double> input,
+              std::vector<std::vector<double>> outputs,
+              int n_tiles,
+              int n_tile_size,
+              const std::vector<std::array<double, 3>> &hyperparameter_sets,
+              int n_regressors,
+              std::vector<bool> trainable_bool);
+
+    /**
+     * Returns batched Gaussian process attributes as string.
+     */
+    std::string repr() const;
+
+    /**
+     * @brief Returns the number of training outputs
+     */
+    std::size_t n_outputs() const;
+
+    /**
+     * @brief Returns the number of members
+     */
+    std::size_t n_members() const;
+
+    /**
+     * @brief Returns the index of the training output of member `member`
+     */
+    std::size_t member_output(std::size_t member) const;
+
+    /**
+     * @brief Returns training input data
+     */
+    std::vector<double> get_training_input() const;
+
+    /**
+     * @brief Returns the training outputs
+     */
+    std::vector<std::vector<double>> get_training_outputs() const;
+
+    /**
+     * @brief Compute and cache the factors of all members
+     */
+    void fit();
+
+    /**
+     * @brief Returns true if the cached factors match the current
+     * hyperparameters of all members and number of regressors
+     */
+    bool is_fitted() const;
+
+    /**
+     * @brief Predict the output of each member for test input
+     */
+    std::vector<std::vector<double>> predict(const std::vector<double> &test_data,
+                                             int m_tiles,
+                                             int m_tile_size);
+
+    /**
+     * @brief Predict the output of each member for test input and
+     * additionally provide the variance of the predictions
+     *
+     * @return mean and variance of each member
+     */
+    std::vector<std::vector<std::vector<double>>> predict_with_uncertainty(
+        const std::vector<double> &test_data, int m_tiles, int m_tile_size);
+
+    /**
+     * @brief Optimize the hyperparameters of every member with Adam
+     *
+     * @param hyperparams Optimizer settings
+     *
+     * @return losses of each member
+     */
+    std::vector<std::vector<double>>
+    optimize(const gpxpy_hyper::Hyperparameters &hyperparams);
+
+    /**
+     * @brief Calculate the loss of each member
+     */
+    std::vector<double> calculate_loss();
+
+    /**
+     * @brief Set the memory budget of the distance tile cache in bytes
+     */
+    void set_distance_cache_budget(std::size_t bytes);
+
+    /**
+     * @brief Returns the memory budget of the distance tile cache in bytes
+     */
+    std::size_t distance_cache_budget() const;
+
+    /**
+     * @brief Drop the cached distance tiles
+     */
+    void clear_distance_cache();
+};
 }  // namespace gpxpy
 
 #endif
@@ -0,0 +1,212 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "covariance_assembly.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+/**
+ * @brief Stationary covariance function of a GP, evaluated on the squared
+ * distance d = r^2 of two lagged feature vectors.
+ *
+ * With lengthscale l and vertical lengthscale v:
+ *
+ *     SquaredExponential  v * exp(-d / (2 l^2))
+ *     Matern32            v * (1 + t) * exp(-t),              t = sqrt(3) r / l
+ *     Matern52            v * (1 + t + t^2 / 3) * exp(-t),    t = sqrt(5) r / l
+ *     RationalQuadratic   v * (1 + d / (2 alpha l^2))^-alpha
+ *
+ * The shape alpha of the rational quadratic kernel is a fixed setting of the
+ * kernel, it is not optimized.
+ */
+enum class Kernel
+{
+    SquaredExponential,
+    Matern32,
+    Matern52,
+    RationalQuadratic
+};
+
+/**
+ * @brief Kernel of a GP and its settings besides the hyperparameters, passed
+ * to the tile generators by value
+ */
+struct kernel_function
+{
+    Kernel type = Kernel::SquaredExponential;
+
+    /** @brief Shape alpha of the rational quadratic kernel, unused otherwise */
+    double shape = 1.0;
+
+    bool operator==(const kernel_function &other) const
+    {
+        return type == other.type && (type != Kernel::RationalQuadratic || shape == other.shape);
+    }
+
+    bool operator!=(const kernel_function &other) const { return !(*this == other); }
+};
+
+// Each policy evaluates its kernel and the derivative of the kernel w.r.t. the
+// lengthscale on a whole tile of squared distances. The tile generators select
+// the policy once per tile with dispatch_kernel and are instantiated for each
+// one, so the loops below are inlined into them and vectorize.
+namespace kernels
+{
+// Size of the blocks of the Matern kernels, small enough to stay in L1
+constexpr std::size_t block_size = 256;
+
+/**
+ * @brief out[i] = p(t) * factor * exp(-t) for t = c * sqrt(d[i]), in blocks
+ *        such that the square roots, scaled_exp and p vectorize. out may
+ *        alias d.
+ */
+template <typename P>
+inline void radial_exp(double *out, const double *d, std::size_t n, double c, double factor, P p)
+{
+    double e[block_size];
+    for (std::size_t start = 0; start < n; start += block_size)
+    {
+        const std::size_t m = std::min(block_size, n - start);
+        for (std::size_t i = 0; i < m; i++)
+        {
+            const double t = c * std::sqrt(d[start + i]);
+            out[start + i] = t;
+            e[i] = t;
+        }
+        scaled_exp(e, m, -1.0, factor);
+        for (std::size_t i = 0; i < m; i++)
+        {
+            out[start + i] = p(out[start + i]) * e[i];
+        }
+    }
+}
+
+struct squared_exponential
+{
+    // out = k(d), out may alias d
+    static void covariance(double *out, const double *d, std::size_t n, double l, double v, double)
+    {
+        if (out != d)
+        {
+            std::copy(d, d + n, out);
+        }
+        scaled_exp(out, n, -1.0 / (2.0 * l * l), v);
+    }
+
+    // out = factor * dk/dl (d), out must not alias d
+    static void lengthscale_derivative(double *out, const double *d, std::size_t n, double l, double v, double, double factor)
+    {
+        std::copy(d, d + n, out);
+        scaled_exp(out, n, -1.0 / (2.0 * l * l), factor);
+        // d/dl of exp(-d / (2 * l^2)) is exp(-d / (2 * l^2)) * d / l^3
+        const double scale = v / (l * l * l);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            out[i] *= scale * d[i];
+        }
+    }
+};
+
+struct matern32
+{
+    static void covariance(double *out, const double *d, std::size_t n, double l, double v, double)
+    {
+        radial_exp(out, d, n, std::sqrt(3.0) / l, v, [](double t)
+                   { return 1.0 + t; });
+    }
+
+    // dk/dl = v * t^2 * exp(-t) / l
+    static void lengthscale_derivative(double *out, const double *d, std::size_t n, double l, double v, double, double factor)
+    {
+        radial_exp(out, d, n, std::sqrt(3.0) / l, factor * v / l, [](double t)
+                   { return t * t; });
+    }
+};
+
+struct matern52
+{
+    static void covariance(double *out, const double *d, std::size_t n, double l, double v, double)
+    {
+        radial_exp(out, d, n, std::sqrt(5.0) / l, v, [](double t)
+                   { return 1.0 + t + t * t / 3.0; });
+    }
+
+    // dk/dl = v * t^2 * (1 + t) * exp(-t) / (3 * l)
+    static void lengthscale_derivative(double *out, const double *d, std::size_t n, double l, double v, double, double factor)
+    {
+        radial_exp(out, d, n, std::sqrt(5.0) / l, factor * v / (3.0 * l), [](double t)
+                   { return t * t * (1.0 + t); });
+    }
+};
+
+struct rational_quadratic
+{
+    // v * (1 + d / (2 alpha l^2))^-alpha = v * exp(-alpha * log1p(d / (2 alpha l^2)))
+    static void covariance(double *out, const double *d, std::size_t n, double l, double v, double alpha)
+    {
+        const double scale = 1.0 / (2.0 * alpha * l * l);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            out[i] = std::log1p(scale * d[i]);
+        }
+        scaled_exp(out, n, -alpha, v);
+    }
+
+    // dk/dl = v * (1 + d / (2 alpha l^2))^(-alpha - 1) * d / l^3
+    static void lengthscale_derivative(double *out, const double *d, std::size_t n, double l, double v, double alpha, double factor)
+    {
+        const double scale = 1.0 / (2.0 * alpha * l * l);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            out[i] = std::log1p(scale * d[i]);
+        }
+        scaled_exp(out, n, -alpha - 1.0, factor * v / (l * l * l));
+        for (std::size_t i = 0; i < n; i++)
+        {
+            out[i] *= d[i];
+        }
+    }
+};
+
+/**
+ * @brief Call f with the policy of the kernel. Branches once, the policy is
+ *        a compile-time type inside f.
+ */
+template <typename F>
+decltype(auto) dispatch_kernel(Kernel type, F &&f)
+{
+    switch (type)
+    {
+        case Kernel::Matern32:
+            return f(matern32{});
+        case Kernel::Matern52:
+            return f(matern52{});
+        case Kernel::RationalQuadratic:
+            return f(rational_quadratic{});
+        case Kernel::SquaredExponential:
+        default:
+            return f(squared_exponential{});
+    }
+}
+
+/**
+ * @brief In-place x = k(x) for n squared distances x
+ */
+inline void covariance(const kernel_function &kernel, double *x, std::size_t n, double lengthscale, double vertical_lengthscale)
+{
+    dispatch_kernel(kernel.type, [&](auto policy)
+                    { decltype(policy)::covariance(x, x, n, lengthscale, vertical_lengthscale, kernel.shape); });
+}
+
+/**
+ * @brief out = factor * dk/dlengthscale (d) for n squared distances d
+ */
+inline void lengthscale_derivative(const kernel_function &kernel, double *out, const double *d, std::size_t n, double lengthscale, double vertical_lengthscale, double factor)
+{
+    dispatch_kernel(kernel.type, [&](auto policy)
+                    { decltype(policy)::lengthscale_derivative(out, d, n, lengthscale, vertical_lengthscale, kernel.shape, factor); });
+}
+}  // namespace kernels
+
+#endif  // end of KERNELS_H
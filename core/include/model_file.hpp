@@ -0,0 +1,109 @@
+#ifndef MODEL_FILE_H
+#define MODEL_FILE_H
+
+#include "kernels.hpp"
+#include "tile_data.hpp"
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Snapshots of a GP: hyperparameters, training data and optionally
+ * its Cholesky factor and alpha.
+ *
+ * A snapshot file is a 128 byte header followed by sections that each start
+ * at a multiple of TILE_ALIGNMENT bytes:
+ *
+ *     offset  size  field
+ *          0     8  magic "GPXPYMDL"
+ *          8     4  format version, currently 1
+ *         12     4  flags, bit 0: the factor and alpha are stored
+ *         16     8  number of samples n
+ *         24     4  number of tiles
+ *         28     4  size of each tile s
+ *         32     4  size of the test tiles
+ *         36     4  number of regressors
+ *         40    24  lengthscale, vertical lengthscale, noise variance
+ *         64     4  trainable flags, bit i for hyperparameter i
+ *         68     4  kernel, the value of the Kernel enum
+ *         72     8  byte order mark 0x0102030405060708
+ *         80     8  shape of the rational quadratic kernel
+ *
+ *     section                  elements per entry  entries
+ *     training input           n                   1
+ *     training output          n                   1
+ *     lower tiles of L         s * s               n_tiles * (n_tiles + 1) / 2
+ *     alpha                    s                   n_tiles
+ *
+ * The tiles of L are stored row by row, (0, 0), (1, 0), (1, 1), ..., the
+ * padding of the last tile row included. Every tile starts at a multiple of
+ * TILE_ALIGNMENT bytes, such that the loaded tiles are views of the mapped
+ * file instead of copies. All numbers are in the byte order of the host that
+ * wrote the file, which the byte order mark checks.
+ */
+namespace model_file
+{
+/** @brief Contents of a snapshot file */
+struct snapshot
+{
+    /** @brief Input data for training */
+    std::vector<double> training_input;
+
+    /** @brief Output data for given input data */
+    std::vector<double> training_output;
+
+    /** @brief Number of tiles */
+    int n_tiles;
+
+    /** @brief Size of each tile */
+    int n_tile_size;
+
+    /** @brief Size of the test tiles */
+    int m_tile_size;
+
+    /** @brief Number of regressors */
+    int n_regressors;
+
+    /** @brief Lengthscale, vertical lengthscale and noise variance */
+    std::array<double, 3> params;
+
+    /** @brief Covariance function */
+    kernel_function kernel;
+
+    /** @brief Trainable flags of the hyperparameters */
+    std::vector<bool> trainable_params;
+
+    /**
+     * @brief Tiles of the Cholesky factor at i * n_tiles + j, lower tiles
+     * only, empty if the factor is not stored
+     */
+    std::vector<mutable_tile_data<double>> K_tiles;
+
+    /** @brief Tiles of alpha = K^-1 * y, empty if the factor is not stored */
+    std::vector<mutable_tile_data<double>> alpha_tiles;
+};
+
+/**
+ * @brief Write a snapshot file
+ *
+ * @param file_path path to the file, overwritten if it exists
+ * @param model snapshot to write, the factor is written if alpha_tiles is
+ *        not empty
+ */
+void write(const std::string &file_path, const snapshot &model);
+
+/**
+ * @brief Read a snapshot file
+ *
+ * The file is memory-mapped. The tiles of the factor and alpha are views of
+ * the private mapping, which they keep alive. Writing to them copies the
+ * touched pages and leaves the file unchanged.
+ *
+ * @param file_path path to the file
+ * @param load_factor also load the factor and alpha if they are stored
+ */
+snapshot read(const std::string &file_path, bool load_factor = true);
+}  // namespace model_file
+
+#endif  // end of MODEL_FILE_H
@@ -0,0 +1,18 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+/**
+ * @brief Floating point precision of the Cholesky factor of a GP.
+ *
+ * Double factors the covariance matrix and solves for alpha in double
+ * precision. Mixed factors it in single precision, which halves the memory
+ * and the GEMM time of the factorization, and refines alpha = K^-1 * y in
+ * double precision by iterative refinement against the double precision K.
+ */
+enum class Precision
+{
+    Double,
+    Mixed
+};
+
+#endif  // end of PRECISION_H
@@ -0,0 +1,199 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <chrono>
+#include <cstddef>
+#include <hpx/future.hpp>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Counters and a timeline of the tile kernels.
+ *
+ * Every task of the tiled algorithms is created with
+ * profiling::annotated_function instead of hpx::annotated_function. It keeps
+ * the HPX annotation, so APEX and the HPX thread descriptions see the same
+ * names as before, and while recording is active it also times the task and
+ * counts the floating point operations of the BLAS calls it makes. Tasks are
+ * grouped into kernels by their annotation and into the phases of a GP by the
+ * prefix of the annotation.
+ *
+ * The idle rate is the share of the wall time times the number of HPX worker
+ * threads not spent in a kernel, so it includes the scheduling overhead.
+ * Timings of GPU kernels cover the host side of the task only.
+ *
+ * Recording is off by default and costs a relaxed atomic load per task then.
+ */
+namespace profiling
+{
+/** @brief Phase of the GP a kernel belongs to */
+enum class Phase
+{
+    // covariance, derivative and cross-covariance tiles
+    Assembly,
+    // tiled Cholesky factorization and its updates
+    Cholesky,
+    // triangular solves, inversion and reductions
+    Solve,
+    // predictive mean, posterior and uncertainty
+    Predict,
+    // loss and gradient of the optimizer
+    Gradient
+};
+
+/** @brief Number of phases */
+constexpr std::size_t n_phases = 5;
+
+/** @brief Totals of the tasks of a kernel or phase */
+struct kernel_stats
+{
+    /** @brief Annotation of the kernel or name of the phase */
+    std::string name;
+
+    Phase phase;
+
+    /** @brief Number of tasks */
+    std::size_t count = 0;
+
+    /** @brief Sum of the task run times in seconds */
+    double time = 0.0;
+
+    /** @brief Floating point operations of the BLAS calls */
+    double flops = 0.0;
+
+    /** @brief Returns flops / time in GFLOP/s, 0 without time */
+    double gflops() const;
+};
+
+/** @brief Recorded totals since start() */
+struct report
+{
+    /** @brief Kernels sorted by decreasing time */
+    std::vector<kernel_stats> kernels;
+
+    /** @brief Phases in the order of Phase */
+    std::vector<kernel_stats> phases;
+
+    /** @brief Wall time of the recording in seconds */
+    double wall_time = 0.0;
+
+    /** @brief Number of HPX worker threads */
+    std::size_t n_threads = 0;
+
+    /** @brief Sum of the task run times in seconds */
+    double busy_time = 0.0;
+
+    /** @brief 1 - busy_time / (wall_time * n_threads) */
+    double idle_rate = 0.0;
+
+    /** @brief Sum of the floating point operations */
+    double flops = 0.0;
+};
+
+// Returns the name of a phase: "assembly", "cholesky", "solve", "predict" or
+// "gradient"
+const char *phase_name(Phase phase);
+
+// Returns the phase of a kernel annotation
+Phase phase_of(const std::string &annotation);
+
+// Clear all counters and the timeline and start recording, `trace` also
+// records every task for write_trace()
+void start(bool trace = false);
+
+// Stop recording, the counters are kept until the next start()
+void stop();
+
+// Returns true while recording
+bool is_active();
+
+// Returns the counters recorded since start()
+report get_report();
+
+// Write the recorded tasks as Chrome trace events (chrome://tracing, Perfetto
+// and the APEX trace viewers read this format), one row per worker thread
+void write_trace(const std::string &file_path);
+
+// Register the HPX performance counters /gpxpy/<phase>/count, time [ns] and
+// flops as well as /gpxpy/busy-time [ns]. Call during HPX startup, e.g. via
+// hpx::register_startup_function; utils::start_hpx_runtime does so.
+void register_counters();
+
+// Add floating point operations to the task running on the calling thread,
+// called by the BLAS adapters
+void add_flops(double flops);
+
+namespace detail
+{
+// Returns the floating point operations counted on the calling thread
+double thread_flops();
+
+// Add a task to the counters and the timeline
+void record(const char *name,
+            std::chrono::steady_clock::time_point begin,
+            std::chrono::steady_clock::time_point end,
+            double flops);
+
+// Records the lifetime of a task, also if it throws
+class task_scope
+{
+  private:
+    const char *_name;
+
+    std::chrono::steady_clock::time_point _begin;
+
+    double _flops;
+
+  public:
+    explicit task_scope(const char *name) :
+        _name(name),
+        _begin(std::chrono::steady_clock::now()),
+        _flops(thread_flops())
+    { }
+
+    task_scope(const task_scope &) = delete;
+    task_scope &operator=(const task_scope &) = delete;
+
+    ~task_scope()
+    {
+        record(_name, _begin, std::chrono::steady_clock::now(), thread_flops() - _flops);
+    }
+};
+
+// Callable that records each call of f while recording is active
+template <typename F>
+struct timed_function
+{
+    F f;
+
+    const char *name;
+
+    template <typename... Ts>
+    decltype(auto) operator()(Ts &&...ts) const
+    {
+        if (!is_active())
+        {
+            return f(std::forward<Ts>(ts)...);
+        }
+        const task_scope scope(name);
+        return f(std::forward<Ts>(ts)...);
+    }
+};
+}  // namespace detail
+
+/**
+ * @brief Drop-in for hpx::annotated_function that also records the task
+ *
+ * @param f callable of the task
+ * @param name annotation of the task, must outlive the task
+ */
+template <typename F>
+auto annotated_function(F &&f, const char *name)
+{
+    return hpx::annotated_function(detail::timed_function<std::decay_t<F>>{ std::forward<F>(f), name }, name);
+}
+}  // namespace profiling
+
+#endif  // end of PROFILING_H
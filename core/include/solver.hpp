@@ -0,0 +1,47 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+/**
+ * @brief Solver of the linear systems with the covariance matrix of a GP.
+ *
+ * Cholesky factors the covariance matrix, exactly, in O(N^3) time and O(N^2)
+ * memory. Iterative solves K * alpha = y by preconditioned conjugate
+ * gradients and estimates log det K by stochastic Lanczos quadrature, see
+ * gp_iterative.hpp. It only multiplies with covariance tiles that are
+ * generated on the fly, in O(N^2) time per iteration and O(N) memory per
+ * right-hand side, at the price of an approximate alpha and loss.
+ */
+enum class Solver
+{
+    Cholesky,
+    Iterative
+};
+
+/**
+ * @brief Settings of Solver::Iterative
+ */
+struct iterative_settings
+{
+    /** @brief Maximum number of conjugate gradient iterations */
+    int max_iter = 1000;
+
+    /**
+     * @brief Relative residual ||b - K * x|| / ||b|| at which the iterations
+     * of a right-hand side b stop
+     */
+    double tolerance = 1e-6;
+
+    /**
+     * @brief Rank of the pivoted Cholesky factor of the preconditioner, 0 to
+     * precondition with the noise variance only
+     */
+    int preconditioner_rank = 15;
+
+    /** @brief Number of probe vectors of the log-determinant estimate */
+    int n_probes = 16;
+
+    /** @brief Seed of the probe vectors */
+    unsigned seed = 0;
+};
+
+#endif  // end of SOLVER_H
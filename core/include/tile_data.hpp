@@ -0,0 +1,164 @@
+#ifndef TILE_DATA_H
+#define TILE_DATA_H
+
+#include "tile_memory_pool.hpp"
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @brief Read-only view of a reference-counted, aligned tile buffer.
+ *
+ * Copying a tile copies the handle, not the elements. Kernels take their
+ * read-only operands as `const const_tile_data<T> &`, such that passing a tile
+ * out of a `hpx::shared_future` neither copies nor touches the reference count.
+ *
+ * @tparam T element type of the tile
+ */
+template <typename T>
+class const_tile_data
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "tile elements must be trivially copyable");
+
+  protected:
+    /** @brief Shared, TILE_ALIGNMENT-aligned buffer */
+    std::shared_ptr<T[]> _data;
+
+    /** @brief Number of elements in the buffer */
+    std::size_t _size;
+
+  public:
+    /**
+     * @brief Construct an empty tile
+     */
+    const_tile_data() :
+        _data(),
+        _size(0)
+    { }
+
+    /**
+     * @brief Returns the number of elements
+     */
+    std::size_t size() const { return _size; }
+
+    /**
+     * @brief Returns a pointer to the first element
+     */
+    const T *data() const { return _data.get(); }
+
+    const T *begin() const { return _data.get(); }
+
+    const T *end() const { return _data.get() + _size; }
+
+    const T &operator[](std::size_t i) const { return _data[i]; }
+
+    /**
+     * @brief Returns the number of handles sharing the buffer
+     */
+    long use_count() const { return _data.use_count(); }
+};
+
+/**
+ * @brief Writable handle to a reference-counted, aligned tile buffer.
+ *
+ * Constness is shallow, like for `std::shared_ptr`: a kernel may write through
+ * a `const mutable_tile_data<T> &` obtained from a `hpx::shared_future`. Each
+ * kernel writes its output tile via `writable()`, which is in place if the
+ * handle is the only owner of the buffer and a copy otherwise.
+ *
+ * `writable()` counts tile handles, not the copies of the `hpx::shared_future`
+ * that holds the handle, so it cannot see readers of the same future. In-place
+ * updates are therefore only safe for tiles private to one task graph, whose
+ * algorithms consume every version of a tile before they schedule the next
+ * write to it. A tile that outlives its task graph, such as the cached factor
+ * and alpha of a GP, which copies of the GP share, or the tiles of the
+ * distance cache, must only be read. Code that updates such a tile passes a
+ * `copy()` to the kernel instead.
+ *
+ * @tparam T element type of the tile
+ */
+template <typename T>
+class mutable_tile_data : public const_tile_data<T>
+{
+  public:
+    /**
+     * @brief Construct an empty tile
+     */
+    mutable_tile_data() = default;
+
+    /**
+     * @brief Allocate an uninitialized tile of `size` elements from the tile
+     *        memory pool
+     *
+     * @param size number of elements
+     */
+    explicit mutable_tile_data(std::size_t size)
+    {
+        this->_size = size;
+        if (size == 0)
+        {
+            return;
+        }
+        // buffers are recycled through the pool instead of freed
+        std::size_t bytes = size * sizeof(T);
+        std::size_t slot;
+        T *buffer = static_cast<T *>(tile_memory_pool::allocate(bytes, slot));
+        this->_data = std::shared_ptr<T[]>(buffer, [bytes, slot](T *p)
+                                           { tile_memory_pool::deallocate(p, bytes, slot); });
+    }
+
+    /**
+     * @brief Wrap the `size` elements of an existing buffer, for example a
+     *        view of a memory-mapped file, which `data` keeps alive. The
+     *        buffer must be TILE_ALIGNMENT-aligned.
+     *
+     * @param data shared buffer
+     * @param size number of elements
+     */
+    mutable_tile_data(std::shared_ptr<T[]> data, std::size_t size)
+    {
+        this->_data = std::move(data);
+        this->_size = size;
+    }
+
+    T *data() const { return this->_data.get(); }
+
+    T *begin() const { return this->_data.get(); }
+
+    T *end() const { return this->_data.get() + this->_size; }
+
+    T &operator[](std::size_t i) const { return this->_data[i]; }
+
+    /**
+     * @brief Returns a handle whose buffer may be written to
+     *
+     * That is this tile itself if no other handle shares its buffer, or a deep
+     * copy otherwise. Futures sharing this handle are not detected, see the
+     * class documentation.
+     */
+    mutable_tile_data writable() const
+    {
+        if (this->use_count() <= 1)
+        {
+            return *this;
+        }
+        return copy();
+    }
+
+    /**
+     * @brief Returns a deep copy of the tile
+     */
+    mutable_tile_data copy() const
+    {
+        mutable_tile_data result(this->_size);
+        if (this->_size > 0)
+        {
+            std::memcpy(result.data(), this->data(), this->_size * sizeof(T));
+        }
+        return result;
+    }
+};
+
+#endif  // end of TILE_DATA_H
@@ -0,0 +1,66 @@
+#ifndef TILE_MEMORY_POOL_H
+#define TILE_MEMORY_POOL_H
+
+#include <cstddef>
+
+/** @brief Alignment of tile buffers in bytes: one cache line / AVX-512 vector */
+constexpr std::size_t TILE_ALIGNMENT = 64;
+
+/** @brief Default limit of the bytes cached in the free lists, 1 GiB */
+constexpr std::size_t TILE_CACHE_LIMIT = std::size_t(1) << 30;
+
+/**
+ * @brief Pool of aligned tile buffers with one free list per HPX worker.
+ *
+ * Buffers are handed out from the free list of the calling worker and, once
+ * released, returned to the free list of the worker that allocated them. With
+ * HPX workers bound to cores, a buffer thus stays on the NUMA node on which it
+ * was first touched, and the tiles of optimization iteration k+1 reuse the
+ * buffers of iteration k instead of going back to the system allocator.
+ *
+ * The cached bytes are limited, split evenly over the free lists. A buffer
+ * that would exceed the share of its free list is freed instead, so tile
+ * shapes that are no longer used do not pin their high-water mark.
+ */
+namespace tile_memory_pool
+{
+/**
+ * @brief Returns an uninitialized, TILE_ALIGNMENT-aligned buffer
+ *
+ * @param bytes size of the buffer in bytes
+ * @param slot set to the free list the buffer has to be returned to
+ */
+void *allocate(std::size_t bytes, std::size_t &slot);
+
+/**
+ * @brief Return a buffer obtained from allocate() to its free list
+ *
+ * @param buffer buffer to return
+ * @param bytes size passed to allocate()
+ * @param slot free list reported by allocate()
+ */
+void deallocate(void *buffer, std::size_t bytes, std::size_t slot);
+
+/**
+ * @brief Free all cached buffers. Buffers still in use are not affected.
+ */
+void release();
+
+/**
+ * @brief Returns the number of bytes currently cached in the free lists
+ */
+std::size_t cached_bytes();
+
+/**
+ * @brief Limit the bytes cached in the free lists and free the cached
+ * buffers beyond it, 0 disables caching
+ */
+void set_cache_limit(std::size_t bytes);
+
+/**
+ * @brief Returns the limit of the bytes cached in the free lists
+ */
+std::size_t cache_limit();
+}  // namespace tile_memory_pool
+
+#endif  // end of TILE_MEMORY_POOL_H
@@ -0,0 +1,166 @@
+#ifndef TILE_TUNER_H
+#define TILE_TUNER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Selection of the tile sizes from micro-benchmarks of the tile
+ *        kernels on the current machine.
+ *
+ * The tuner times potrf, trsm, syrk, gemm and the assembly of a covariance
+ * tile for a set of candidate tile sizes and feeds the timings into a model
+ * of the tiled algorithms: the run time is bounded by the total work spread
+ * over the HPX threads and by the critical path of the task graph, and each
+ * task costs a fixed scheduling overhead. The candidate with the smallest
+ * estimate wins, which includes the work spent on the padding of the last
+ * tile.
+ *
+ * The timings do not depend on the number of samples, so they are measured
+ * once per machine and number of regressors and kept in a per-host cache
+ * file, see default_cache_path().
+ */
+namespace tile_tuner
+{
+/** @brief Operation the tile sizes are tuned for */
+enum class Workload
+{
+    // fit the GP and predict with uncertainty
+    Predict,
+    // optimizer iterations on the training data
+    Optimize
+};
+
+/** @brief Best-of-repetitions run time of the tile kernels in seconds */
+struct kernel_timings
+{
+    /** @brief Tile size the kernels were timed at */
+    int tile_size;
+
+    double potrf;
+
+    double trsm;
+
+    double syrk;
+
+    double gemm;
+
+    /** @brief Assembly of one covariance tile */
+    double assembly;
+};
+
+/** @brief Tiling of the training and test data */
+struct tile_config
+{
+    int n_tiles;
+
+    int n_tile_size;
+
+    int m_tiles;
+
+    int m_tile_size;
+};
+
+/**
+ * @brief Returns the candidate tile sizes tried by tune(): powers of two
+ *        from 32 to 2048
+ */
+std::vector<int> default_candidates();
+
+/**
+ * @brief Returns the path of the timing cache: the file named by the
+ *        environment variable GPXPY_TUNING_CACHE if set, otherwise
+ *        `gpxpy/tile_timings_<hostname>.txt` in $XDG_CACHE_HOME or
+ *        $HOME/.cache
+ */
+std::string default_cache_path();
+
+/**
+ * @brief Time the tile kernels at each of the tile sizes on the calling
+ *        thread
+ *
+ * @param tile_sizes tile sizes to time
+ * @param n_regressors number of regressors of the covariance tiles
+ * @param repetitions number of runs per kernel, the fastest one counts
+ */
+std::vector<kernel_timings> benchmark_kernels(const std::vector<int> &tile_sizes,
+                                              int n_regressors,
+                                              int repetitions = 3);
+
+/**
+ * @brief Read the timings of a cache file measured with n_regressors
+ *        regressors. Returns an empty vector if the file does not exist,
+ *        malformed lines are skipped.
+ */
+std::vector<kernel_timings> load_timings(const std::string &cache_path, int n_regressors);
+
+/**
+ * @brief Add timings measured with n_regressors regressors to a cache file,
+ *        replacing older timings of the same tile sizes. Creates the
+ *        directory of the file if needed.
+ */
+void store_timings(const std::string &cache_path,
+                   int n_regressors,
+                   const std::vector<kernel_timings> &timings);
+
+/**
+ * @brief Estimated run time of the Cholesky factorization of n_samples
+ *        samples with the tile size of `timings`, including the covariance
+ *        assembly
+ *
+ * @param timings kernel timings at the tile size
+ * @param n_samples number of training samples
+ * @param n_threads number of HPX worker threads
+ */
+double estimate_fit_time(const kernel_timings &timings, std::size_t n_samples, std::size_t n_threads);
+
+/**
+ * @brief Estimated run time of one optimizer iteration, which assembles the
+ *        covariance matrix and two derivatives and forms their traces with
+ *        the inverse: about four factorizations worth of tile kernels
+ */
+double estimate_optimize_time(const kernel_timings &timings, std::size_t n_samples, std::size_t n_threads);
+
+/**
+ * @brief Estimated run time of predict_with_uncertainty for n_test samples
+ *        with test tiles of size m_tile_size, given the training tiling
+ *
+ * Test tiles are m_tile_size x n_tile_size blocks, their kernel times are
+ * scaled from the square kernels at the training tile size.
+ *
+ * @param timings kernel timings at the training tile size
+ * @param n_samples number of training samples
+ * @param n_test number of test samples
+ * @param m_tile_size size of the test tiles
+ * @param n_threads number of HPX worker threads
+ */
+double estimate_predict_time(const kernel_timings &timings,
+                             std::size_t n_samples,
+                             std::size_t n_test,
+                             int m_tile_size,
+                             std::size_t n_threads);
+
+/**
+ * @brief Pick the training and test tiling for a problem
+ *
+ * Timings of candidates missing from the cache file are measured and added
+ * to it. A cache file that cannot be written is ignored.
+ *
+ * @param n_train number of training samples
+ * @param n_test number of test samples
+ * @param n_regressors number of regressors
+ * @param workload operation to tune for
+ * @param n_threads number of HPX worker threads, 0 for the threads of the
+ *        running HPX runtime or the hardware concurrency if it is not running
+ * @param cache_path timing cache, empty for default_cache_path()
+ */
+tile_config tune(std::size_t n_train,
+                 std::size_t n_test,
+                 int n_regressors,
+                 Workload workload,
+                 std::size_t n_threads = 0,
+                 const std::string &cache_path = "");
+}  // namespace tile_tuner
+
+#endif  // end of TILE_TUNER_H
@@ -1,11 +1,62 @@
 #ifndef TILED_ALGORITHMS_CPU
 #define TILED_ALGORITHMS_CPU
 
+#include "gp_optimizer.hpp"
+#include "profiling.hpp"
+#include "tile_data.hpp"
 #include <cmath>
 #include <hpx/future.hpp>
+#include <vector>
+
+// The algorithms used by fit and predict are templates over the element type
+// of the tiles and are instantiated for float and double in
+// tiled_algorithms_cpu.cpp. The optimizer works in double precision.
 
 // Tiled Cholesky Algorithm ------------------------------------------------ {{{
 
+/**
+ * @brief Task graph used by cholesky_tiled.
+ *
+ * RightLooking schedules all kernels with normal priority. Priority runs the
+ * panel POTRF and TRSM, which form the critical path, with high priority.
+ * Lookahead additionally prioritizes the updates of the next panel, such that
+ * its factorization starts before the trailing GEMMs of the current step.
+ * LeftLooking applies all updates of a column just before its factorization.
+ */
+enum class CholeskyVariant
+{
+    RightLooking,
+    Priority,
+    Lookahead,
+    LeftLooking
+};
+
+/**
+ * @brief Set the variant used by cholesky_tiled for this process. Defaults to
+ *        CholeskyVariant::Lookahead.
+ */
+void set_cholesky_variant(CholeskyVariant variant);
+
+/**
+ * @brief Returns the variant used by cholesky_tiled
+ */
+CholeskyVariant get_cholesky_variant();
+
+/**
+ * @brief Perform the Cholesky decomposition with the variant set by
+ *        set_cholesky_variant.
+ *
+ * @param ft_tiles Matrix represented as a vector of tiles, containing the
+ *        covariance matrix, afterwards the Cholesky decomposition.
+ * @param N Size of the matrix.
+ * @param n_tiles Number of tiles.
+ */
+template <typename T>
+void cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles);
+
 /**
  * @brief Perform right-looking Cholesky decomposition.
  *
@@ -14,8 +65,39 @@
  * @param N Size of the matrix.
  * @param n_tiles Number of tiles.
  */
+template <typename T>
 void right_looking_cholesky_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles);
+
+/**
+ * @brief Perform right-looking Cholesky decomposition with high-priority
+ *        panel kernels.
+ */
+template <typename T>
+void priority_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles);
+
+/**
+ * @brief Perform right-looking Cholesky decomposition with high-priority
+ *        panel kernels and high-priority updates of the next `depth` panels.
+ */
+template <typename T>
+void lookahead_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles,
+    std::size_t depth = 1);
+
+/**
+ * @brief Perform left-looking Cholesky decomposition.
+ */
+template <typename T>
+void left_looking_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
     std::size_t N,
     std::size_t n_tiles);
 
@@ -23,30 +105,32 @@ void right_looking_cholesky_tiled(
 
 // Tiled Triangular Solve Algorithms --------------------------------------- {{{
 
+template <typename T>
 void forward_solve_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_rhs,
     std::size_t N,
     std::size_t n_tiles);
 
+template <typename T>
 void backward_solve_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_rhs,
     std::size_t N,
     std::size_t n_tiles);
 
 // Tiled Triangular Solve Algorithms for matrices (K * X = B)
 void forward_solve_tiled_matrix(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
     std::size_t m_tiles);
 
 void backward_solve_tiled_matrix(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
@@ -54,55 +138,184 @@ void backward_solve_tiled_matrix(
 
 // }}} -------------------------------- end of Tiled Triangular Solve Algorithms
 
+// Tiled Reduction --------------------------------------------------------- {{{
+
+/**
+ * @brief Fold futures pairwise in a binary tree: the reduction has depth
+ *        ceil(log2(n)) instead of n for a chain of partial results.
+ *
+ * @param ft_partials Partial results, e.g. one per tile, at least one.
+ * @param add Combines two partial results, called as add(a, b, args...).
+ * @param annotation Annotation of the tasks of the tree.
+ * @param args Further arguments of `add`, copied into each task.
+ *
+ * @return Future of the reduced result.
+ */
+template <typename T, typename Add, typename... Args>
+hpx::shared_future<T>
+reduce_tiled(std::vector<hpx::shared_future<T>> ft_partials,
+             Add add,
+             const char *annotation,
+             const Args &...args)
+{
+    while (ft_partials.size() > 1)
+    {
+        // fold the upper half onto the lower half
+        std::size_t half = (ft_partials.size() + 1) / 2;
+        for (std::size_t i = 0; i + half < ft_partials.size(); i++)
+        {
+            ft_partials[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(add), annotation),
+                ft_partials[i],
+                ft_partials[i + half],
+                args...);
+        }
+        ft_partials.resize(half);
+    }
+    return ft_partials[0];
+}
+
+// Sum scalar futures in a binary tree of depth O(log n), zero if there are
+// none
+hpx::shared_future<double>
+reduce_sum_tiled(std::vector<hpx::shared_future<double>> ft_partials);
+
+// Returns the first `size` elements of the concatenated vector tiles, which
+// must be ready, dropping the padding of the last tile
+std::vector<double>
+concat_tiles(const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+             std::size_t size);
+
+// }}} -------------------------------------------------- end of Tiled Reduction
+
+// Tiled Cholesky Update --------------------------------------------------- {{{
+
+/**
+ * @brief Factor the tile rows from `first_row` on against the finished rows
+ *        before them.
+ *
+ * The rows before `first_row` hold the Cholesky factor of the leading block
+ * of the covariance matrix, the rows from `first_row` on the lower tiles of
+ * the new trailing rows of the covariance matrix. Afterwards all rows hold the
+ * Cholesky factor of the extended matrix, at the cost of the new rows only.
+ *
+ * @param ft_tiles Matrix represented as a vector of tiles.
+ * @param N Size of the tiles.
+ * @param first_row First tile row to factor.
+ * @param n_tiles Number of tiles.
+ */
+void extend_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::size_t N,
+    std::size_t first_row,
+    std::size_t n_tiles);
+
+/**
+ * @brief Factor the leading `n_columns` tile columns of the lower tiles of a
+ *        covariance matrix, without updating the trailing tiles.
+ *
+ * @param ft_tiles Matrix represented as a vector of tiles.
+ * @param N Size of the tiles.
+ * @param n_columns Number of tile columns to factor.
+ * @param n_tiles Number of tiles.
+ */
+void cholesky_panel_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_columns,
+    std::size_t n_tiles);
+
+/**
+ * @brief Update the Cholesky factor L of the trailing tiles from `first` on to
+ *        the Cholesky factor of L * L^T + X * X^T - Y * Y^T.
+ *
+ * Tile row i of [X, Y] is ft_vectors[i], a tile of N rows whose first
+ * `n_update` columns belong to X. Applies one (hyperbolic) rotation per column
+ * of L and vector, in O(n^2 * k) for k vectors. Throws std::runtime_error if
+ * the downdated matrix is not positive definite. Consumes ft_vectors.
+ *
+ * @param ft_tiles Matrix represented as a vector of tiles.
+ * @param ft_vectors Tile rows of the update and downdate vectors.
+ * @param N Size of the tiles.
+ * @param n_update Number of update vectors.
+ * @param first First tile row and column of the trailing tiles.
+ * @param n_tiles Number of tiles.
+ */
+void update_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_vectors,
+    std::size_t N,
+    std::size_t n_update,
+    std::size_t first,
+    std::size_t n_tiles);
+
+// }}} -------------------------------------------- end of Tiled Cholesky Update
+
 // Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
 // Tiled Triangular Solve Algorithms for Matrices (K * X = B)
+template <typename T>
 void forward_solve_KcK_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_rhs,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
     std::size_t m_tiles);
 
 void compute_gemm_of_invK_y(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_invK,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_y,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_alpha,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_invK,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_y,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_alpha,
     std::size_t N,
     std::size_t n_tiles);
 
 // Tiled Loss
 void compute_loss_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_alpha,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_y,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_alpha,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_y,
     hpx::shared_future<double> &loss,
     std::size_t N,
-    std::size_t n_tiles);
+    std::size_t n_tiles,
+    std::size_t n_samples);
 
 // Tiled Prediction
+template <typename T>
 void prediction_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_vector,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_vector,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_rhs,
     std::size_t N_row,
     std::size_t N_col,
     std::size_t n_tiles,
     std::size_t m_tiles);
 
+// Tiled Prediction of several outputs: rhs(N_row, M) tiles += tiles * X
+// with X(N_col, M) tiles
+void prediction_tiled_matrix(
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_X,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs,
+    std::size_t N_row,
+    std::size_t N_col,
+    std::size_t M,
+    std::size_t n_tiles,
+    std::size_t m_tiles);
+
 // Tiled Diagonal of Posterior Covariance Matrix
+template <typename T>
 void posterior_covariance_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tCC_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_inter_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tCC_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_inter_tiles,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
     std::size_t m_tiles);
 
-// Tiled Diagonal of Posterior Covariance Matrix
+// Tiled Posterior Covariance Matrix, updates the lower tiles of ft_priorK
 void full_cov_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tCC_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_priorK,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tCC_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_priorK,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
@@ -110,36 +323,35 @@ void full_cov_tiled(
 
 // Tiled Prediction Uncertainty
 void prediction_uncertainty_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_priorK,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_inter,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_vector,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_priorK,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_inter,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_vector,
     std::size_t M,
     std::size_t m_tiles);
 
 // Tiled Prediction Uncertainty
 void pred_uncer_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_priorK,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_vector,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_priorK,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_vector,
     std::size_t M,
     std::size_t m_tiles);
 
 // Compute I-y*y^T*inv(K)
 void update_grad_K_tiled_mkl(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_v1,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_v2,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_v1,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_v2,
     std::size_t N,
     std::size_t n_tiles);
 
-// Perform a gradient scent step for selected hyperparameter using Adam
-// algorithm
-void update_hyperparameter(
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_invK,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_gradparam,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_alpha,
-    double *hyperparameters,
-    std::size_t N,
-    std::size_t n_tiles,
+// Perform an Adam step for the selected hyperparameter given the two terms of
+// its gradient: trace(inv(K) * grad_param) and alpha^T * grad_param * alpha.
+// Returns the updated hyperparameter without waiting for it.
+hpx::shared_future<double> update_hyperparameter_adam(
+    const hpx::shared_future<double> &grad_left,
+    const hpx::shared_future<double> &grad_right,
+    const hpx::shared_future<optimizer_parameters> &hyperparameters,
+    std::size_t n_samples,
     std::vector<hpx::shared_future<double>> &m_T,
     std::vector<hpx::shared_future<double>> &v_T,
     const std::vector<hpx::shared_future<double>> &beta1_T,
@@ -147,17 +359,32 @@ void update_hyperparameter(
     int iter,
     int param_idx);
 
-// Update noise variance using gradient decent + Adam
-void update_noise_variance(
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_invK,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_alpha,
-    double *hyperparameters,
+// Tiled Algorithms for the Trace Terms ------------------------------------ {{{
+
+// Compute the lower tiles of K^-1 from the Cholesky factor
+void compute_inverse_lower_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_invK,
     std::size_t N,
-    std::size_t n_tiles,
-    std::vector<hpx::shared_future<double>> &m_T,
-    std::vector<hpx::shared_future<double>> &v_T,
-    const std::vector<hpx::shared_future<double>> &beta1_T,
-    const std::vector<hpx::shared_future<double>> &beta2_T,
-    int iter);
+    std::size_t n_tiles);
+
+// Y = A * X for symmetric A stored as lower tiles
+void symmetric_matrix_product_tiled(
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_X,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_Y,
+    std::size_t N,
+    std::size_t M,
+    std::size_t n_tiles);
+
+// trace(A * B) for symmetric A, B stored as lower tiles
+void trace_of_product_lower_tiled(
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_A,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_B,
+    hpx::shared_future<double> &trace,
+    std::size_t N,
+    std::size_t n_tiles);
+
+// }}} ----------------------------- end of Tiled Algorithms for the Trace Terms
 
 #endif
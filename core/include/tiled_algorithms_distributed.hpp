@@ -0,0 +1,171 @@
+#ifndef TILED_ALGORITHMS_DISTRIBUTED_H
+#define TILED_ALGORITHMS_DISTRIBUTED_H
+
+#include "distribution_policy.hpp"
+#include "tile_data.hpp"
+#include <cstdint>
+#include <hpx/future.hpp>
+#include <hpx/include/naming.hpp>
+#include <vector>
+
+/**
+ * @brief Handle to the lower tiles of a symmetric matrix that are spread
+ *        over several localities.
+ *
+ * The handle lives on the locality that schedules the task graph, the tiles
+ * live in the tile store of the locality that owns them according to the
+ * distribution policy. Only the owner computes on a tile. Other localities
+ * receive read-only copies of finished panel tiles, which they drop once
+ * their last update of the step has run.
+ *
+ * Destroying the handle waits for all scheduled updates and releases the
+ * tiles on all localities.
+ */
+class distributed_tiles
+{
+  private:
+    distribution_policy _policy;
+
+    /** @brief Localities of the process grid, in grid order */
+    std::vector<hpx::id_type> _localities;
+
+    /** @brief Identifies the matrix in the tile stores */
+    std::uint64_t _id;
+
+    std::size_t _n_tiles;
+
+    std::size_t _n_tile_size;
+
+    /**
+     * @brief Row-major n_tiles x n_tiles, only lower tiles are used. Ready
+     *        once the last scheduled update of the tile has been applied.
+     */
+    std::vector<hpx::shared_future<void>> _versions;
+
+  public:
+    /**
+     * @brief Create an empty distributed matrix. Must be called on an HPX
+     *        thread.
+     *
+     * @param policy distribution of the tiles, must not use more localities
+     *        than the HPX runtime has
+     * @param n_tiles number of tiles per dimension
+     * @param n_tile_size size of each tile
+     */
+    distributed_tiles(const distribution_policy &policy,
+                      std::size_t n_tiles,
+                      std::size_t n_tile_size);
+
+    ~distributed_tiles();
+
+    distributed_tiles(const distributed_tiles &) = delete;
+
+    distributed_tiles &operator=(const distributed_tiles &) = delete;
+
+    const distribution_policy &policy() const { return _policy; }
+
+    std::uint64_t id() const { return _id; }
+
+    std::size_t n_tiles() const { return _n_tiles; }
+
+    std::size_t n_tile_size() const { return _n_tile_size; }
+
+    const std::vector<hpx::id_type> &localities() const { return _localities; }
+
+    /**
+     * @brief Returns the locality that owns tile (row, col)
+     */
+    const hpx::id_type &owner(std::size_t row, std::size_t col) const
+    {
+        return _localities[_policy.owner(row, col)];
+    }
+
+    /**
+     * @brief Returns the future of the last update of tile (row, col)
+     */
+    hpx::shared_future<void> &version(std::size_t row, std::size_t col)
+    {
+        return _versions[row * _n_tiles + col];
+    }
+
+    const hpx::shared_future<void> &version(std::size_t row,
+                                            std::size_t col) const
+    {
+        return _versions[row * _n_tiles + col];
+    }
+};
+
+// Distributed Assembly ---------------------------------------------------- {{{
+
+/**
+ * @brief Assemble the lower tiles of the covariance matrix on their owners.
+ *
+ * Sends the training input once to every locality of the grid.
+ *
+ * @param tiles distributed matrix, overwritten by the covariance matrix
+ * @param n_regressors number of regressors
+ * @param hyperparameters lengthscale, vertical lengthscale, noise variance
+ * @param input training input data
+ */
+void assemble_covariance_distributed(distributed_tiles &tiles,
+                                     std::size_t n_regressors,
+                                     const double *hyperparameters,
+                                     const std::vector<double> &input);
+
+/**
+ * @brief Returns a local copy of tile (row, col) once it is up to date
+ */
+hpx::shared_future<mutable_tile_data<double>>
+fetch_tile_distributed(const distributed_tiles &tiles,
+                       std::size_t row,
+                       std::size_t col);
+
+// }}} --------------------------------------------- end of Distributed Assembly
+
+// Distributed Cholesky Algorithm ------------------------------------------ {{{
+
+/**
+ * @brief Perform right-looking Cholesky decomposition of a distributed
+ *        matrix.
+ *
+ * The DAG is that of `right_looking_cholesky_tiled`, with every kernel run
+ * by the owner of its output tile. The owner of a finished panel tile pushes
+ * it to all localities that own a tile it updates, once per step and
+ * locality, instead of once per consuming kernel.
+ *
+ * @param tiles distributed matrix, containing the covariance matrix,
+ *        afterwards the Cholesky factor.
+ */
+void cholesky_distributed(distributed_tiles &tiles);
+
+// }}} ----------------------------------- end of Distributed Cholesky Algorithm
+
+// Distributed Triangular Solve Algorithms --------------------------------- {{{
+
+/**
+ * @brief Solve L * x = b with a distributed Cholesky factor.
+ *
+ * The right-hand side tiles stay on the calling locality; each is sent to the
+ * owner of the factor tile it is multiplied with, which is cheaper than
+ * moving the factor.
+ *
+ * @param tiles distributed Cholesky factor L
+ * @param ft_rhs tiles of b, afterwards x
+ */
+void forward_solve_distributed(
+    const distributed_tiles &tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs);
+
+/**
+ * @brief Solve L^T * x = b with a distributed Cholesky factor.
+ *
+ * @param tiles distributed Cholesky factor L
+ * @param ft_rhs tiles of b, afterwards x
+ */
+void backward_solve_distributed(
+    const distributed_tiles &tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs);
+
+// }}} -------------------------- end of Distributed Triangular Solve Algorithms
+
+#endif  // end of TILED_ALGORITHMS_DISTRIBUTED_H
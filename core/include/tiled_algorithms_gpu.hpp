@@ -0,0 +1,86 @@
+#ifndef TILED_ALGORITHMS_GPU_H
+#define TILED_ALGORITHMS_GPU_H
+
+#include "device_tile_data.hpp"
+#include <hpx/future.hpp>
+#include <vector>
+
+namespace gpu
+{
+
+// Tiled Cholesky Algorithm ------------------------------------------------ {{{
+
+/**
+ * @brief Perform right-looking Cholesky decomposition of device tiles, with
+ *        high-priority panel kernels and updates of the next panel.
+ *
+ * @param ft_tiles Matrix represented as a vector of tiles, containing the
+ *        covariance matrix, afterwards the Cholesky decomposition.
+ * @param N Size of the matrix.
+ * @param n_tiles Number of tiles.
+ */
+void cholesky_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles);
+
+// }}} ----------------------------------------- end of Tiled Cholesky Algorithm
+
+// Tiled Triangular Solve Algorithms --------------------------------------- {{{
+
+void forward_solve_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_rhs,
+    std::size_t N,
+    std::size_t n_tiles);
+
+void backward_solve_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_rhs,
+    std::size_t N,
+    std::size_t n_tiles);
+
+// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
+void forward_solve_KcK_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_rhs,
+    std::size_t N,
+    std::size_t M,
+    std::size_t n_tiles,
+    std::size_t m_tiles);
+
+// }}} -------------------------------- end of Tiled Triangular Solve Algorithms
+
+// Tiled Prediction -------------------------------------------------------- {{{
+
+void prediction_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_vector,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_rhs,
+    std::size_t N_row,
+    std::size_t N_col,
+    std::size_t n_tiles,
+    std::size_t m_tiles);
+
+// Tiled Diagonal of Posterior Covariance Matrix
+void posterior_covariance_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tCC_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_inter_tiles,
+    std::size_t N,
+    std::size_t M,
+    std::size_t n_tiles,
+    std::size_t m_tiles);
+
+// Tiled Prediction Uncertainty
+void prediction_uncertainty_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_priorK,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_inter,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_vector,
+    std::size_t M,
+    std::size_t m_tiles);
+
+// }}} ------------------------------------------------- end of Tiled Prediction
+
+}  // namespace gpu
+
+#endif  // end of TILED_ALGORITHMS_GPU_H
@@ -11,7 +11,7 @@ namespace utils
 {
 /**
  * @brief Compute the number of tiles for training data, given the number of
- * samples and the size of each tile.
+ * samples and the size of each tile. The last tile is zero-padded.
  *
  * @param n_samples Number of samples
  * @param n_tile_size Size of each tile
@@ -19,26 +19,55 @@ namespace utils
 int compute_train_tiles(int n_samples, int n_tile_size);
 
 /**
- * @brief Compute the number of tiles for training data, given the number of
- * samples and the size of each tile.
+ * @brief Compute the size of the tiles for training data, given the number of
+ * samples and the number of tiles. The last tile is zero-padded.
  *
  * @param n_samples Number of samples
- * @param n_tile_size Size of each tile
+ * @param n_tiles Number of tiles
  */
 int compute_train_tile_size(int n_samples, int n_tiles);
 
-// Compute number of test tiles and the size of a test tile
+// Compute number of test tiles and the size of a test tile, the size of the
+// training tiles with a zero-padded last tile
 std::pair<int, int> compute_test_tiles(int m_samples, int n_tiles, int n_tile_size);
 
-// Load data from file
+// Load the first `n_samples` samples from a text or binary data file
 std::vector<double> load_data(const std::string &file_path, int n_samples);
 
+// Write samples to a text or binary data file
+void save_data(const std::string &file_path, const std::vector<double> &data, bool binary = true, bool single_precision = false);
+
+// Convert between the text and binary data file formats, in the direction
+// given by the format of `source_path`
+void convert_data(const std::string &source_path, const std::string &target_path, bool single_precision = false);
+
 // Print a vector
 void print(const std::vector<double> &vec, int start = 0, int end = -1, const std::string &separator = " ");
 
 // Start HPX runtime
 void start_hpx_runtime(int argc, char **argv);
 
+// Split the diagonal POTRF and panel TRSM kernels of tiles with at least
+// `min_tile_size` rows over up to `n_threads` HPX threads, 1 runs all kernels
+// sequentially. See kernel_parallelism in adapter_mkl.hpp.
+void set_kernel_threads(std::size_t n_threads, std::size_t min_tile_size = 512);
+
+// Maximum number of HPX threads of a split kernel
+std::size_t kernel_threads();
+
+// Limit the bytes of freed tile buffers kept for reuse, see
+// tile_memory_pool.hpp. 0 disables the reuse.
+void set_tile_cache_limit(std::size_t bytes);
+
+// Limit of the bytes of freed tile buffers kept for reuse
+std::size_t tile_cache_limit();
+
+// Bytes of freed tile buffers currently kept for reuse
+std::size_t tile_cache_bytes();
+
+// Return the freed tile buffers kept for reuse to the system
+void release_tile_cache();
+
 // Resume HPX runtime
 void resume_hpx_runtime();
 
@@ -47,6 +76,12 @@ void suspend_hpx_runtime();
 
 // Stop HPX runtime
 void stop_hpx_runtime();
+
+// Index of the calling locality, 0 on the root locality
+std::size_t locality_id();
+
+// Number of localities of the HPX runtime
+std::size_t n_localities();
 }  // namespace utils
 
 #endif
@@ -0,0 +1,330 @@
+#include "../include/adapter_cublas.hpp"
+
+#include "../include/gp_algorithms_gpu.hpp"
+
+// cuBLAS and cuSOLVER are column-major. A row-major N x M tile read
+// column-major is its M x N transpose, so each kernel below computes the
+// transposed operation of its counterpart in adapter_mkl.cpp: the lower
+// triangle of a row-major tile is the upper triangle in cuBLAS, transposes
+// flip and the operands of products swap.
+
+namespace gpu
+{
+
+////////////////////////////////////////////////////////////////////////////////
+// BLAS operations for tiled cholkesy
+// in-place Cholesky decomposition of A -> return factorized matrix L
+device_tile_data<double> potrf(const device_tile_data<double> &A,
+                               std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> A_out = A.writable();
+    int workspace_size;
+    check(cusolverDnDpotrf_bufferSize(context.cusolver, CUBLAS_FILL_MODE_UPPER, N, A_out.data(), N, &workspace_size), "cusolverDnDpotrf_bufferSize");
+    if (workspace_size > context.workspace_size)
+    {
+        // pending work of this stream may still use the old workspace
+        check(cudaFreeAsync(context.workspace, context.stream), "cudaFreeAsync");
+        check(cudaMallocAsync(reinterpret_cast<void **>(&context.workspace), workspace_size * sizeof(double), context.stream), "cudaMallocAsync");
+        context.workspace_size = workspace_size;
+    }
+    // POTRF - like LAPACKE_dpotrf2, the status is not checked
+    check(cusolverDnDpotrf(context.cusolver, CUBLAS_FILL_MODE_UPPER, N, A_out.data(), N, context.workspace, context.workspace_size, context.info), "cusolverDnDpotrf");
+    synchronize(context);
+    return A_out;
+}
+
+// in-place solve X * L^T = A where L lower triangular
+device_tile_data<double> trsm(const device_tile_data<double> &L,
+                              const device_tile_data<double> &A,
+                              std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> A_out = A.writable();
+    const double alpha = 1.0;
+    // L * X^T = A^T
+    check(cublasDtrsm(context.cublas, CUBLAS_SIDE_LEFT, CUBLAS_FILL_MODE_UPPER, CUBLAS_OP_T, CUBLAS_DIAG_NON_UNIT, N, N, &alpha, L.data(), N, A_out.data(), N), "cublasDtrsm");
+    synchronize(context);
+    return A_out;
+}
+
+// A = A - B * B^T
+device_tile_data<double> syrk(const device_tile_data<double> &A,
+                              const device_tile_data<double> &B,
+                              std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> A_out = A.writable();
+    const double alpha = -1.0;
+    const double beta = 1.0;
+    check(cublasDsyrk(context.cublas, CUBLAS_FILL_MODE_UPPER, CUBLAS_OP_T, N, N, &alpha, B.data(), N, &beta, A_out.data(), N), "cublasDsyrk");
+    synchronize(context);
+    return A_out;
+}
+
+// C = C - A * B^T
+device_tile_data<double> gemm(const device_tile_data<double> &A,
+                              const device_tile_data<double> &B,
+                              const device_tile_data<double> &C,
+                              std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> C_out = C.writable();
+    const double alpha = -1.0;
+    const double beta = 1.0;
+    // C^T = C^T - B * A^T
+    check(cublasDgemm(context.cublas, CUBLAS_OP_T, CUBLAS_OP_N, N, N, N, &alpha, B.data(), N, A.data(), N, &beta, C_out.data(), N), "cublasDgemm");
+    synchronize(context);
+    return C_out;
+}
+
+// in-place solve L * x = a where L lower triangular
+device_tile_data<double> trsv_l(const device_tile_data<double> &L,
+                                const device_tile_data<double> &a,
+                                std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> a_out = a.writable();
+    check(cublasDtrsv(context.cublas, CUBLAS_FILL_MODE_UPPER, CUBLAS_OP_T, CUBLAS_DIAG_NON_UNIT, N, L.data(), N, a_out.data(), 1), "cublasDtrsv");
+    synchronize(context);
+    return a_out;
+}
+
+// b = b - A * a
+device_tile_data<double> gemv_l(const device_tile_data<double> &A,
+                                const device_tile_data<double> &a,
+                                const device_tile_data<double> &b,
+                                std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> b_out = b.writable();
+    const double alpha = -1.0;
+    const double beta = 1.0;
+    check(cublasDgemv(context.cublas, CUBLAS_OP_T, N, N, &alpha, A.data(), N, a.data(), 1, &beta, b_out.data(), 1), "cublasDgemv");
+    synchronize(context);
+    return b_out;
+}
+
+// in-place solve L^T * x = a where L lower triangular
+device_tile_data<double> trsv_u(const device_tile_data<double> &L,
+                                const device_tile_data<double> &a,
+                                std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> a_out = a.writable();
+    check(cublasDtrsv(context.cublas, CUBLAS_FILL_MODE_UPPER, CUBLAS_OP_N, CUBLAS_DIAG_NON_UNIT, N, L.data(), N, a_out.data(), 1), "cublasDtrsv");
+    synchronize(context);
+    return a_out;
+}
+
+// b = b - A^T * a
+device_tile_data<double> gemv_u(const device_tile_data<double> &A,
+                                const device_tile_data<double> &a,
+                                const device_tile_data<double> &b,
+                                std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> b_out = b.writable();
+    const double alpha = -1.0;
+    const double beta = 1.0;
+    check(cublasDgemv(context.cublas, CUBLAS_OP_N, N, N, &alpha, A.data(), N, a.data(), 1, &beta, b_out.data(), 1), "cublasDgemv");
+    synchronize(context);
+    return b_out;
+}
+
+// A = A - x * y^T
+device_tile_data<double> ger(const device_tile_data<double> &A,
+                             const device_tile_data<double> &x,
+                             const device_tile_data<double> &y,
+                             std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> A_out = A.writable();
+    const double alpha = -1.0;
+    // A^T = A^T - y * x^T
+    check(cublasDger(context.cublas, N, N, &alpha, y.data(), 1, x.data(), 1, A_out.data(), N), "cublasDger");
+    synchronize(context);
+    return A_out;
+}
+
+// C = C + A * B
+device_tile_data<double> gemm_diag(const device_tile_data<double> &A,
+                                   const device_tile_data<double> &B,
+                                   const device_tile_data<double> &C,
+                                   std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> C_out = C.writable();
+    const double alpha = 1.0;
+    const double beta = 1.0;
+    // C^T = C^T + B^T * A^T
+    check(cublasDgemm(context.cublas, CUBLAS_OP_N, CUBLAS_OP_N, N, N, N, &alpha, B.data(), N, A.data(), N, &beta, C_out.data(), N), "cublasDgemm");
+    synchronize(context);
+    return C_out;
+}
+
+// BLAS operations for tiled prediction
+// b = b + A * a where A(N_row, N_col), a(N_col) and b(N_row)
+device_tile_data<double> gemv_p(const device_tile_data<double> &A,
+                                const device_tile_data<double> &a,
+                                const device_tile_data<double> &b,
+                                std::size_t N_row,
+                                std::size_t N_col)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> b_out = b.writable();
+    const double alpha = 1.0;
+    const double beta = 1.0;
+    check(cublasDgemv(context.cublas, CUBLAS_OP_T, N_col, N_row, &alpha, A.data(), N_col, a.data(), 1, &beta, b_out.data(), 1), "cublasDgemv");
+    synchronize(context);
+    return b_out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BLAS operations used in uncertainty computation
+// in-place solve L * X = A where L lower triangular
+device_tile_data<double> trsm_l_KcK(const device_tile_data<double> &L,
+                                    const device_tile_data<double> &A,
+                                    std::size_t N,
+                                    std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> A_out = A.writable();
+    const double alpha = 1.0;
+    // X^T * L^T = A^T
+    check(cublasDtrsm(context.cublas, CUBLAS_SIDE_RIGHT, CUBLAS_FILL_MODE_UPPER, CUBLAS_OP_N, CUBLAS_DIAG_NON_UNIT, M, N, &alpha, L.data(), N, A_out.data(), M), "cublasDtrsm");
+    synchronize(context);
+    return A_out;
+}
+
+// C = C - A * B
+device_tile_data<double> gemm_l_KcK(const device_tile_data<double> &A,
+                                    const device_tile_data<double> &B,
+                                    const device_tile_data<double> &C,
+                                    std::size_t N,
+                                    std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> C_out = C.writable();
+    const double alpha = -1.0;
+    const double beta = 1.0;
+    // C^T = C^T - B^T * A^T
+    check(cublasDgemm(context.cublas, CUBLAS_OP_N, CUBLAS_OP_N, M, N, N, &alpha, B.data(), M, A.data(), N, &beta, C_out.data(), M), "cublasDgemm");
+    synchronize(context);
+    return C_out;
+}
+
+// C = C - A^T * B
+device_tile_data<double> gemm_cross_tcross_matrix(const device_tile_data<double> &A,
+                                                  const device_tile_data<double> &B,
+                                                  const device_tile_data<double> &C,
+                                                  std::size_t N,
+                                                  std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> C_out = C.writable();
+    const double alpha = -1.0;
+    const double beta = 1.0;
+    // C^T = C^T - B^T * A
+    check(cublasDgemm(context.cublas, CUBLAS_OP_N, CUBLAS_OP_T, M, M, N, &alpha, B.data(), M, A.data(), M, &beta, C_out.data(), M), "cublasDgemm");
+    synchronize(context);
+    return C_out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BLAS operations used in optimization step
+// in-place solve L * X = A where L lower triangular
+device_tile_data<double> trsm_l_matrix(const device_tile_data<double> &L,
+                                       const device_tile_data<double> &A,
+                                       std::size_t N,
+                                       std::size_t M)
+{
+    return trsm_l_KcK(L, A, N, M);
+}
+
+// C = C - A * B
+device_tile_data<double> gemm_l_matrix(const device_tile_data<double> &A,
+                                       const device_tile_data<double> &B,
+                                       const device_tile_data<double> &C,
+                                       std::size_t N,
+                                       std::size_t M)
+{
+    return gemm_l_KcK(A, B, C, N, M);
+}
+
+// in-place solve L^T * X = A where L upper triangular
+device_tile_data<double> trsm_u_matrix(const device_tile_data<double> &L,
+                                       const device_tile_data<double> &A,
+                                       std::size_t N,
+                                       std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> A_out = A.writable();
+    const double alpha = 1.0;
+    // X^T * L = A^T
+    check(cublasDtrsm(context.cublas, CUBLAS_SIDE_RIGHT, CUBLAS_FILL_MODE_UPPER, CUBLAS_OP_T, CUBLAS_DIAG_NON_UNIT, M, N, &alpha, L.data(), N, A_out.data(), M), "cublasDtrsm");
+    synchronize(context);
+    return A_out;
+}
+
+// C = C - A^T * B
+device_tile_data<double> gemm_u_matrix(const device_tile_data<double> &A,
+                                       const device_tile_data<double> &B,
+                                       const device_tile_data<double> &C,
+                                       std::size_t N,
+                                       std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> C_out = C.writable();
+    const double alpha = -1.0;
+    const double beta = 1.0;
+    // C^T = C^T - B^T * A
+    check(cublasDgemm(context.cublas, CUBLAS_OP_N, CUBLAS_OP_T, M, N, N, &alpha, B.data(), M, A.data(), N, &beta, C_out.data(), M), "cublasDgemm");
+    synchronize(context);
+    return C_out;
+}
+
+// inverse of lower triangular L, upper triangle of the result set to zero
+device_tile_data<double> trtri(const device_tile_data<double> &L,
+                               std::size_t N)
+{
+    // solving L * X = I leaves exact zeros above the diagonal
+    return trsm_l_KcK(L, gen_tile_identity(N), N, N);
+}
+
+// C = C + A * B
+device_tile_data<double> gemm_nn_add(const device_tile_data<double> &A,
+                                     const device_tile_data<double> &B,
+                                     const device_tile_data<double> &C,
+                                     std::size_t N,
+                                     std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> C_out = C.writable();
+    const double alpha = 1.0;
+    const double beta = 1.0;
+    check(cublasDgemm(context.cublas, CUBLAS_OP_N, CUBLAS_OP_N, M, N, N, &alpha, B.data(), M, A.data(), N, &beta, C_out.data(), M), "cublasDgemm");
+    synchronize(context);
+    return C_out;
+}
+
+// C = C + A^T * B
+device_tile_data<double> gemm_tn_add(const device_tile_data<double> &A,
+                                     const device_tile_data<double> &B,
+                                     const device_tile_data<double> &C,
+                                     std::size_t N,
+                                     std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> C_out = C.writable();
+    const double alpha = 1.0;
+    const double beta = 1.0;
+    check(cublasDgemm(context.cublas, CUBLAS_OP_N, CUBLAS_OP_T, M, N, N, &alpha, B.data(), M, A.data(), N, &beta, C_out.data(), M), "cublasDgemm");
+    synchronize(context);
+    return C_out;
+}
+
+// dot_uncertainty and gemm_grad have no BLAS equivalent, their kernels are in
+// gp_algorithms_gpu.cu
+
+}  // namespace gpu
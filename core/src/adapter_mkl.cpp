@@ -1,305 +1,867 @@
 #include "../include/adapter_mkl.hpp"
 
+#include "../include/profiling.hpp"
 #include "mkl_cblas.h"
 #include "mkl_lapacke.h"
+#include <algorithm>
+#include <atomic>
+#include <hpx/execution.hpp>
+#include <hpx/future.hpp>
+#include <stdexcept>
 #include <vector>
 
+namespace
+{
+// The MKL routines used by the kernels, overloaded on the element type. Each
+// call counts its floating point operations for the profiling.
+namespace blas
+{
+using profiling::add_flops;
+
+inline void potrf(int layout, char uplo, MKL_INT n, double *a, MKL_INT lda)
+{
+    add_flops(static_cast<double>(n) * n * n / 3);
+    LAPACKE_dpotrf2(layout, uplo, n, a, lda);
+}
+
+inline void potrf(int layout, char uplo, MKL_INT n, float *a, MKL_INT lda)
+{
+    add_flops(static_cast<double>(n) * n * n / 3);
+    LAPACKE_spotrf2(layout, uplo, n, a, lda);
+}
+
+inline void trtri(int layout, char uplo, char diag, MKL_INT n, double *a, MKL_INT lda)
+{
+    add_flops(static_cast<double>(n) * n * n / 3);
+    LAPACKE_dtrtri(layout, uplo, diag, n, a, lda);
+}
+
+inline void trtri(int layout, char uplo, char diag, MKL_INT n, float *a, MKL_INT lda)
+{
+    add_flops(static_cast<double>(n) * n * n / 3);
+    LAPACKE_strtri(layout, uplo, diag, n, a, lda);
+}
+
+inline void trsm(CBLAS_LAYOUT layout, CBLAS_SIDE side, CBLAS_UPLO uplo, CBLAS_TRANSPOSE trans, CBLAS_DIAG diag, MKL_INT m, MKL_INT n, double alpha, const double *a, MKL_INT lda, double *b, MKL_INT ldb)
+{
+    add_flops(side == CblasLeft ? static_cast<double>(m) * m * n : static_cast<double>(m) * n * n);
+    cblas_dtrsm(layout, side, uplo, trans, diag, m, n, alpha, a, lda, b, ldb);
+}
+
+inline void trsm(CBLAS_LAYOUT layout, CBLAS_SIDE side, CBLAS_UPLO uplo, CBLAS_TRANSPOSE trans, CBLAS_DIAG diag, MKL_INT m, MKL_INT n, float alpha, const float *a, MKL_INT lda, float *b, MKL_INT ldb)
+{
+    add_flops(side == CblasLeft ? static_cast<double>(m) * m * n : static_cast<double>(m) * n * n);
+    cblas_strsm(layout, side, uplo, trans, diag, m, n, alpha, a, lda, b, ldb);
+}
+
+inline void syrk(CBLAS_LAYOUT layout, CBLAS_UPLO uplo, CBLAS_TRANSPOSE trans, MKL_INT n, MKL_INT k, double alpha, const double *a, MKL_INT lda, double beta, double *c, MKL_INT ldc)
+{
+    add_flops(static_cast<double>(n) * n * k);
+    cblas_dsyrk(layout, uplo, trans, n, k, alpha, a, lda, beta, c, ldc);
+}
+
+inline void syrk(CBLAS_LAYOUT layout, CBLAS_UPLO uplo, CBLAS_TRANSPOSE trans, MKL_INT n, MKL_INT k, float alpha, const float *a, MKL_INT lda, float beta, float *c, MKL_INT ldc)
+{
+    add_flops(static_cast<double>(n) * n * k);
+    cblas_ssyrk(layout, uplo, trans, n, k, alpha, a, lda, beta, c, ldc);
+}
+
+inline void gemm(CBLAS_LAYOUT layout, CBLAS_TRANSPOSE trans_a, CBLAS_TRANSPOSE trans_b, MKL_INT m, MKL_INT n, MKL_INT k, double alpha, const double *a, MKL_INT lda, const double *b, MKL_INT ldb, double beta, double *c, MKL_INT ldc)
+{
+    add_flops(2.0 * m * n * k);
+    cblas_dgemm(layout, trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
+
+inline void gemm(CBLAS_LAYOUT layout, CBLAS_TRANSPOSE trans_a, CBLAS_TRANSPOSE trans_b, MKL_INT m, MKL_INT n, MKL_INT k, float alpha, const float *a, MKL_INT lda, const float *b, MKL_INT ldb, float beta, float *c, MKL_INT ldc)
+{
+    add_flops(2.0 * m * n * k);
+    cblas_sgemm(layout, trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
+}
+
+inline void trsv(CBLAS_LAYOUT layout, CBLAS_UPLO uplo, CBLAS_TRANSPOSE trans, CBLAS_DIAG diag, MKL_INT n, const double *a, MKL_INT lda, double *x, MKL_INT incx)
+{
+    add_flops(static_cast<double>(n) * n);
+    cblas_dtrsv(layout, uplo, trans, diag, n, a, lda, x, incx);
+}
+
+inline void trsv(CBLAS_LAYOUT layout, CBLAS_UPLO uplo, CBLAS_TRANSPOSE trans, CBLAS_DIAG diag, MKL_INT n, const float *a, MKL_INT lda, float *x, MKL_INT incx)
+{
+    add_flops(static_cast<double>(n) * n);
+    cblas_strsv(layout, uplo, trans, diag, n, a, lda, x, incx);
+}
+
+inline void gemv(CBLAS_LAYOUT layout, CBLAS_TRANSPOSE trans, MKL_INT m, MKL_INT n, double alpha, const double *a, MKL_INT lda, const double *x, MKL_INT incx, double beta, double *y, MKL_INT incy)
+{
+    add_flops(2.0 * m * n);
+    cblas_dgemv(layout, trans, m, n, alpha, a, lda, x, incx, beta, y, incy);
+}
+
+inline void gemv(CBLAS_LAYOUT layout, CBLAS_TRANSPOSE trans, MKL_INT m, MKL_INT n, float alpha, const float *a, MKL_INT lda, const float *x, MKL_INT incx, float beta, float *y, MKL_INT incy)
+{
+    add_flops(2.0 * m * n);
+    cblas_sgemv(layout, trans, m, n, alpha, a, lda, x, incx, beta, y, incy);
+}
+
+inline void ger(CBLAS_LAYOUT layout, MKL_INT m, MKL_INT n, double alpha, const double *x, MKL_INT incx, const double *y, MKL_INT incy, double *a, MKL_INT lda)
+{
+    add_flops(2.0 * m * n);
+    cblas_dger(layout, m, n, alpha, x, incx, y, incy, a, lda);
+}
+
+inline void ger(CBLAS_LAYOUT layout, MKL_INT m, MKL_INT n, float alpha, const float *x, MKL_INT incx, const float *y, MKL_INT incy, float *a, MKL_INT lda)
+{
+    add_flops(2.0 * m * n);
+    cblas_sger(layout, m, n, alpha, x, incx, y, incy, a, lda);
+}
+
+inline double dot(MKL_INT n, const double *x, MKL_INT incx, const double *y, MKL_INT incy)
+{
+    add_flops(2.0 * n);
+    return cblas_ddot(n, x, incx, y, incy);
+}
+
+inline float dot(MKL_INT n, const float *x, MKL_INT incx, const float *y, MKL_INT incy)
+{
+    add_flops(2.0 * n);
+    return cblas_sdot(n, x, incx, y, incy);
+}
+
+inline void stev(int layout, char jobz, MKL_INT n, double *d, double *e, double *z, MKL_INT ldz)
+{
+    add_flops(6.0 * n * n * n);
+    LAPACKE_dstev(layout, jobz, n, d, e, z, ldz);
+}
+
+inline void stev(int layout, char jobz, MKL_INT n, float *d, float *e, float *z, MKL_INT ldz)
+{
+    add_flops(6.0 * n * n * n);
+    LAPACKE_sstev(layout, jobz, n, d, e, z, ldz);
+}
+}  // namespace blas
+
+// Split of the large kernels, see kernel_parallelism
+std::atomic<std::size_t> kernel_threads{ 1 };
+std::atomic<std::size_t> kernel_min_tile_size{ 512 };
+std::atomic<std::size_t> kernel_block_size{ 128 };
+
+// Number of HPX tasks to split a kernel on a tile of size N into, 1 to run it
+// sequentially
+std::size_t n_kernel_chunks(std::size_t N)
+{
+    const std::size_t n_threads = std::min(kernel_threads.load(), hpx::get_num_worker_threads());
+    if (n_threads <= 1 || N < kernel_min_tile_size.load())
+    {
+        return 1;
+    }
+    return n_threads;
+}
+
+// Run f(c) for the chunks c = 0 .. n - 1 as high priority HPX tasks, the first
+// one on the calling thread, and rethrow the first error. The other chunks are
+// profiled as tasks of their own.
+template <typename F>
+void for_each_chunk(std::size_t n, const F &f)
+{
+    std::vector<hpx::future<void>> futures;
+    futures.reserve(n);
+    const hpx::execution::parallel_executor executor(hpx::threads::thread_priority::high);
+    for (std::size_t c = 1; c < n; c++)
+    {
+        futures.push_back(hpx::async(executor, profiling::annotated_function(f, "cholesky_split"), c));
+    }
+    f(0);
+    for (hpx::future<void> &future : futures)
+    {
+        future.get();
+    }
+}
+
+// Blocked right-looking Cholesky decomposition of the lower triangle of
+// A(N, N) split into `n_chunks` tasks per step
+template <typename T>
+void parallel_potrf(T *A, std::size_t N, std::size_t n_chunks)
+{
+    const std::size_t nb = std::max<std::size_t>(1, kernel_block_size.load());
+    for (std::size_t k = 0; k < N; k += nb)
+    {
+        const std::size_t kb = std::min(nb, N - k);
+        blas::potrf(LAPACK_ROW_MAJOR, 'L', kb, A + k * N + k, N);
+        const std::size_t r = k + kb;
+        if (r == N)
+        {
+            break;
+        }
+        // panel below the diagonal block, rows are independent
+        const std::size_t rows = N - r;
+        const std::size_t chunk_rows = (rows + n_chunks - 1) / n_chunks;
+        for_each_chunk(n_chunks, [=](std::size_t c)
+                       {
+                           const std::size_t begin = std::min(rows, c * chunk_rows);
+                           const std::size_t end = std::min(rows, begin + chunk_rows);
+                           if (begin < end)
+                           {
+                               blas::trsm(CblasRowMajor, CblasRight, CblasLower, CblasTrans, CblasNonUnit, end - begin, kb, T(1.0), A + k * N + k, N, A + (r + begin) * N + k, N);
+                           }
+                       });
+        // lower trailing matrix, block rows dealt round robin as their cost
+        // grows with the row
+        const std::size_t n_blocks = (rows + nb - 1) / nb;
+        for_each_chunk(std::min(n_chunks, n_blocks), [=](std::size_t c)
+                       {
+                           for (std::size_t b = c; b < n_blocks; b += n_chunks)
+                           {
+                               const std::size_t i = r + b * nb;
+                               const std::size_t ib = std::min(nb, N - i);
+                               if (i > r)
+                               {
+                                   blas::gemm(CblasRowMajor, CblasNoTrans, CblasTrans, ib, i - r, kb, T(-1.0), A + i * N + k, N, A + r * N + k, N, T(1.0), A + i * N + r, N);
+                               }
+                               blas::syrk(CblasRowMajor, CblasLower, CblasNoTrans, ib, kb, T(-1.0), A + i * N + k, N, T(1.0), A + i * N + i, N);
+                           }
+                       });
+    }
+}
+
+// Solve X * L^T = A for A(N, N) in `n_chunks` row blocks
+template <typename T>
+void parallel_trsm(const T *L, T *A, std::size_t N, std::size_t n_chunks)
+{
+    const std::size_t chunk_rows = (N + n_chunks - 1) / n_chunks;
+    for_each_chunk(n_chunks, [=](std::size_t c)
+                   {
+                       const std::size_t begin = std::min(N, c * chunk_rows);
+                       const std::size_t end = std::min(N, begin + chunk_rows);
+                       if (begin < end)
+                       {
+                           blas::trsm(CblasRowMajor, CblasRight, CblasLower, CblasTrans, CblasNonUnit, end - begin, N, T(1.0), L, N, A + begin * N, N);
+                       }
+                   });
+}
+}  // namespace
+
+/**
+ * @brief Set the split of large kernels for this process
+ */
+void set_kernel_parallelism(const kernel_parallelism &policy)
+{
+    if (policy.n_threads == 0 || policy.block_size == 0)
+    {
+        throw std::invalid_argument("The number of kernel threads and the block size must be positive");
+    }
+    kernel_threads.store(policy.n_threads);
+    kernel_min_tile_size.store(policy.min_tile_size);
+    kernel_block_size.store(policy.block_size);
+}
+
+/**
+ * @brief Returns the split of large kernels
+ */
+kernel_parallelism get_kernel_parallelism()
+{
+    kernel_parallelism policy;
+    policy.n_threads = kernel_threads.load();
+    policy.min_tile_size = kernel_min_tile_size.load();
+    policy.block_size = kernel_block_size.load();
+    return policy;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // BLAS operations for tiled cholkesy
 // in-place Cholesky decomposition of A -> return factorized matrix L
-std::vector<double> potrf(std::vector<double> A,
-                          std::size_t N)
+template <typename T>
+mutable_tile_data<T> potrf(const mutable_tile_data<T> &A,
+                           std::size_t N)
 {
+    // write in place if this is the only handle to the buffer
+    mutable_tile_data<T> A_out = A.writable();
+    const std::size_t n_chunks = n_kernel_chunks(N);
+    if (n_chunks > 1)
+    {
+        parallel_potrf(A_out.data(), N, n_chunks);
+        return A_out;
+    }
     // use ?potrf2 recursive version for better stability
-    // POTRF - caution with dpotrf
-    LAPACKE_dpotrf2(LAPACK_ROW_MAJOR, 'L', N, A.data(), N);
+    // POTRF - caution with ?potrf
+    blas::potrf(LAPACK_ROW_MAJOR, 'L', N, A_out.data(), N);
     // return vector
-    return A;
+    return A_out;
 }
 
 // in-place solve X * L^T = A where L lower triangular
-std::vector<double> trsm(std::vector<double> L,
-                         std::vector<double> A,
-                         std::size_t N)
+template <typename T>
+mutable_tile_data<T> trsm(const const_tile_data<T> &L,
+                          const mutable_tile_data<T> &A,
+                          std::size_t N)
 {
+    mutable_tile_data<T> A_out = A.writable();
+    const std::size_t n_chunks = n_kernel_chunks(N);
+    if (n_chunks > 1)
+    {
+        parallel_trsm(L.data(), A_out.data(), N, n_chunks);
+        return A_out;
+    }
     // TRSM constants
-    const double alpha = 1.0;
-    // TRSM kernel - caution with dtrsm
-    cblas_dtrsm(CblasRowMajor, CblasRight, CblasLower, CblasTrans, CblasNonUnit, N, N, alpha, L.data(), N, A.data(), N);
+    const T alpha = 1.0;
+    // TRSM kernel - caution with ?trsm
+    blas::trsm(CblasRowMajor, CblasRight, CblasLower, CblasTrans, CblasNonUnit, N, N, alpha, L.data(), N, A_out.data(), N);
     // return vector
-    return A;
+    return A_out;
 }
 
 // A = A - B * B^T
-std::vector<double> syrk(std::vector<double> A,
-                         std::vector<double> B,
-                         std::size_t N)
+template <typename T>
+mutable_tile_data<T> syrk(const mutable_tile_data<T> &A,
+                          const const_tile_data<T> &B,
+                          std::size_t N)
 {
+    mutable_tile_data<T> A_out = A.writable();
     // SYRK constants
-    const double alpha = -1.0;
-    const double beta = 1.0;
-    // SYRK kernel - caution with dsyrk
-    cblas_dsyrk(CblasRowMajor, CblasLower, CblasNoTrans, N, N, alpha, B.data(), N, beta, A.data(), N);
+    const T alpha = -1.0;
+    const T beta = 1.0;
+    // SYRK kernel - caution with ?syrk
+    blas::syrk(CblasRowMajor, CblasLower, CblasNoTrans, N, N, alpha, B.data(), N, beta, A_out.data(), N);
     // return vector
-    return A;
+    return A_out;
 }
 
 // C = C - A * B^T
-std::vector<double> gemm(std::vector<double> A,
-                         std::vector<double> B,
-                         std::vector<double> C,
-                         std::size_t N)
+template <typename T>
+mutable_tile_data<T> gemm(const const_tile_data<T> &A,
+                          const const_tile_data<T> &B,
+                          const mutable_tile_data<T> &C,
+                          std::size_t N)
 {
+    mutable_tile_data<T> C_out = C.writable();
     // GEMM constants
-    const double alpha = -1.0;
-    const double beta = 1.0;
-    // GEMM kernel - caution with dgemm
-    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, A.data(), N, B.data(), N, beta, C.data(), N);
+    const T alpha = -1.0;
+    const T beta = 1.0;
+    // GEMM kernel - caution with ?gemm
+    blas::gemm(CblasRowMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, A.data(), N, B.data(), N, beta, C_out.data(), N);
     // return vector
-    return C;
+    return C_out;
 }
 
 // in-place solve L * x = a where L lower triangular
-std::vector<double> trsv_l(std::vector<double> L,
-                           std::vector<double> a,
-                           std::size_t N)
+template <typename T>
+mutable_tile_data<T> trsv_l(const const_tile_data<T> &L,
+                            const mutable_tile_data<T> &a,
+                            std::size_t N)
 {
+    mutable_tile_data<T> a_out = a.writable();
     // TRSV kernel
-    cblas_dtrsv(CblasRowMajor, CblasLower, CblasNoTrans, CblasNonUnit, N, L.data(), N, a.data(), 1);
+    blas::trsv(CblasRowMajor, CblasLower, CblasNoTrans, CblasNonUnit, N, L.data(), N, a_out.data(), 1);
     // return vector
-    return a;
+    return a_out;
 }
 
 // b = b - A * a
-std::vector<double> gemv_l(std::vector<double> A,
-                           std::vector<double> a,
-                           std::vector<double> b,
-                           std::size_t N)
+template <typename T>
+mutable_tile_data<T> gemv_l(const const_tile_data<T> &A,
+                            const const_tile_data<T> &a,
+                            const mutable_tile_data<T> &b,
+                            std::size_t N)
 {
+    mutable_tile_data<T> b_out = b.writable();
     // GEMV constants
-    const double alpha = -1.0;
-    const double beta = 1.0;
+    const T alpha = -1.0;
+    const T beta = 1.0;
     // GEMV kernel
-    cblas_dgemv(CblasRowMajor, CblasNoTrans, N, N, alpha, A.data(), N, a.data(), 1, beta, b.data(), 1);
+    blas::gemv(CblasRowMajor, CblasNoTrans, N, N, alpha, A.data(), N, a.data(), 1, beta, b_out.data(), 1);
     // return vector
-    return b;
+    return b_out;
 }
 
 // in-place solve L^T * x = a where L lower triangular
-std::vector<double> trsv_u(std::vector<double> L,
-                           std::vector<double> a,
-                           std::size_t N)
+template <typename T>
+mutable_tile_data<T> trsv_u(const const_tile_data<T> &L,
+                            const mutable_tile_data<T> &a,
+                            std::size_t N)
 {
+    mutable_tile_data<T> a_out = a.writable();
     // TRSV kernel
-    cblas_dtrsv(CblasRowMajor, CblasLower, CblasTrans, CblasNonUnit, N, L.data(), N, a.data(), 1);
+    blas::trsv(CblasRowMajor, CblasLower, CblasTrans, CblasNonUnit, N, L.data(), N, a_out.data(), 1);
     // return vector
-    return a;
+    return a_out;
 }
 
 // b = b - A^T * a
-std::vector<double> gemv_u(std::vector<double> A,
-                           std::vector<double> a,
-                           std::vector<double> b,
-                           std::size_t N)
+template <typename T>
+mutable_tile_data<T> gemv_u(const const_tile_data<T> &A,
+                            const const_tile_data<T> &a,
+                            const mutable_tile_data<T> &b,
+                            std::size_t N)
 {
+    mutable_tile_data<T> b_out = b.writable();
     // GEMV constants
-    const double alpha = -1.0;
-    const double beta = 1.0;
+    const T alpha = -1.0;
+    const T beta = 1.0;
     // GEMV kernel
-    cblas_dgemv(CblasRowMajor, CblasTrans, N, N, alpha, A.data(), N, a.data(), 1, beta, b.data(), 1);
+    blas::gemv(CblasRowMajor, CblasTrans, N, N, alpha, A.data(), N, a.data(), 1, beta, b_out.data(), 1);
     // return vector
-    return b;
+    return b_out;
 }
 
 // A = y*beta^T + A
-std::vector<double> ger(std::vector<double> A,
-                        std::vector<double> x,
-                        std::vector<double> y,
-                        std::size_t N)
+template <typename T>
+mutable_tile_data<T> ger(const mutable_tile_data<T> &A,
+                         const const_tile_data<T> &x,
+                         const const_tile_data<T> &y,
+                         std::size_t N)
 {
+    mutable_tile_data<T> A_out = A.writable();
     // GER constants
-    const double alpha = -1.0;
+    const T alpha = -1.0;
     // GER kernel
-    cblas_dger(CblasRowMajor, N, N, alpha, x.data(), 1, y.data(), 1, A.data(), N);
+    blas::ger(CblasRowMajor, N, N, alpha, x.data(), 1, y.data(), 1, A_out.data(), N);
     // return A
-    return A;
+    return A_out;
 }
 
 // C = C + A * B^T
-std::vector<double> gemm_diag(std::vector<double> A,
-                              std::vector<double> B,
-                              std::vector<double> C,
-                              std::size_t N)
+template <typename T>
+mutable_tile_data<T> gemm_diag(const const_tile_data<T> &A,
+                               const const_tile_data<T> &B,
+                               const mutable_tile_data<T> &C,
+                               std::size_t N)
 {
+    mutable_tile_data<T> C_out = C.writable();
     // GEMM constants
-    const double alpha = 1.0;
-    const double beta = 1.0;
+    const T alpha = 1.0;
+    const T beta = 1.0;
     // GEMM kernel
-    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, A.data(), N, B.data(), N, beta, C.data(), N);
+    blas::gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, A.data(), N, B.data(), N, beta, C_out.data(), N);
     // return vector
-    return C;
+    return C_out;
 }
 
 // BLAS operations for tiled prediction
 // b = b + A * a where A(N_row, N_col), a(N_col) and b(N_row)
-std::vector<double> gemv_p(std::vector<double> A,
-                           std::vector<double> a,
-                           std::vector<double> b,
-                           std::size_t N_row,
-                           std::size_t N_col)
+template <typename T>
+mutable_tile_data<T> gemv_p(const const_tile_data<T> &A,
+                            const const_tile_data<T> &a,
+                            const mutable_tile_data<T> &b,
+                            std::size_t N_row,
+                            std::size_t N_col)
 {
+    mutable_tile_data<T> b_out = b.writable();
     // GEMV constants
-    const double alpha = 1.0;
-    const double beta = 1.0;
+    const T alpha = 1.0;
+    const T beta = 1.0;
     // GEMV kernel
-    cblas_dgemv(CblasRowMajor, CblasNoTrans, N_row, N_col, alpha, A.data(), N_col, a.data(), 1, beta, b.data(), 1);
+    blas::gemv(CblasRowMajor, CblasNoTrans, N_row, N_col, alpha, A.data(), N_col, a.data(), 1, beta, b_out.data(), 1);
+    // return vector
+    return b_out;
+}
+
+// C = C + A * B where A(N_row, N_col), B(N_col, M) and C(N_row, M)
+template <typename T>
+mutable_tile_data<T> gemm_p(const const_tile_data<T> &A,
+                            const const_tile_data<T> &B,
+                            const mutable_tile_data<T> &C,
+                            std::size_t N_row,
+                            std::size_t N_col,
+                            std::size_t M)
+{
+    mutable_tile_data<T> C_out = C.writable();
+    // GEMM constants
+    const T alpha = 1.0;
+    const T beta = 1.0;
+    // GEMM kernel
+    blas::gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N_row, M, N_col, alpha, A.data(), N_col, B.data(), M, beta, C_out.data(), M);
     // return vector
-    return b;
+    return C_out;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // BLAS operations used in uncertainty computation
 // in-place solve X * L = A where L lower triangular
-std::vector<double> trsm_l_KcK(std::vector<double> L,
-                               std::vector<double> A,
-                               std::size_t N,
-                               std::size_t M)
+template <typename T>
+mutable_tile_data<T> trsm_l_KcK(const const_tile_data<T> &L,
+                                const mutable_tile_data<T> &A,
+                                std::size_t N,
+                                std::size_t M)
 {
+    mutable_tile_data<T> A_out = A.writable();
     // TRSM constants
-    const double alpha = 1.0;
-    // TRSM kernel - caution with dtrsm
-    cblas_dtrsm(CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, N, M, alpha, L.data(), N, A.data(), M);
+    const T alpha = 1.0;
+    // TRSM kernel - caution with ?trsm
+    blas::trsm(CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, N, M, alpha, L.data(), N, A_out.data(), M);
     // return vector
-    return A;
+    return A_out;
 }
 
 // C = C - A * B
-std::vector<double> gemm_l_KcK(std::vector<double> A,
-                               std::vector<double> B,
-                               std::vector<double> C,
-                               std::size_t N,
-                               std::size_t M)
+template <typename T>
+mutable_tile_data<T> gemm_l_KcK(const const_tile_data<T> &A,
+                                const const_tile_data<T> &B,
+                                const mutable_tile_data<T> &C,
+                                std::size_t N,
+                                std::size_t M)
 {
+    mutable_tile_data<T> C_out = C.writable();
     // GEMM constants
-    const double alpha = -1.0;
-    const double beta = 1.0;
-    // GEMM kernel - caution with dgemm
-    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N, M, N, alpha, A.data(), N, B.data(), M, beta, C.data(), M);
+    const T alpha = -1.0;
+    const T beta = 1.0;
+    // GEMM kernel - caution with ?gemm
+    blas::gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N, M, N, alpha, A.data(), N, B.data(), M, beta, C_out.data(), M);
     // return vector
-    return C;
+    return C_out;
 }
 
 // C = C - A^T * B
-std::vector<double> gemm_cross_tcross_matrix(std::vector<double> A,
-                                             std::vector<double> B,
-                                             std::vector<double> C,
-                                             std::size_t N,
-                                             std::size_t M)
+template <typename T>
+mutable_tile_data<T> gemm_cross_tcross_matrix(const const_tile_data<T> &A,
+                                              const const_tile_data<T> &B,
+                                              const mutable_tile_data<T> &C,
+                                              std::size_t N,
+                                              std::size_t M)
 {
+    mutable_tile_data<T> C_out = C.writable();
     // GEMM constants
-    const double alpha = -1.0;
-    const double beta = 1.0;
-    // GEMM kernel - caution with dgemm
-    cblas_dgemm(CblasRowMajor, CblasTrans, CblasNoTrans, M, M, N, alpha, A.data(), M, B.data(), M, beta, C.data(), M);
+    const T alpha = -1.0;
+    const T beta = 1.0;
+    // GEMM kernel - caution with ?gemm
+    blas::gemm(CblasRowMajor, CblasTrans, CblasNoTrans, M, M, N, alpha, A.data(), M, B.data(), M, beta, C_out.data(), M);
     // return vector
-    return C;
+    return C_out;
+}
+
+// C = C - A^T * A on the lower triangle of C(M, M) where A(N, M), the strict
+// upper triangle of C is not referenced
+template <typename T>
+mutable_tile_data<T> syrk_tcross_matrix(const const_tile_data<T> &A,
+                                        const mutable_tile_data<T> &C,
+                                        std::size_t N,
+                                        std::size_t M)
+{
+    mutable_tile_data<T> C_out = C.writable();
+    // SYRK constants
+    const T alpha = -1.0;
+    const T beta = 1.0;
+    // SYRK kernel - caution with ?syrk
+    blas::syrk(CblasRowMajor, CblasLower, CblasTrans, M, N, alpha, A.data(), M, beta, C_out.data(), M);
+    // return vector
+    return C_out;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // BLAS operations used in optimization step
 // in-place solve L * X = A where L lower triangular
-std::vector<double> trsm_l_matrix(std::vector<double> L,
-                                  std::vector<double> A,
-                                  std::size_t N,
-                                  std::size_t M)
+template <typename T>
+mutable_tile_data<T> trsm_l_matrix(const const_tile_data<T> &L,
+                                   const mutable_tile_data<T> &A,
+                                   std::size_t N,
+                                   std::size_t M)
 {
+    mutable_tile_data<T> A_out = A.writable();
     // TRSM constants
-    const double alpha = 1.0;
-    // TRSM kernel - caution with dtrsm
-    cblas_dtrsm(CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, N, M, alpha, L.data(), N, A.data(), M);
+    const T alpha = 1.0;
+    // TRSM kernel - caution with ?trsm
+    blas::trsm(CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasNonUnit, N, M, alpha, L.data(), N, A_out.data(), M);
     // return vector
-    return A;
+    return A_out;
 }
 
 // C = C - A * B
-std::vector<double> gemm_l_matrix(std::vector<double> A,
-                                  std::vector<double> B,
-                                  std::vector<double> C,
-                                  std::size_t N,
-                                  std::size_t M)
+template <typename T>
+mutable_tile_data<T> gemm_l_matrix(const const_tile_data<T> &A,
+                                   const const_tile_data<T> &B,
+                                   const mutable_tile_data<T> &C,
+                                   std::size_t N,
+                                   std::size_t M)
 {
+    mutable_tile_data<T> C_out = C.writable();
     // GEMM constants
-    const double alpha = -1.0;
-    const double beta = 1.0;
-    // GEMM kernel - caution with dgemm
-    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N, M, N, alpha, A.data(), N, B.data(), M, beta, C.data(), M);
+    const T alpha = -1.0;
+    const T beta = 1.0;
+    // GEMM kernel - caution with ?gemm
+    blas::gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N, M, N, alpha, A.data(), N, B.data(), M, beta, C_out.data(), M);
     // return vector
-    return C;
+    return C_out;
 }
 
 // in-place solve L^T * X = A where L upper triangular
-std::vector<double> trsm_u_matrix(std::vector<double> L,
-                                  std::vector<double> A,
-                                  std::size_t N,
-                                  std::size_t M)
+template <typename T>
+mutable_tile_data<T> trsm_u_matrix(const const_tile_data<T> &L,
+                                   const mutable_tile_data<T> &A,
+                                   std::size_t N,
+                                   std::size_t M)
 {
+    mutable_tile_data<T> A_out = A.writable();
     // TRSM constants
-    const double alpha = 1.0;
-    // TRSM kernel - caution with dtrsm
-    cblas_dtrsm(CblasRowMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit, N, M, alpha, L.data(), N, A.data(), M);
+    const T alpha = 1.0;
+    // TRSM kernel - caution with ?trsm
+    blas::trsm(CblasRowMajor, CblasLeft, CblasLower, CblasTrans, CblasNonUnit, N, M, alpha, L.data(), N, A_out.data(), M);
     // return vector
-    return A;
+    return A_out;
 }
 
 // C = C - A^T * B
-std::vector<double> gemm_u_matrix(std::vector<double> A,
-                                  std::vector<double> B,
-                                  std::vector<double> C,
-                                  std::size_t N,
-                                  std::size_t M)
+template <typename T>
+mutable_tile_data<T> gemm_u_matrix(const const_tile_data<T> &A,
+                                   const const_tile_data<T> &B,
+                                   const mutable_tile_data<T> &C,
+                                   std::size_t N,
+                                   std::size_t M)
 {
+    mutable_tile_data<T> C_out = C.writable();
     // GEMM constants
-    const double alpha = -1.0;
-    const double beta = 1.0;
-    // GEMM kernel - caution with dgemm
-    cblas_dgemm(CblasRowMajor, CblasTrans, CblasNoTrans, N, M, N, alpha, A.data(), N, B.data(), M, beta, C.data(), M);
+    const T alpha = -1.0;
+    const T beta = 1.0;
+    // GEMM kernel - caution with ?gemm
+    blas::gemm(CblasRowMajor, CblasTrans, CblasNoTrans, N, M, N, alpha, A.data(), N, B.data(), M, beta, C_out.data(), M);
     // return vector
-    return C;
+    return C_out;
+}
+
+// inverse of lower triangular L, upper triangle of the result set to zero
+template <typename T>
+mutable_tile_data<T> trtri(const const_tile_data<T> &L,
+                           std::size_t N)
+{
+    // L stays valid, invert a copy
+    mutable_tile_data<T> L_inv(N * N);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        for (std::size_t j = 0; j < N; j++)
+        {
+            L_inv[i * N + j] = j <= i ? L[i * N + j] : T(0);
+        }
+    }
+    // TRTRI kernel
+    blas::trtri(LAPACK_ROW_MAJOR, 'L', 'N', N, L_inv.data(), N);
+    // return vector
+    return L_inv;
+}
+
+// C = C + A * B
+template <typename T>
+mutable_tile_data<T> gemm_nn_add(const const_tile_data<T> &A,
+                                 const const_tile_data<T> &B,
+                                 const mutable_tile_data<T> &C,
+                                 std::size_t N,
+                                 std::size_t M)
+{
+    mutable_tile_data<T> C_out = C.writable();
+    // GEMM constants
+    const T alpha = 1.0;
+    const T beta = 1.0;
+    // GEMM kernel
+    blas::gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N, M, N, alpha, A.data(), N, B.data(), M, beta, C_out.data(), M);
+    // return vector
+    return C_out;
+}
+
+// C = C + A^T * B
+template <typename T>
+mutable_tile_data<T> gemm_tn_add(const const_tile_data<T> &A,
+                                 const const_tile_data<T> &B,
+                                 const mutable_tile_data<T> &C,
+                                 std::size_t N,
+                                 std::size_t M)
+{
+    mutable_tile_data<T> C_out = C.writable();
+    // GEMM constants
+    const T alpha = 1.0;
+    const T beta = 1.0;
+    // GEMM kernel
+    blas::gemm(CblasRowMajor, CblasTrans, CblasNoTrans, N, M, N, alpha, A.data(), N, B.data(), M, beta, C_out.data(), M);
+    // return vector
+    return C_out;
 }
 
 // Dot product used in dot calculation
-double dot(std::size_t N,
-           std::vector<double> A,
-           std::vector<double> B)
+template <typename T>
+T dot(std::size_t N,
+      const const_tile_data<T> &A,
+      const const_tile_data<T> &B)
 {
-    return cblas_ddot(N, A.data(), 1, B.data(), 1);
+    return blas::dot(N, A.data(), 1, B.data(), 1);
 }
 
 // C = C - A * B
-std::vector<double> dot_uncertainty(std::vector<double> A,
-                                    std::vector<double> R,
-                                    std::size_t N,
-                                    std::size_t M)
+template <typename T>
+mutable_tile_data<T> dot_uncertainty(const const_tile_data<T> &A,
+                                     const mutable_tile_data<T> &R,
+                                     std::size_t N,
+                                     std::size_t M)
 {
+    mutable_tile_data<T> R_out = R.writable();
     for (int j = 0; j < M; ++j)
     {
         // Extract the j-th column and compute its dot product with itself
-        R[j] += cblas_ddot(N, &A[j], M, &A[j], M);
+        R_out[j] += blas::dot(N, &A[j], M, &A[j], M);
     }
 
-    return R;
+    return R_out;
 }
 
 // C = C - A * B
-std::vector<double> gemm_grad(std::vector<double> A,
-                              std::vector<double> B,
-                              std::vector<double> R,
-                              std::size_t N,
-                              std::size_t M)
+template <typename T>
+mutable_tile_data<T> gemm_grad(const const_tile_data<T> &A,
+                               const const_tile_data<T> &B,
+                               const mutable_tile_data<T> &R,
+                               std::size_t N,
+                               std::size_t M)
 {
+    mutable_tile_data<T> R_out = R.writable();
     for (std::size_t i = 0; i < N; ++i)
     {
-        R[i] += cblas_ddot(M, &A[i * M], 1, &B[i], N);
+        R_out[i] += blas::dot(M, &A[i * M], 1, &B[i], N);
+    }
+    return R_out;
+}
+
+// in-place solve X * L^T = A where L(N, N) lower triangular and A(N_row, N)
+template <typename T>
+mutable_tile_data<T> trsm_rect(const const_tile_data<T> &L,
+                               const mutable_tile_data<T> &A,
+                               std::size_t N_row,
+                               std::size_t N)
+{
+    mutable_tile_data<T> A_out = A.writable();
+    // TRSM constants
+    const T alpha = 1.0;
+    // TRSM kernel
+    blas::trsm(CblasRowMajor, CblasRight, CblasLower, CblasTrans, CblasNonUnit, N_row, N, alpha, L.data(), N, A_out.data(), N);
+    // return vector
+    return A_out;
+}
+
+// C = C + A^T * B where A(N_row, N), B(N_row, N) and C(N, N)
+template <typename T>
+mutable_tile_data<T> gemm_tn_rect(const const_tile_data<T> &A,
+                                  const const_tile_data<T> &B,
+                                  const mutable_tile_data<T> &C,
+                                  std::size_t N_row,
+                                  std::size_t N)
+{
+    mutable_tile_data<T> C_out = C.writable();
+    // GEMM constants
+    const T alpha = 1.0;
+    const T beta = 1.0;
+    // GEMM kernel
+    blas::gemm(CblasRowMajor, CblasTrans, CblasNoTrans, N, N, N_row, alpha, A.data(), N, B.data(), N, beta, C_out.data(), N);
+    // return vector
+    return C_out;
+}
+
+// C = A * B where A(N_row, N) and B(N, N)
+template <typename T>
+mutable_tile_data<T> gemm_nn_rect(const const_tile_data<T> &A,
+                                  const const_tile_data<T> &B,
+                                  std::size_t N_row,
+                                  std::size_t N)
+{
+    mutable_tile_data<T> C(N_row * N);
+    // GEMM constants
+    const T alpha = 1.0;
+    const T beta = 0.0;
+    // GEMM kernel
+    blas::gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, N_row, N, N, alpha, A.data(), N, B.data(), N, beta, C.data(), N);
+    // return vector
+    return C;
+}
+
+// b = b + A^T * a where A(N_row, N_col), a(N_row) and b(N_col)
+template <typename T>
+mutable_tile_data<T> gemv_t(const const_tile_data<T> &A,
+                            const const_tile_data<T> &a,
+                            const mutable_tile_data<T> &b,
+                            std::size_t N_row,
+                            std::size_t N_col)
+{
+    mutable_tile_data<T> b_out = b.writable();
+    // GEMV constants
+    const T alpha = 1.0;
+    const T beta = 1.0;
+    // GEMV kernel
+    blas::gemv(CblasRowMajor, CblasTrans, N_row, N_col, alpha, A.data(), N_col, a.data(), 1, beta, b_out.data(), 1);
+    // return vector
+    return b_out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BLAS operations for iterative solvers
+
+// C = C + A^T * B where A(N_row, N_col), B(N_row, M) and C(N_col, M)
+template <typename T>
+mutable_tile_data<T> gemm_tn_p(const const_tile_data<T> &A,
+                               const const_tile_data<T> &B,
+                               const mutable_tile_data<T> &C,
+                               std::size_t N_row,
+                               std::size_t N_col,
+                               std::size_t M)
+{
+    mutable_tile_data<T> C_out = C.writable();
+    // GEMM constants
+    const T alpha = 1.0;
+    const T beta = 1.0;
+    // GEMM kernel
+    blas::gemm(CblasRowMajor, CblasTrans, CblasNoTrans, N_col, M, N_row, alpha, A.data(), N_col, B.data(), M, beta, C_out.data(), M);
+    // return vector
+    return C_out;
+}
+
+// eigenvalues of the symmetric tridiagonal matrix with diagonal d(N) and
+// off-diagonal e(N - 1), followed by the first entries of its eigenvectors
+template <typename T>
+mutable_tile_data<T> stev(const const_tile_data<T> &d,
+                          const const_tile_data<T> &e,
+                          std::size_t N)
+{
+    mutable_tile_data<T> result(2 * N);
+    if (N == 0)
+    {
+        return result;
     }
-    return R;
+    std::copy(d.begin(), d.begin() + N, result.begin());
+    // STEV overwrites the off-diagonal and needs room for N - 1 entries
+    mutable_tile_data<T> off_diagonal(N);
+    std::copy(e.begin(), e.begin() + (N - 1), off_diagonal.begin());
+    mutable_tile_data<T> eigenvectors(N * N);
+    // STEV kernel
+    blas::stev(LAPACK_ROW_MAJOR, 'V', N, result.data(), off_diagonal.data(), eigenvectors.data(), N);
+    std::copy(eigenvectors.begin(), eigenvectors.begin() + N, result.begin() + N);
+    // return vector
+    return result;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Instantiations for single and double precision tiles
+#define INSTANTIATE_ADAPTER_MKL(T)                                                                                                                                             \
+    template mutable_tile_data<T> potrf<T>(const mutable_tile_data<T> &, std::size_t);                                                                                         \
+    template mutable_tile_data<T> trsm<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t);                                                              \
+    template mutable_tile_data<T> syrk<T>(const mutable_tile_data<T> &, const const_tile_data<T> &, std::size_t);                                                              \
+    template mutable_tile_data<T> gemm<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t);                                  \
+    template mutable_tile_data<T> trsv_l<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t);                                                            \
+    template mutable_tile_data<T> gemv_l<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t);                                \
+    template mutable_tile_data<T> trsv_u<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t);                                                            \
+    template mutable_tile_data<T> gemv_u<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t);                                \
+    template mutable_tile_data<T> ger<T>(const mutable_tile_data<T> &, const const_tile_data<T> &, const const_tile_data<T> &, std::size_t);                                   \
+    template mutable_tile_data<T> gemm_diag<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t);                             \
+    template mutable_tile_data<T> gemv_p<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                   \
+    template mutable_tile_data<T> gemm_p<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t, std::size_t);      \
+    template mutable_tile_data<T> trsm_l_KcK<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                                           \
+    template mutable_tile_data<T> gemm_l_KcK<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);               \
+    template mutable_tile_data<T> gemm_cross_tcross_matrix<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t); \
+    template mutable_tile_data<T> syrk_tcross_matrix<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                                   \
+    template mutable_tile_data<T> trsm_l_matrix<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                                        \
+    template mutable_tile_data<T> gemm_l_matrix<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);            \
+    template mutable_tile_data<T> trsm_u_matrix<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                                        \
+    template mutable_tile_data<T> gemm_u_matrix<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);            \
+    template mutable_tile_data<T> trtri<T>(const const_tile_data<T> &, std::size_t);                                                                                           \
+    template mutable_tile_data<T> gemm_nn_add<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);              \
+    template mutable_tile_data<T> gemm_tn_add<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);              \
+    template T dot<T>(std::size_t, const const_tile_data<T> &, const const_tile_data<T> &);                                                                                    \
+    template mutable_tile_data<T> dot_uncertainty<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                                      \
+    template mutable_tile_data<T> gemm_grad<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                \
+    template mutable_tile_data<T> trsm_rect<T>(const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                                            \
+    template mutable_tile_data<T> gemm_tn_rect<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);             \
+    template mutable_tile_data<T> gemm_nn_rect<T>(const const_tile_data<T> &, const const_tile_data<T> &, std::size_t, std::size_t);                                           \
+    template mutable_tile_data<T> gemv_t<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t);                    \
+    template mutable_tile_data<T> gemm_tn_p<T>(const const_tile_data<T> &, const const_tile_data<T> &, const mutable_tile_data<T> &, std::size_t, std::size_t, std::size_t);   \
+    template mutable_tile_data<T> stev<T>(const const_tile_data<T> &, const const_tile_data<T> &, std::size_t);
+
+INSTANTIATE_ADAPTER_MKL(float)
+INSTANTIATE_ADAPTER_MKL(double)
@@ -0,0 +1,210 @@
+#include "../include/covariance_assembly.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+/**
+ * @brief Copy the inputs [start - n_regressors, start + N) into a buffer,
+ *        zero-padded for negative indices and indices past the last sample.
+ *
+ * Entries 1..n_regressors of (buffer + i) are the feature vector of sample
+ * start + i, entry 0 is the input that dropped out of the window.
+ */
+std::vector<double> lagged_window(const std::vector<double> &input,
+                                  std::size_t start,
+                                  std::size_t N,
+                                  std::size_t n_regressors)
+{
+    std::vector<double> window(N + n_regressors, 0.0);
+    for (std::size_t t = 0; t < N + n_regressors; t++)
+    {
+        if (start + t >= n_regressors && start + t - n_regressors < input.size())
+        {
+            window[t] = input[start + t - n_regressors];
+        }
+    }
+    return window;
+}
+
+// direct sum of squared differences of one row against N_col columns
+inline void direct_distances(double *distances,
+                             const double *row_window,
+                             const double *col_window,
+                             std::size_t N_col,
+                             std::size_t n_regressors)
+{
+    std::fill(distances, distances + N_col, 0.0);
+    for (std::size_t k = 1; k <= n_regressors; k++)
+    {
+        const double z_ik = row_window[k];
+        const double *z_jk = col_window + k;
+        for (std::size_t j = 0; j < N_col; j++)
+        {
+            const double diff = z_ik - z_jk[j];
+            distances[j] += diff * diff;
+        }
+    }
+}
+
+// exp on ~[-708, 709] by Cody-Waite range reduction and a degree-12 Taylor
+// polynomial: branch-free, such that the calling loop vectorizes
+inline double exp_poly(double x)
+{
+    constexpr double log2e = 1.4426950408889634;
+    constexpr double ln2_hi = 6.93147180369123816490e-01;
+    constexpr double ln2_lo = 1.90821492927058770002e-10;
+    // adding 1.5 * 2^52 rounds to the nearest integer
+    constexpr double shifter = 6755399441055744.0;
+    constexpr std::uint64_t shifter_bits = 0x4338000000000000ULL;
+
+    x = std::min(std::max(x, -708.0), 709.0);
+    const double t = x * log2e + shifter;
+    const double n = t - shifter;
+    const double r = x - n * ln2_hi - n * ln2_lo;
+
+    double p = 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    // 2^n from the integer held in the low mantissa bits of t
+    std::uint64_t bits;
+    std::memcpy(&bits, &t, sizeof(bits));
+    bits = (bits - shifter_bits + 1023) << 52;
+    double scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+}  // namespace
+
+GPXPY_TARGET_CLONES
+void compute_lagged_distances(double *distances,
+                              std::size_t row_start,
+                              std::size_t col_start,
+                              std::size_t N_row,
+                              std::size_t N_col,
+                              std::size_t n_regressors,
+                              const std::vector<double> &row_input,
+                              const std::vector<double> &col_input)
+{
+    if (n_regressors == 0)
+    {
+        std::fill(distances, distances + N_row * N_col, 0.0);
+        return;
+    }
+    const std::vector<double> row_window =
+        lagged_window(row_input, row_start, N_row, n_regressors);
+    const std::vector<double> col_window =
+        lagged_window(col_input, col_start, N_col, n_regressors);
+    const double *z_j = col_window.data();
+
+    for (std::size_t i = 0; i < N_row; i++)
+    {
+        double *d_i = distances + i * N_col;
+        const double *z_i = row_window.data() + i;
+        if (i % n_regressors == 0)
+        {
+            // reseed
+            direct_distances(d_i, z_i, z_j, N_col, n_regressors);
+            continue;
+        }
+        direct_distances(d_i, z_i, z_j, 1, n_regressors);
+        // d(i, j) from d(i-1, j-1): add the newest lag, drop the oldest
+        const double *d_prev = d_i - N_col;
+        const double z_new = z_i[n_regressors];
+        const double z_old = z_i[0];
+        for (std::size_t j = 1; j < N_col; j++)
+        {
+            const double diff_new = z_new - z_j[j + n_regressors];
+            const double diff_old = z_old - z_j[j];
+            const double d = d_prev[j - 1] + diff_new * diff_new - diff_old * diff_old;
+            // cancellation must not produce negative distances
+            d_i[j] = std::max(d, 0.0);
+        }
+    }
+}
+
+void compute_lagged_distances_diag(double *distances,
+                                   std::size_t row_start,
+                                   std::size_t col_start,
+                                   std::size_t N,
+                                   std::size_t n_regressors,
+                                   const std::vector<double> &row_input,
+                                   const std::vector<double> &col_input)
+{
+    if (n_regressors == 0)
+    {
+        std::fill(distances, distances + N, 0.0);
+        return;
+    }
+    const std::vector<double> row_window =
+        lagged_window(row_input, row_start, N, n_regressors);
+    const std::vector<double> col_window =
+        lagged_window(col_input, col_start, N, n_regressors);
+
+    for (std::size_t i = 0; i < N; i++)
+    {
+        const double *z_i = row_window.data() + i;
+        const double *z_j = col_window.data() + i;
+        if (i % n_regressors == 0)
+        {
+            direct_distances(distances + i, z_i, z_j, 1, n_regressors);
+            continue;
+        }
+        const double diff_new = z_i[n_regressors] - z_j[n_regressors];
+        const double diff_old = z_i[0] - z_j[0];
+        const double d = distances[i - 1] + diff_new * diff_new - diff_old * diff_old;
+        distances[i] = std::max(d, 0.0);
+    }
+}
+
+std::size_t n_valid_samples(std::size_t start, std::size_t N, std::size_t n_samples)
+{
+    return start < n_samples ? std::min(N, n_samples - start) : 0;
+}
+
+void mask_padding(double *tile,
+                  std::size_t row_start,
+                  std::size_t col_start,
+                  std::size_t N_row,
+                  std::size_t N_col,
+                  std::size_t n_row_samples,
+                  std::size_t n_col_samples,
+                  double diagonal)
+{
+    const std::size_t valid_rows = n_valid_samples(row_start, N_row, n_row_samples);
+    const std::size_t valid_cols = n_valid_samples(col_start, N_col, n_col_samples);
+    if (valid_rows == N_row && valid_cols == N_col)
+    {
+        return;
+    }
+    for (std::size_t i = 0; i < N_row; i++)
+    {
+        // the padded columns of a valid row, all columns of a padded row
+        for (std::size_t j = i < valid_rows ? valid_cols : 0; j < N_col; j++)
+        {
+            tile[i * N_col + j] = row_start + i == col_start + j ? diagonal : 0.0;
+        }
+    }
+}
+
+GPXPY_TARGET_CLONES
+void scaled_exp(double *x, std::size_t n, double scale, double factor)
+{
+    for (std::size_t i = 0; i < n; i++)
+    {
+        x[i] = factor * exp_poly(scale * x[i]);
+    }
+}
@@ -0,0 +1,482 @@
+#include "../include/data_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <future>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace data_file
+{
+namespace
+{
+constexpr char magic[8] = { 'G', 'P', 'X', 'P', 'Y', 'B', 'I', 'N' };
+constexpr std::uint32_t format_version = 1;
+constexpr std::size_t header_bytes = 32;
+
+// smallest chunk of a file worth a thread of its own
+constexpr std::size_t min_chunk_bytes = std::size_t(1) << 20;
+
+// samples converted per write of write_binary
+constexpr std::size_t write_block = std::size_t(1) << 16;
+
+// longest token accepted by the text parser
+constexpr std::size_t max_token_length = 63;
+
+// Memory-Mapped Files ----------------------------------------------------- {{{
+
+// Read-only mapping of a whole file, unmapped on destruction
+class mapped_file
+{
+  public:
+    explicit mapped_file(const std::string &file_path)
+    {
+        int fd = open(file_path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Error: File not found: " + file_path);
+        }
+        struct stat status;
+        if (fstat(fd, &status) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Error: Cannot read file: " + file_path);
+        }
+        _size = static_cast<std::size_t>(status.st_size);
+        if (_size > 0)
+        {
+            void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("Error: Cannot map file: " + file_path);
+            }
+            // every chunk is read front to back
+            madvise(data, _size, MADV_SEQUENTIAL);
+            _data = static_cast<const char *>(data);
+        }
+        // the mapping outlives the descriptor
+        close(fd);
+    }
+
+    ~mapped_file()
+    {
+        if (_data != nullptr)
+        {
+            munmap(const_cast<char *>(_data), _size);
+        }
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    const char *data() const { return _data; }
+
+    std::size_t size() const { return _size; }
+
+  private:
+    const char *_data = nullptr;
+    std::size_t _size = 0;
+};
+
+// Number of chunks to split `bytes` bytes of work into
+std::size_t n_chunks(std::size_t bytes)
+{
+    std::size_t n_threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<std::size_t>(1, std::min(n_threads, bytes / min_chunk_bytes));
+}
+
+// Run f(c) for the chunks c = 0 .. n - 1 concurrently and rethrow the first
+// error. Plain threads since data is usually loaded before the HPX runtime
+// is started.
+template <typename F>
+void for_each_chunk(std::size_t n, const F &f)
+{
+    std::vector<std::future<void>> futures;
+    for (std::size_t c = 1; c < n; c++)
+    {
+        futures.push_back(std::async(std::launch::async, f, c));
+    }
+    std::exception_ptr error;
+    try
+    {
+        f(0);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    for (auto &future : futures)
+    {
+        try
+        {
+            future.get();
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+// }}} ---------------------------------------------- end of Memory-Mapped Files
+
+// Binary Format ----------------------------------------------------------- {{{
+
+// Unsigned integer of type U stored little-endian at `bytes`, independent of
+// the byte order of the host
+template <typename U>
+U load_le(const char *bytes)
+{
+    U value = 0;
+    for (std::size_t i = 0; i < sizeof(U); i++)
+    {
+        value |= static_cast<U>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+template <typename U>
+void store_le(char *bytes, U value)
+{
+    for (std::size_t i = 0; i < sizeof(U); i++)
+    {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+// Floating point sample of type S with the bit pattern of U
+template <typename S, typename U>
+double load_sample(const char *bytes)
+{
+    const U bits = load_le<U>(bytes);
+    S value;
+    std::memcpy(&value, &bits, sizeof(S));
+    return static_cast<double>(value);
+}
+
+template <typename S, typename U>
+void store_sample(char *bytes, double sample)
+{
+    const S value = static_cast<S>(sample);
+    U bits;
+    std::memcpy(&bits, &value, sizeof(S));
+    store_le<U>(bytes, bits);
+}
+
+std::size_t element_size(data_type type)
+{
+    return type == data_type::Float32 ? sizeof(float) : sizeof(double);
+}
+
+header parse_header(const char *bytes, std::size_t size, const std::string &file_path)
+{
+    if (size < header_bytes || std::memcmp(bytes, magic, sizeof(magic)) != 0)
+    {
+        throw std::runtime_error("Error: Not a binary data file: " + file_path);
+    }
+    const std::uint32_t version = load_le<std::uint32_t>(bytes + 8);
+    if (version != format_version)
+    {
+        throw std::runtime_error("Error: Unsupported binary data file version "
+                                 + std::to_string(version) + ": " + file_path);
+    }
+    const std::uint32_t type = load_le<std::uint32_t>(bytes + 12);
+    if (type != static_cast<std::uint32_t>(data_type::Float64)
+        && type != static_cast<std::uint32_t>(data_type::Float32))
+    {
+        throw std::runtime_error("Error: Unknown element type "
+                                 + std::to_string(type) + ": " + file_path);
+    }
+    header result{ static_cast<data_type>(type),
+                   static_cast<std::size_t>(load_le<std::uint64_t>(bytes + 16)) };
+    if ((size - header_bytes) / element_size(result.type) < result.count)
+    {
+        throw std::runtime_error("Error: Binary data file is truncated: " + file_path);
+    }
+    return result;
+}
+
+// }}} ---------------------------------------------------- end of Binary Format
+
+// Text Format ------------------------------------------------------------- {{{
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// A token starts at `p` if it is preceded by whitespace or the file start.
+// Chunk [begin, end) owns the tokens starting in it.
+bool is_token_start(const char *text, std::size_t p)
+{
+    return !is_space(text[p]) && (p == 0 || is_space(text[p - 1]));
+}
+
+std::size_t count_tokens(const char *text, std::size_t begin, std::size_t end)
+{
+    std::size_t count = 0;
+    for (std::size_t p = begin; p < end; p++)
+    {
+        count += is_token_start(text, p);
+    }
+    return count;
+}
+
+// Parse the first `n_values` tokens starting in [begin, end) into `values`
+void parse_tokens(const char *text,
+                  std::size_t size,
+                  std::size_t begin,
+                  std::size_t end,
+                  double *values,
+                  std::size_t n_values,
+                  const std::string &file_path)
+{
+    // tokens are copied since the mapping is not null-terminated
+    char token[max_token_length + 1];
+    std::size_t parsed = 0;
+    for (std::size_t p = begin; p < end && parsed < n_values; p++)
+    {
+        if (!is_token_start(text, p))
+        {
+            continue;
+        }
+        std::size_t length = 0;
+        while (p + length < size && !is_space(text[p + length]))
+        {
+            length++;
+        }
+        if (length > max_token_length)
+        {
+            throw std::runtime_error("Error: Invalid value '"
+                                     + std::string(text + p, max_token_length)
+                                     + "...' in file " + file_path);
+        }
+        std::memcpy(token, text + p, length);
+        token[length] = '\0';
+        char *token_end;
+        values[parsed++] = std::strtod(token, &token_end);
+        if (token_end != token + length)
+        {
+            throw std::runtime_error("Error: Invalid value '" + std::string(token)
+                                     + "' in file " + file_path);
+        }
+        p += length;
+    }
+}
+
+// }}} ------------------------------------------------------ end of Text Format
+
+}  // namespace
+
+/**
+ * @brief Returns true if the file starts with the magic of a binary data file
+ *
+ * @param file_path path to the file
+ */
+bool is_binary(const std::string &file_path)
+{
+    FILE *file = fopen(file_path.c_str(), "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    char bytes[sizeof(magic)];
+    const bool binary = fread(bytes, 1, sizeof(magic), file) == sizeof(magic)
+                        && std::memcmp(bytes, magic, sizeof(magic)) == 0;
+    fclose(file);
+    return binary;
+}
+
+/**
+ * @brief Read and validate the header of a binary data file
+ *
+ * @param file_path path to the file
+ */
+header read_header(const std::string &file_path)
+{
+    mapped_file file(file_path);
+    return parse_header(file.data(), file.size(), file_path);
+}
+
+/**
+ * @brief Read the first `n_samples` samples of a binary data file.
+ *
+ * The payload is converted from the mapping in parallel chunks, straight
+ * into the returned vector.
+ *
+ * @param file_path path to the file
+ * @param n_samples number of samples to read, at most the count of the
+ *        header, or all_samples
+ */
+std::vector<double> read_binary(const std::string &file_path, std::size_t n_samples)
+{
+    mapped_file file(file_path);
+    const header head = parse_header(file.data(), file.size(), file_path);
+    if (n_samples == all_samples)
+    {
+        n_samples = head.count;
+    }
+    if (n_samples > head.count)
+    {
+        throw std::runtime_error("Error: Data not correctly read. Expected "
+                                 + std::to_string(n_samples)
+                                 + " elements, but the file holds "
+                                 + std::to_string(head.count));
+    }
+    std::vector<double> data(n_samples);
+    const char *payload = file.data() + header_bytes;
+    const std::size_t element = element_size(head.type);
+    const std::size_t n = n_chunks(n_samples * element);
+    for_each_chunk(n,
+                   [&](std::size_t c)
+                   {
+                       const std::size_t begin = n_samples * c / n;
+                       const std::size_t end = n_samples * (c + 1) / n;
+                       for (std::size_t i = begin; i < end; i++)
+                       {
+                           data[i] = head.type == data_type::Float32
+                                         ? load_sample<float, std::uint32_t>(payload + i * element)
+                                         : load_sample<double, std::uint64_t>(payload + i * element);
+                       }
+                   });
+    return data;
+}
+
+/**
+ * @brief Write samples to a binary data file
+ *
+ * @param file_path path to the file, overwritten if it exists
+ * @param data samples to write
+ * @param type element type, Float32 rounds the samples to single precision
+ */
+void write_binary(const std::string &file_path,
+                  const std::vector<double> &data,
+                  data_type type)
+{
+    FILE *file = fopen(file_path.c_str(), "wb");
+    if (file == NULL)
+    {
+        throw std::runtime_error("Error: Cannot open file for writing: " + file_path);
+    }
+    char head[header_bytes] = {};
+    std::memcpy(head, magic, sizeof(magic));
+    store_le<std::uint32_t>(head + 8, format_version);
+    store_le<std::uint32_t>(head + 12, static_cast<std::uint32_t>(type));
+    store_le<std::uint64_t>(head + 16, data.size());
+    bool written = fwrite(head, 1, header_bytes, file) == header_bytes;
+
+    const std::size_t element = element_size(type);
+    std::vector<char> block(write_block * element);
+    for (std::size_t start = 0; written && start < data.size(); start += write_block)
+    {
+        const std::size_t n = std::min(write_block, data.size() - start);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            if (type == data_type::Float32)
+            {
+                store_sample<float, std::uint32_t>(block.data() + i * element, data[start + i]);
+            }
+            else
+            {
+                store_sample<double, std::uint64_t>(block.data() + i * element, data[start + i]);
+            }
+        }
+        written = fwrite(block.data(), 1, n * element, file) == n * element;
+    }
+    if ((fclose(file) != 0) || !written)
+    {
+        throw std::runtime_error("Error: Cannot write file: " + file_path);
+    }
+}
+
+/**
+ * @brief Parse the first `n_samples` values of a text data file.
+ *
+ * The mapped file is cut into one chunk per hardware thread. A first pass
+ * counts the tokens of each chunk, which gives the index of its first value,
+ * a second pass parses the chunks that hold one of the first `n_samples`
+ * values straight into the returned vector.
+ *
+ * @param file_path path to the file
+ * @param n_samples number of values to parse, or all_samples
+ */
+std::vector<double> read_text(const std::string &file_path, std::size_t n_samples)
+{
+    mapped_file file(file_path);
+    const char *text = file.data();
+    const std::size_t size = file.size();
+    const std::size_t n = n_chunks(size);
+
+    std::vector<std::size_t> counts(n);
+    for_each_chunk(n,
+                   [&](std::size_t c)
+                   { counts[c] = count_tokens(text, size * c / n, size * (c + 1) / n); });
+    std::vector<std::size_t> offsets(n + 1, 0);
+    for (std::size_t c = 0; c < n; c++)
+    {
+        offsets[c + 1] = offsets[c] + counts[c];
+    }
+    if (n_samples == all_samples)
+    {
+        n_samples = offsets[n];
+    }
+    if (offsets[n] < n_samples)
+    {
+        throw std::runtime_error("Error: Data not correctly read. Expected "
+                                 + std::to_string(n_samples)
+                                 + " elements, but read "
+                                 + std::to_string(offsets[n]));
+    }
+
+    std::vector<double> data(n_samples);
+    for_each_chunk(n,
+                   [&](std::size_t c)
+                   {
+                       if (offsets[c] < n_samples)
+                       {
+                           parse_tokens(text, size, size * c / n, size * (c + 1) / n, data.data() + offsets[c], std::min(counts[c], n_samples - offsets[c]), file_path);
+                       }
+                   });
+    return data;
+}
+
+/**
+ * @brief Write samples to a text data file, one value per line with enough
+ * digits to read back the same doubles
+ *
+ * @param file_path path to the file, overwritten if it exists
+ * @param data samples to write
+ */
+void write_text(const std::string &file_path, const std::vector<double> &data)
+{
+    FILE *file = fopen(file_path.c_str(), "w");
+    if (file == NULL)
+    {
+        throw std::runtime_error("Error: Cannot open file for writing: " + file_path);
+    }
+    bool written = true;
+    for (std::size_t i = 0; written && i < data.size(); i++)
+    {
+        written = fprintf(file, "%.17g\n", data[i]) > 0;
+    }
+    if ((fclose(file) != 0) || !written)
+    {
+        throw std::runtime_error("Error: Cannot write file: " + file_path);
+    }
+}
+}  // namespace data_file
@@ -0,0 +1,75 @@
+#include "../include/distance_cache.hpp"
+
+#include "../include/gp_optimizer.hpp"
+#include "../include/profiling.hpp"
+
+distance_tile_cache::distance_tile_cache(std::size_t budget) :
+    _budget(budget),
+    _cached_bytes(0),
+    _n_tiles(0),
+    _n_tile_size(0),
+    _n_regressors(0)
+{ }
+
+hpx::shared_future<mutable_tile_data<double>>
+distance_tile_cache::tile(std::size_t row,
+                          std::size_t col,
+                          std::size_t n_tiles,
+                          std::size_t n_tile_size,
+                          std::size_t n_regressors,
+                          const std::vector<double> &input)
+{
+    if (n_tiles != _n_tiles || n_tile_size != _n_tile_size
+        || n_regressors != _n_regressors)
+    {
+        clear();
+        _n_tiles = n_tiles;
+        _n_tile_size = n_tile_size;
+        _n_regressors = n_regressors;
+        _tiles.resize(n_tiles * n_tiles);
+    }
+
+    hpx::shared_future<mutable_tile_data<double>> &cached =
+        _tiles[row * n_tiles + col];
+    if (cached.valid())
+    {
+        return cached;
+    }
+    hpx::shared_future<mutable_tile_data<double>> distances =
+        hpx::async(profiling::annotated_function(&compute_cov_dist_vec,
+                                                 "assemble_cov_dist"),
+                   row,
+                   col,
+                   n_tile_size,
+                   n_regressors,
+                   input);
+    const std::size_t bytes = n_tile_size * n_tile_size * sizeof(double);
+    if (_cached_bytes + bytes <= _budget)
+    {
+        cached = distances;
+        _cached_bytes += bytes;
+    }
+    return distances;
+}
+
+void distance_tile_cache::clear()
+{
+    _tiles.clear();
+    _cached_bytes = 0;
+    _n_tiles = 0;
+    _n_tile_size = 0;
+    _n_regressors = 0;
+}
+
+void distance_tile_cache::set_budget(std::size_t budget)
+{
+    if (budget < _cached_bytes)
+    {
+        clear();
+    }
+    _budget = budget;
+}
+
+std::size_t distance_tile_cache::budget() const { return _budget; }
+
+std::size_t distance_tile_cache::cached_bytes() const { return _cached_bytes; }
@@ -0,0 +1,298 @@
+#include "../include/gp_algorithms_gpu.hpp"
+
+#include "../include/adapter_cublas.hpp"
+#include <algorithm>
+
+namespace gpu
+{
+
+namespace
+{
+constexpr unsigned block_size = 256;
+
+// Number of blocks to cover n threads
+unsigned n_blocks(std::size_t n)
+{
+    return static_cast<unsigned>((n + block_size - 1) / block_size);
+}
+
+// Squared distance of the lagged feature vectors of samples i and j, i.e.
+// of input[i - n_regressors + 1 .. i] with zeros before the first and past
+// the last sample
+__device__ double lagged_distance(const double *i_input,
+                                  long i,
+                                  long n_i,
+                                  const double *j_input,
+                                  long j,
+                                  long n_j,
+                                  long n_regressors)
+{
+    double distance = 0.0;
+    for (long k = 0; k < n_regressors; k++)
+    {
+        const double z_ik = i - k >= 0 && i - k < n_i ? i_input[i - k] : 0.0;
+        const double z_jk = j - k >= 0 && j - k < n_j ? j_input[j - k] : 0.0;
+        distance += (z_ik - z_jk) * (z_ik - z_jk);
+    }
+    return distance;
+}
+
+// tile = factor * exp(scale * distance) + noise on the global diagonal, and
+// `padding` on the global diagonal and zero elsewhere in the rows and columns
+// past the last sample, see mask_padding
+__global__ void covariance_kernel(double *tile,
+                                  std::size_t row_start,
+                                  std::size_t col_start,
+                                  std::size_t n_rows,
+                                  std::size_t n_cols,
+                                  std::size_t n_regressors,
+                                  const double *row_input,
+                                  std::size_t n_row_samples,
+                                  const double *col_input,
+                                  std::size_t n_col_samples,
+                                  double scale,
+                                  double factor,
+                                  double noise,
+                                  double padding)
+{
+    const std::size_t idx = blockIdx.x * static_cast<std::size_t>(blockDim.x) + threadIdx.x;
+    if (idx >= n_rows * n_cols)
+    {
+        return;
+    }
+    const std::size_t i_global = row_start + idx / n_cols;
+    const std::size_t j_global = col_start + idx % n_cols;
+    if (i_global >= n_row_samples || j_global >= n_col_samples)
+    {
+        tile[idx] = i_global == j_global ? padding : 0.0;
+        return;
+    }
+    const double distance = lagged_distance(row_input, static_cast<long>(i_global), static_cast<long>(n_row_samples), col_input, static_cast<long>(j_global), static_cast<long>(n_col_samples), static_cast<long>(n_regressors));
+    tile[idx] = factor * exp(scale * distance) + (i_global == j_global ? noise : 0.0);
+}
+
+// diagonal of covariance_kernel without noise
+__global__ void prior_covariance_kernel(double *tile,
+                                        std::size_t row_start,
+                                        std::size_t col_start,
+                                        std::size_t N,
+                                        std::size_t n_regressors,
+                                        const double *input,
+                                        std::size_t n_samples,
+                                        double scale,
+                                        double factor)
+{
+    const std::size_t i = blockIdx.x * static_cast<std::size_t>(blockDim.x) + threadIdx.x;
+    if (i >= N)
+    {
+        return;
+    }
+    const double distance = lagged_distance(input, static_cast<long>(row_start + i), static_cast<long>(n_samples), input, static_cast<long>(col_start + i), static_cast<long>(n_samples), static_cast<long>(n_regressors));
+    tile[i] = factor * exp(scale * distance);
+}
+
+__global__ void transpose_kernel(double *transposed, const double *tile, std::size_t N_row, std::size_t N_col)
+{
+    const std::size_t idx = blockIdx.x * static_cast<std::size_t>(blockDim.x) + threadIdx.x;
+    if (idx >= N_row * N_col)
+    {
+        return;
+    }
+    const std::size_t i = idx / N_col;
+    const std::size_t j = idx % N_col;
+    transposed[j * N_row + i] = tile[idx];
+}
+
+__global__ void identity_kernel(double *tile, std::size_t N)
+{
+    const std::size_t idx = blockIdx.x * static_cast<std::size_t>(blockDim.x) + threadIdx.x;
+    if (idx >= N * N)
+    {
+        return;
+    }
+    tile[idx] = idx / N == idx % N ? 1.0 : 0.0;
+}
+
+__global__ void difference_kernel(double *result, const double *A, const double *B, std::size_t M)
+{
+    const std::size_t i = blockIdx.x * static_cast<std::size_t>(blockDim.x) + threadIdx.x;
+    if (i < M)
+    {
+        result[i] = A[i] - B[i];
+    }
+}
+
+// R[j] += sum_i A[i, j]^2 for the N x M tile A, one thread per column
+__global__ void column_norms_kernel(double *R, const double *A, std::size_t N, std::size_t M)
+{
+    const std::size_t j = blockIdx.x * static_cast<std::size_t>(blockDim.x) + threadIdx.x;
+    if (j >= M)
+    {
+        return;
+    }
+    double sum = 0.0;
+    for (std::size_t i = 0; i < N; i++)
+    {
+        sum += A[i * M + j] * A[i * M + j];
+    }
+    R[j] += sum;
+}
+
+// R[i] += sum_k A[i, k] * B[k, i] for the N x M tile A and M x N tile B
+__global__ void diagonal_product_kernel(double *R, const double *A, const double *B, std::size_t N, std::size_t M)
+{
+    const std::size_t i = blockIdx.x * static_cast<std::size_t>(blockDim.x) + threadIdx.x;
+    if (i >= N)
+    {
+        return;
+    }
+    double sum = 0.0;
+    for (std::size_t k = 0; k < M; k++)
+    {
+        sum += A[i * M + k] * B[k * N + i];
+    }
+    R[i] += sum;
+}
+}  // namespace
+
+device_tile_data<double> gen_tile_covariance(std::size_t row,
+                                             std::size_t col,
+                                             std::size_t N,
+                                             std::size_t n_regressors,
+                                             double *hyperparameters,
+                                             const device_tile_data<double> &input)
+{
+    double &lengthscale = hyperparameters[0];
+    double &vertical_lengthscale = hyperparameters[1];
+    double &noise_variance = hyperparameters[2];
+    gpu_context &context = local_context();
+    device_tile_data<double> tile(N * N);
+    covariance_kernel<<<n_blocks(N * N), block_size, 0, context.stream>>>(
+        tile.data(), N * row, N * col, N, N, n_regressors, input.data(), input.size(), input.data(), input.size(), -1.0 / (2.0 * lengthscale * lengthscale), vertical_lengthscale, noise_variance, 1.0);
+    synchronize(context);
+    return tile;
+}
+
+device_tile_data<double> gen_tile_prior_covariance(std::size_t row,
+                                                   std::size_t col,
+                                                   std::size_t N,
+                                                   std::size_t n_regressors,
+                                                   double *hyperparameters,
+                                                   const device_tile_data<double> &input)
+{
+    double &lengthscale = hyperparameters[0];
+    double &vertical_lengthscale = hyperparameters[1];
+    gpu_context &context = local_context();
+    device_tile_data<double> tile(N);
+    prior_covariance_kernel<<<n_blocks(N), block_size, 0, context.stream>>>(
+        tile.data(), N * row, N * col, N, n_regressors, input.data(), input.size(), -1.0 / (2.0 * lengthscale * lengthscale), vertical_lengthscale);
+    synchronize(context);
+    return tile;
+}
+
+device_tile_data<double> gen_tile_cross_covariance(std::size_t row,
+                                                   std::size_t col,
+                                                   std::size_t N_row,
+                                                   std::size_t N_col,
+                                                   std::size_t n_regressors,
+                                                   double *hyperparameters,
+                                                   const device_tile_data<double> &row_input,
+                                                   const device_tile_data<double> &col_input)
+{
+    double &lengthscale = hyperparameters[0];
+    double &vertical_lengthscale = hyperparameters[1];
+    gpu_context &context = local_context();
+    device_tile_data<double> tile(N_row * N_col);
+    // no noise, the test and training samples differ
+    covariance_kernel<<<n_blocks(N_row * N_col), block_size, 0, context.stream>>>(
+        tile.data(), N_row * row, N_col * col, N_row, N_col, n_regressors, row_input.data(), row_input.size(), col_input.data(), col_input.size(), -1.0 / (2.0 * lengthscale * lengthscale), vertical_lengthscale, 0.0, 0.0);
+    synchronize(context);
+    return tile;
+}
+
+device_tile_data<double> gen_tile_cross_cov_T(std::size_t N_row,
+                                              std::size_t N_col,
+                                              const device_tile_data<double> &cross_covariance_tile)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> transposed(N_row * N_col);
+    transpose_kernel<<<n_blocks(N_row * N_col), block_size, 0, context.stream>>>(
+        transposed.data(), cross_covariance_tile.data(), N_row, N_col);
+    synchronize(context);
+    return transposed;
+}
+
+device_tile_data<double> gen_tile_output(std::size_t row,
+                                         std::size_t N,
+                                         const std::vector<double> &output)
+{
+    if (N * (row + 1) <= output.size())
+    {
+        return upload(output.data() + N * row, N);
+    }
+    // zero past the last sample
+    std::vector<double> padded(N, 0.0);
+    if (N * row < output.size())
+    {
+        std::copy(output.begin() + N * row, output.end(), padded.begin());
+    }
+    return upload(padded.data(), N);
+}
+
+device_tile_data<double> gen_tile_zeros(std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> tile(N);
+    check(cudaMemsetAsync(tile.data(), 0, N * sizeof(double), context.stream), "cudaMemsetAsync");
+    synchronize(context);
+    return tile;
+}
+
+device_tile_data<double> gen_tile_identity(std::size_t N)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> tile(N * N);
+    identity_kernel<<<n_blocks(N * N), block_size, 0, context.stream>>>(tile.data(), N);
+    synchronize(context);
+    return tile;
+}
+
+device_tile_data<double> diag_posterior(const device_tile_data<double> &A,
+                                        const device_tile_data<double> &B,
+                                        std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> tile(M);
+    difference_kernel<<<n_blocks(M), block_size, 0, context.stream>>>(tile.data(), A.data(), B.data(), M);
+    synchronize(context);
+    return tile;
+}
+
+// R = R + diag(A^T * A)
+device_tile_data<double> dot_uncertainty(const device_tile_data<double> &A,
+                                         const device_tile_data<double> &R,
+                                         std::size_t N,
+                                         std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> R_out = R.writable();
+    column_norms_kernel<<<n_blocks(M), block_size, 0, context.stream>>>(R_out.data(), A.data(), N, M);
+    synchronize(context);
+    return R_out;
+}
+
+// R = R + diag(A * B)
+device_tile_data<double> gemm_grad(const device_tile_data<double> &A,
+                                   const device_tile_data<double> &B,
+                                   const device_tile_data<double> &R,
+                                   std::size_t N,
+                                   std::size_t M)
+{
+    gpu_context &context = local_context();
+    device_tile_data<double> R_out = R.writable();
+    diagonal_product_kernel<<<n_blocks(N), block_size, 0, context.stream>>>(R_out.data(), A.data(), B.data(), N, M);
+    synchronize(context);
+    return R_out;
+}
+
+}  // namespace gpu
@@ -1,13 +1,40 @@
 #include "../include/gp_algorithms_cpu.hpp"
 
+#include "../include/covariance_assembly.hpp"
+#include "../include/kernels.hpp"
+#include <algorithm>
+#include <type_traits>
+
+namespace
+{
+// Round a tile computed in double precision to the element type T, a no-op
+// for double tiles
+template <typename T>
+mutable_tile_data<T> to_precision(const mutable_tile_data<double> &tile)
+{
+    if constexpr (std::is_same<T, double>::value)
+    {
+        return tile;
+    }
+    else
+    {
+        mutable_tile_data<T> result(tile.size());
+        std::copy(tile.begin(), tile.end(), result.begin());
+        return result;
+    }
+}
+}  // namespace
+
 /**
- * @brief Compute the squared exponential kernel of two feature vectors.
+ * @brief Compute the kernel of two feature vectors.
  *
  * @param i_global  global index of the first feature vector
  * @param j_global  global index of the second feature vector
  * @param n_regressors  number of regressors
  * @param hyperparameters  hyperparameters of the covariance function: expects
- *        lengthscale in hyperparameters[0]
+ *        lengthscale in hyperparameters[0] and vertical lengthscale in
+ *        hyperparameters[1]
+ * @param kernel covariance function
  * @param i_input  first feature vector
  * @param j_input  second feature vector
  *
@@ -17,12 +44,10 @@ double compute_covariance_function(std::size_t i_global,
                                    std::size_t j_global,
                                    std::size_t n_regressors,
                                    double *hyperparameters,
+                                   const kernel_function &kernel,
                                    const std::vector<double> &i_input,
                                    const std::vector<double> &j_input)
 {
-    // formula in papers:
-    // C(z_i,z_j) = vertical_lengthscale * exp(-0.5*lengthscale*(z_i-z_j)^2)
-
     double &lengthscale = hyperparameters[0];
     double &vertical_lengthscale = hyperparameters[1];
     double z_ik = 0.0;
@@ -43,9 +68,10 @@ double compute_covariance_function(std::size_t i_global,
         {
             z_jk = j_input[j_local];
         }
-        distance += pow(z_ik - z_jk, 2);
+        distance += (z_ik - z_jk) * (z_ik - z_jk);
     }
-    return vertical_lengthscale * exp(-1.0 / (2.0 * pow(lengthscale, 2.0)) * distance);
+    kernels::covariance(kernel, &distance, 1, lengthscale, vertical_lengthscale);
+    return distance;
 }
 
 /**
@@ -56,146 +82,113 @@ double compute_covariance_function(std::size_t i_global,
  * @param N size of the tile
  * @param n_regressors number of regressors
  * @param hyperparameters hyperparameters of the covariance function
+ * @param kernel covariance function
  * @param input input data
  */
-std::vector<double> gen_tile_covariance(std::size_t row,
-                                        std::size_t col,
-                                        std::size_t N,
-                                        std::size_t n_regressors,
-                                        double *hyperparameters,
-                                        const std::vector<double> &input)
+template <typename T>
+mutable_tile_data<T> gen_tile_covariance(std::size_t row,
+                                         std::size_t col,
+                                         std::size_t N,
+                                         std::size_t n_regressors,
+                                         double *hyperparameters,
+                                         const kernel_function &kernel,
+                                         const std::vector<double> &input)
 {
-    std::size_t i_global, j_global;
-    double covariance_function;
+    double &lengthscale = hyperparameters[0];
+    double &vertical_lengthscale = hyperparameters[1];
     double &noise_variance = hyperparameters[2];
-    // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N * N);
-    for (std::size_t i = 0; i < N; i++)
+    // Initialize tile with the squared distances
+    mutable_tile_data<double> tile(N * N);
+    compute_lagged_distances(tile.data(), N * row, N * col, N, N, n_regressors, input, input);
+    // compute covariance function
+    kernels::covariance(kernel, tile.data(), N * N, lengthscale, vertical_lengthscale);
+    if (row == col)
     {
-        i_global = N * row + i;
-        for (std::size_t j = 0; j < N; j++)
+        // noise variance on diagonal
+        for (std::size_t i = 0; i < N; i++)
         {
-            j_global = N * col + j;
-            // compute covariance function
-            covariance_function = compute_covariance_function(i_global,
-                                                              j_global,
-                                                              n_regressors,
-                                                              hyperparameters,
-                                                              input,
-                                                              input);
-            if (i_global == j_global)
-            {
-                // noise variance on diagonal
-                covariance_function += noise_variance;
-            }
-            tile[i * N + j] = covariance_function;
+            tile[i * N + i] += noise_variance;
         }
     }
-    return std::move(tile);
+    // identity on the padding past the last sample
+    mask_padding(tile.data(), N * row, N * col, N, N, input.size(), input.size(), 1.0);
+    return to_precision<T>(tile);
 }
 
 // generate a tile of the prior covariance matrix
-std::vector<double>
+template <typename T>
+mutable_tile_data<T>
 gen_tile_full_prior_covariance(std::size_t row,
                                std::size_t col,
                                std::size_t N,
                                std::size_t n_regressors,
                                double *hyperparameters,
+                               const kernel_function &kernel,
                                const std::vector<double> &input)
 {
-    std::size_t i_global, j_global;
-    double covariance_function;
-    // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N * N);
-    for (std::size_t i = 0; i < N; i++)
-    {
-        i_global = N * row + i;
-        for (std::size_t j = 0; j < N; j++)
-        {
-            j_global = N * col + j;
-            // compute covariance function
-            covariance_function = compute_covariance_function(i_global,
-                                                              j_global,
-                                                              n_regressors,
-                                                              hyperparameters,
-                                                              input,
-                                                              input);
-            tile[i * N + j] = covariance_function;
-        }
-    }
-    return std::move(tile);
+    double &lengthscale = hyperparameters[0];
+    double &vertical_lengthscale = hyperparameters[1];
+    // Initialize tile with the squared distances
+    mutable_tile_data<double> tile(N * N);
+    compute_lagged_distances(tile.data(), N * row, N * col, N, N, n_regressors, input, input);
+    // compute covariance function
+    kernels::covariance(kernel, tile.data(), N * N, lengthscale, vertical_lengthscale);
+    return to_precision<T>(tile);
 }
 
 // generate a tile of the prior covariance matrix
-std::vector<double> gen_tile_prior_covariance(std::size_t row,
-                                              std::size_t col,
-                                              std::size_t N,
-                                              std::size_t n_regressors,
-                                              double *hyperparameters,
-                                              const std::vector<double> &input)
+template <typename T>
+mutable_tile_data<T> gen_tile_prior_covariance(std::size_t row,
+                                               std::size_t col,
+                                               std::size_t N,
+                                               std::size_t n_regressors,
+                                               double *hyperparameters,
+                                               const kernel_function &kernel,
+                                               const std::vector<double> &input)
 {
-    std::size_t i_global, j_global;
-    double covariance_function;
-    // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N);
-    for (std::size_t i = 0; i < N; i++)
-    {
-        i_global = N * row + i;
-        j_global = N * col + i;
-        // compute covariance function
-        covariance_function = compute_covariance_function(
-            i_global, j_global, n_regressors, hyperparameters, input, input);
-        tile[i] = covariance_function;
-    }
-    return std::move(tile);
+    double &lengthscale = hyperparameters[0];
+    double &vertical_lengthscale = hyperparameters[1];
+    // Initialize tile with the squared distances of the diagonal
+    mutable_tile_data<double> tile(N);
+    compute_lagged_distances_diag(tile.data(), N * row, N * col, N, n_regressors, input, input);
+    // compute covariance function
+    kernels::covariance(kernel, tile.data(), N, lengthscale, vertical_lengthscale);
+    return to_precision<T>(tile);
 }
 
 // generate a tile of the cross-covariance matrix
-std::vector<double>
+template <typename T>
+mutable_tile_data<T>
 gen_tile_cross_covariance(std::size_t row,
                           std::size_t col,
                           std::size_t N_row,
                           std::size_t N_col,
                           std::size_t n_regressors,
                           double *hyperparameters,
+                          const kernel_function &kernel,
                           const std::vector<double> &row_input,
                           const std::vector<double> &col_input)
 {
-    std::size_t i_global, j_global;
-    double covariance_function;
-    // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N_row * N_col);
-    for (std::size_t i = 0; i < N_row; i++)
-    {
-        i_global = N_row * row + i;
-        for (std::size_t j = 0; j < N_col; j++)
-        {
-            j_global = N_col * col + j;
-            // compute covariance function
-            covariance_function = compute_covariance_function(i_global,
-                                                              j_global,
-                                                              n_regressors,
-                                                              hyperparameters,
-                                                              row_input,
-                                                              col_input);
-            tile[i * N_col + j] = covariance_function;
-        }
-    }
-    return std::move(tile);
+    double &lengthscale = hyperparameters[0];
+    double &vertical_lengthscale = hyperparameters[1];
+    // Initialize tile with the squared distances
+    mutable_tile_data<double> tile(N_row * N_col);
+    compute_lagged_distances(tile.data(), N_row * row, N_col * col, N_row, N_col, n_regressors, row_input, col_input);
+    // compute covariance function
+    kernels::covariance(kernel, tile.data(), N_row * N_col, lengthscale, vertical_lengthscale);
+    // no correlation with the padding past the last samples
+    mask_padding(tile.data(), N_row * row, N_col * col, N_row, N_col, row_input.size(), col_input.size(), 0.0);
+    return to_precision<T>(tile);
 }
 
 // generate a tile of the cross-covariance matrix
-std::vector<double>
+template <typename T>
+mutable_tile_data<T>
 gen_tile_cross_cov_T(std::size_t N_row,
                      std::size_t N_col,
-                     const std::vector<double> &cross_covariance_tile)
+                     const const_tile_data<T> &cross_covariance_tile)
 {
-    std::vector<double> transposed;
-    transposed.resize(N_row * N_col);
+    mutable_tile_data<T> transposed(N_row * N_col);
     for (std::size_t i = 0; i < N_row; ++i)
     {
         for (std::size_t j = 0; j < N_col; j++)
@@ -207,18 +200,19 @@ gen_tile_cross_cov_T(std::size_t N_row,
 }
 
 // generate a tile containing the output observations
-std::vector<double> gen_tile_output(std::size_t row,
-                                    std::size_t N,
-                                    const std::vector<double> &output)
+template <typename T>
+mutable_tile_data<T> gen_tile_output(std::size_t row,
+                                     std::size_t N,
+                                     const std::vector<double> &output)
 {
     std::size_t i_global;
     // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N);
+    mutable_tile_data<T> tile(N);
     for (std::size_t i = 0; i < N; i++)
     {
         i_global = N * row + i;
-        tile[i] = output[i_global];
+        // zero past the last sample
+        tile[i] = i_global < output.size() ? static_cast<T>(output[i_global]) : T(0);
     }
     return std::move(tile);
 }
@@ -244,11 +238,53 @@ double compute_error_norm(std::size_t n_tiles,
 }
 
 // generate an empty tile
-std::vector<double> gen_tile_zeros(std::size_t N)
+template <typename T>
+mutable_tile_data<T> gen_tile_zeros(std::size_t N)
 {
     // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N);
-    std::fill(tile.begin(), tile.end(), 0.0);
+    mutable_tile_data<T> tile(N);
+    std::fill(tile.begin(), tile.end(), T(0));
     return std::move(tile);
 }
+
+// round a tile to the element type T
+template <typename T, typename S>
+mutable_tile_data<T> convert_tile(const const_tile_data<S> &tile)
+{
+    mutable_tile_data<T> result(tile.size());
+    for (std::size_t i = 0; i < tile.size(); i++)
+    {
+        result[i] = static_cast<T>(tile[i]);
+    }
+    return result;
+}
+
+// x + d for a double precision tile x and a single precision correction d
+mutable_tile_data<double> add_correction(const mutable_tile_data<double> &x,
+                                         const const_tile_data<float> &d,
+                                         std::size_t N)
+{
+    mutable_tile_data<double> x_out = x.writable();
+    for (std::size_t i = 0; i < N; i++)
+    {
+        x_out[i] += static_cast<double>(d[i]);
+    }
+    return x_out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Instantiations for single and double precision tiles
+#define INSTANTIATE_GP_ALGORITHMS(T)                                                                                                                                                                                          \
+    template mutable_tile_data<T> gen_tile_covariance<T>(std::size_t, std::size_t, std::size_t, std::size_t, double *, const kernel_function &, const std::vector<double> &);                                                 \
+    template mutable_tile_data<T> gen_tile_full_prior_covariance<T>(std::size_t, std::size_t, std::size_t, std::size_t, double *, const kernel_function &, const std::vector<double> &);                                      \
+    template mutable_tile_data<T> gen_tile_prior_covariance<T>(std::size_t, std::size_t, std::size_t, std::size_t, double *, const kernel_function &, const std::vector<double> &);                                           \
+    template mutable_tile_data<T> gen_tile_cross_covariance<T>(std::size_t, std::size_t, std::size_t, std::size_t, std::size_t, double *, const kernel_function &, const std::vector<double> &, const std::vector<double> &); \
+    template mutable_tile_data<T> gen_tile_cross_cov_T<T>(std::size_t, std::size_t, const const_tile_data<T> &);                                                                                                              \
+    template mutable_tile_data<T> gen_tile_output<T>(std::size_t, std::size_t, const std::vector<double> &);                                                                                                                  \
+    template mutable_tile_data<T> gen_tile_zeros<T>(std::size_t);
+
+INSTANTIATE_GP_ALGORITHMS(float)
+INSTANTIATE_GP_ALGORITHMS(double)
+
+template mutable_tile_data<float> convert_tile<float, double>(const const_tile_data<double> &);
+template mutable_tile_data<double> convert_tile<double, float>(const const_tile_data<float> &);
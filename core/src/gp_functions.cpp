@@ -1,17 +1,51 @@
 #include "../include/gp_functions.hpp"
 
+#include "../include/adapter_mkl.hpp"
+#include "../include/covariance_assembly.hpp"
 #include "../include/gp_algorithms_cpu.hpp"
+#include "../include/gp_iterative.hpp"
 #include "../include/gp_optimizer.hpp"
+#include "../include/profiling.hpp"
 #include "../include/tiled_algorithms_cpu.hpp"
+#include "../include/tiled_algorithms_distributed.hpp"
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <numeric>
 #include <sstream>
 #include <vector>
 
 namespace gpxpy_hyper
 {
 
+/**
+ * @brief Returns the name of a trace mode
+ */
+std::string trace_mode_name(TraceMode mode)
+{
+    switch (mode)
+    {
+        case TraceMode::Explicit: return "explicit";
+        case TraceMode::Cholesky: return "cholesky";
+        case TraceMode::Hutchinson: return "hutchinson";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Returns the name of an optimizer
+ */
+std::string optimizer_name(Optimizer optimizer)
+{
+    switch (optimizer)
+    {
+        case Optimizer::Adam: return "adam";
+        case Optimizer::LBFGS: return "lbfgs";
+    }
+    return "unknown";
+}
+
 /**
  * @brief Initialize hyperparameters
  *
@@ -22,6 +56,12 @@ namespace gpxpy_hyper
  * @param opt_i number of optimization iterations
  * @param M_T_init initial values for first moment vector
  * @param V_T_init initial values for second moment vector
+ * @param mode computation of the trace term of the gradient
+ * @param probes number of probe vectors for TraceMode::Hutchinson
+ * @param probe_seed seed of the probe vectors
+ * @param method update rule of the optimizer
+ * @param tol convergence tolerance of Optimizer::LBFGS
+ * @param m number of steps kept by Optimizer::LBFGS
  */
 Hyperparameters::Hyperparameters(double lr,
                                  double b1,
@@ -29,14 +69,26 @@ Hyperparameters::Hyperparameters(double lr,
                                  double eps,
                                  int opt_i,
                                  std::vector<double> M_T_init,
-                                 std::vector<double> V_T_init) :
+                                 std::vector<double> V_T_init,
+                                 TraceMode mode,
+                                 int probes,
+                                 unsigned probe_seed,
+                                 Optimizer method,
+                                 double tol,
+                                 int m) :
     learning_rate(lr),
     beta1(b1),
     beta2(b2),
     epsilon(eps),
     opt_iter(opt_i),
     M_T(M_T_init),
-    V_T(V_T_init)
+    V_T(V_T_init),
+    trace_mode(mode),
+    n_probes(probes),
+    seed(probe_seed),
+    optimizer(method),
+    tolerance(tol),
+    history(m)
 { }
 
 /**
@@ -48,39 +100,53 @@ std::string Hyperparameters::repr() const
     oss << std::fixed << std::setprecision(8);
     oss << "Hyperparameters: [learning_rate=" << learning_rate
         << ", beta1=" << beta1 << ", beta2=" << beta2
-        << ", epsilon=" << epsilon << ", opt_iter=" << opt_iter << "]";
+        << ", epsilon=" << epsilon << ", opt_iter=" << opt_iter
+        << ", trace_mode=" << trace_mode_name(trace_mode);
+    if (trace_mode == TraceMode::Hutchinson)
+    {
+        oss << ", n_probes=" << n_probes << ", seed=" << seed;
+    }
+    oss << ", optimizer=" << optimizer_name(optimizer);
+    if (optimizer == Optimizer::LBFGS)
+    {
+        oss << ", tolerance=" << tolerance << ", history=" << history;
+    }
+    oss << "]";
     return oss.str();
 }
 
 }  // namespace gpxpy_hyper
 
 /**
- * @brief Compute the predictions and uncertainties.
+ * @brief Compute the Cholesky factor of the covariance matrix and
+ *        alpha = K^-1 * y.
+ *
+ * Blocks until the factorization is done, such that the returned tiles can be
+ * reused by the `*_fitted_hpx` prediction functions.
  *
  * @param training_input training input data
  * @param training_output training output data
- * @param test_input test input data
  * @param n_tiles number of tiles
  * @param n_tile_size size of each tile
- * @param m_tiles number of test tiles
- * @param m_tile_size size of each test tile
  * @param lengthscale lengthscale hyperparameter
  * @param vertical_lengthscale vertical lengthscale hyperparameter
  * @param noise_variance noise variance hyperparameter
  * @param n_regressors number of regressors
+ * @param kernel covariance function
+ * @param K_tiles lower tiles of the Cholesky factor L
+ * @param alpha_tiles tiles of alpha
  */
-hpx::shared_future<std::vector<double>>
-predict_hpx(const std::vector<double> &training_input,
-            const std::vector<double> &training_output,
-            const std::vector<double> &test_input,
-            int n_tiles,
-            int n_tile_size,
-            int m_tiles,
-            int m_tile_size,
-            double lengthscale,
-            double vertical_lengthscale,
-            double noise_variance,
-            int n_regressors)
+void fit_hpx(const std::vector<double> &training_input,
+             const std::vector<double> &training_output,
+             int n_tiles,
+             int n_tile_size,
+             double lengthscale,
+             double vertical_lengthscale,
+             double noise_variance,
+             int n_regressors,
+             const kernel_function &kernel,
+             std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+             std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles)
 {
     double hyperparameters[3];
     hyperparameters[0] = lengthscale;           // variance of training_output
@@ -88,344 +154,1178 @@ predict_hpx(const std::vector<double> &training_input,
                                                 // training_input
     hyperparameters[2] = noise_variance;        // some small value
 
-    // declare data structures
-    // tiled future data structures
-    std::vector<hpx::shared_future<std::vector<double>>> K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> alpha_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> cross_covariance_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> prediction_tiles;
-
     // Assemble covariance matrix vector
+    K_tiles.clear();
     K_tiles.resize(n_tiles * n_tiles);
     for (std::size_t i = 0; i < n_tiles; i++)
     {
         for (std::size_t j = 0; j <= i; j++)
         {
             K_tiles[i * n_tiles + j] =
-                hpx::async(hpx::annotated_function(&gen_tile_covariance,
-                                                   "assemble_tiled_K"),
+                hpx::async(profiling::annotated_function(&gen_tile_covariance<double>,
+                                                         "assemble_tiled_K"),
                            i,
                            j,
                            n_tile_size,
                            n_regressors,
                            hyperparameters,
+                           kernel,
                            training_input);
         }
     }
     // Assemble alpha
+    alpha_tiles.clear();
     alpha_tiles.resize(n_tiles);
     for (std::size_t i = 0; i < n_tiles; i++)
     {
         alpha_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_output, "assemble_tiled_alpha"),
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled_alpha"),
             i,
             n_tile_size,
             training_output);
     }
-    // Assemble MxN cross-covariance matrix vector
-    cross_covariance_tiles.resize(m_tiles * n_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
-    {
-        for (std::size_t j = 0; j < n_tiles; j++)
-        {
-            cross_covariance_tiles[i * n_tiles + j] =
-                hpx::async(hpx::annotated_function(&gen_tile_cross_covariance,
-                                                   "assemble_pred"),
-                           i,
-                           j,
-                           m_tile_size,
-                           n_tile_size,
-                           n_regressors,
-                           hyperparameters,
-                           test_input,
-                           training_input);
-        }
-    }
-    // Assemble placeholder for prediction
-    prediction_tiles.resize(m_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
-    {
-        prediction_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_zeros, "assemble_tiled"),
-            m_tile_size);
-    }
 
     //////////////////////////////////////////////////////////////////////////////
     //// Compute Cholesky decomposition
-    right_looking_cholesky_tiled(K_tiles, n_tile_size, n_tiles);
+    cholesky_tiled(K_tiles, n_tile_size, n_tiles);
     //// Triangular solve K_NxN * alpha = y
     forward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
     backward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
 
-    //////////////////////////////////////////////////////////////////////////////
-    //// Compute predictions
-    prediction_tiled(cross_covariance_tiles, alpha_tiles, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
-
-    //// Get predictions and uncertainty to return them
-    std::vector<double> pred;
-    pred.reserve(test_input.size());  // preallocate memory
-    for (std::size_t i; i < m_tiles; i++)
-    {
-        pred.insert(pred.end(), prediction_tiles[i].get().begin(), prediction_tiles[i].get().end());
-    }
-
-    // Return computed data
-    return hpx::async([pred]()
-                      { return pred; });
+    // alpha depends on every tile of L, hence on every task that reads
+    // `hyperparameters`, which must not outlive this stack frame
+    hpx::wait_all(alpha_tiles);
 }
 
-// Compute the predictions and uncertainties
-hpx::shared_future<std::vector<std::vector<double>>>
-predict_with_uncertainty_hpx(const std::vector<double> &training_input,
-                             const std::vector<double> &training_output,
-                             const std::vector<double> &test_input,
-                             int n_tiles,
-                             int n_tile_size,
-                             int m_tiles,
-                             int m_tile_size,
-                             double lengthscale,
-                             double vertical_lengthscale,
-                             double noise_variance,
-                             int n_regressors)
+/**
+ * @brief Compute the Cholesky factor of the covariance matrix on the localities
+ *        of `policy` and alpha = K^-1 * y on the calling locality.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ * @param policy distribution of the covariance tiles
+ * @param K_tiles distributed Cholesky factor L
+ * @param diag_tiles local copies of the diagonal tiles of L, the other tiles
+ *        stay empty
+ * @param alpha_tiles tiles of alpha
+ */
+void fit_distributed_hpx(const std::vector<double> &training_input,
+                         const std::vector<double> &training_output,
+                         int n_tiles,
+                         int n_tile_size,
+                         double lengthscale,
+                         double vertical_lengthscale,
+                         double noise_variance,
+                         int n_regressors,
+                         const distribution_policy &policy,
+                         std::shared_ptr<distributed_tiles> &K_tiles,
+                         std::vector<hpx::shared_future<mutable_tile_data<double>>> &diag_tiles,
+                         std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles)
 {
     double hyperparameters[3];
-    hyperparameters[0] =
-        lengthscale;  // lengthscale = variance of training_output
-    hyperparameters[1] =
-        vertical_lengthscale;             // vertical_lengthscale = standard deviation of
-                                          // training_input
-    hyperparameters[2] = noise_variance;  // noise_variance = small value
-    // declare data structures
-    // tiled future data structures
-    std::vector<hpx::shared_future<std::vector<double>>> K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> alpha_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> prior_K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> prior_inter_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> cross_covariance_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>>
-        t_cross_covariance_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> prediction_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>>
-        prediction_uncertainty_tiles;
+    hyperparameters[0] = lengthscale;
+    hyperparameters[1] = vertical_lengthscale;
+    hyperparameters[2] = noise_variance;
 
-    //////////////////////////////////////////////////////////////////////////////
-    // Assemble covariance matrix vector
-    K_tiles.resize(n_tiles * n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
-    {
-        for (std::size_t j = 0; j <= i; j++)
-        {
-            K_tiles[i * n_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_covariance, "assemble_tiled"),
-                i,
-                j,
-                n_tile_size,
-                n_regressors,
-                hyperparameters,
-                training_input);
-        }
-    }
+    // Assemble covariance matrix on the owners of the tiles
+    K_tiles = std::make_shared<distributed_tiles>(policy, n_tiles, n_tile_size);
+    assemble_covariance_distributed(*K_tiles, n_regressors, hyperparameters, training_input);
     // Assemble alpha
+    alpha_tiles.clear();
     alpha_tiles.resize(n_tiles);
     for (std::size_t i = 0; i < n_tiles; i++)
     {
         alpha_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_output, "assemble_tiled"), i, n_tile_size, training_output);
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled_alpha"),
+            i,
+            n_tile_size,
+            training_output);
     }
-    // Assemble prior covariance matrix vector
-    prior_K_tiles.resize(m_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Compute Cholesky decomposition
+    cholesky_distributed(*K_tiles);
+    //// Triangular solve K_NxN * alpha = y
+    forward_solve_distributed(*K_tiles, alpha_tiles);
+    backward_solve_distributed(*K_tiles, alpha_tiles);
+
+    diag_tiles.clear();
+    diag_tiles.resize(n_tiles * n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
     {
-        prior_K_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_prior_covariance,
-                                    "assemble_tiled"),
-            i,
-            i,
-            m_tile_size,
-            n_regressors,
-            hyperparameters,
-            test_input);
+        diag_tiles[i * n_tiles + i] = fetch_tile_distributed(*K_tiles, i, i);
     }
-    // Assemble MxN cross-covariance matrix vector
-    cross_covariance_tiles.resize(m_tiles * n_tiles);
-    // Assemble NxM (transpose) cross-covariance matrix vector
-    t_cross_covariance_tiles.resize(n_tiles * m_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
+    hpx::wait_all(alpha_tiles);
+}
+
+/**
+ * @brief Compute r = y - K * alpha in double precision.
+ *
+ * The lower tiles of K are assembled on the fly and released once both of
+ * their products are done, such that K is never stored in double precision.
+ * Does not block.
+ */
+static std::vector<hpx::shared_future<mutable_tile_data<double>>>
+compute_residual_tiled(const std::vector<double> &training_input,
+                       const std::vector<hpx::shared_future<mutable_tile_data<double>>> &y_tiles,
+                       const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+                       int n_tiles,
+                       int n_tile_size,
+                       int n_regressors,
+                       const kernel_function &kernel,
+                       double *hyperparameters)
+{
+    // r starts as a copy of y, the updates below would otherwise be in place
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> r_tiles(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
     {
-        for (std::size_t j = 0; j < n_tiles; j++)
+        r_tiles[i] = hpx::dataflow(
+            hpx::unwrapping([](const mutable_tile_data<double> &y)
+                            { return y.copy(); }),
+            y_tiles[i]);
+    }
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
         {
-            cross_covariance_tiles[i * n_tiles + j] =
-                hpx::async(hpx::annotated_function(&gen_tile_cross_covariance,
-                                                   "assemble_pred"),
+            hpx::shared_future<mutable_tile_data<double>> K_tile =
+                hpx::async(profiling::annotated_function(&gen_tile_covariance<double>,
+                                                         "assemble_residual"),
                            i,
                            j,
-                           m_tile_size,
                            n_tile_size,
                            n_regressors,
                            hyperparameters,
-                           test_input,
+                           kernel,
                            training_input);
-
-            t_cross_covariance_tiles[j * m_tiles + i] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&gen_tile_cross_cov_T),
-                                        "assemble_pred"),
-                m_tile_size,
-                n_tile_size,
-                cross_covariance_tiles[i * n_tiles + j]);
+            // r_i = r_i - K_ij * alpha_j
+            r_tiles[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gemv_l<double>),
+                                              "residual_tiled"),
+                K_tile,
+                alpha_tiles[j],
+                r_tiles[i],
+                n_tile_size);
+            if (i != j)
+            {
+                // r_j = r_j - K_ij^T * alpha_i for the upper tile K_ji
+                r_tiles[j] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gemv_u<double>),
+                                                  "residual_tiled"),
+                    K_tile,
+                    alpha_tiles[i],
+                    r_tiles[j],
+                    n_tile_size);
+            }
         }
     }
-    // Assemble placeholder matrix for diag(K_MxN * (K^-1_NxN * K_NxM))
-    prior_inter_tiles.resize(m_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
+    return r_tiles;
+}
+
+/**
+ * @brief Compute the Cholesky factor of the covariance matrix in single
+ *        precision and alpha = K^-1 * y in double precision.
+ *
+ * The first solve with the single precision factor is followed by
+ * `refinement_steps` steps of iterative refinement: the residual
+ * r = y - K * alpha is computed in double precision, the correction
+ * d = K^-1 * r is solved with the single precision factor and added to alpha
+ * in double precision. Blocks until alpha is done.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ * @param kernel covariance function
+ * @param refinement_steps number of refinement steps
+ * @param L_tiles lower tiles of the single precision Cholesky factor L
+ * @param diag_tiles double precision copies of the diagonal tiles of L, as
+ *        used by the loss, at their n_tiles x n_tiles positions
+ * @param alpha_tiles tiles of alpha
+ * @param residuals receives ||y - K * alpha|| / ||y|| after the first solve
+ *        and after each refinement step
+ */
+void fit_mixed_hpx(const std::vector<double> &training_input,
+                   const std::vector<double> &training_output,
+                   int n_tiles,
+                   int n_tile_size,
+                   double lengthscale,
+                   double vertical_lengthscale,
+                   double noise_variance,
+                   int n_regressors,
+                   const kernel_function &kernel,
+                   int refinement_steps,
+                   std::vector<hpx::shared_future<mutable_tile_data<float>>> &L_tiles,
+                   std::vector<hpx::shared_future<mutable_tile_data<double>>> &diag_tiles,
+                   std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+                   std::vector<double> &residuals)
+{
+    double hyperparameters[3];
+    hyperparameters[0] = lengthscale;
+    hyperparameters[1] = vertical_lengthscale;
+    hyperparameters[2] = noise_variance;
+
+    // Assemble covariance matrix in single precision
+    L_tiles.clear();
+    L_tiles.resize(n_tiles * n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
     {
-        prior_inter_tiles[i] =
-            hpx::async(hpx::annotated_function(&gen_tile_zeros_diag,
-                                               "assemble_prior_inter"),
-                       m_tile_size);
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            L_tiles[i * n_tiles + j] =
+                hpx::async(profiling::annotated_function(&gen_tile_covariance<float>,
+                                                         "assemble_tiled_K"),
+                           i,
+                           j,
+                           n_tile_size,
+                           n_regressors,
+                           hyperparameters,
+                           kernel,
+                           training_input);
+        }
     }
-    // Assemble placeholder for prediction
-    prediction_tiles.resize(m_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
+    // Assemble y and the initial residual r = y for alpha = 0
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles(n_tiles);
+    alpha_tiles.clear();
+    alpha_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
     {
-        prediction_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_zeros, "assemble_tiled"),
-            m_tile_size);
+        y_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled_alpha"),
+            i,
+            n_tile_size,
+            training_output);
+        alpha_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled_alpha"),
+            n_tile_size);
     }
-    // Assemble placeholder for uncertainty
-    prediction_uncertainty_tiles.resize(m_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> r_tiles = y_tiles;
+    double y_norm = 0.0;
+    for (double y : training_output)
     {
-        prediction_uncertainty_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_zeros, "assemble_tiled"),
-            m_tile_size);
+        y_norm += y * y;
     }
+    y_norm = std::sqrt(y_norm);
 
     //////////////////////////////////////////////////////////////////////////////
-    //// Compute Cholesky decomposition
-    right_looking_cholesky_tiled(K_tiles, n_tile_size, n_tiles);
-    //// Triangular solve K_NxN * alpha = y
-    forward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
-    backward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
-
-    //// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
-    forward_solve_KcK_tiled(K_tiles, t_cross_covariance_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
-    // backward_solve_KK_tiled(K_tiles, cross_covariance_tiles, n_tile_size,
-    // m_tile_size, n_tiles, m_tiles);
-
-    //////////////////////////////////////////////////////////////////////////////
-    //// Compute predictions
-    prediction_tiled(cross_covariance_tiles, alpha_tiles, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
-    // posterior covariance matrix - (K_MxN * K^-1_NxN) * K_NxM
-    posterior_covariance_tiled(t_cross_covariance_tiles, prior_inter_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
-
-    //// Compute predicition uncertainty
-    prediction_uncertainty_tiled(prior_K_tiles, prior_inter_tiles, prediction_uncertainty_tiles, m_tile_size, m_tiles);
+    //// Compute Cholesky decomposition in single precision
+    cholesky_tiled(L_tiles, n_tile_size, n_tiles);
 
-    //// Get predictions and uncertainty to return them
-    std::vector<double> pred_full;
-    std::vector<double> pred_var_full;
-    pred_full.reserve(test_input.size());      // preallocate memory
-    pred_var_full.reserve(test_input.size());  // preallocate memory
-    for (std::size_t i; i < m_tiles; i++)
+    residuals.clear();
+    std::vector<hpx::shared_future<mutable_tile_data<float>>> d_tiles(n_tiles);
+    for (int step = 0; step <= refinement_steps; step++)
     {
-        pred_full.insert(pred_full.end(), prediction_tiles[i].get().begin(), prediction_tiles[i].get().end());
-        pred_var_full.insert(pred_var_full.end(),
-                             prediction_uncertainty_tiles[i].get().begin(),
-                             prediction_uncertainty_tiles[i].get().end());
-    }
-
-    // Return computed data
-    return hpx::async([pred_full, pred_var_full]()
-                      {
-        std::vector<std::vector<double>> result(2);
-        result[0] = pred_full;
-        result[1] = pred_var_full;
-        return result; });
-}
-
-// Compute the predictions and full covariance matrix
-hpx::shared_future<std::vector<std::vector<double>>>
-predict_with_full_cov_hpx(const std::vector<double> &training_input,
-                          const std::vector<double> &training_output,
-                          const std::vector<double> &test_input,
-                          int n_tiles,
-                          int n_tile_size,
-                          int m_tiles,
-                          int m_tile_size,
-                          double lengthscale,
-                          double vertical_lengthscale,
-                          double noise_variance,
-                          int n_regressors)
+        //// Solve K * d = r in single precision
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            d_tiles[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&convert_tile<float, double>),
+                                              "refinement_tiled"),
+                r_tiles[i]);
+        }
+        forward_solve_tiled(L_tiles, d_tiles, n_tile_size, n_tiles);
+        backward_solve_tiled(L_tiles, d_tiles, n_tile_size, n_tiles);
+        //// alpha = alpha + d and r = y - K * alpha in double precision
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            alpha_tiles[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&add_correction),
+                                              "refinement_tiled"),
+                alpha_tiles[i],
+                d_tiles[i],
+                n_tile_size);
+        }
+        r_tiles = compute_residual_tiled(training_input, y_tiles, alpha_tiles, n_tiles, n_tile_size, n_regressors, kernel, hyperparameters);
+        std::vector<hpx::shared_future<double>> r_norm_tiled(n_tiles);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            r_norm_tiled[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&dot<double>),
+                                              "refinement_tiled"),
+                n_tile_size,
+                r_tiles[i],
+                r_tiles[i]);
+        }
+        // the residual depends on every task that reads `hyperparameters`
+        residuals.push_back(std::sqrt(reduce_sum_tiled(r_norm_tiled).get()) / y_norm);
+    }
+
+    diag_tiles.clear();
+    diag_tiles.resize(n_tiles * n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        diag_tiles[i * n_tiles + i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&convert_tile<double, float>),
+                                          "refinement_tiled"),
+            L_tiles[i * n_tiles + i]);
+    }
+    hpx::wait_all(alpha_tiles);
+}
+
+/**
+ * @brief Deep copy of a tile, for tiles of a cached factor that are updated
+ *        while other GPs or pending predictions may still read them.
+ */
+static mutable_tile_data<double> copy_tile(const mutable_tile_data<double> &tile)
+{
+    return tile.copy();
+}
+
+/**
+ * @brief Concatenate square tiles of size N to one tile of N rows.
+ */
+static mutable_tile_data<double>
+concatenate_row_tiles(const std::vector<mutable_tile_data<double>> &tiles, std::size_t N)
+{
+    const std::size_t n_cols = N * tiles.size();
+    mutable_tile_data<double> row(N * n_cols);
+    for (std::size_t t = 0; t < tiles.size(); t++)
+    {
+        for (std::size_t i = 0; i < N; i++)
+        {
+            std::copy(tiles[t].data() + i * N, tiles[t].data() + (i + 1) * N, row.data() + i * n_cols + t * N);
+        }
+    }
+    return row;
+}
+
+/**
+ * @brief Extend the Cholesky factor and alpha of a fitted GP by appended
+ *        samples and drop its oldest tiles. Blocks until alpha is done.
+ *
+ * The lagged features of the old samples do not depend on the new ones, so
+ * the factor only gains tile rows, which are factored against the finished
+ * rows. A zero-padded last tile row is refactored with its new samples.
+ *
+ * Dropping the leading d tiles leaves the factor of the trailing matrix as a
+ * rank-update of the trailing tiles of L by the dropped columns. The first
+ * n_regressors - 1 samples of the window lose their lagged history, which
+ * changes the leading a tile columns. These are factored anew and the
+ * trailing tiles updated by the old columns before d + a and downdated by the
+ * new leading columns, in O(n^2 * (d + 2a) * n_tile_size) instead of the
+ * O(n^3) of a refactorization. The updated tiles are copies, the tiles of the
+ * old factor are never written.
+ *
+ * @param training_input training input data with the appended samples and
+ *        before dropping tiles
+ * @param training_output training output data with the appended samples
+ * @param n_old_samples number of samples the factor was computed for
+ * @param n_dropped_tiles number of leading tiles to drop
+ * @param n_tile_size size of each tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ * @param kernel covariance function
+ * @param K_tiles lower tiles of the Cholesky factor, updated
+ * @param alpha_tiles tiles of alpha, updated
+ */
+void append_fitted_hpx(const std::vector<double> &training_input,
+                       const std::vector<double> &training_output,
+                       std::size_t n_old_samples,
+                       int n_dropped_tiles,
+                       int n_tile_size,
+                       double lengthscale,
+                       double vertical_lengthscale,
+                       double noise_variance,
+                       int n_regressors,
+                       const kernel_function &kernel,
+                       std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+                       std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles)
 {
     double hyperparameters[3];
-    hyperparameters[0] =
+    hyperparameters[0] = lengthscale;
+    hyperparameters[1] = vertical_lengthscale;
+    hyperparameters[2] = noise_variance;
+
+    const std::size_t N = n_tile_size;
+    const std::size_t old_tiles = alpha_tiles.size();
+    const std::size_t n_tiles = (training_input.size() + N - 1) / N;
+    // a zero-padded last tile row gets new samples and is factored again
+    const std::size_t first_row = n_old_samples / N;
+
+    // Move the finished rows to the positions in the extended matrix
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> L_tiles(n_tiles * n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            if (i < first_row)
+            {
+                L_tiles[i * n_tiles + j] = K_tiles[i * old_tiles + j];
+            }
+            else
+            {
+                L_tiles[i * n_tiles + j] =
+                    hpx::async(profiling::annotated_function(&gen_tile_covariance<double>,
+                                                             "assemble_tiled_K"),
+                               i,
+                               j,
+                               N,
+                               n_regressors,
+                               hyperparameters,
+                               kernel,
+                               training_input);
+            }
+        }
+    }
+    K_tiles.clear();
+    extend_cholesky_tiled(L_tiles, N, first_row, n_tiles);
+
+    std::vector<double> window_output;
+    const std::vector<double> *output = &training_output;
+    std::size_t n_window = n_tiles;
+    if (n_dropped_tiles > 0)
+    {
+        const std::size_t d = n_dropped_tiles;
+        n_window = n_tiles - d;
+        const std::vector<double> window_input(training_input.begin() + d * N, training_input.end());
+        window_output.assign(training_output.begin() + d * N, training_output.end());
+        output = &window_output;
+        // leading window tiles whose lagged features reach into the dropped
+        // samples
+        const std::size_t n_history = n_regressors > 1 ? n_regressors - 1 : 0;
+        const std::size_t a = std::min(n_window, (n_history + N - 1) / N);
+
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> window_tiles(n_window * n_window);
+        std::vector<std::vector<hpx::shared_future<mutable_tile_data<double>>>> vector_tiles(n_window);
+        for (std::size_t i = 0; i < n_window; i++)
+        {
+            for (std::size_t j = 0; j <= i; j++)
+            {
+                if (j < a)
+                {
+                    window_tiles[i * n_window + j] =
+                        hpx::async(profiling::annotated_function(&gen_tile_covariance<double>,
+                                                                 "assemble_tiled_K"),
+                                   i,
+                                   j,
+                                   N,
+                                   n_regressors,
+                                   hyperparameters,
+                                   kernel,
+                                   window_input);
+                }
+                else
+                {
+                    // updated in place below, the old factor may be shared
+                    // with a copy of the GP or read by a pending prediction
+                    window_tiles[i * n_window + j] = hpx::dataflow(
+                        profiling::annotated_function(hpx::unwrapping(&copy_tile), "cholesky_update_tiled"),
+                        L_tiles[(i + d) * n_tiles + j + d]);
+                }
+            }
+            if (i >= a)
+            {
+                // update vectors: the old columns before the trailing tiles
+                vector_tiles[i].assign(L_tiles.begin() + (i + d) * n_tiles, L_tiles.begin() + (i + d) * n_tiles + d + a);
+            }
+        }
+        L_tiles.clear();
+        cholesky_panel_tiled(window_tiles, N, a, n_window);
+
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> vectors(n_window);
+        for (std::size_t i = a; i < n_window; i++)
+        {
+            // downdate vectors: the new leading columns
+            vector_tiles[i].insert(vector_tiles[i].end(), window_tiles.begin() + i * n_window, window_tiles.begin() + i * n_window + a);
+            vectors[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&concatenate_row_tiles),
+                                              "cholesky_update_tiled"),
+                vector_tiles[i],
+                N);
+        }
+        update_cholesky_tiled(window_tiles, vectors, N, (d + a) * N, a, n_window);
+        L_tiles = std::move(window_tiles);
+    }
+    K_tiles = std::move(L_tiles);
+
+    // Solve K * alpha = y with the updated factor
+    alpha_tiles.clear();
+    alpha_tiles.resize(n_window);
+    for (std::size_t i = 0; i < n_window; i++)
+    {
+        alpha_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled_alpha"),
+            i,
+            N,
+            *output);
+    }
+    forward_solve_tiled(K_tiles, alpha_tiles, N, n_window);
+    backward_solve_tiled(K_tiles, alpha_tiles, N, n_window);
+
+    // alpha depends on every tile of L, hence on every task that reads
+    // `hyperparameters`, which must not outlive this stack frame
+    hpx::wait_all(alpha_tiles);
+}
+
+/**
+ * @brief Compute the predictions.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param test_input test input data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of each test tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ * @param kernel covariance function
+ */
+hpx::shared_future<std::vector<double>>
+predict_hpx(const std::vector<double> &training_input,
+            const std::vector<double> &training_output,
+            const std::vector<double> &test_input,
+            int n_tiles,
+            int n_tile_size,
+            int m_tiles,
+            int m_tile_size,
+            double lengthscale,
+            double vertical_lengthscale,
+            double noise_variance,
+            int n_regressors,
+            const kernel_function &kernel)
+{
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha_tiles;
+    fit_hpx(training_input, training_output, n_tiles, n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel, K_tiles, alpha_tiles);
+    return predict_fitted_hpx(training_input, test_input, K_tiles, alpha_tiles, n_tiles, n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel);
+}
+
+/**
+ * @brief Compute the predictions with the covariance matrix distributed by
+ *        `policy`.
+ *
+ * Only the Cholesky factor is distributed, the cross-covariance matrix is
+ * assembled on the calling locality. The distributed assembly is limited to
+ * the squared exponential kernel.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param test_input test input data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of each test tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ * @param policy distribution of the covariance tiles
+ */
+hpx::shared_future<std::vector<double>>
+predict_hpx(const std::vector<double> &training_input,
+            const std::vector<double> &training_output,
+            const std::vector<double> &test_input,
+            int n_tiles,
+            int n_tile_size,
+            int m_tiles,
+            int m_tile_size,
+            double lengthscale,
+            double vertical_lengthscale,
+            double noise_variance,
+            int n_regressors,
+            const distribution_policy &policy)
+{
+    if (!policy.is_distributed())
+    {
+        return predict_hpx(training_input, training_output, test_input, n_tiles, n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel_function());
+    }
+    std::shared_ptr<distributed_tiles> K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> diag_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha_tiles;
+    fit_distributed_hpx(training_input, training_output, n_tiles, n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, policy, K_tiles, diag_tiles, alpha_tiles);
+    return predict_fitted_hpx(training_input, test_input, diag_tiles, alpha_tiles, n_tiles, n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel_function());
+}
+
+/**
+ * @brief Compute the predictions with Solver::Iterative.
+ *
+ * alpha = K^-1 * y is solved by preconditioned conjugate gradients, see
+ * iterative::fit_hpx, and the covariance tiles are only generated inside the
+ * tasks that multiply with them. Blocks until alpha is solved.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param test_input test input data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of each test tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter, must be positive
+ * @param n_regressors number of regressors
+ * @param kernel covariance function
+ * @param settings iterations and preconditioner of the conjugate gradients
+ */
+hpx::shared_future<std::vector<double>>
+predict_hpx(const std::vector<double> &training_input,
+            const std::vector<double> &training_output,
+            const std::vector<double> &test_input,
+            int n_tiles,
+            int n_tile_size,
+            int m_tiles,
+            int m_tile_size,
+            double lengthscale,
+            double vertical_lengthscale,
+            double noise_variance,
+            int n_regressors,
+            const kernel_function &kernel,
+            const iterative_settings &settings)
+{
+    const iterative::fit_state state = iterative::fit_hpx(training_input, training_output, n_tiles, n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel, settings, false);
+    return iterative::predict_fitted_hpx(training_input, test_input, state.alpha_tiles, n_tiles, n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, n_regressors, kernel);
+}
+
+/**
+ * @brief Compute the predictions from a precomputed Cholesky factor and alpha.
+ *
+ * Only assembles the cross-covariance matrix, costs O(N*M). Does not block,
+ * the returned future becomes ready once the prediction tiles are computed.
+ *
+ * @param training_input training input data
+ * @param test_input test input data
+ * @param K_tiles lower tiles of the Cholesky factor L, see `fit_hpx`
+ * @param alpha_tiles tiles of alpha = K^-1 * y, see `fit_hpx`
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of each test tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ * @param kernel covariance function
+ */
+hpx::shared_future<std::vector<double>>
+predict_fitted_hpx(const std::vector<double> &training_input,
+                   const std::vector<double> &test_input,
+                   const std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+                   const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+                   int n_tiles,
+                   int n_tile_size,
+                   int m_tiles,
+                   int m_tile_size,
+                   double lengthscale,
+                   double vertical_lengthscale,
+                   double noise_variance,
+                   int n_regressors,
+                   const kernel_function &kernel)
+{
+    // the tile generators read the hyperparameters until the prediction tiles
+    // are ready, the returned future keeps them alive
+    auto hyperparameters = std::make_shared<std::array<double, 3>>();
+    (*hyperparameters)[0] = lengthscale;           // variance of training_output
+    (*hyperparameters)[1] = vertical_lengthscale;  // standard deviation of
+                                                   // training_input
+    (*hyperparameters)[2] = noise_variance;        // some small value
+
+    // declare data structures
+    // tiled future data structures
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha = alpha_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> cross_covariance_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prediction_tiles;
+
+    // Assemble MxN cross-covariance matrix vector
+    cross_covariance_tiles.resize(m_tiles * n_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        for (std::size_t j = 0; j < n_tiles; j++)
+        {
+            cross_covariance_tiles[i * n_tiles + j] =
+                hpx::async(profiling::annotated_function(&gen_tile_cross_covariance<double>,
+                                                         "assemble_pred"),
+                           i,
+                           j,
+                           m_tile_size,
+                           n_tile_size,
+                           n_regressors,
+                           hyperparameters->data(),
+                           kernel,
+                           test_input,
+                           training_input);
+        }
+    }
+    // Assemble placeholder for prediction
+    prediction_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prediction_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+            m_tile_size);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Compute predictions
+    prediction_tiled(cross_covariance_tiles, alpha, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
+
+    //// Get predictions to return them once they are computed
+    const std::size_t m_samples = test_input.size();
+    return hpx::dataflow(
+        profiling::annotated_function(
+            [hyperparameters, m_samples](const std::vector<hpx::shared_future<mutable_tile_data<double>>> &tiles)
+            { return concat_tiles(tiles, m_samples); },
+            "predict_collect"),
+        prediction_tiles);
+}
+
+// Compute the predictions and uncertainties
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_uncertainty_hpx(const std::vector<double> &training_input,
+                             const std::vector<double> &training_output,
+                             const std::vector<double> &test_input,
+                             int n_tiles,
+                             int n_tile_size,
+                             int m_tiles,
+                             int m_tile_size,
+                             double lengthscale,
+                             double vertical_lengthscale,
+                             double noise_variance,
+                             int n_regressors,
+                             const kernel_function &kernel)
+{
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha_tiles;
+    fit_hpx(training_input, training_output, n_tiles, n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel, K_tiles, alpha_tiles);
+    return predict_with_uncertainty_fitted_hpx(training_input, test_input, K_tiles, alpha_tiles, n_tiles, n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel);
+}
+
+// Compute the predictions and uncertainties from a precomputed Cholesky
+// factor and alpha
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_uncertainty_fitted_hpx(
+    const std::vector<double> &training_input,
+    const std::vector<double> &test_input,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+    int n_tiles,
+    int n_tile_size,
+    int m_tiles,
+    int m_tile_size,
+    double lengthscale,
+    double vertical_lengthscale,
+    double noise_variance,
+    int n_regressors,
+    const kernel_function &kernel)
+{
+    // the tile generators read the hyperparameters until the prediction tiles
+    // are ready, the returned future keeps them alive
+    auto hyperparameters = std::make_shared<std::array<double, 3>>();
+    (*hyperparameters)[0] =
         lengthscale;  // lengthscale = variance of training_output
-    hyperparameters[1] =
-        vertical_lengthscale;             // vertical_lengthscale = standard deviation of
-                                          // training_input
-    hyperparameters[2] = noise_variance;  // noise_variance = small value
+    (*hyperparameters)[1] =
+        vertical_lengthscale;                // vertical_lengthscale = standard deviation of
+                                             // training_input
+    (*hyperparameters)[2] = noise_variance;  // noise_variance = small value
     // declare data structures
     // tiled future data structures
-    std::vector<hpx::shared_future<std::vector<double>>> K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> alpha_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> prior_K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> prior_inter_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> cross_covariance_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>>
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> L_tiles = K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha = alpha_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prior_K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prior_inter_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> cross_covariance_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>>
         t_cross_covariance_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> prediction_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>>
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prediction_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>>
         prediction_uncertainty_tiles;
 
     //////////////////////////////////////////////////////////////////////////////
-    // Assemble covariance matrix vector
-    K_tiles.resize(n_tiles * n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
+    // Assemble prior covariance matrix vector
+    prior_K_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
     {
-        for (std::size_t j = 0; j <= i; j++)
+        prior_K_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_prior_covariance<double>,
+                                          "assemble_tiled"),
+            i,
+            i,
+            m_tile_size,
+            n_regressors,
+            hyperparameters->data(),
+            kernel,
+            test_input);
+    }
+    // Assemble MxN cross-covariance matrix vector
+    cross_covariance_tiles.resize(m_tiles * n_tiles);
+    // Assemble NxM (transpose) cross-covariance matrix vector
+    t_cross_covariance_tiles.resize(n_tiles * m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        for (std::size_t j = 0; j < n_tiles; j++)
         {
-            K_tiles[i * n_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_covariance, "assemble_tiled"),
-                i,
-                j,
+            cross_covariance_tiles[i * n_tiles + j] =
+                hpx::async(profiling::annotated_function(&gen_tile_cross_covariance<double>,
+                                                         "assemble_pred"),
+                           i,
+                           j,
+                           m_tile_size,
+                           n_tile_size,
+                           n_regressors,
+                           hyperparameters->data(),
+                           kernel,
+                           test_input,
+                           training_input);
+
+            t_cross_covariance_tiles[j * m_tiles + i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_cross_cov_T<double>),
+                                              "assemble_pred"),
+                m_tile_size,
                 n_tile_size,
-                n_regressors,
-                hyperparameters,
-                training_input);
+                cross_covariance_tiles[i * n_tiles + j]);
         }
     }
-    // Assemble alpha
-    alpha_tiles.resize(n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
+    // Assemble placeholder matrix for diag(K_MxN * (K^-1_NxN * K_NxM))
+    prior_inter_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prior_inter_tiles[i] =
+            hpx::async(profiling::annotated_function(&gen_tile_zeros_diag,
+                                                     "assemble_prior_inter"),
+                       m_tile_size);
+    }
+    // Assemble placeholder for prediction
+    prediction_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prediction_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+            m_tile_size);
+    }
+    // Assemble placeholder for uncertainty
+    prediction_uncertainty_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prediction_uncertainty_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+            m_tile_size);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
+    forward_solve_KcK_tiled(L_tiles, t_cross_covariance_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+    // backward_solve_KK_tiled(K_tiles, cross_covariance_tiles, n_tile_size,
+    // m_tile_size, n_tiles, m_tiles);
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Compute predictions
+    prediction_tiled(cross_covariance_tiles, alpha, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
+    // posterior covariance matrix - (K_MxN * K^-1_NxN) * K_NxM
+    posterior_covariance_tiled(t_cross_covariance_tiles, prior_inter_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+
+    //// Compute predicition uncertainty
+    prediction_uncertainty_tiled(prior_K_tiles, prior_inter_tiles, prediction_uncertainty_tiles, m_tile_size, m_tiles);
+
+    //// Get predictions and uncertainty to return them once they are computed
+    const std::size_t m_samples = test_input.size();
+    return hpx::dataflow(
+        profiling::annotated_function(
+            [hyperparameters, m_samples](const std::vector<hpx::shared_future<mutable_tile_data<double>>> &mean_tiles,
+                                         const std::vector<hpx::shared_future<mutable_tile_data<double>>> &var_tiles)
+            { return std::vector<std::vector<double>>{ concat_tiles(mean_tiles, m_samples), concat_tiles(var_tiles, m_samples) }; },
+            "predict_collect"),
+        prediction_tiles,
+        prediction_uncertainty_tiles);
+}
+
+// Compute the predictions and uncertainties from a single precision Cholesky
+// factor and a double precision alpha, see `fit_mixed_hpx`. The predictions
+// are computed in double precision, the solve of the uncertainties in single
+// precision.
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_uncertainty_mixed_hpx(
+    const std::vector<double> &training_input,
+    const std::vector<double> &test_input,
+    const std::vector<hpx::shared_future<mutable_tile_data<float>>> &L_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+    int n_tiles,
+    int n_tile_size,
+    int m_tiles,
+    int m_tile_size,
+    double lengthscale,
+    double vertical_lengthscale,
+    double noise_variance,
+    int n_regressors,
+    const kernel_function &kernel)
+{
+    // the tile generators read the hyperparameters until the prediction tiles
+    // are ready, the returned future keeps them alive
+    auto hyperparameters = std::make_shared<std::array<double, 3>>();
+    (*hyperparameters)[0] = lengthscale;
+    (*hyperparameters)[1] = vertical_lengthscale;
+    (*hyperparameters)[2] = noise_variance;
+    // declare data structures
+    // tiled future data structures
+    std::vector<hpx::shared_future<mutable_tile_data<float>>> L = L_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha = alpha_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prior_K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<float>>> prior_inter_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> cross_covariance_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<float>>>
+        t_cross_covariance_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prediction_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>>
+        prediction_uncertainty_tiles;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Assemble prior covariance matrix vector
+    prior_K_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prior_K_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_prior_covariance<double>,
+                                          "assemble_tiled"),
+            i,
+            i,
+            m_tile_size,
+            n_regressors,
+            hyperparameters->data(),
+            kernel,
+            test_input);
+    }
+    // Assemble MxN cross-covariance matrix vector in double precision and
+    // its NxM transpose in single precision
+    cross_covariance_tiles.resize(m_tiles * n_tiles);
+    t_cross_covariance_tiles.resize(n_tiles * m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        for (std::size_t j = 0; j < n_tiles; j++)
+        {
+            cross_covariance_tiles[i * n_tiles + j] =
+                hpx::async(profiling::annotated_function(&gen_tile_cross_covariance<double>,
+                                                         "assemble_pred"),
+                           i,
+                           j,
+                           m_tile_size,
+                           n_tile_size,
+                           n_regressors,
+                           hyperparameters->data(),
+                           kernel,
+                           test_input,
+                           training_input);
+
+            hpx::shared_future<mutable_tile_data<float>> cross_covariance_tile =
+                hpx::dataflow(profiling::annotated_function(
+                                  hpx::unwrapping(&convert_tile<float, double>),
+                                  "assemble_pred"),
+                              cross_covariance_tiles[i * n_tiles + j]);
+            t_cross_covariance_tiles[j * m_tiles + i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_cross_cov_T<float>),
+                                              "assemble_pred"),
+                m_tile_size,
+                n_tile_size,
+                cross_covariance_tile);
+        }
+    }
+    // Assemble placeholders for diag(K_MxN * (K^-1_NxN * K_NxM)), the
+    // prediction and the uncertainty
+    prior_inter_tiles.resize(m_tiles);
+    prediction_tiles.resize(m_tiles);
+    prediction_uncertainty_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prior_inter_tiles[i] =
+            hpx::async(profiling::annotated_function(&gen_tile_zeros<float>,
+                                                     "assemble_prior_inter"),
+                       m_tile_size);
+        prediction_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+            m_tile_size);
+        prediction_uncertainty_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+            m_tile_size);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
+    forward_solve_KcK_tiled(L, t_cross_covariance_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Compute predictions
+    prediction_tiled(cross_covariance_tiles, alpha, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
+    // posterior covariance matrix - (K_MxN * K^-1_NxN) * K_NxM
+    posterior_covariance_tiled(t_cross_covariance_tiles, prior_inter_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+
+    //// Compute predicition uncertainty in double precision
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> inter_tiles(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        inter_tiles[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&convert_tile<double, float>),
+                                          "uncertainty_tiled"),
+            prior_inter_tiles[i]);
+    }
+    prediction_uncertainty_tiled(prior_K_tiles, inter_tiles, prediction_uncertainty_tiles, m_tile_size, m_tiles);
+
+    //// Get predictions and uncertainty to return them once they are computed
+    const std::size_t m_samples = test_input.size();
+    return hpx::dataflow(
+        profiling::annotated_function(
+            [hyperparameters, m_samples](const std::vector<hpx::shared_future<mutable_tile_data<double>>> &mean_tiles,
+                                         const std::vector<hpx::shared_future<mutable_tile_data<double>>> &var_tiles)
+            { return std::vector<std::vector<double>>{ concat_tiles(mean_tiles, m_samples), concat_tiles(var_tiles, m_samples) }; },
+            "predict_collect"),
+        prediction_tiles,
+        prediction_uncertainty_tiles);
+}
+
+// Compute the predictions and the posterior covariance in `format`
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_full_cov_hpx(const std::vector<double> &training_input,
+                          const std::vector<double> &training_output,
+                          const std::vector<double> &test_input,
+                          int n_tiles,
+                          int n_tile_size,
+                          int m_tiles,
+                          int m_tile_size,
+                          double lengthscale,
+                          double vertical_lengthscale,
+                          double noise_variance,
+                          int n_regressors,
+                          const kernel_function &kernel,
+                          CovarianceFormat format)
+{
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha_tiles;
+    fit_hpx(training_input, training_output, n_tiles, n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel, K_tiles, alpha_tiles);
+    return predict_with_full_cov_fitted_hpx(training_input, test_input, K_tiles, alpha_tiles, n_tiles, n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel, format);
+}
+
+/**
+ * @brief Returns the lower triangle of the symmetric tiled matrix of order M,
+ *        packed row by row, from its lower tiles.
+ *
+ * @param ft_tiles lower tiles of the matrix, the strict upper triangle of its
+ *        diagonal tiles is not read
+ * @param M order of the matrix without the padding of the last tile
+ * @param N size of the tiles
+ * @param n_tiles number of tiles per dimension
+ */
+static std::vector<double>
+pack_lower_tiles(const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+                 std::size_t M,
+                 std::size_t N,
+                 std::size_t n_tiles)
+{
+    std::vector<double> packed;
+    packed.reserve(M * (M + 1) / 2);
+    for (std::size_t row = 0; row < M; row++)
+    {
+        const std::size_t i = row / N;
+        const std::size_t r = row % N;
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            const mutable_tile_data<double> &tile = ft_tiles[i * n_tiles + j].get();
+            const std::size_t n_cols = j == i ? r + 1 : N;
+            packed.insert(packed.end(), tile.begin() + r * N, tile.begin() + r * N + n_cols);
+        }
+    }
+    return packed;
+}
+
+/**
+ * @brief Returns the row-major N_row x M_col matrix of the tiles
+ *        ft_tiles[i * m_tiles + j] of size N x M, without the padding.
+ */
+static std::vector<double>
+gather_tiles(const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+             std::size_t N_row,
+             std::size_t M_col,
+             std::size_t N,
+             std::size_t M,
+             std::size_t m_tiles)
+{
+    std::vector<double> matrix;
+    matrix.reserve(N_row * M_col);
+    for (std::size_t row = 0; row < N_row; row++)
+    {
+        const std::size_t i = row / N;
+        const std::size_t r = row % N;
+        for (std::size_t j = 0; j * M < M_col; j++)
+        {
+            const mutable_tile_data<double> &tile = ft_tiles[i * m_tiles + j].get();
+            const std::size_t n_cols = std::min(M, M_col - j * M);
+            matrix.insert(matrix.end(), tile.begin() + r * M, tile.begin() + r * M + n_cols);
+        }
+    }
+    return matrix;
+}
+
+// Compute the predictions and the posterior covariance in `format` from a
+// precomputed Cholesky factor and alpha
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_full_cov_fitted_hpx(
+    const std::vector<double> &training_input,
+    const std::vector<double> &test_input,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+    int n_tiles,
+    int n_tile_size,
+    int m_tiles,
+    int m_tile_size,
+    double lengthscale,
+    double vertical_lengthscale,
+    double noise_variance,
+    int n_regressors,
+    const kernel_function &kernel,
+    CovarianceFormat format)
+{
+    if (format == CovarianceFormat::Diagonal)
     {
-        alpha_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_output, "assemble_tiled"), i, n_tile_size, training_output);
+        // the diagonal needs no M x M tiles at all
+        return predict_with_uncertainty_fitted_hpx(training_input, test_input, K_tiles, alpha_tiles, n_tiles, n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, kernel);
     }
-    // Assemble prior covariance matrix vector
+    double hyperparameters[3];
+    hyperparameters[0] =
+        lengthscale;  // lengthscale = variance of training_output
+    hyperparameters[1] =
+        vertical_lengthscale;             // vertical_lengthscale = standard deviation of
+                                          // training_input
+    hyperparameters[2] = noise_variance;  // noise_variance = small value
+    // declare data structures
+    // tiled future data structures
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> L_tiles = K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha = alpha_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prior_K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> cross_covariance_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>>
+        t_cross_covariance_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prediction_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>>
+        prediction_uncertainty_tiles;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Assemble the lower tiles of the prior covariance matrix, the upper tiles
+    // stay empty
     prior_K_tiles.resize(m_tiles * m_tiles);
     for (std::size_t i = 0; i < m_tiles; i++)
     {
         for (std::size_t j = 0; j <= i; j++)
         {
             prior_K_tiles[i * m_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_full_prior_covariance,
-                                        "assemble_prior_tiled"),
+                profiling::annotated_function(&gen_tile_full_prior_covariance<double>,
+                                              "assemble_prior_tiled"),
                 i,
                 j,
                 m_tile_size,
                 n_regressors,
                 hyperparameters,
+                kernel,
                 test_input);
-
-            if (i != j)
-            {
-                prior_K_tiles[j * m_tiles + i] =
-                    hpx::dataflow(hpx::annotated_function(
-                                      hpx::unwrapping(&gen_tile_grad_l_trans),
-                                      "assemble_prior_tiled"),
-                                  m_tile_size,
-                                  prior_K_tiles[i * m_tiles + j]);
-            }
         }
     }
     // Assemble MxN cross-covariance matrix vector
@@ -437,140 +1337,831 @@ predict_with_full_cov_hpx(const std::vector<double> &training_input,
         for (std::size_t j = 0; j < n_tiles; j++)
         {
             cross_covariance_tiles[i * n_tiles + j] =
-                hpx::async(hpx::annotated_function(&gen_tile_cross_covariance,
-                                                   "assemble_pred"),
+                hpx::async(profiling::annotated_function(&gen_tile_cross_covariance<double>,
+                                                         "assemble_pred"),
                            i,
                            j,
                            m_tile_size,
                            n_tile_size,
                            n_regressors,
                            hyperparameters,
+                           kernel,
                            test_input,
                            training_input);
 
             t_cross_covariance_tiles[j * m_tiles + i] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&gen_tile_cross_cov_T),
-                                        "assemble_pred"),
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_cross_cov_T<double>),
+                                              "assemble_pred"),
                 m_tile_size,
                 n_tile_size,
                 cross_covariance_tiles[i * n_tiles + j]);
         }
     }
-    // Assemble placeholder for prediction
-    prediction_tiles.resize(m_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
+    // Assemble placeholder for prediction
+    prediction_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prediction_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+            m_tile_size);
+    }
+    // Assemble placeholder for uncertainty
+    prediction_uncertainty_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prediction_uncertainty_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+            m_tile_size);
+    }
+    //////////////////////////////////////////////////////////////////////////////
+    //// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
+    forward_solve_KcK_tiled(L_tiles, t_cross_covariance_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Compute predictions
+    prediction_tiled(cross_covariance_tiles, alpha, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
+    if (format == CovarianceFormat::Lower)
+    {
+        // lower tiles of the posterior covariance matrix
+        // K_MxM - (K_MxN * K^-1_NxN) * K_NxM
+        full_cov_tiled(t_cross_covariance_tiles, prior_K_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+        //// Compute predicition uncertainty
+        pred_uncer_tiled(prior_K_tiles, prediction_uncertainty_tiles, m_tile_size, m_tiles);
+    }
+    else
+    {
+        // the prior covariance is returned as is, only its diagonal is updated
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> prior_diag_tiles(m_tiles);
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> prior_inter_tiles(m_tiles);
+        for (std::size_t i = 0; i < m_tiles; i++)
+        {
+            prior_inter_tiles[i] =
+                hpx::async(profiling::annotated_function(&gen_tile_zeros_diag,
+                                                         "assemble_prior_inter"),
+                           m_tile_size);
+        }
+        pred_uncer_tiled(prior_K_tiles, prior_diag_tiles, m_tile_size, m_tiles);
+        // diag(K_MxN * (K^-1_NxN * K_NxM))
+        posterior_covariance_tiled(t_cross_covariance_tiles, prior_inter_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+        //// Compute predicition uncertainty
+        prediction_uncertainty_tiled(prior_diag_tiles, prior_inter_tiles, prediction_uncertainty_tiles, m_tile_size, m_tiles);
+    }
+
+    //// Get predictions and uncertainty to return them
+    std::vector<std::vector<double>> result(2);
+    std::vector<double> &pred = result[0];
+    std::vector<double> &pred_var = result[1];
+    pred.reserve(test_input.size());      // preallocate memory
+    pred_var.reserve(test_input.size());  // preallocate memory
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        pred.insert(pred.end(), prediction_tiles[i].get().begin(), prediction_tiles[i].get().end());
+        pred_var.insert(pred_var.end(),
+                        prediction_uncertainty_tiles[i].get().begin(),
+                        prediction_uncertainty_tiles[i].get().end());
+    }
+    // drop the padding of the last tile
+    pred.resize(test_input.size());
+    pred_var.resize(test_input.size());
+    // posterior covariance or K_MxM, packed
+    result.push_back(pack_lower_tiles(prior_K_tiles, test_input.size(), m_tile_size, m_tiles));
+    if (format == CovarianceFormat::LowRank)
+    {
+        // V = L^-1 * K_NxM without the padding of the training samples
+        result.push_back(gather_tiles(t_cross_covariance_tiles, training_input.size(), test_input.size(), n_tile_size, m_tile_size, m_tiles));
+    }
+
+    // Return computed data
+    return hpx::make_ready_future(std::move(result));
+}
+
+// Compute loss for given data and Gaussian process model
+hpx::shared_future<double>
+compute_loss_hpx(const std::vector<double> &training_input,
+                 const std::vector<double> &training_output,
+                 int n_tiles,
+                 int n_tile_size,
+                 int n_regressors,
+                 double *hyperparameters,
+                 const kernel_function &kernel)
+{
+    // declare data structures
+    // tiled future data structures
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles;
+    hpx::shared_future<double> loss_value;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Assemble covariance matrix vector
+    K_tiles.resize(n_tiles * n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            K_tiles[i * n_tiles + j] = hpx::async(
+                profiling::annotated_function(&gen_tile_covariance<double>, "assemble_tiled"),
+                i,
+                j,
+                n_tile_size,
+                n_regressors,
+                hyperparameters,
+                kernel,
+                training_input);
+        }
+    }
+
+    // Assemble alpha
+    alpha_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        alpha_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled"), i, n_tile_size, training_output);
+    }
+    // Assemble y
+    y_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        y_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled"), i, n_tile_size, training_output);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Cholesky decomposition
+    cholesky_tiled(K_tiles, n_tile_size, n_tiles);
+    // Triangular solve K_NxN * alpha = y
+    forward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
+    backward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
+    // Compute loss
+    compute_loss_tiled(K_tiles, alpha_tiles, y_tiles, loss_value, n_tile_size, n_tiles, training_output.size());
+    // Return loss
+    return loss_value;
+}
+
+// Estimate the loss with Solver::Iterative, see iterative::fit_hpx. Blocks.
+hpx::shared_future<double>
+compute_loss_hpx(const std::vector<double> &training_input,
+                 const std::vector<double> &training_output,
+                 int n_tiles,
+                 int n_tile_size,
+                 int n_regressors,
+                 double *hyperparameters,
+                 const kernel_function &kernel,
+                 const iterative_settings &settings)
+{
+    const iterative::fit_state state = iterative::fit_hpx(training_input, training_output, n_tiles, n_tile_size, hyperparameters[0], hyperparameters[1], hyperparameters[2], n_regressors, kernel, settings, true);
+    return hpx::make_ready_future(state.loss).share();
+}
+
+// Compute loss from a precomputed Cholesky factor and alpha
+hpx::shared_future<double>
+compute_loss_fitted_hpx(
+    const std::vector<double> &training_output,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+    int n_tiles,
+    int n_tile_size)
+{
+    // declare data structures
+    // tiled future data structures
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> L_tiles = K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha = alpha_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles;
+    hpx::shared_future<double> loss_value;
+
+    // Assemble y
+    y_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        y_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled"), i, n_tile_size, training_output);
+    }
+    // Compute loss
+    compute_loss_tiled(L_tiles, alpha, y_tiles, loss_value, n_tile_size, n_tiles, training_output.size());
+    // Return loss
+    return loss_value;
+}
+
+/**
+ * @brief Schedule the assembly of the covariance matrix and its derivatives
+ *        for one optimizer iteration. Does not block.
+ *
+ * Only the lower tiles are assembled, all trace modes use the symmetry of K
+ * and its derivatives.
+ *
+ * @param training_input training input data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param n_regressors number of regressors
+ * @param hyperparameters hyperparameters of the iteration
+ * @param trainable_params flags for lengthscale, vertical lengthscale, noise
+ * @param distance_cache cache of the squared distance tiles
+ * @param tiles receives the assembled tiles
+ */
+static void assemble_optimizer_tiles_hpx(
+    const std::vector<double> &training_input,
+    std::size_t n_tiles,
+    std::size_t n_tile_size,
+    std::size_t n_regressors,
+    const hpx::shared_future<optimizer_parameters> &hyperparameters,
+    const std::vector<bool> &trainable_params,
+    distance_tile_cache &distance_cache,
+    optimizer_tiles &tiles)
+{
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles = tiles.K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &grad_l_tiles = tiles.grad_l_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &grad_v_tiles = tiles.grad_v_tiles;
+    K_tiles.assign(n_tiles * n_tiles, {});
+    grad_l_tiles.assign(n_tiles * n_tiles, {});
+    grad_v_tiles.assign(n_tiles * n_tiles, {});
+
+    // Assemble covariance matrix vector, derivative of covariance matrix
+    // vector w.r.t. to vertical lengthscale and derivative of covariance
+    // matrix vector w.r.t. to lengthscale
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            hpx::shared_future<mutable_tile_data<double>> cov_dists =
+                distance_cache.tile(i, j, n_tiles, n_tile_size, n_regressors, training_input);
+
+            K_tiles[i * n_tiles + j] =
+                hpx::dataflow(profiling::annotated_function(
+                                  hpx::unwrapping(&gen_tile_covariance_opt),
+                                  "assemble_K"),
+                              i,
+                              j,
+                              n_tile_size,
+                              n_regressors,
+                              training_input.size(),
+                              hyperparameters,
+                              cov_dists);
+
+            if (trainable_params[0])
+            {
+                grad_l_tiles[i * n_tiles + j] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gen_tile_grad_l),
+                                                  "assemble_gradl"),
+                    i,
+                    j,
+                    n_tile_size,
+                    n_regressors,
+                    training_input.size(),
+                    hyperparameters,
+                    cov_dists);
+            }
+
+            if (trainable_params[1])
+            {
+                grad_v_tiles[i * n_tiles + j] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gen_tile_grad_v),
+                                                  "assemble_gradv"),
+                    i,
+                    j,
+                    n_tile_size,
+                    n_regressors,
+                    training_input.size(),
+                    hyperparameters,
+                    cov_dists);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compute the loss and the two terms of its gradient for one optimizer
+ *        iteration on tiles assembled by assemble_optimizer_tiles_hpx. Does
+ *        not block.
+ *
+ * Only the lower tiles of K and its derivatives are used. With
+ * TraceMode::Explicit alpha and the trace terms use K^-1 from L * L^T * X = I,
+ * of which trace(inv(K) * del(K)) reads the lower tiles. The other modes
+ * compute alpha by triangular solves and obtain trace(inv(K) * del(K)) from
+ * the lower tiles of K^-1 (TraceMode::Cholesky) or from w = K^-1 * z for
+ * Rademacher probes z (TraceMode::Hutchinson).
+ *
+ * @param training_output training output data
+ * @param y_tiles tiles of the training output
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param hyperparameters hyperparameters of the iteration
+ * @param hyperparams optimizer settings
+ * @param trainable_params flags for lengthscale, vertical lengthscale, noise
+ * @param iter global iteration count, varies the probes between iterations
+ * @param tiles covariance tiles and derivatives, consumed by the iteration
+ * @param grad_left receives trace(inv(K) * del(K)/del(param)) of the
+ *        trainable hyperparameters
+ * @param grad_right receives alpha^T * del(K)/del(param) * alpha of the
+ *        trainable hyperparameters
+ *
+ * @return loss
+ */
+static hpx::shared_future<double> compute_loss_gradient_terms_hpx(
+    const std::vector<double> &training_output,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &y_tiles,
+    std::size_t n_tiles,
+    std::size_t n_tile_size,
+    const hpx::shared_future<optimizer_parameters> &hyperparameters,
+    const gpxpy_hyper::Hyperparameters &hyperparams,
+    const std::vector<bool> &trainable_params,
+    int iter,
+    optimizer_tiles &tiles,
+    std::vector<hpx::shared_future<double>> &grad_left,
+    std::vector<hpx::shared_future<double>> &grad_right)
+{
+    const gpxpy_hyper::TraceMode mode = hyperparams.trace_mode;
+    if (mode == gpxpy_hyper::TraceMode::Hutchinson && hyperparams.n_probes <= 0)
+    {
+        throw std::invalid_argument("n_probes must be positive");
+    }
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &K_tiles = tiles.K_tiles;
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &grad_l_tiles = tiles.grad_l_tiles;
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &grad_v_tiles = tiles.grad_v_tiles;
+    // tiled future data structures
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> alpha_tiles(n_tiles);
+    // data holder for loss
+    hpx::shared_future<double> loss_value;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Cholesky decomposition
+    cholesky_tiled(K_tiles, n_tile_size, n_tiles);
+
+    // K^-1 for TraceMode::Explicit and TraceMode::Cholesky
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> invK_tiles;
+    if (mode == gpxpy_hyper::TraceMode::Explicit)
+    {
+        // Assemble placeholder matrix for K^-1
+        invK_tiles.resize(n_tiles * n_tiles);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            for (std::size_t j = 0; j < n_tiles; j++)
+            {
+                invK_tiles[i * n_tiles + j] = hpx::async(
+                    profiling::annotated_function(&gen_tile_identity,
+                                                  "assemble_identity_matrix"),
+                    i,
+                    j,
+                    n_tile_size);
+            }
+        }
+        // Assemble alpha
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            alpha_tiles[i] = hpx::async(
+                profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+                n_tile_size);
+        }
+        // Compute K^-1 through L*L^T*X = I
+        forward_solve_tiled_matrix(K_tiles, invK_tiles, n_tile_size, n_tile_size, n_tiles, n_tiles);
+        backward_solve_tiled_matrix(K_tiles, invK_tiles, n_tile_size, n_tile_size, n_tiles, n_tiles);
+        // inv(K)*y
+        compute_gemm_of_invK_y(invK_tiles, y_tiles, alpha_tiles, n_tile_size, n_tiles);
+    }
+    else
+    {
+        // Triangular solve K_NxN * alpha = y
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            alpha_tiles[i] = hpx::async(
+                profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled"), i, n_tile_size, training_output);
+        }
+        forward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
+        backward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
+        if (mode == gpxpy_hyper::TraceMode::Cholesky)
+        {
+            compute_inverse_lower_tiled(K_tiles, invK_tiles, n_tile_size, n_tiles);
+        }
+    }
+    // Compute loss
+    compute_loss_tiled(K_tiles, alpha_tiles, y_tiles, loss_value, n_tile_size, n_tiles, training_output.size());
+
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> *grad_tiles[2] = { &grad_l_tiles, &grad_v_tiles };
+    grad_left.assign(3, {});
+    grad_right.assign(3, {});
+
+    ///////////////////////////////////////
+    /// part 1: trace(inv(K) * grad_param)
+    if (mode != gpxpy_hyper::TraceMode::Hutchinson)
+    {
+        for (int p = 0; p < 2; p++)
+        {
+            if (trainable_params[p])
+            {
+                trace_of_product_lower_tiled(invK_tiles, *grad_tiles[p], grad_left[p], n_tile_size, n_tiles);
+            }
+        }
+        if (trainable_params[2])
+        {
+            std::vector<hpx::shared_future<double>> partial_sums(n_tiles);
+            for (std::size_t j = 0; j < n_tiles; ++j)
+            {
+                partial_sums[j] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&sum_noise_gradleft),
+                                                  "grad_left_tiled"),
+                    invK_tiles[j * n_tiles + j],
+                    0.0,
+                    hyperparameters,
+                    n_tile_size,
+                    n_valid_samples(j * n_tile_size, n_tile_size, training_output.size()));
+            }
+            grad_left[2] = reduce_sum_tiled(partial_sums);
+        }
+    }
+    else
+    {
+        // probes z and w = K^-1 * z
+        const std::size_t n_probes = hyperparams.n_probes;
+        const unsigned seed = hyperparams.seed + static_cast<unsigned>(iter);
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> probe_tiles(n_tiles);
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> solved_probe_tiles(n_tiles);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            probe_tiles[i] = hpx::async(
+                profiling::annotated_function(&gen_tile_probes, "assemble_probes"), i, n_tile_size, n_probes, training_output.size(), seed);
+            solved_probe_tiles[i] = hpx::async(
+                profiling::annotated_function(&gen_tile_probes, "assemble_probes"), i, n_tile_size, n_probes, training_output.size(), seed);
+        }
+        forward_solve_tiled_matrix(K_tiles, solved_probe_tiles, n_tile_size, n_probes, n_tiles, 1);
+        backward_solve_tiled_matrix(K_tiles, solved_probe_tiles, n_tile_size, n_probes, n_tiles, 1);
+        // trace(inv(K) * grad_param) ~ mean of w^T * grad_param * z
+        for (int p = 0; p < 2; p++)
+        {
+            if (trainable_params[p])
+            {
+                std::vector<hpx::shared_future<mutable_tile_data<double>>> product_tiles(n_tiles);
+                for (std::size_t i = 0; i < n_tiles; i++)
+                {
+                    product_tiles[i] = hpx::async(
+                        profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"), n_tile_size * n_probes);
+                }
+                symmetric_matrix_product_tiled(*grad_tiles[p], probe_tiles, product_tiles, n_tile_size, n_probes, n_tiles);
+                std::vector<hpx::shared_future<double>> partial_sums(n_tiles);
+                for (std::size_t i = 0; i < n_tiles; i++)
+                {
+                    partial_sums[i] = hpx::dataflow(
+                        profiling::annotated_function(hpx::unwrapping(&sum_gradright),
+                                                      "grad_left_tiled"),
+                        solved_probe_tiles[i],
+                        product_tiles[i],
+                        0.0,
+                        n_tile_size * n_probes);
+                }
+                grad_left[p] = reduce_sum_tiled(partial_sums);
+            }
+        }
+        if (trainable_params[2])
+        {
+            std::vector<hpx::shared_future<double>> partial_sums(n_tiles);
+            for (std::size_t i = 0; i < n_tiles; i++)
+            {
+                partial_sums[i] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&sum_noise_gradleft_probes),
+                                                  "grad_left_tiled"),
+                    solved_probe_tiles[i],
+                    probe_tiles[i],
+                    0.0,
+                    hyperparameters,
+                    n_tile_size * n_probes);
+            }
+            grad_left[2] = reduce_sum_tiled(partial_sums);
+        }
+    }
+
+    ///////////////////////////////////////
+    /// part 2: alpha^T * grad_param * alpha
+    for (int p = 0; p < 2; p++)
     {
-        prediction_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_zeros, "assemble_tiled"),
-            m_tile_size);
+        if (trainable_params[p])
+        {
+            std::vector<hpx::shared_future<mutable_tile_data<double>>> inter_alpha(n_tiles);
+            for (std::size_t i = 0; i < n_tiles; i++)
+            {
+                inter_alpha[i] = hpx::async(
+                    profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"), n_tile_size);
+            }
+            symmetric_matrix_product_tiled(*grad_tiles[p], alpha_tiles, inter_alpha, n_tile_size, 1, n_tiles);
+            std::vector<hpx::shared_future<double>> partial_sums(n_tiles);
+            for (std::size_t i = 0; i < n_tiles; i++)
+            {
+                partial_sums[i] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&sum_gradright),
+                                                  "grad_right_tiled"),
+                    inter_alpha[i],
+                    alpha_tiles[i],
+                    0.0,
+                    n_tile_size);
+            }
+            grad_right[p] = reduce_sum_tiled(partial_sums);
+        }
     }
-    // Assemble placeholder for uncertainty
-    prediction_uncertainty_tiles.resize(m_tiles);
-    for (std::size_t i = 0; i < m_tiles; i++)
+    if (trainable_params[2])
     {
-        prediction_uncertainty_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_zeros, "assemble_tiled"),
-            m_tile_size);
+        std::vector<hpx::shared_future<double>> partial_sums(n_tiles);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            partial_sums[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&sum_noise_gradright),
+                                              "grad_right_tiled"),
+                alpha_tiles[i],
+                0.0,
+                hyperparameters,
+                n_tile_size);
+        }
+        grad_right[2] = reduce_sum_tiled(partial_sums);
     }
-    //////////////////////////////////////////////////////////////////////////////
-    //// Compute Cholesky decomposition
-    right_looking_cholesky_tiled(K_tiles, n_tile_size, n_tiles);
-    //// Triangular solve K_NxN * alpha = y
-    forward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
-    backward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
-
-    //// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
-    forward_solve_KcK_tiled(K_tiles, t_cross_covariance_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
 
-    //////////////////////////////////////////////////////////////////////////////
-    //// Compute predictions
-    prediction_tiled(cross_covariance_tiles, alpha_tiles, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
-    // posterior covariance matrix K_MxM - (K_MxN * K^-1_NxN) * K_NxM
-    full_cov_tiled(t_cross_covariance_tiles, prior_K_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
-    //// Compute predicition uncertainty
-    pred_uncer_tiled(prior_K_tiles, prediction_uncertainty_tiles, m_tile_size, m_tiles);
+    return loss_value;
+}
 
-    //// Get predictions and uncertainty to return them
-    std::vector<double> pred;
-    std::vector<double> pred_var;
-    pred.reserve(test_input.size());      // preallocate memory
-    pred_var.reserve(test_input.size());  // preallocate memory
-    for (std::size_t i; i < m_tiles; i++)
+/**
+ * @brief Perform one optimizer iteration on tiles assembled by
+ *        assemble_optimizer_tiles_hpx: compute the loss and take an Adam step
+ *        for each trainable hyperparameter.
+ *
+ * See compute_loss_gradient_terms_hpx for the trace modes. The updates of
+ * the three hyperparameters run concurrently and nothing is waited for: the
+ * updated hyperparameters and the loss are returned as futures.
+ *
+ * @param training_output training output data
+ * @param y_tiles tiles of the training output
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param hyperparameters hyperparameters of the iteration, replaced by the
+ *        updated hyperparameters
+ * @param hyperparams optimizer settings
+ * @param trainable_params flags for lengthscale, vertical lengthscale, noise
+ * @param m_T first moments
+ * @param v_T second moments
+ * @param beta1_T powers of beta1
+ * @param beta2_T powers of beta2
+ * @param beta_idx index of the current iteration in beta1_T and beta2_T
+ * @param iter global iteration count, varies the probes between iterations
+ * @param tiles covariance tiles and derivatives, consumed by the iteration
+ *
+ * @return loss before the update
+ */
+static hpx::shared_future<double> optimizer_iteration_hpx(
+    const std::vector<double> &training_output,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &y_tiles,
+    std::size_t n_tiles,
+    std::size_t n_tile_size,
+    hpx::shared_future<optimizer_parameters> &hyperparameters,
+    const gpxpy_hyper::Hyperparameters &hyperparams,
+    const std::vector<bool> &trainable_params,
+    std::vector<hpx::shared_future<double>> &m_T,
+    std::vector<hpx::shared_future<double>> &v_T,
+    const std::vector<hpx::shared_future<double>> &beta1_T,
+    const std::vector<hpx::shared_future<double>> &beta2_T,
+    int beta_idx,
+    int iter,
+    optimizer_tiles &tiles)
+{
+    // untrained hyperparameters keep their value
+    std::vector<hpx::shared_future<double>> updated_params(3);
+    for (int p = 0; p < 3; p++)
     {
-        pred.insert(pred.end(), prediction_tiles[i].get().begin(), prediction_tiles[i].get().end());
-        pred_var.insert(pred_var.end(),
-                        prediction_uncertainty_tiles[i].get().begin(),
-                        prediction_uncertainty_tiles[i].get().end());
+        updated_params[p] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&get_kernel_param),
+                                          "gradient_tiled"),
+            hyperparameters,
+            p);
     }
 
-    // Return computed data
-    return hpx::async([pred, pred_var]()
-                      {
-        std::vector<std::vector<double>> result(2);
-        result[0] = pred;
-        result[1] = pred_var;
-        return result; });
+    std::vector<hpx::shared_future<double>> grad_left;
+    std::vector<hpx::shared_future<double>> grad_right;
+    hpx::shared_future<double> loss_value =
+        compute_loss_gradient_terms_hpx(training_output, y_tiles, n_tiles, n_tile_size, hyperparameters, hyperparams, trainable_params, iter, tiles, grad_left, grad_right);
+
+    //////////////////////////////
+    /// part 3: update parameters
+    for (int p = 0; p < 3; p++)
+    {
+        if (trainable_params[p])
+        {
+            updated_params[p] = update_hyperparameter_adam(grad_left[p], grad_right[p], hyperparameters, training_output.size(), m_T, v_T, beta1_T, beta2_T, beta_idx, p);
+        }
+    }
+    hyperparameters = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&update_kernel_params),
+                                      "gradient_tiled"),
+        hyperparameters,
+        updated_params[0],
+        updated_params[1],
+        updated_params[2]);
+    return loss_value;
 }
 
-// Compute loss for given data and Gaussian process model
-hpx::shared_future<double>
-compute_loss_hpx(const std::vector<double> &training_input,
-                 const std::vector<double> &training_output,
-                 int n_tiles,
-                 int n_tile_size,
-                 int n_regressors,
-                 double *hyperparameters)
+// Number of optimizer iterations whose task graphs may be in flight at once
+constexpr int OPTIMIZER_LOOKAHEAD = 2;
+
+/**
+ * @brief Returns the optimizer parameters for the given kernel, its
+ *        hyperparameters and Adam settings
+ */
+optimizer_parameters
+make_optimizer_parameters(double lengthscale,
+                          double vertical_lengthscale,
+                          double noise_variance,
+                          const kernel_function &kernel,
+                          const gpxpy_hyper::Hyperparameters &hyperparams)
 {
-    // declare data structures
-    // tiled future data structures
-    std::vector<hpx::shared_future<std::vector<double>>> K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> alpha_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> y_tiles;
-    hpx::shared_future<double> loss_value;
+    optimizer_parameters params;
+    params[0] = lengthscale;                // lengthscale
+    params[1] = vertical_lengthscale;       // vertical_lengthscale
+    params[2] = noise_variance;             // noise_variance
+    params[3] = hyperparams.learning_rate;  // learning rate
+    params[4] = hyperparams.beta1;          // beta1
+    params[5] = hyperparams.beta2;          // beta2
+    params[6] = hyperparams.epsilon;        // epsilon
+    params.kernel = kernel;
+    return params;
+}
 
-    //////////////////////////////////////////////////////////////////////////////
-    // Assemble covariance matrix vector
-    K_tiles.resize(n_tiles * n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
+/**
+ * @brief Compute the loss and its gradient w.r.t. the unconstrained
+ *        hyperparameters, which costs one factorization. Blocks.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param y_tiles tiles of the training output
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param n_regressors number of regressors
+ * @param params hyperparameters to evaluate the loss at
+ * @param hyperparams optimizer settings
+ * @param trainable_params flags for lengthscale, vertical lengthscale, noise
+ * @param distance_cache cache of the squared distance tiles
+ * @param gradient receives the gradient, zero for untrained hyperparameters
+ *
+ * @return loss
+ */
+static double evaluate_loss_gradient_hpx(const std::vector<double> &training_input,
+                                         const std::vector<double> &training_output,
+                                         std::vector<hpx::shared_future<mutable_tile_data<double>>> &y_tiles,
+                                         std::size_t n_tiles,
+                                         std::size_t n_tile_size,
+                                         std::size_t n_regressors,
+                                         const optimizer_parameters &params,
+                                         const gpxpy_hyper::Hyperparameters &hyperparams,
+                                         const std::vector<bool> &trainable_params,
+                                         distance_tile_cache &distance_cache,
+                                         std::vector<double> &gradient)
+{
+    const hpx::shared_future<optimizer_parameters> hyperparameters = hpx::make_ready_future(params);
+    optimizer_tiles tiles;
+    assemble_optimizer_tiles_hpx(training_input, n_tiles, n_tile_size, n_regressors, hyperparameters, trainable_params, distance_cache, tiles);
+    std::vector<hpx::shared_future<double>> grad_left;
+    std::vector<hpx::shared_future<double>> grad_right;
+    // the same probes at every evaluation, such that the line search and the
+    // gradient changes compare one objective
+    hpx::shared_future<double> loss =
+        compute_loss_gradient_terms_hpx(training_output, y_tiles, n_tiles, n_tile_size, hyperparameters, hyperparams, trainable_params, 0, tiles, grad_left, grad_right);
+    gradient.assign(3, 0.0);
+    for (int p = 0; p < 3; p++)
     {
-        for (std::size_t j = 0; j <= i; j++)
+        if (trainable_params[p])
         {
-            K_tiles[i * n_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_covariance, "assemble_tiled"),
-                i,
-                j,
-                n_tile_size,
-                n_regressors,
-                hyperparameters,
-                training_input);
+            gradient[p] = compute_gradient(grad_left[p].get(), grad_right[p].get(), training_output.size());
         }
     }
+    return loss.get();
+}
 
-    // Assemble alpha
-    alpha_tiles.resize(n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
+/**
+ * @brief Optimize the hyperparameters with L-BFGS and a backtracking line
+ *        search on the unconstrained hyperparameters. Blocks.
+ *
+ * Every trial point of the line search costs one factorization, most
+ * iterations accept the first one. Stops after hyperparams.opt_iter
+ * iterations, once the largest entry of the gradient or the decrease of the
+ * loss relative to max(1, |loss|) is at most hyperparams.tolerance, or if the
+ * line search finds no decrease.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param n_regressors number of regressors
+ * @param params initial hyperparameters, replaced by the optimized ones
+ * @param hyperparams optimizer settings
+ * @param trainable_params flags for lengthscale, vertical lengthscale, noise
+ * @param distance_cache cache of the squared distance tiles
+ *
+ * @return loss of the initial hyperparameters followed by the loss after
+ *         each iteration
+ */
+static std::vector<double>
+optimize_lbfgs_hpx(const std::vector<double> &training_input,
+                   const std::vector<double> &training_output,
+                   std::size_t n_tiles,
+                   std::size_t n_tile_size,
+                   std::size_t n_regressors,
+                   optimizer_parameters &params,
+                   const gpxpy_hyper::Hyperparameters &hyperparams,
+                   const std::vector<bool> &trainable_params,
+                   distance_tile_cache &distance_cache)
+{
+    // Armijo constant and maximum number of step halvings of the line search
+    constexpr double sufficient_decrease = 1e-4;
+    constexpr int max_halvings = 20;
+    if (hyperparams.tolerance < 0.0 || hyperparams.history <= 0)
     {
-        alpha_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_output, "assemble_tiled"), i, n_tile_size, training_output);
+        throw std::invalid_argument("L-BFGS requires a non-negative tolerance and a positive history");
     }
     // Assemble y
-    y_tiles.resize(n_tiles);
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles(n_tiles);
     for (std::size_t i = 0; i < n_tiles; i++)
     {
-        y_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_output, "assemble_tiled"), i, n_tile_size, training_output);
+        y_tiles[i] =
+            hpx::async(profiling::annotated_function(&gen_tile_output<double>, "assemble_y"),
+                       i,
+                       n_tile_size,
+                       training_output);
     }
 
-    //////////////////////////////////////////////////////////////////////////////
-    // Cholesky decomposition
-    right_looking_cholesky_tiled(K_tiles, n_tile_size, n_tiles);
-    // Triangular solve K_NxN * alpha = y
-    forward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
-    backward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
-    // Compute loss
-    compute_loss_tiled(K_tiles, alpha_tiles, y_tiles, loss_value, n_tile_size, n_tiles);
-    // Return loss
-    return loss_value;
+    std::vector<double> gradient;
+    double loss = evaluate_loss_gradient_hpx(training_input, training_output, y_tiles, n_tiles, n_tile_size, n_regressors, params, hyperparams, trainable_params, distance_cache, gradient);
+    std::vector<double> losses = { loss };
+    std::vector<std::vector<double>> steps;
+    std::vector<std::vector<double>> gradient_changes;
+    for (int iter = 0; iter < hyperparams.opt_iter; iter++)
+    {
+        double max_gradient = 0.0;
+        for (double g : gradient)
+        {
+            max_gradient = std::max(max_gradient, std::fabs(g));
+        }
+        if (max_gradient <= hyperparams.tolerance)
+        {
+            break;
+        }
+        std::vector<double> direction = lbfgs_direction(gradient, steps, gradient_changes);
+        double slope = std::inner_product(gradient.begin(), gradient.end(), direction.begin(), 0.0);
+        if (!(slope < 0.0))
+        {
+            // not a descent direction, restart from steepest descent
+            steps.clear();
+            gradient_changes.clear();
+            direction = lbfgs_direction(gradient, steps, gradient_changes);
+            slope = std::inner_product(gradient.begin(), gradient.end(), direction.begin(), 0.0);
+        }
+
+        // Backtracking line search on the unconstrained hyperparameters
+        std::vector<double> unconstrained(3);
+        for (int p = 0; p < 3; p++)
+        {
+            unconstrained[p] = to_unconstrained(params[p], p == 2);
+        }
+        optimizer_parameters trial = params;
+        std::vector<double> trial_gradient;
+        double trial_loss = loss;
+        double t = 1.0;
+        bool accepted = false;
+        for (int k = 0; k <= max_halvings; k++)
+        {
+            if (k > 0)
+            {
+                t *= 0.5;
+            }
+            for (int p = 0; p < 3; p++)
+            {
+                if (trainable_params[p])
+                {
+                    trial[p] = to_constrained(unconstrained[p] + t * direction[p], p == 2);
+                }
+            }
+            trial_loss = evaluate_loss_gradient_hpx(training_input, training_output, y_tiles, n_tiles, n_tile_size, n_regressors, trial, hyperparams, trainable_params, distance_cache, trial_gradient);
+            // a loss that is not finite means K lost positive definiteness
+            accepted = std::isfinite(trial_loss) && trial_loss <= loss + sufficient_decrease * t * slope;
+            if (accepted)
+            {
+                break;
+            }
+        }
+        if (!accepted)
+        {
+            break;
+        }
+
+        std::vector<double> step(3);
+        std::vector<double> gradient_change(3);
+        for (int p = 0; p < 3; p++)
+        {
+            step[p] = t * direction[p];
+            gradient_change[p] = trial_gradient[p] - gradient[p];
+        }
+        lbfgs_push(steps, gradient_changes, std::move(step), std::move(gradient_change), hyperparams.history);
+        const double decrease = loss - trial_loss;
+        params = trial;
+        loss = trial_loss;
+        gradient = std::move(trial_gradient);
+        losses.push_back(loss);
+        if (decrease <= hyperparams.tolerance * std::max(1.0, std::fabs(loss)))
+        {
+            break;
+        }
+    }
+    return losses;
 }
 
 // Perform optimization for a given number of iterations
@@ -583,35 +2174,33 @@ optimize_hpx(const std::vector<double> &training_input,
              double &vertical_lengthscale,
              double &noise_variance,
              int n_regressors,
+             const kernel_function &kernel,
              const gpxpy_hyper::Hyperparameters &hyperparams,
-             std::vector<bool> trainable_params)
+             std::vector<bool> trainable_params,
+             distance_tile_cache &distance_cache)
 {
-    double hyperparameters[7];
-    hyperparameters[0] = lengthscale;                // lengthscale
-    hyperparameters[1] = vertical_lengthscale;       // vertical_lengthscale
-    hyperparameters[2] = noise_variance;             // noise_variance
-    hyperparameters[3] = hyperparams.learning_rate;  // learning rate
-    hyperparameters[4] = hyperparams.beta1;          // beta1
-    hyperparameters[5] = hyperparams.beta2;          // beta2
-    hyperparameters[6] = hyperparams.epsilon;        // epsilon
+    const optimizer_parameters initial_params = make_optimizer_parameters(lengthscale, vertical_lengthscale, noise_variance, kernel, hyperparams);
+    if (hyperparams.optimizer == gpxpy_hyper::Optimizer::LBFGS)
+    {
+        optimizer_parameters params = initial_params;
+        std::vector<double> lbfgs_losses = optimize_lbfgs_hpx(training_input, training_output, n_tiles, n_tile_size, n_regressors, params, hyperparams, trainable_params, distance_cache);
+        lengthscale = params[0];
+        vertical_lengthscale = params[1];
+        noise_variance = params[2];
+        return hpx::make_ready_future(std::move(lbfgs_losses));
+    }
+    hpx::shared_future<optimizer_parameters> hyperparameters =
+        hpx::make_ready_future(initial_params);
     // declare data structures
     // tiled future data structures
-    std::vector<hpx::shared_future<std::vector<double>>> K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> grad_v_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> grad_l_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> grad_K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> grad_I_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> alpha_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> y_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles;
     // data holders for Adam
     std::vector<hpx::shared_future<double>> m_T;
     std::vector<hpx::shared_future<double>> v_T;
     std::vector<hpx::shared_future<double>> beta1_T;
     std::vector<hpx::shared_future<double>> beta2_T;
-    // data holder for loss
-    hpx::shared_future<double> loss_value;
     // data holder for computed loss values
-    std::vector<double> losses;
+    std::vector<hpx::shared_future<double>> losses;
     losses.resize(hyperparams.opt_iter);
     //////////////////////////////////////////////////////////////////////////////
     // Assemble beta1_t and beta2_t
@@ -619,18 +2208,18 @@ optimize_hpx(const std::vector<double> &training_input,
     for (int i = 0; i < hyperparams.opt_iter; i++)
     {
         beta1_T[i] =
-            hpx::async(hpx::annotated_function(&gen_beta_T, "assemble_tiled"),
+            hpx::async(profiling::annotated_function(&gen_beta_T, "assemble_tiled"),
                        i + 1,
-                       hyperparameters,
+                       initial_params,
                        4);
     }
     beta2_T.resize(hyperparams.opt_iter);
     for (int i = 0; i < hyperparams.opt_iter; i++)
     {
         beta2_T[i] =
-            hpx::async(hpx::annotated_function(&gen_beta_T, "assemble_tiled"),
+            hpx::async(profiling::annotated_function(&gen_beta_T, "assemble_tiled"),
                        i + 1,
-                       hyperparameters,
+                       initial_params,
                        5);
     }
     // Assemble first and second momemnt vectors: m_T and v_T
@@ -639,180 +2228,48 @@ optimize_hpx(const std::vector<double> &training_input,
     for (int i = 0; i < 3; i++)
     {
         m_T[i] =
-            hpx::async(hpx::annotated_function(&gen_zero, "assemble_tiled"));
+            hpx::async(profiling::annotated_function(&gen_zero, "assemble_tiled"));
         v_T[i] =
-            hpx::async(hpx::annotated_function(&gen_zero, "assemble_tiled"));
-    }
-    // Assemble y
-    y_tiles.resize(n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
-    {
-        y_tiles[i] =
-            hpx::async(hpx::annotated_function(&gen_tile_output, "assemble_y"),
-                       i,
-                       n_tile_size,
-                       training_output);
-    }
-
-    //////////////////////////////////////////////////////////////////////////////
-    // Perform optimization
-    for (int iter = 0; iter < hyperparams.opt_iter; iter++)
-    {
-        // Assemble covariance matrix vector, derivative of covariance matrix
-        // vector w.r.t. to vertical lengthscale and derivative of covariance
-        // matrix vector w.r.t. to lengthscale
-        K_tiles.resize(n_tiles * n_tiles);
-        grad_v_tiles.resize(n_tiles * n_tiles);
-        grad_l_tiles.resize(n_tiles * n_tiles);
-        for (std::size_t i = 0; i < n_tiles; i++)
-        {
-            for (std::size_t j = 0; j <= i; j++)
-            {
-                hpx::shared_future<std::vector<double>> cov_dists =
-                    hpx::async(hpx::annotated_function(&compute_cov_dist_vec,
-                                                       "assemble_cov_dist"),
-                               i,
-                               j,
-                               n_tile_size,
-                               n_regressors,
-                               hyperparameters,
-                               training_input);
-
-                K_tiles[i * n_tiles + j] =
-                    hpx::dataflow(hpx::annotated_function(
-                                      hpx::unwrapping(&gen_tile_covariance_opt),
-                                      "assemble_K"),
-                                  i,
-                                  j,
-                                  n_tile_size,
-                                  n_regressors,
-                                  hyperparameters,
-                                  cov_dists);
-
-                grad_v_tiles[i * n_tiles + j] = hpx::dataflow(
-                    hpx::annotated_function(hpx::unwrapping(&gen_tile_grad_v),
-                                            "assemble_gradv"),
-                    i,
-                    j,
-                    n_tile_size,
-                    n_regressors,
-                    hyperparameters,
-                    cov_dists);
-
-                grad_l_tiles[i * n_tiles + j] = hpx::dataflow(
-                    hpx::annotated_function(hpx::unwrapping(&gen_tile_grad_l),
-                                            "assemble_gradl"),
-                    i,
-                    j,
-                    n_tile_size,
-                    n_regressors,
-                    hyperparameters,
-                    cov_dists);
-
-                if (i != j)
-                {
-                    grad_v_tiles[j * n_tiles + i] = hpx::dataflow(
-                        hpx::annotated_function(
-                            hpx::unwrapping(&gen_tile_grad_v_trans),
-                            "assemble_gradv_t"),
-                        n_tile_size,
-                        grad_v_tiles[i * n_tiles + j]);
-
-                    grad_l_tiles[j * n_tiles + i] = hpx::dataflow(
-                        hpx::annotated_function(
-                            hpx::unwrapping(&gen_tile_grad_l_trans),
-                            "assemble_gradl_t"),
-                        n_tile_size,
-                        grad_l_tiles[i * n_tiles + j]);
-                }
-            }
-        }
-        // Assemble placeholder matrix for K^-1 * (I - y*y^T*K^-1)
-        grad_K_tiles.resize(n_tiles * n_tiles);
-        for (std::size_t i = 0; i < n_tiles; i++)
-        {
-            for (std::size_t j = 0; j < n_tiles; j++)
-            {
-                grad_K_tiles[i * n_tiles + j] =
-                    hpx::async(hpx::annotated_function(&gen_tile_identity,
-                                                       "assemble_tiled"),
-                               i,
-                               j,
-                               n_tile_size);
-            }
-        }
-        // Assemble alpha
-        alpha_tiles.resize(n_tiles);
-        for (std::size_t i = 0; i < n_tiles; i++)
-        {
-            alpha_tiles[i] = hpx::async(
-                hpx::annotated_function(&gen_tile_zeros, "assemble_tiled"),
-                n_tile_size);
-        }
-        // Assemble placeholder matrix for K^-1
-        grad_I_tiles.resize(n_tiles * n_tiles);
-        for (std::size_t i = 0; i < n_tiles; i++)
-        {
-            for (std::size_t j = 0; j < n_tiles; j++)
-            {
-                grad_I_tiles[i * n_tiles + j] = hpx::async(
-                    hpx::annotated_function(&gen_tile_identity,
-                                            "assemble_identity_matrix"),
-                    i,
-                    j,
-                    n_tile_size);
-            }
-        }
-
-        //////////////////////////////////////////////////////////////////////////////
-        // Cholesky decomposition
-        right_looking_cholesky_tiled(K_tiles, n_tile_size, n_tiles);
-        // Compute K^-1 through L*L^T*X = I
-        forward_solve_tiled_matrix(K_tiles, grad_I_tiles, n_tile_size, n_tile_size, n_tiles, n_tiles);
-        backward_solve_tiled_matrix(K_tiles, grad_I_tiles, n_tile_size, n_tile_size, n_tiles, n_tiles);
-
-        // Triangular solve K_NxN * alpha = y
-        // forward_solve_tiled(grad_I_tiles, alpha_tiles, n_tile_size, n_tiles);
-        // backward_solve_tiled(grad_I_tiles, alpha_tiles, n_tile_size,
-        // n_tiles);
-
-        // inv(K)*y
-        compute_gemm_of_invK_y(grad_I_tiles, y_tiles, alpha_tiles, n_tile_size, n_tiles);
-
-        // Compute loss
-        compute_loss_tiled(K_tiles, alpha_tiles, y_tiles, loss_value, n_tile_size, n_tiles);
-        losses[iter] = loss_value.get();
-
-        // Compute I-y*y^T*inv(K) -> NxN matrix
-        // update_grad_K_tiled(grad_K_tiles, y_tiles, alpha_tiles, n_tile_size,
-        // n_tiles);
-
-        // Compute K^-1 *(I - y*y^T*K^-1)
-        // forward_solve_tiled_matrix(K_tiles, grad_K_tiles, n_tile_size,
-        // n_tile_size, n_tiles, n_tiles); backward_solve_tiled_matrix(K_tiles,
-        // grad_K_tiles, n_tile_size, n_tile_size, n_tiles, n_tiles);
+            hpx::async(profiling::annotated_function(&gen_zero, "assemble_tiled"));
+    }
+    // Assemble y
+    y_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        y_tiles[i] =
+            hpx::async(profiling::annotated_function(&gen_tile_output<double>, "assemble_y"),
+                       i,
+                       n_tile_size,
+                       training_output);
+    }
 
-        // Update the hyperparameters
-        if (trainable_params[0])
-        {  // lengthscale
-            update_hyperparameter(grad_I_tiles, grad_l_tiles, alpha_tiles, hyperparameters, n_tile_size, n_tiles, m_T, v_T, beta1_T, beta2_T, 0, 0);
-        }
-        if (trainable_params[1])
-        {  // vertical_lengthscale
-            update_hyperparameter(grad_I_tiles, grad_v_tiles, alpha_tiles, hyperparameters, n_tile_size, n_tiles, m_T, v_T, beta1_T, beta2_T, 0, 1);
-        }
-        if (trainable_params[2])
-        {  // noise_variance
-            update_noise_variance(grad_I_tiles, alpha_tiles, hyperparameters, n_tile_size, n_tiles, m_T, v_T, beta1_T, beta2_T, iter);
+    //////////////////////////////////////////////////////////////////////////////
+    // Perform optimization
+    for (int iter = 0; iter < hyperparams.opt_iter; iter++)
+    {
+        // Bound the task graph to a few iterations in flight. The assembly of
+        // iteration k+1 still starts as soon as the update of iteration k
+        // resolves.
+        if (iter >= OPTIMIZER_LOOKAHEAD)
+        {
+            losses[iter - OPTIMIZER_LOOKAHEAD].wait();
         }
+        optimizer_tiles tiles;
+        assemble_optimizer_tiles_hpx(training_input, n_tiles, n_tile_size, n_regressors, hyperparameters, trainable_params, distance_cache, tiles);
+        losses[iter] = optimizer_iteration_hpx(training_output, y_tiles, n_tiles, n_tile_size, hyperparameters, hyperparams, trainable_params, m_T, v_T, beta1_T, beta2_T, iter, iter, tiles);
     }
     // Update hyperparameter attributes in Gaussian process model
-    lengthscale = hyperparameters[0];
-    vertical_lengthscale = hyperparameters[1];
-    noise_variance = hyperparameters[2];
+    const optimizer_parameters &final_params = hyperparameters.get();
+    lengthscale = final_params[0];
+    vertical_lengthscale = final_params[1];
+    noise_variance = final_params[2];
     // Return losses
-    return hpx::async([losses]()
-                      { return losses; });
+    return hpx::dataflow(
+        profiling::annotated_function(
+            hpx::unwrapping([](const std::vector<double> &loss_values)
+                            { return loss_values; }),
+            "collect_losses"),
+        losses);
 }
 
 // Perform a single optimization step
@@ -825,36 +2282,29 @@ optimize_step_hpx(const std::vector<double> &training_input,
                   double &vertical_lengthscale,
                   double &noise_variance,
                   int n_regressors,
+                  const kernel_function &kernel,
                   gpxpy_hyper::Hyperparameters &hyperparams,
                   std::vector<bool> trainable_params,
-                  int iter)
+                  int iter,
+                  distance_tile_cache &distance_cache)
 {
-    double hyperparameters[7];
-    hyperparameters[0] = lengthscale;                // lengthscale
-    hyperparameters[1] = vertical_lengthscale;       // vertical_lengthscale
-    hyperparameters[2] = noise_variance;             // noise_variance
-    hyperparameters[3] = hyperparams.learning_rate;  // learning rate
-    hyperparameters[4] = hyperparams.beta1;          // beta1
-    hyperparameters[5] = hyperparams.beta2;          // beta2
-    hyperparameters[6] = hyperparams.epsilon;        // epsilon
+    if (hyperparams.optimizer != gpxpy_hyper::Optimizer::Adam)
+    {
+        throw std::invalid_argument("a single optimization step supports only the Adam optimizer");
+    }
+    const optimizer_parameters initial_params = make_optimizer_parameters(lengthscale, vertical_lengthscale, noise_variance, kernel, hyperparams);
+    hpx::shared_future<optimizer_parameters> hyperparameters =
+        hpx::make_ready_future(initial_params);
     // declare data structures
     // tiled future data structures
-    std::vector<hpx::shared_future<std::vector<double>>> K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> grad_v_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> grad_l_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> grad_K_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> grad_I_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> alpha_tiles;
-    std::vector<hpx::shared_future<std::vector<double>>> y_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles;
     // data holders for Adam
     std::vector<hpx::shared_future<double>> m_T;
     std::vector<hpx::shared_future<double>> v_T;
     std::vector<hpx::shared_future<double>> beta1_T;
     std::vector<hpx::shared_future<double>> beta2_T;
-    // data holder for loss
-    hpx::shared_future<double> loss_value;
     // make shared future
-    for (std::size_t i; i < 3; i++)
+    for (std::size_t i = 0; i < 3; i++)
     {
         hpx::shared_future<double> m =
             hpx::make_ready_future(hyperparams.M_T[i]);  //.share();
@@ -867,149 +2317,623 @@ optimize_step_hpx(const std::vector<double> &training_input,
     // Assemble beta1_t and beta2_t
     beta1_T.resize(1);
     beta1_T[0] =
-        hpx::async(hpx::annotated_function(&gen_beta_T, "assemble_tiled"),
+        hpx::async(profiling::annotated_function(&gen_beta_T, "assemble_tiled"),
                    iter + 1,
-                   hyperparameters,
+                   initial_params,
                    4);
     beta2_T.resize(1);
     beta2_T[0] =
-        hpx::async(hpx::annotated_function(&gen_beta_T, "assemble_tiled"),
+        hpx::async(profiling::annotated_function(&gen_beta_T, "assemble_tiled"),
                    iter + 1,
-                   hyperparameters,
+                   initial_params,
                    5);
-    // Assemble covariance matrix vector
-    K_tiles.resize(n_tiles * n_tiles);
+    // Assemble y
+    y_tiles.resize(n_tiles);
     for (std::size_t i = 0; i < n_tiles; i++)
     {
-        for (std::size_t j = 0; j <= i; j++)
-        {
-            K_tiles[i * n_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_covariance, "assemble_tiled"),
-                i,
-                j,
-                n_tile_size,
-                n_regressors,
-                hyperparameters,
-                training_input);
-        }
+        y_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_tiled"), i, n_tile_size, training_output);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Perform optimization step
+    optimizer_tiles tiles;
+    assemble_optimizer_tiles_hpx(training_input, n_tiles, n_tile_size, n_regressors, hyperparameters, trainable_params, distance_cache, tiles);
+    hpx::shared_future<double> loss = optimizer_iteration_hpx(training_output, y_tiles, n_tiles, n_tile_size, hyperparameters, hyperparams, trainable_params, m_T, v_T, beta1_T, beta2_T, 0, iter, tiles);
+
+    // Update hyperparameter attributes in Gaussian process model
+    const optimizer_parameters &updated_params = hyperparameters.get();
+    lengthscale = updated_params[0];
+    vertical_lengthscale = updated_params[1];
+    noise_variance = updated_params[2];
+    // Update hyperparameter attributes (first and second moment) for Adam
+    for (std::size_t i = 0; i < 3; i++)
+    {
+        hyperparams.M_T[i] = m_T[i].get();
+        hyperparams.V_T[i] = v_T[i].get();
+    }
+
+    // Return loss value
+    return loss;
+}
+
+// Initialize an optimizer session for the given hyperparameters
+void init_optimizer_session_hpx(optimizer_session_state &state,
+                                const std::vector<double> &training_output,
+                                int n_tiles,
+                                int n_tile_size,
+                                double lengthscale,
+                                double vertical_lengthscale,
+                                double noise_variance,
+                                const kernel_function &kernel,
+                                const gpxpy_hyper::Hyperparameters &hyperparams)
+{
+    if (hyperparams.optimizer != gpxpy_hyper::Optimizer::Adam)
+    {
+        throw std::invalid_argument("an optimizer session supports only the Adam optimizer");
+    }
+    state.hyperparameters = hpx::make_ready_future(
+        make_optimizer_parameters(lengthscale, vertical_lengthscale, noise_variance, kernel, hyperparams));
+    update_optimizer_session_data(state, training_output, n_tiles, n_tile_size);
+    state.data_generation = 0;
+    // Adam moments
+    state.m_T.clear();
+    state.v_T.clear();
+    for (std::size_t i = 0; i < 3; i++)
+    {
+        state.m_T.push_back(hpx::make_ready_future(hyperparams.M_T[i]));
+        state.v_T.push_back(hpx::make_ready_future(hyperparams.V_T[i]));
+    }
+    state.iter = 0;
+}
+
+// Perform one optimization step of a session
+hpx::shared_future<double> optimizer_session_step_hpx(optimizer_session_state &state,
+                                  const std::vector<double> &training_input,
+                                  const std::vector<double> &training_output,
+                                  int n_tiles,
+                                  int n_tile_size,
+                                  int n_regressors,
+                                  const gpxpy_hyper::Hyperparameters &hyperparams,
+                                  const std::vector<bool> &trainable_params,
+                                  distance_tile_cache &distance_cache)
+{
+    hpx::shared_future<optimizer_parameters> &hyperparameters = state.hyperparameters;
+    if (state.assembled && (state.trainable_params != trainable_params || state.n_regressors != n_regressors))
+    {
+        // changed between steps, e.g. for staged training
+        discard_optimizer_session_tiles(state);
     }
-    // Assemble derivative of covariance matrix vector w.r.t. to vertical
-    // lengthscale
-    grad_v_tiles.resize(n_tiles * n_tiles);
+    if (!state.assembled)
+    {
+        assemble_optimizer_tiles_hpx(training_input, n_tiles, n_tile_size, n_regressors, hyperparameters, trainable_params, distance_cache, state.next_tiles);
+    }
+    state.assembled = false;
+    // Powers of beta1 and beta2 for this step only
+    std::vector<hpx::shared_future<double>> beta1_T{ hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&gen_beta_T), "assemble_tiled"),
+        state.iter + 1,
+        hyperparameters,
+        4) };
+    std::vector<hpx::shared_future<double>> beta2_T{ hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&gen_beta_T), "assemble_tiled"),
+        state.iter + 1,
+        hyperparameters,
+        5) };
+    hpx::shared_future<double> loss = optimizer_iteration_hpx(training_output, state.y_tiles, n_tiles, n_tile_size, hyperparameters, hyperparams, trainable_params, state.m_T, state.v_T, beta1_T, beta2_T, 0, state.iter, state.next_tiles);
+    state.iter++;
+
+    // The assembly of the next step starts as soon as the updated
+    // hyperparameters resolve, while the caller processes the loss
+    assemble_optimizer_tiles_hpx(training_input, n_tiles, n_tile_size, n_regressors, hyperparameters, trainable_params, distance_cache, state.next_tiles);
+    state.assembled = true;
+    state.trainable_params = trainable_params;
+    state.n_regressors = n_regressors;
+    return loss;
+}
+
+// Drop the tiles scheduled ahead by a session step
+void discard_optimizer_session_tiles(optimizer_session_state &state)
+{
+    state.next_tiles = optimizer_tiles();
+    state.assembled = false;
+}
+
+// Reassemble the output tiles of a session and drop the tiles scheduled ahead
+void update_optimizer_session_data(optimizer_session_state &state,
+                                   const std::vector<double> &training_output,
+                                   int n_tiles,
+                                   int n_tile_size)
+{
+    discard_optimizer_session_tiles(state);
+    // Assemble y
+    state.y_tiles.resize(n_tiles);
     for (std::size_t i = 0; i < n_tiles; i++)
     {
-        for (std::size_t j = 0; j < n_tiles; j++)
+        state.y_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_output<double>, "assemble_y"), i, n_tile_size, training_output);
+    }
+    state.n_tiles = n_tiles;
+    state.n_tile_size = n_tile_size;
+}
+
+/**
+ * @brief Generate a tile row of the training outputs `columns`, one column per
+ *        output, zero past the last sample.
+ */
+static mutable_tile_data<double>
+gen_tile_outputs(std::size_t row,
+                 std::size_t N,
+                 const std::vector<std::vector<double>> &outputs,
+                 const std::vector<std::size_t> &columns)
+{
+    const std::size_t M = columns.size();
+    mutable_tile_data<double> tile(N * M);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        const std::size_t i_global = N * row + i;
+        for (std::size_t c = 0; c < M; c++)
         {
-            grad_v_tiles[i * n_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_grad_v, "assemble_tiled"), i, j, n_tile_size, n_regressors, hyperparameters, training_input);
+            const std::vector<double> &output = outputs[columns[c]];
+            tile[i * M + c] = i_global < output.size() ? output[i_global] : 0.0;
         }
     }
-    // Assemble derivative of covariance matrix vector w.r.t. to lengthscale
-    grad_l_tiles.resize(n_tiles * n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
+    return tile;
+}
+
+/**
+ * @brief Returns the loss terms of one diagonal tile for each of the M
+ *        columns of alpha and y: y^T * alpha plus the log determinant of the
+ *        tile.
+ */
+static std::vector<double>
+compute_losses_tile(const const_tile_data<double> &K_diag_tile,
+                    const const_tile_data<double> &alpha_tile,
+                    const const_tile_data<double> &y_tile,
+                    std::size_t N,
+                    std::size_t M)
+{
+    double log_det = 0.0;
+    for (std::size_t i = 0; i < N; i++)
     {
-        for (std::size_t j = 0; j < n_tiles; j++)
+        log_det += log(K_diag_tile[i * N + i] * K_diag_tile[i * N + i]);
+    }
+    std::vector<double> l(M, log_det);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        for (std::size_t c = 0; c < M; c++)
         {
-            grad_l_tiles[i * n_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_grad_l, "assemble_tiled"), i, j, n_tile_size, n_regressors, hyperparameters, training_input);
+            l[c] += y_tile[i * M + c] * alpha_tile[i * M + c];
         }
     }
-    // Assemble matrix that will be multiplied with derivates
-    grad_K_tiles.resize(n_tiles * n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
+    return l;
+}
+
+/**
+ * @brief Returns the loss of each column from the loss terms of all tiles,
+ *        see add_losses.
+ */
+static std::vector<double>
+add_losses_batched(const std::vector<std::vector<double>> &losses, std::size_t n_samples)
+{
+    std::vector<double> l(losses.front().size(), 0.0);
+    for (const std::vector<double> &tile_losses : losses)
     {
-        for (std::size_t j = 0; j < n_tiles; j++)
+        for (std::size_t c = 0; c < l.size(); c++)
         {
-            grad_K_tiles[i * n_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_identity, "assemble_tiled"),
-                i,
-                j,
-                n_tile_size);
+            l[c] += tile_losses[c];
         }
     }
-    // Assemble alpha
-    alpha_tiles.resize(n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
+    for (double &loss : l)
     {
-        alpha_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_output, "assemble_tiled"), i, n_tile_size, training_output);
+        loss = 0.5 * (loss + n_samples * log(2.0 * M_PI)) / n_samples;
     }
-    // Assemble y
-    y_tiles.resize(n_tiles);
-    for (std::size_t i = 0; i < n_tiles; i++)
+    return l;
+}
+
+/**
+ * @brief Compute the Cholesky factor and alpha of every fit in one task graph.
+ *
+ * Each squared distance tile is requested once from distance_cache and scaled
+ * into the covariance tiles of all fits, whose factorizations then run
+ * concurrently. The outputs of a fit are solved as one multi-column
+ * right-hand side with forward_solve_tiled_matrix and
+ * backward_solve_tiled_matrix. Does not block.
+ *
+ * @param training_input training input data
+ * @param training_outputs training outputs, indexed by batched_fit::outputs
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param n_regressors number of regressors
+ * @param distance_cache cache of the squared distance tiles
+ * @param fits hyperparameters and outputs of the fits, receive the tiles
+ */
+void fit_batched_hpx(const std::vector<double> &training_input,
+                     const std::vector<std::vector<double>> &training_outputs,
+                     int n_tiles,
+                     int n_tile_size,
+                     int n_regressors,
+                     distance_tile_cache &distance_cache,
+                     std::vector<batched_fit> &fits)
+{
+    std::vector<hpx::shared_future<optimizer_parameters>> hyperparameters(fits.size());
+    for (std::size_t f = 0; f < fits.size(); f++)
     {
-        y_tiles[i] = hpx::async(
-            hpx::annotated_function(&gen_tile_output, "assemble_tiled"), i, n_tile_size, training_output);
+        optimizer_parameters params = {};
+        params[0] = fits[f].params[0];  // lengthscale
+        params[1] = fits[f].params[1];  // vertical_lengthscale
+        params[2] = fits[f].params[2];  // noise_variance
+        hyperparameters[f] = hpx::make_ready_future(params);
+        fits[f].K_tiles.assign(n_tiles * n_tiles, {});
+        fits[f].alpha_tiles.assign(n_tiles, {});
     }
-    // Assemble placeholder matrix for K^-1
-    grad_I_tiles.resize(n_tiles * n_tiles);
+
+    // Assemble the covariance matrices of all fits from the same distances
     for (std::size_t i = 0; i < n_tiles; i++)
     {
-        for (std::size_t j = 0; j < n_tiles; j++)
+        for (std::size_t j = 0; j <= i; j++)
         {
-            grad_I_tiles[i * n_tiles + j] =
-                hpx::async(hpx::annotated_function(&gen_tile_identity,
-                                                   "assemble_identity_matrix"),
-                           i,
-                           j,
-                           n_tile_size);
+            hpx::shared_future<mutable_tile_data<double>> cov_dists =
+                distance_cache.tile(i, j, n_tiles, n_tile_size, n_regressors, training_input);
+            for (std::size_t f = 0; f < fits.size(); f++)
+            {
+                fits[f].K_tiles[i * n_tiles + j] =
+                    hpx::dataflow(profiling::annotated_function(
+                                      hpx::unwrapping(&gen_tile_covariance_opt),
+                                      "assemble_K"),
+                                  i,
+                                  j,
+                                  n_tile_size,
+                                  n_regressors,
+                                  training_input.size(),
+                                  hyperparameters[f],
+                                  cov_dists);
+            }
         }
     }
-    //////////////////////////////////////////////////////////////////////////////
-    // Cholesky decomposition
-    right_looking_cholesky_tiled(K_tiles, n_tile_size, n_tiles);
-    // Triangular solve K_NxN * alpha = y
-    forward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
-    backward_solve_tiled(K_tiles, alpha_tiles, n_tile_size, n_tiles);
-
-    // Compute K^-1 through L*L^T*X = I
-    forward_solve_tiled_matrix(K_tiles, grad_I_tiles, n_tile_size, n_tile_size, n_tiles, n_tiles);
-    backward_solve_tiled_matrix(K_tiles, grad_I_tiles, n_tile_size, n_tile_size, n_tiles, n_tiles);
-
-    // Compute loss
-    compute_loss_tiled(K_tiles, alpha_tiles, y_tiles, loss_value, n_tile_size, n_tiles);
 
-    // // Fill I-y*y^T*inv(K)
-    // update_grad_K_tiled(grad_K_tiles, y_tiles, alpha_tiles, n_tile_size,
-    // n_tiles);
+    for (batched_fit &fit : fits)
+    {
+        // Calculate Cholesky decomposition
+        cholesky_tiled(fit.K_tiles, n_tile_size, n_tiles);
+        // Triangular solves K_NxN * alpha = Y for all outputs at once
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            fit.alpha_tiles[i] = hpx::async(
+                profiling::annotated_function(&gen_tile_outputs, "assemble_y"), i, n_tile_size, training_outputs, fit.outputs);
+        }
+        forward_solve_tiled_matrix(fit.K_tiles, fit.alpha_tiles, n_tile_size, fit.outputs.size(), n_tiles, 1);
+        backward_solve_tiled_matrix(fit.K_tiles, fit.alpha_tiles, n_tile_size, fit.outputs.size(), n_tiles, 1);
+    }
+}
 
-    // // Compute K^-1 * (I-y*y^T*K^-1)
-    // forward_solve_tiled_matrix(K_tiles, grad_K_tiles, n_tile_size,
-    // n_tile_size, n_tiles, n_tiles); backward_solve_tiled_matrix(K_tiles,
-    // grad_K_tiles, n_tile_size, n_tile_size, n_tiles, n_tiles);
+/**
+ * @brief Compute the predictions of every member of the fits.
+ *
+ * The cross-covariance tiles of a fit are assembled once for all its outputs,
+ * whose means are computed as one matrix product. The variance only depends
+ * on the hyperparameters and is computed once per fit.
+ *
+ * @param training_input training input data
+ * @param test_input test input data
+ * @param fits fitted batch, see fit_batched_hpx
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of each test tile
+ * @param n_regressors number of regressors
+ * @param uncertainty also compute the variances
+ *
+ * @return the mean and optionally the variance of each output of each fit,
+ *         in the order of the fits and their outputs
+ */
+hpx::shared_future<std::vector<std::vector<std::vector<double>>>>
+predict_batched_hpx(const std::vector<double> &training_input,
+                    const std::vector<double> &test_input,
+                    const std::vector<batched_fit> &fits,
+                    int n_tiles,
+                    int n_tile_size,
+                    int m_tiles,
+                    int m_tile_size,
+                    int n_regressors,
+                    bool uncertainty)
+{
+    // the tile generators keep a pointer to the hyperparameters
+    std::vector<std::array<double, 3>> hyperparameters(fits.size());
+    std::vector<std::vector<hpx::shared_future<mutable_tile_data<double>>>> prediction_tiles(fits.size());
+    std::vector<std::vector<hpx::shared_future<mutable_tile_data<double>>>> prediction_uncertainty_tiles(fits.size());
+    for (std::size_t f = 0; f < fits.size(); f++)
+    {
+        hyperparameters[f] = fits[f].params;
+        const std::size_t n_outputs = fits[f].outputs.size();
+        // Assemble MxN cross-covariance matrix vector
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> cross_covariance_tiles(m_tiles * n_tiles);
+        for (std::size_t i = 0; i < m_tiles; i++)
+        {
+            for (std::size_t j = 0; j < n_tiles; j++)
+            {
+                cross_covariance_tiles[i * n_tiles + j] =
+                    hpx::async(profiling::annotated_function(&gen_tile_cross_covariance<double>,
+                                                             "assemble_pred"),
+                               i,
+                               j,
+                               m_tile_size,
+                               n_tile_size,
+                               n_regressors,
+                               hyperparameters[f].data(),
+                               kernel_function(),
+                               test_input,
+                               training_input);
+            }
+        }
+        // Assemble placeholder for prediction, one column per output
+        prediction_tiles[f].resize(m_tiles);
+        for (std::size_t i = 0; i < m_tiles; i++)
+        {
+            prediction_tiles[f][i] = hpx::async(
+                profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+                m_tile_size * n_outputs);
+        }
+        //// Compute predictions
+        prediction_tiled_matrix(cross_covariance_tiles, fits[f].alpha_tiles, prediction_tiles[f], m_tile_size, n_tile_size, n_outputs, n_tiles, m_tiles);
+        if (!uncertainty)
+        {
+            continue;
+        }
 
-    // Update the hyperparameters
-    if (trainable_params[0])
-    {  // lengthscale
-        update_hyperparameter(grad_I_tiles, grad_l_tiles, alpha_tiles, hyperparameters, n_tile_size, n_tiles, m_T, v_T, beta1_T, beta2_T, 0, 0);
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> L_tiles = fits[f].K_tiles;
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> prior_K_tiles(m_tiles);
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> prior_inter_tiles(m_tiles);
+        std::vector<hpx::shared_future<mutable_tile_data<double>>> t_cross_covariance_tiles(n_tiles * m_tiles);
+        prediction_uncertainty_tiles[f].resize(m_tiles);
+        for (std::size_t i = 0; i < m_tiles; i++)
+        {
+            prior_K_tiles[i] = hpx::async(
+                profiling::annotated_function(&gen_tile_prior_covariance<double>,
+                                              "assemble_tiled"),
+                i,
+                i,
+                m_tile_size,
+                n_regressors,
+                hyperparameters[f].data(),
+                kernel_function(),
+                test_input);
+            prior_inter_tiles[i] =
+                hpx::async(profiling::annotated_function(&gen_tile_zeros_diag,
+                                                         "assemble_prior_inter"),
+                           m_tile_size);
+            prediction_uncertainty_tiles[f][i] = hpx::async(
+                profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+                m_tile_size);
+            for (std::size_t j = 0; j < n_tiles; j++)
+            {
+                t_cross_covariance_tiles[j * m_tiles + i] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gen_tile_cross_cov_T<double>),
+                                                  "assemble_pred"),
+                    m_tile_size,
+                    n_tile_size,
+                    cross_covariance_tiles[i * n_tiles + j]);
+            }
+        }
+        //// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
+        forward_solve_KcK_tiled(L_tiles, t_cross_covariance_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+        // posterior covariance matrix - (K_MxN * K^-1_NxN) * K_NxM
+        posterior_covariance_tiled(t_cross_covariance_tiles, prior_inter_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+        //// Compute predicition uncertainty
+        prediction_uncertainty_tiled(prior_K_tiles, prior_inter_tiles, prediction_uncertainty_tiles[f], m_tile_size, m_tiles);
     }
 
-    if (trainable_params[1])
-    {  // vertical_lengthscale
-        update_hyperparameter(grad_K_tiles, grad_v_tiles, alpha_tiles, hyperparameters, n_tile_size, n_tiles, m_T, v_T, beta1_T, beta2_T, 0, 1);
+    //// Get predictions and uncertainty to return them
+    std::vector<std::vector<std::vector<double>>> result;
+    for (std::size_t f = 0; f < fits.size(); f++)
+    {
+        const std::size_t n_outputs = fits[f].outputs.size();
+        std::vector<double> pred_var;
+        if (uncertainty)
+        {
+            pred_var.reserve(test_input.size());
+            for (std::size_t i = 0; i < m_tiles; i++)
+            {
+                pred_var.insert(pred_var.end(),
+                                prediction_uncertainty_tiles[f][i].get().begin(),
+                                prediction_uncertainty_tiles[f][i].get().end());
+            }
+            // drop the padding of the last tile
+            pred_var.resize(test_input.size());
+        }
+        for (std::size_t o = 0; o < n_outputs; o++)
+        {
+            std::vector<double> pred(test_input.size());
+            for (std::size_t k = 0; k < test_input.size(); k++)
+            {
+                const mutable_tile_data<double> &tile = prediction_tiles[f][k / m_tile_size].get();
+                pred[k] = tile[(k % m_tile_size) * n_outputs + o];
+            }
+            result.push_back({ std::move(pred) });
+            if (uncertainty)
+            {
+                result.back().push_back(pred_var);
+            }
+        }
     }
+    return hpx::make_ready_future(std::move(result));
+}
 
-    if (trainable_params[2])
-    {  // noise_variance
-        update_noise_variance(grad_K_tiles, alpha_tiles, hyperparameters, n_tile_size, n_tiles, m_T, v_T, beta1_T, beta2_T, 0);
+/**
+ * @brief Compute the loss of every member of the fits from their Cholesky
+ *        factors and alpha.
+ *
+ * @param training_outputs training outputs, indexed by batched_fit::outputs
+ * @param fits fitted batch, see fit_batched_hpx
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ *
+ * @return result[f][o] the loss of output o of fit f
+ */
+hpx::shared_future<std::vector<std::vector<double>>>
+compute_loss_batched_hpx(const std::vector<std::vector<double>> &training_outputs,
+                         const std::vector<batched_fit> &fits,
+                         int n_tiles,
+                         int n_tile_size)
+{
+    const std::size_t n_samples = training_outputs.front().size();
+    std::vector<hpx::shared_future<std::vector<double>>> losses(fits.size());
+    for (std::size_t f = 0; f < fits.size(); f++)
+    {
+        std::vector<hpx::shared_future<std::vector<double>>> loss_tiled(n_tiles);
+        for (std::size_t k = 0; k < n_tiles; k++)
+        {
+            hpx::shared_future<mutable_tile_data<double>> y_tile = hpx::async(
+                profiling::annotated_function(&gen_tile_outputs, "assemble_y"), k, n_tile_size, training_outputs, fits[f].outputs);
+            loss_tiled[k] =
+                hpx::dataflow(profiling::annotated_function(
+                                  hpx::unwrapping(&compute_losses_tile), "loss_tiled"),
+                              fits[f].K_tiles[k * n_tiles + k],
+                              fits[f].alpha_tiles[k],
+                              y_tile,
+                              n_tile_size,
+                              fits[f].outputs.size());
+        }
+        losses[f] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&add_losses_batched), "loss_tiled"),
+            loss_tiled,
+            n_samples);
     }
+    return hpx::dataflow(
+        profiling::annotated_function(
+            hpx::unwrapping([](const std::vector<std::vector<double>> &loss_values)
+                            { return loss_values; }),
+            "collect_losses"),
+        losses);
+}
 
-    // Update hyperparameter attributes in Gaussian process model
-    lengthscale = hyperparameters[0];
-    // printf("lengthscale: %.12lf\n", lengthscale);
-    vertical_lengthscale = hyperparameters[1];
-    noise_variance = hyperparameters[2];
-    // Update hyperparameter attributes (first and second moment) for Adam
-    for (std::size_t i; i < 3; i++)
+/**
+ * @brief Optimize the hyperparameters of every member of a batch.
+ *
+ * The members are optimized independently with Adam, as optimize_hpx does for
+ * a single GP, but their iterations are scheduled into one task graph. All
+ * members request the same squared distance tiles from distance_cache, so
+ * the distances of the cached tiles are computed once for the whole batch.
+ * Each member has its own factorization, as the hyperparameters of the
+ * members diverge after the first step.
+ *
+ * @param training_input training input data
+ * @param training_outputs training outputs
+ * @param member_outputs index of the training output of each member
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param member_params lengthscale, vertical lengthscale and noise variance of
+ *        each member, replaced by the optimized values
+ * @param n_regressors number of regressors
+ * @param hyperparams optimizer settings
+ * @param trainable_params flags for lengthscale, vertical lengthscale, noise
+ * @param distance_cache cache of the squared distance tiles
+ *
+ * @return the losses of each member
+ */
+hpx::shared_future<std::vector<std::vector<double>>>
+optimize_batched_hpx(const std::vector<double> &training_input,
+                     const std::vector<std::vector<double>> &training_outputs,
+                     const std::vector<std::size_t> &member_outputs,
+                     int n_tiles,
+                     int n_tile_size,
+                     std::vector<std::array<double, 3>> &member_params,
+                     int n_regressors,
+                     const gpxpy_hyper::Hyperparameters &hyperparams,
+                     const std::vector<bool> &trainable_params,
+                     distance_tile_cache &distance_cache)
+{
+    if (hyperparams.optimizer != gpxpy_hyper::Optimizer::Adam)
     {
-        hyperparams.M_T[i] = m_T[i].get();
-        hyperparams.V_T[i] = v_T[i].get();
+        throw std::invalid_argument("batched optimization supports only the Adam optimizer");
+    }
+    const std::size_t n_members = member_outputs.size();
+    // data holders per member
+    std::vector<hpx::shared_future<optimizer_parameters>> hyperparameters(n_members);
+    std::vector<std::vector<hpx::shared_future<mutable_tile_data<double>>>> y_tiles(n_members);
+    std::vector<std::vector<hpx::shared_future<double>>> m_T(n_members);
+    std::vector<std::vector<hpx::shared_future<double>>> v_T(n_members);
+    std::vector<std::vector<hpx::shared_future<double>>> losses(n_members);
+    // powers of beta1 and beta2, the same for all members
+    const optimizer_parameters adam_params = make_optimizer_parameters(0.0, 0.0, 0.0, kernel_function(), hyperparams);
+    std::vector<hpx::shared_future<double>> beta1_T(hyperparams.opt_iter);
+    std::vector<hpx::shared_future<double>> beta2_T(hyperparams.opt_iter);
+    for (int i = 0; i < hyperparams.opt_iter; i++)
+    {
+        beta1_T[i] =
+            hpx::async(profiling::annotated_function(&gen_beta_T, "assemble_tiled"),
+                       i + 1,
+                       adam_params,
+                       4);
+        beta2_T[i] =
+            hpx::async(profiling::annotated_function(&gen_beta_T, "assemble_tiled"),
+                       i + 1,
+                       adam_params,
+                       5);
+    }
+    for (std::size_t m = 0; m < n_members; m++)
+    {
+        hyperparameters[m] = hpx::make_ready_future(
+            make_optimizer_parameters(member_params[m][0], member_params[m][1], member_params[m][2], kernel_function(), hyperparams));
+        m_T[m].resize(3);
+        v_T[m].resize(3);
+        for (int i = 0; i < 3; i++)
+        {
+            m_T[m][i] =
+                hpx::async(profiling::annotated_function(&gen_zero, "assemble_tiled"));
+            v_T[m][i] =
+                hpx::async(profiling::annotated_function(&gen_zero, "assemble_tiled"));
+        }
+        y_tiles[m].resize(n_tiles);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            y_tiles[m][i] =
+                hpx::async(profiling::annotated_function(&gen_tile_output<double>, "assemble_y"),
+                           i,
+                           n_tile_size,
+                           training_outputs[member_outputs[m]]);
+        }
+        losses[m].resize(hyperparams.opt_iter);
     }
 
-    // Return loss value
-    double loss = loss_value.get();
-    return hpx::async([loss]()
-                      { return loss; });
+    //////////////////////////////////////////////////////////////////////////////
+    // Perform optimization
+    for (int iter = 0; iter < hyperparams.opt_iter; iter++)
+    {
+        // Bound the task graph to a few iterations in flight
+        if (iter >= OPTIMIZER_LOOKAHEAD)
+        {
+            for (std::size_t m = 0; m < n_members; m++)
+            {
+                losses[m][iter - OPTIMIZER_LOOKAHEAD].wait();
+            }
+        }
+        for (std::size_t m = 0; m < n_members; m++)
+        {
+            optimizer_tiles tiles;
+            assemble_optimizer_tiles_hpx(training_input, n_tiles, n_tile_size, n_regressors, hyperparameters[m], trainable_params, distance_cache, tiles);
+            losses[m][iter] = optimizer_iteration_hpx(training_outputs[member_outputs[m]], y_tiles[m], n_tiles, n_tile_size, hyperparameters[m], hyperparams, trainable_params, m_T[m], v_T[m], beta1_T, beta2_T, iter, iter, tiles);
+        }
+    }
+    // Update the hyperparameters of the members
+    std::vector<hpx::shared_future<std::vector<double>>> member_losses(n_members);
+    for (std::size_t m = 0; m < n_members; m++)
+    {
+        const optimizer_parameters &final_params = hyperparameters[m].get();
+        member_params[m] = { final_params[0], final_params[1], final_params[2] };
+        member_losses[m] = hpx::dataflow(
+            profiling::annotated_function(
+                hpx::unwrapping([](const std::vector<double> &loss_values)
+                                { return loss_values; }),
+                "collect_losses"),
+            losses[m]);
+    }
+    return hpx::dataflow(
+        profiling::annotated_function(
+            hpx::unwrapping([](const std::vector<std::vector<double>> &loss_values)
+                            { return loss_values; }),
+            "collect_losses"),
+        member_losses);
 }
 
 hpx::shared_future<std::vector<std::vector<double>>>
@@ -1020,7 +2944,8 @@ cholesky_hpx(const std::vector<double> &training_input,
              double lengthscale,
              double vertical_lengthscale,
              double noise_variance,
-             int n_regressors)
+             int n_regressors,
+             const kernel_function &kernel)
 {
     double hyperparameters[3];
 
@@ -1035,7 +2960,7 @@ cholesky_hpx(const std::vector<double> &training_input,
 
     // Tiled future data structure is matrix represented as vector of tiles.
     // Tiles are represented as vector, each wrapped in a shared_future.
-    std::vector<hpx::shared_future<std::vector<double>>> K_tiles;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> K_tiles;
 
     // Assemble covariance matrix vector
     K_tiles.resize(n_tiles * n_tiles);
@@ -1044,18 +2969,19 @@ cholesky_hpx(const std::vector<double> &training_input,
         for (std::size_t j = 0; j <= i; j++)
         {
             K_tiles[i * n_tiles + j] = hpx::async(
-                hpx::annotated_function(&gen_tile_covariance, "assemble_tiled"),
+                profiling::annotated_function(&gen_tile_covariance<double>, "assemble_tiled"),
                 i,
                 j,
                 n_tile_size,
                 n_regressors,
                 hyperparameters,
+                kernel,
                 training_input);
         }
     }
 
     // Calculate Cholesky decomposition
-    right_looking_cholesky_tiled(K_tiles, n_tile_size, n_tiles);
+    cholesky_tiled(K_tiles, n_tile_size, n_tiles);
 
     // Get & return predictions and uncertainty
     std::vector<std::vector<double>> result(n_tiles * n_tiles);
@@ -1063,7 +2989,8 @@ cholesky_hpx(const std::vector<double> &training_input,
     {
         for (std::size_t j = 0; j <= i; j++)
         {
-            result[i * n_tiles + j] = K_tiles[i * n_tiles + j].get();
+            const mutable_tile_data<double> &tile = K_tiles[i * n_tiles + j].get();
+            result[i * n_tiles + j].assign(tile.begin(), tile.end());
         }
     }
     return hpx::async([result]()
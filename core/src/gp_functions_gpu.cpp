@@ -0,0 +1,320 @@
+#include "../include/gp_functions_gpu.hpp"
+
+#include "../include/gp_algorithms_gpu.hpp"
+#include "../include/profiling.hpp"
+#include "../include/tiled_algorithms_gpu.hpp"
+
+namespace gpu
+{
+
+/**
+ * @brief Compute the Cholesky factor and alpha = K^-1 * y on the GPU.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ * @param state device tiles of L and alpha and the training input
+ * @param diag_tiles host copies of the diagonal tiles of L, the other tiles
+ *        stay empty
+ * @param alpha_tiles host copies of the tiles of alpha
+ */
+void fit_hpx(const std::vector<double> &training_input,
+             const std::vector<double> &training_output,
+             int n_tiles,
+             int n_tile_size,
+             double lengthscale,
+             double vertical_lengthscale,
+             double noise_variance,
+             int n_regressors,
+             fit_state &state,
+             std::vector<hpx::shared_future<mutable_tile_data<double>>> &diag_tiles,
+             std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles)
+{
+    double hyperparameters[3];
+    hyperparameters[0] = lengthscale;
+    hyperparameters[1] = vertical_lengthscale;
+    hyperparameters[2] = noise_variance;
+
+    // the only transfer of the training input
+    state.training_input = upload(training_input.data(), training_input.size());
+
+    // Assemble covariance matrix vector
+    state.L_tiles.clear();
+    state.L_tiles.resize(n_tiles * n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            state.L_tiles[i * n_tiles + j] =
+                hpx::async(profiling::annotated_function(&gen_tile_covariance,
+                                                         "assemble_tiled_K_gpu"),
+                           i,
+                           j,
+                           n_tile_size,
+                           n_regressors,
+                           hyperparameters,
+                           state.training_input);
+        }
+    }
+    // Assemble alpha
+    state.alpha_tiles.clear();
+    state.alpha_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        state.alpha_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_output, "assemble_tiled_alpha_gpu"),
+            i,
+            n_tile_size,
+            training_output);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Compute Cholesky decomposition
+    cholesky_tiled(state.L_tiles, n_tile_size, n_tiles);
+    //// Triangular solve K_NxN * alpha = y
+    forward_solve_tiled(state.L_tiles, state.alpha_tiles, n_tile_size, n_tiles);
+    backward_solve_tiled(state.L_tiles, state.alpha_tiles, n_tile_size, n_tiles);
+
+    // host copies for the loss
+    diag_tiles.clear();
+    diag_tiles.resize(n_tiles * n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        diag_tiles[i * n_tiles + i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&download<double>),
+                                          "download_diag_gpu"),
+            state.L_tiles[i * n_tiles + i]);
+    }
+    alpha_tiles.clear();
+    alpha_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        alpha_tiles[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&download<double>),
+                                          "download_alpha_gpu"),
+            state.alpha_tiles[i]);
+    }
+
+    // alpha depends on every tile of L, see fit_hpx in gp_functions.cpp
+    hpx::wait_all(alpha_tiles);
+    hpx::wait_all(diag_tiles);
+}
+
+/**
+ * @brief Compute the predictions from a Cholesky factor and alpha on the GPU.
+ *
+ * @param state device tiles of L and alpha and the training input
+ * @param test_input test input data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of each test tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ */
+hpx::shared_future<std::vector<double>>
+predict_fitted_hpx(const fit_state &state,
+                   const std::vector<double> &test_input,
+                   int n_tiles,
+                   int n_tile_size,
+                   int m_tiles,
+                   int m_tile_size,
+                   double lengthscale,
+                   double vertical_lengthscale,
+                   double noise_variance,
+                   int n_regressors)
+{
+    double hyperparameters[3];
+    hyperparameters[0] = lengthscale;
+    hyperparameters[1] = vertical_lengthscale;
+    hyperparameters[2] = noise_variance;
+
+    const device_tile_data<double> test_data = upload(test_input.data(), test_input.size());
+    std::vector<hpx::shared_future<device_tile_data<double>>> alpha = state.alpha_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> cross_covariance_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> prediction_tiles;
+
+    // Assemble MxN cross-covariance matrix vector
+    cross_covariance_tiles.resize(m_tiles * n_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        for (std::size_t j = 0; j < n_tiles; j++)
+        {
+            cross_covariance_tiles[i * n_tiles + j] =
+                hpx::async(profiling::annotated_function(&gen_tile_cross_covariance,
+                                                         "assemble_pred_gpu"),
+                           i,
+                           j,
+                           m_tile_size,
+                           n_tile_size,
+                           n_regressors,
+                           hyperparameters,
+                           test_data,
+                           state.training_input);
+        }
+    }
+    // Assemble placeholder for prediction
+    prediction_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prediction_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros, "assemble_tiled_gpu"),
+            m_tile_size);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Compute predictions
+    prediction_tiled(cross_covariance_tiles, alpha, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
+
+    //// Get predictions to return them
+    std::vector<double> pred;
+    pred.reserve(test_input.size());
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        const mutable_tile_data<double> tile = download(prediction_tiles[i].get());
+        pred.insert(pred.end(), tile.begin(), tile.end());
+    }
+    // drop the padding of the last tile
+    pred.resize(test_input.size());
+
+    return hpx::make_ready_future(std::move(pred));
+}
+
+/**
+ * @brief Compute the predictions and uncertainties from a Cholesky factor and
+ *        alpha on the GPU.
+ *
+ * @param state device tiles of L and alpha and the training input
+ * @param test_input test input data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of each test tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param n_regressors number of regressors
+ */
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_with_uncertainty_fitted_hpx(const fit_state &state,
+                                    const std::vector<double> &test_input,
+                                    int n_tiles,
+                                    int n_tile_size,
+                                    int m_tiles,
+                                    int m_tile_size,
+                                    double lengthscale,
+                                    double vertical_lengthscale,
+                                    double noise_variance,
+                                    int n_regressors)
+{
+    double hyperparameters[3];
+    hyperparameters[0] = lengthscale;
+    hyperparameters[1] = vertical_lengthscale;
+    hyperparameters[2] = noise_variance;
+
+    const device_tile_data<double> test_data = upload(test_input.data(), test_input.size());
+    std::vector<hpx::shared_future<device_tile_data<double>>> L_tiles = state.L_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> alpha = state.alpha_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> prior_K_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> prior_inter_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> cross_covariance_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> t_cross_covariance_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> prediction_tiles;
+    std::vector<hpx::shared_future<device_tile_data<double>>> prediction_uncertainty_tiles;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Assemble prior covariance matrix vector
+    prior_K_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prior_K_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_prior_covariance,
+                                          "assemble_tiled_gpu"),
+            i,
+            i,
+            m_tile_size,
+            n_regressors,
+            hyperparameters,
+            test_data);
+    }
+    // Assemble MxN cross-covariance matrix vector and its NxM transpose
+    cross_covariance_tiles.resize(m_tiles * n_tiles);
+    t_cross_covariance_tiles.resize(n_tiles * m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        for (std::size_t j = 0; j < n_tiles; j++)
+        {
+            cross_covariance_tiles[i * n_tiles + j] =
+                hpx::async(profiling::annotated_function(&gen_tile_cross_covariance,
+                                                         "assemble_pred_gpu"),
+                           i,
+                           j,
+                           m_tile_size,
+                           n_tile_size,
+                           n_regressors,
+                           hyperparameters,
+                           test_data,
+                           state.training_input);
+
+            t_cross_covariance_tiles[j * m_tiles + i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_cross_cov_T),
+                                              "assemble_pred_gpu"),
+                m_tile_size,
+                n_tile_size,
+                cross_covariance_tiles[i * n_tiles + j]);
+        }
+    }
+    // Assemble placeholders for diag(K_MxN * (K^-1_NxN * K_NxM)) and the
+    // prediction
+    prior_inter_tiles.resize(m_tiles);
+    prediction_tiles.resize(m_tiles);
+    prediction_uncertainty_tiles.resize(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prior_inter_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros, "assemble_prior_inter_gpu"),
+            m_tile_size);
+        prediction_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros, "assemble_tiled_gpu"),
+            m_tile_size);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
+    forward_solve_KcK_tiled(L_tiles, t_cross_covariance_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+
+    //////////////////////////////////////////////////////////////////////////////
+    //// Compute predictions
+    prediction_tiled(cross_covariance_tiles, alpha, prediction_tiles, m_tile_size, n_tile_size, n_tiles, m_tiles);
+    // posterior covariance matrix - (K_MxN * K^-1_NxN) * K_NxM
+    posterior_covariance_tiled(t_cross_covariance_tiles, prior_inter_tiles, n_tile_size, m_tile_size, n_tiles, m_tiles);
+
+    //// Compute predicition uncertainty
+    prediction_uncertainty_tiled(prior_K_tiles, prior_inter_tiles, prediction_uncertainty_tiles, m_tile_size, m_tiles);
+
+    //// Get predictions and uncertainty to return them
+    std::vector<std::vector<double>> result(2);
+    result[0].reserve(test_input.size());
+    result[1].reserve(test_input.size());
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        const mutable_tile_data<double> pred = download(prediction_tiles[i].get());
+        const mutable_tile_data<double> pred_var = download(prediction_uncertainty_tiles[i].get());
+        result[0].insert(result[0].end(), pred.begin(), pred.end());
+        result[1].insert(result[1].end(), pred_var.begin(), pred_var.end());
+    }
+    // drop the padding of the last tile
+    result[0].resize(test_input.size());
+    result[1].resize(test_input.size());
+
+    return hpx::make_ready_future(std::move(result));
+}
+
+}  // namespace gpu
@@ -0,0 +1,906 @@
+#include "../include/gp_iterative.hpp"
+
+#include "../include/adapter_mkl.hpp"
+#include "../include/covariance_assembly.hpp"
+#include "../include/gp_algorithms_cpu.hpp"
+#include "../include/profiling.hpp"
+#include "../include/tiled_algorithms_cpu.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace iterative
+{
+namespace
+{
+// Covariance between the lagged features of two input series, generated tile
+// by tile by the tasks that multiply with it
+struct covariance_operator
+{
+    std::vector<double> row_input;
+    std::vector<double> col_input;
+    // lengthscale, vertical lengthscale and noise variance
+    std::array<double, 3> hyperparameters;
+    kernel_function kernel;
+    std::size_t n_regressors;
+};
+
+using operator_ptr = std::shared_ptr<const covariance_operator>;
+
+// Preconditioner P = L * L^T + noise * I
+struct preconditioner
+{
+    // tile rows of the pivoted Cholesky factor L, N x rank each
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> L;
+    // Cholesky factor of noise * I + L^T * L, rank x rank
+    hpx::shared_future<mutable_tile_data<double>> C;
+    std::size_t rank;
+    double noise;
+    // log det P over the samples
+    double log_det;
+};
+
+// Tile kernels ------------------------------------------------------------ {{{
+
+/**
+ * @brief Y + K_ij * X for the covariance tile K_ij of the training input,
+ *        which is generated here and dropped afterwards
+ */
+mutable_tile_data<double> gen_tile_covariance_product(const mutable_tile_data<double> &Y,
+                                                      const const_tile_data<double> &X,
+                                                      std::size_t row,
+                                                      std::size_t col,
+                                                      std::size_t N,
+                                                      std::size_t M,
+                                                      const operator_ptr &op)
+{
+    std::array<double, 3> hyperparameters = op->hyperparameters;
+    const mutable_tile_data<double> K =
+        gen_tile_covariance<double>(row, col, N, op->n_regressors, hyperparameters.data(), op->kernel, op->row_input);
+    return gemm_nn_add(K, X, Y, N, M);
+}
+
+/**
+ * @brief y + K_ij * x for the test x training cross-covariance tile K_ij,
+ *        which is generated here and dropped afterwards
+ */
+mutable_tile_data<double> gen_tile_cross_covariance_product(const mutable_tile_data<double> &y,
+                                                            const const_tile_data<double> &x,
+                                                            std::size_t row,
+                                                            std::size_t col,
+                                                            std::size_t N_row,
+                                                            std::size_t N_col,
+                                                            const operator_ptr &op)
+{
+    std::array<double, 3> hyperparameters = op->hyperparameters;
+    const mutable_tile_data<double> K =
+        gen_tile_cross_covariance<double>(row, col, N_row, N_col, op->n_regressors, hyperparameters.data(), op->kernel, op->row_input, op->col_input);
+    return gemv_p(K, x, y, N_row, N_col);
+}
+
+/**
+ * @brief Inner products of the columns of two N x M tiles
+ */
+std::vector<double> gen_tile_column_dots(const const_tile_data<double> &A,
+                                         const const_tile_data<double> &B,
+                                         std::size_t N,
+                                         std::size_t M)
+{
+    std::vector<double> dots(M, 0.0);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        for (std::size_t c = 0; c < M; c++)
+        {
+            dots[c] += A[i * M + c] * B[i * M + c];
+        }
+    }
+    return dots;
+}
+
+/**
+ * @brief Inner products r^T * r followed by r^T * z of the columns of a tile
+ *        of residuals R and preconditioned residuals Z
+ */
+std::vector<double> gen_tile_residual_dots(const const_tile_data<double> &R,
+                                           const const_tile_data<double> &Z,
+                                           std::size_t N,
+                                           std::size_t M)
+{
+    std::vector<double> dots(2 * M, 0.0);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        for (std::size_t c = 0; c < M; c++)
+        {
+            dots[c] += R[i * M + c] * R[i * M + c];
+            dots[M + c] += R[i * M + c] * Z[i * M + c];
+        }
+    }
+    return dots;
+}
+
+/**
+ * @brief Add the inner products of two sets of tiles
+ */
+std::vector<double> add_columns(const std::vector<double> &a, const std::vector<double> &b)
+{
+    std::vector<double> sum = a;
+    for (std::size_t c = 0; c < sum.size(); c++)
+    {
+        sum[c] += b[c];
+    }
+    return sum;
+}
+
+/**
+ * @brief Add two tiles of `size` elements
+ */
+mutable_tile_data<double> add_tiles(const mutable_tile_data<double> &a,
+                                    const const_tile_data<double> &b,
+                                    std::size_t size)
+{
+    mutable_tile_data<double> sum = a.writable();
+    for (std::size_t i = 0; i < size; i++)
+    {
+        sum[i] += b[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Step lengths r^T * z / d^T * K * d of the columns that have not
+ *        converged, zero for the others
+ */
+std::vector<double> gen_step_lengths(const std::vector<double> &curvatures,
+                                     const std::vector<double> &rz,
+                                     const std::vector<bool> &active)
+{
+    std::vector<double> steps(rz.size(), 0.0);
+    for (std::size_t c = 0; c < rz.size(); c++)
+    {
+        if (active[c] && curvatures[c] > 0.0)
+        {
+            steps[c] = rz[c] / curvatures[c];
+        }
+    }
+    return steps;
+}
+
+/**
+ * @brief X + sign * a_c * D_c for the columns c of N x M tiles
+ */
+mutable_tile_data<double> gen_tile_axpy(const mutable_tile_data<double> &X,
+                                        const const_tile_data<double> &D,
+                                        const std::vector<double> &a,
+                                        double sign,
+                                        std::size_t N,
+                                        std::size_t M)
+{
+    mutable_tile_data<double> X_out = X.writable();
+    for (std::size_t i = 0; i < N; i++)
+    {
+        for (std::size_t c = 0; c < M; c++)
+        {
+            X_out[i * M + c] += sign * a[c] * D[i * M + c];
+        }
+    }
+    return X_out;
+}
+
+/**
+ * @brief Next search directions Z_c + b_c * D_c
+ *
+ * Writes a new tile, the update of the solution may still read D.
+ */
+mutable_tile_data<double> gen_tile_direction(const const_tile_data<double> &Z,
+                                             const const_tile_data<double> &D,
+                                             const std::vector<double> &b,
+                                             std::size_t N,
+                                             std::size_t M)
+{
+    mutable_tile_data<double> D_out(N * M);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        for (std::size_t c = 0; c < M; c++)
+        {
+            D_out[i * M + c] = Z[i * M + c] + b[c] * D[i * M + c];
+        }
+    }
+    return D_out;
+}
+
+/**
+ * @brief factor * R for a tile of `size` elements
+ */
+mutable_tile_data<double> gen_tile_scaled(const const_tile_data<double> &R, double factor, std::size_t size)
+{
+    mutable_tile_data<double> Z(size);
+    for (std::size_t i = 0; i < size; i++)
+    {
+        Z[i] = factor * R[i];
+    }
+    return Z;
+}
+
+/**
+ * @brief Contribution L_i^T * R_i of a tile row to L^T * R
+ */
+mutable_tile_data<double> gen_tile_projection(const const_tile_data<double> &L,
+                                              const const_tile_data<double> &R,
+                                              std::size_t N,
+                                              std::size_t rank,
+                                              std::size_t M)
+{
+    return gemm_tn_p(L, R, gen_tile_zeros<double>(rank * M), N, rank, M);
+}
+
+/**
+ * @brief U = (noise * I + L^T * L)^-1 * W from the Cholesky factor C
+ */
+mutable_tile_data<double> solve_woodbury(const const_tile_data<double> &C,
+                                         const mutable_tile_data<double> &W,
+                                         std::size_t rank,
+                                         std::size_t M)
+{
+    return trsm_u_matrix(C, trsm_l_matrix(C, W, rank, M), rank, M);
+}
+
+/**
+ * @brief Tile row (R_i - L_i * U) / noise of P^-1 * R
+ */
+mutable_tile_data<double> gen_tile_preconditioned(const const_tile_data<double> &R,
+                                                  const const_tile_data<double> &L,
+                                                  const const_tile_data<double> &U,
+                                                  double noise,
+                                                  std::size_t N,
+                                                  std::size_t rank,
+                                                  std::size_t M)
+{
+    mutable_tile_data<double> Z = gemm_p(L, U, gen_tile_zeros<double>(N * M), N, rank, M);
+    for (std::size_t i = 0; i < N * M; i++)
+    {
+        Z[i] = (R[i] - Z[i]) / noise;
+    }
+    return Z;
+}
+
+/**
+ * @brief Add column `step` of the pivoted Cholesky factor to a tile row of L
+ *        and subtract its squares from the remaining diagonal, both in place
+ *
+ * @return largest remaining diagonal entry of the tile and its global index
+ */
+std::pair<double, std::size_t>
+gen_tile_pivoted_cholesky_column(const mutable_tile_data<double> &L,
+                                 const mutable_tile_data<double> &diagonal,
+                                 std::size_t row,
+                                 std::size_t pivot,
+                                 std::size_t step,
+                                 std::size_t rank,
+                                 const std::vector<double> &pivot_row,
+                                 double pivot_value,
+                                 std::size_t N,
+                                 const operator_ptr &op)
+{
+    const std::size_t n_samples = op->row_input.size();
+    mutable_tile_data<double> column(N);
+    compute_lagged_distances(column.data(), N * row, pivot, N, 1, op->n_regressors, op->row_input, op->row_input);
+    kernels::covariance(op->kernel, column.data(), N, op->hyperparameters[0], op->hyperparameters[1]);
+    mask_padding(column.data(), N * row, pivot, N, 1, n_samples, n_samples, 0.0);
+    const double scale = 1.0 / std::sqrt(pivot_value);
+    std::pair<double, std::size_t> largest{ 0.0, N * row };
+    for (std::size_t i = 0; i < N; i++)
+    {
+        double value = column[i];
+        for (std::size_t s = 0; s < step; s++)
+        {
+            value -= L[i * rank + s] * pivot_row[s];
+        }
+        value *= scale;
+        L[i * rank + step] = value;
+        // the pivot is exact, rounding must not select it again
+        diagonal[i] = N * row + i == pivot ? 0.0 : diagonal[i] - value * value;
+        if (diagonal[i] > largest.first)
+        {
+            largest = { diagonal[i], N * row + i };
+        }
+    }
+    return largest;
+}
+
+/**
+ * @brief Tile row of the right-hand sides [y, z_1, ..., z_t], N x (1 + t),
+ *        with probes z = L * G + g ~ N(0, P) for g ~ N(0, noise * I)
+ */
+mutable_tile_data<double> gen_tile_right_hand_sides(std::size_t row,
+                                                    std::size_t N,
+                                                    std::size_t n_probes,
+                                                    const std::vector<double> &output,
+                                                    const const_tile_data<double> &L,
+                                                    const const_tile_data<double> &G,
+                                                    std::size_t rank,
+                                                    double noise,
+                                                    unsigned seed)
+{
+    const std::size_t M = 1 + n_probes;
+    // zero rows on the padding past the last sample
+    const std::size_t n_valid = n_valid_samples(N * row, N, output.size());
+    mutable_tile_data<double> B = gen_tile_zeros<double>(N * M);
+    // independent, reproducible stream per tile row
+    std::seed_seq seq{ seed, static_cast<unsigned>(row) };
+    std::mt19937_64 generator(seq);
+    std::normal_distribution<double> normal(0.0, std::sqrt(noise));
+    for (std::size_t i = 0; i < n_valid; i++)
+    {
+        B[i * M] = output[N * row + i];
+        for (std::size_t c = 0; c < n_probes; c++)
+        {
+            double value = normal(generator);
+            for (std::size_t s = 0; s < rank; s++)
+            {
+                value += L[i * rank + s] * G[s * n_probes + c];
+            }
+            B[i * M + 1 + c] = value;
+        }
+    }
+    return B;
+}
+
+/**
+ * @brief Column c of a N x M tile
+ */
+mutable_tile_data<double> gen_tile_column(const const_tile_data<double> &X, std::size_t c, std::size_t N, std::size_t M)
+{
+    mutable_tile_data<double> column(N);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        column[i] = X[i * M + c];
+    }
+    return column;
+}
+
+/**
+ * @brief e_1^T * log(T) * e_1 for the Lanczos tridiagonal matrix T given by
+ *        the step lengths a and direction updates b of one right-hand side
+ *
+ * T_jj = 1 / a_j + b_j-1 / a_j-1 and T_j,j+1 = sqrt(b_j) / a_j, see Saad,
+ * Iterative Methods for Sparse Linear Systems, Section 6.7.3.
+ */
+double lanczos_quadrature(const std::vector<double> &a, const std::vector<double> &b)
+{
+    const std::size_t m = a.size();
+    if (m == 0)
+    {
+        return 0.0;
+    }
+    mutable_tile_data<double> diagonal(m);
+    mutable_tile_data<double> off_diagonal(m);
+    for (std::size_t j = 0; j < m; j++)
+    {
+        diagonal[j] = 1.0 / a[j] + (j > 0 ? b[j - 1] / a[j - 1] : 0.0);
+        off_diagonal[j] = j + 1 < m ? std::sqrt(b[j]) / a[j] : 0.0;
+    }
+    const mutable_tile_data<double> eigen = stev(diagonal, off_diagonal, m);
+    double quadrature = 0.0;
+    for (std::size_t k = 0; k < m; k++)
+    {
+        // T is positive definite up to rounding
+        quadrature += eigen[m + k] * eigen[m + k] * std::log(std::max(eigen[k], std::numeric_limits<double>::min()));
+    }
+    return quadrature;
+}
+
+// }}} ----------------------------------------------------- end of Tile kernels
+
+// Task graphs ------------------------------------------------------------- {{{
+
+/**
+ * @brief Schedule Y = K * X for N x M tiles X. Does not block.
+ *
+ * Each tile row of Y is one chain of tasks. The tiles above the diagonal are
+ * generated as well instead of reusing the transposed lower tiles, which
+ * would need a second accumulation per tile: the chains stay independent and
+ * no tile outlives the task that generates it.
+ */
+void covariance_product_tiled(const operator_ptr &op,
+                              const std::vector<hpx::shared_future<mutable_tile_data<double>>> &X,
+                              std::vector<hpx::shared_future<mutable_tile_data<double>>> &Y,
+                              std::size_t N,
+                              std::size_t M)
+{
+    const std::size_t n_tiles = X.size();
+    Y.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        Y[i] = hpx::async(profiling::annotated_function(&gen_tile_zeros<double>, "cg_product"), N * M);
+        for (std::size_t j = 0; j < n_tiles; j++)
+        {
+            Y[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_covariance_product), "cg_product"),
+                Y[i],
+                X[j],
+                i,
+                j,
+                N,
+                M,
+                op);
+        }
+    }
+}
+
+/**
+ * @brief Schedule Z = P^-1 * R for N x M tiles R. Does not block.
+ */
+void apply_preconditioner_tiled(const preconditioner &P,
+                                const std::vector<hpx::shared_future<mutable_tile_data<double>>> &R,
+                                std::vector<hpx::shared_future<mutable_tile_data<double>>> &Z,
+                                std::size_t N,
+                                std::size_t M)
+{
+    const std::size_t n_tiles = R.size();
+    Z.resize(n_tiles);
+    if (P.rank == 0)
+    {
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            Z[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_scaled), "preconditioner_tiled"),
+                R[i],
+                1.0 / P.noise,
+                N * M);
+        }
+        return;
+    }
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> projections(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        projections[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_tile_projection), "preconditioner_tiled"),
+            P.L[i],
+            R[i],
+            N,
+            P.rank,
+            M);
+    }
+    hpx::shared_future<mutable_tile_data<double>> U = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&solve_woodbury), "preconditioner_tiled"),
+        P.C,
+        reduce_tiled(std::move(projections), &add_tiles, "cg_reduce", P.rank * M),
+        P.rank,
+        M);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        Z[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_tile_preconditioned), "preconditioner_tiled"),
+            R[i],
+            P.L[i],
+            U,
+            P.noise,
+            N,
+            P.rank,
+            M);
+    }
+}
+
+/**
+ * @brief Compute the rank `max_rank` pivoted Cholesky factor of the noise-free
+ *        covariance matrix and the factorization of the preconditioner.
+ *        Blocks.
+ *
+ * Each step selects the largest remaining diagonal entry as pivot, which
+ * takes one synchronization, and updates the tile rows of L concurrently,
+ * in O(N * max_rank^2) time overall. The factorization stops early once the
+ * remaining diagonal vanishes, the trailing columns of L stay zero.
+ */
+preconditioner build_preconditioner(const operator_ptr &op,
+                                    std::size_t n_tiles,
+                                    std::size_t N,
+                                    std::size_t max_rank)
+{
+    const std::size_t n_samples = op->row_input.size();
+    preconditioner P;
+    P.noise = op->hyperparameters[2];
+    P.rank = std::min(max_rank, n_samples);
+    P.log_det = static_cast<double>(n_samples) * std::log(P.noise);
+    if (P.rank == 0)
+    {
+        return P;
+    }
+    const std::size_t rank = P.rank;
+    // k(x, x) of the stationary kernels, at distance zero
+    double prior_variance = 0.0;
+    kernels::covariance(op->kernel, &prior_variance, 1, op->hyperparameters[0], op->hyperparameters[1]);
+
+    std::vector<mutable_tile_data<double>> L(n_tiles);
+    std::vector<mutable_tile_data<double>> diagonal(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        L[i] = gen_tile_zeros<double>(N * rank);
+        diagonal[i] = gen_tile_zeros<double>(N);
+        std::fill(diagonal[i].begin(), diagonal[i].begin() + n_valid_samples(N * i, N, n_samples), prior_variance);
+    }
+    std::pair<double, std::size_t> largest{ prior_variance, 0 };
+    for (std::size_t step = 0; step < rank; step++)
+    {
+        if (!(largest.first > 1e-12 * prior_variance))
+        {
+            break;
+        }
+        const std::size_t pivot = largest.second;
+        const mutable_tile_data<double> &pivot_tile = L[pivot / N];
+        const std::vector<double> pivot_row(pivot_tile.begin() + (pivot % N) * rank,
+                                            pivot_tile.begin() + (pivot % N) * rank + step);
+        std::vector<hpx::future<std::pair<double, std::size_t>>> columns;
+        columns.reserve(n_tiles);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            columns.push_back(hpx::async(profiling::annotated_function(&gen_tile_pivoted_cholesky_column, "preconditioner_tiled"),
+                                         L[i],
+                                         diagonal[i],
+                                         i,
+                                         pivot,
+                                         step,
+                                         rank,
+                                         pivot_row,
+                                         largest.first,
+                                         N,
+                                         op));
+        }
+        largest = { 0.0, 0 };
+        for (hpx::future<std::pair<double, std::size_t>> &column : columns)
+        {
+            const std::pair<double, std::size_t> tile_largest = column.get();
+            if (tile_largest.first > largest.first)
+            {
+                largest = tile_largest;
+            }
+        }
+    }
+
+    // noise * I + L^T * L and log det P = (n - rank) * log(noise) + log det(noise * I + L^T * L)
+    mutable_tile_data<double> C = gen_tile_zeros<double>(rank * rank);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        C = gemm_tn_rect(L[i], L[i], C, N, rank);
+    }
+    for (std::size_t s = 0; s < rank; s++)
+    {
+        C[s * rank + s] += P.noise;
+    }
+    C = potrf(C, rank);
+    P.log_det = static_cast<double>(n_samples - rank) * std::log(P.noise);
+    for (std::size_t s = 0; s < rank; s++)
+    {
+        P.log_det += 2.0 * std::log(C[s * rank + s]);
+    }
+    P.C = hpx::make_ready_future(C).share();
+    P.L.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        P.L[i] = hpx::make_ready_future(L[i]).share();
+    }
+    return P;
+}
+
+// }}} ------------------------------------------------------ end of Task graphs
+}  // namespace
+
+// Fit and predict --------------------------------------------------------- {{{
+
+/**
+ * @brief Solve K * alpha = y by preconditioned conjugate gradients and, if
+ *        `with_loss` is set, estimate the loss by stochastic Lanczos
+ *        quadrature. Blocks.
+ *
+ * All right-hand sides share the products with K. A right-hand side b stops
+ * once ||b - K * x|| <= settings.tolerance * ||b||, the iterations once all
+ * have stopped or after settings.max_iter iterations.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter, must be positive
+ * @param n_regressors number of regressors
+ * @param kernel covariance function
+ * @param settings iterations, preconditioner and probes
+ * @param with_loss also estimate the loss, which needs settings.n_probes
+ *        probe vectors as additional right-hand sides
+ *
+ * @return alpha, the loss and the residuals of the iterations
+ */
+fit_state fit_hpx(const std::vector<double> &training_input,
+                  const std::vector<double> &training_output,
+                  int n_tiles,
+                  int n_tile_size,
+                  double lengthscale,
+                  double vertical_lengthscale,
+                  double noise_variance,
+                  int n_regressors,
+                  const kernel_function &kernel,
+                  const iterative_settings &settings,
+                  bool with_loss)
+{
+    if (!(noise_variance > 0.0))
+    {
+        throw std::invalid_argument("Solver::Iterative requires a positive noise variance");
+    }
+    if (settings.max_iter < 0 || settings.tolerance < 0.0 || settings.preconditioner_rank < 0)
+    {
+        throw std::invalid_argument("Solver::Iterative requires a non-negative max_iter, tolerance and preconditioner_rank");
+    }
+    if (with_loss && settings.n_probes <= 0)
+    {
+        throw std::invalid_argument("The loss of Solver::Iterative requires a positive number of probes");
+    }
+    const std::size_t N = n_tile_size;
+    const std::size_t n_samples = training_output.size();
+    const std::size_t n_probes = with_loss ? settings.n_probes : 0;
+    const std::size_t M = 1 + n_probes;
+    const operator_ptr op = std::make_shared<const covariance_operator>(
+        covariance_operator{ training_input, training_input, { lengthscale, vertical_lengthscale, noise_variance }, kernel, static_cast<std::size_t>(n_regressors) });
+    const preconditioner P = build_preconditioner(op, n_tiles, N, settings.preconditioner_rank);
+
+    // factor part of the probes, from a stream of its own next to those of
+    // the tile rows
+    mutable_tile_data<double> G(P.rank * n_probes);
+    std::seed_seq seq{ settings.seed, static_cast<unsigned>(n_tiles) };
+    std::mt19937_64 generator(seq);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    for (double &g : G)
+    {
+        g = normal(generator);
+    }
+
+    // Assemble the right-hand sides and the initial solution
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> X(n_tiles);
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> R(n_tiles);
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> D;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> Z;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> V;
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        R[i] = hpx::async(profiling::annotated_function(&gen_tile_right_hand_sides, "assemble_cg"),
+                          i,
+                          N,
+                          n_probes,
+                          training_output,
+                          P.rank > 0 ? P.L[i].get() : mutable_tile_data<double>(),
+                          G,
+                          P.rank,
+                          noise_variance,
+                          settings.seed);
+        X[i] = hpx::async(profiling::annotated_function(&gen_tile_zeros<double>, "assemble_cg"), N * M);
+    }
+    apply_preconditioner_tiled(P, R, Z, N, M);
+    D = Z;
+
+    std::vector<hpx::shared_future<std::vector<double>>> partial_dots(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        partial_dots[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_tile_residual_dots), "cg_reduce"),
+            R[i],
+            Z[i],
+            N,
+            M);
+    }
+    std::vector<double> dots = reduce_tiled(partial_dots, &add_columns, "cg_reduce").get();
+    // norms of the right-hand sides and b^T * P^-1 * b, which scales the
+    // quadrature of a probe
+    std::vector<double> b_norm(M);
+    std::vector<double> rz(M);
+    std::vector<bool> active(M);
+    for (std::size_t c = 0; c < M; c++)
+    {
+        b_norm[c] = std::sqrt(dots[c]);
+        rz[c] = dots[M + c];
+        active[c] = b_norm[c] > 0.0 && rz[c] > 0.0;
+    }
+    const std::vector<double> initial_rz = rz;
+
+    //////////////////////////////////////////////////////////////////////////////
+    // Conjugate gradients, recording the coefficients of the Lanczos matrices
+    std::vector<std::vector<double>> steps(M);
+    std::vector<std::vector<double>> updates(M);
+    fit_state state;
+    for (int iter = 0; iter < settings.max_iter && std::find(active.begin(), active.end(), true) != active.end(); iter++)
+    {
+        covariance_product_tiled(op, D, V, N, M);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            partial_dots[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_column_dots), "cg_reduce"),
+                D[i],
+                V[i],
+                N,
+                M);
+        }
+        hpx::shared_future<std::vector<double>> a = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_step_lengths), "cg_update"),
+            reduce_tiled(partial_dots, &add_columns, "cg_reduce"),
+            rz,
+            active);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            X[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_axpy), "cg_update"),
+                X[i],
+                D[i],
+                a,
+                1.0,
+                N,
+                M);
+            R[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_axpy), "cg_update"),
+                R[i],
+                V[i],
+                a,
+                -1.0,
+                N,
+                M);
+        }
+        apply_preconditioner_tiled(P, R, Z, N, M);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            partial_dots[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_residual_dots), "cg_reduce"),
+                R[i],
+                Z[i],
+                N,
+                M);
+        }
+        // the only synchronization of the iteration
+        dots = reduce_tiled(partial_dots, &add_columns, "cg_reduce").get();
+        const std::vector<double> &step_lengths = a.get();
+
+        std::vector<double> b(M, 0.0);
+        for (std::size_t c = 0; c < M; c++)
+        {
+            if (!active[c])
+            {
+                continue;
+            }
+            if (!(step_lengths[c] > 0.0))
+            {
+                // breakdown, d^T * K * d is not positive
+                active[c] = false;
+                continue;
+            }
+            steps[c].push_back(step_lengths[c]);
+            active[c] = std::sqrt(dots[c]) > settings.tolerance * b_norm[c] && dots[M + c] > 0.0;
+            if (active[c])
+            {
+                b[c] = dots[M + c] / rz[c];
+                updates[c].push_back(b[c]);
+                rz[c] = dots[M + c];
+            }
+        }
+        state.residuals.push_back(b_norm[0] > 0.0 ? std::sqrt(dots[0]) / b_norm[0] : 0.0);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            D[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_direction), "cg_update"),
+                Z[i],
+                D[i],
+                b,
+                N,
+                M);
+        }
+    }
+
+    state.alpha_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        state.alpha_tiles[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_tile_column), "cg_update"),
+            X[i],
+            0,
+            N,
+            M);
+    }
+    state.loss = std::numeric_limits<double>::quiet_NaN();
+    if (with_loss)
+    {
+        //////////////////////////////////////////////////////////////////////////
+        // Loss from y^T * alpha and the quadrature of the probes
+        std::vector<hpx::shared_future<double>> partial_yKy(n_tiles);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            partial_yKy[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&dot<double>), "loss_tiled"),
+                N,
+                hpx::async(profiling::annotated_function(&gen_tile_output<double>, "assemble_y"), i, N, training_output),
+                state.alpha_tiles[i]);
+        }
+        std::vector<hpx::future<double>> quadratures;
+        quadratures.reserve(n_probes);
+        for (std::size_t c = 1; c < M; c++)
+        {
+            quadratures.push_back(hpx::async(profiling::annotated_function(&lanczos_quadrature, "loss_lanczos"), steps[c], updates[c]));
+        }
+        double log_det = P.log_det;
+        for (std::size_t c = 1; c < M; c++)
+        {
+            log_det += initial_rz[c] * quadratures[c - 1].get() / static_cast<double>(n_probes);
+        }
+        const double yKy = reduce_sum_tiled(std::move(partial_yKy)).get();
+        state.loss = 0.5 * (yKy + log_det + static_cast<double>(n_samples) * std::log(2.0 * M_PI)) / static_cast<double>(n_samples);
+    }
+    hpx::wait_all(state.alpha_tiles);
+    return state;
+}
+
+/**
+ * @brief Compute the predictions from alpha.
+ *
+ * Like prediction_tiled, but each task generates its cross-covariance tile
+ * and drops it after the product, so only O(N + M) memory is held. Does not
+ * block, the returned future becomes ready once the predictions are
+ * computed.
+ *
+ * @param training_input training input data
+ * @param test_input test input data
+ * @param alpha_tiles tiles of alpha = K^-1 * y, see fit_hpx
+ * @param n_tiles number of tiles
+ * @param n_tile_size size of each tile
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of each test tile
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param n_regressors number of regressors
+ * @param kernel covariance function
+ */
+hpx::shared_future<std::vector<double>>
+predict_fitted_hpx(const std::vector<double> &training_input,
+                   const std::vector<double> &test_input,
+                   const std::vector<hpx::shared_future<mutable_tile_data<double>>> &alpha_tiles,
+                   int n_tiles,
+                   int n_tile_size,
+                   int m_tiles,
+                   int m_tile_size,
+                   double lengthscale,
+                   double vertical_lengthscale,
+                   int n_regressors,
+                   const kernel_function &kernel)
+{
+    // the tasks read the inputs until the prediction tiles are ready
+    const operator_ptr op = std::make_shared<const covariance_operator>(
+        covariance_operator{ test_input, training_input, { lengthscale, vertical_lengthscale, 0.0 }, kernel, static_cast<std::size_t>(n_regressors) });
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> prediction_tiles(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        prediction_tiles[i] = hpx::async(
+            profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+            m_tile_size);
+        for (std::size_t j = 0; j < n_tiles; j++)
+        {
+            prediction_tiles[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_cross_covariance_product), "predict_iterative"),
+                prediction_tiles[i],
+                alpha_tiles[j],
+                i,
+                j,
+                m_tile_size,
+                n_tile_size,
+                op);
+        }
+    }
+
+    const std::size_t m_samples = test_input.size();
+    return hpx::dataflow(
+        profiling::annotated_function(
+            [m_samples](const std::vector<hpx::shared_future<mutable_tile_data<double>>> &tiles)
+            { return concat_tiles(tiles, m_samples); },
+            "predict_collect"),
+        prediction_tiles);
+}
+
+// }}} -------------------------------------------------- end of Fit and predict
+}  // namespace iterative
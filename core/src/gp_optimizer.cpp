@@ -1,7 +1,10 @@
 #include "../include/gp_optimizer.hpp"
 
 #include "../include/adapter_mkl.hpp"
+#include "../include/covariance_assembly.hpp"
+#include <algorithm>
 #include <numeric>
+#include <random>
 
 /**
  * @brief Transform hyperparameter to enforce constraints using softplus.
@@ -44,16 +47,15 @@ double compute_sigmoid(const double &parameter)
 }
 
 /**
- * @brief Compute the distance divided by the lengthscale.
+ * @brief Compute the squared distance of the lagged feature vectors.
  */
 double compute_covariance_dist_func(std::size_t i_global,
                                     std::size_t j_global,
                                     std::size_t n_regressors,
-                                    double *hyperparameters,
                                     const std::vector<double> &i_input,
                                     const std::vector<double> &j_input)
 {
-    // C(z_i,z_j) = vertical_lengthscale * exp(-0.5*lengthscale*(z_i-z_j)^2)
+    // the kernel and the lengthscale are applied by the callers
     double z_ik = 0.0;
     double z_jk = 0.0;
     double distance = 0.0;
@@ -70,173 +72,104 @@ double compute_covariance_dist_func(std::size_t i_global,
         {
             z_jk = j_input[j_local];
         }
-        distance += pow(z_ik - z_jk, 2);
+        distance += (z_ik - z_jk) * (z_ik - z_jk);
     }
 
-    return -1.0 / (2.0 * pow(hyperparameters[0], 2.0)) * distance;
+    return distance;
 }
 
 /**
- * @brief Compute vector of distances devided by the lengthscale.
+ * @brief Compute a tile of squared distances. They do not depend on the
+ *        hyperparameters and may be reused across optimizer iterations.
  */
-std::vector<double> compute_cov_dist_vec(std::size_t row,
-                                         std::size_t col,
-                                         std::size_t N,
-                                         std::size_t n_regressors,
-                                         double *hyperparameters,
-                                         const std::vector<double> &input)
+mutable_tile_data<double> compute_cov_dist_vec(std::size_t row,
+                                               std::size_t col,
+                                               std::size_t N,
+                                               std::size_t n_regressors,
+                                               const std::vector<double> &input)
 {
-    std::size_t i_global, j_global;
-    double cov_dist;
-    // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N * N);
-    for (std::size_t i = 0; i < N; i++)
-    {
-        i_global = N * row + i;
-        for (std::size_t j = 0; j < N; j++)
-        {
-            j_global = N * col + j;
-            // compute covariance function
-            cov_dist =
-                compute_covariance_dist_func(i_global, j_global, n_regressors, hyperparameters, input, input);
-            tile[i * N + j] = cov_dist;
-        }
-    }
-    return std::move(tile);
+    mutable_tile_data<double> tile(N * N);
+    compute_lagged_distances(tile.data(), N * row, N * col, N, N, n_regressors, input, input);
+    return tile;
 }
 
 /**
  * @brief Generate a tile of the covariance matrix.
  */
-std::vector<double>
+mutable_tile_data<double>
 gen_tile_covariance_opt(std::size_t row,
                         std::size_t col,
                         std::size_t N,
                         std::size_t n_regressors,
-                        double *hyperparameters,
-                        const std::vector<double> &cov_dists)
+                        std::size_t n_samples,
+                        const optimizer_parameters &hyperparameters,
+                        const const_tile_data<double> &cov_dists)
 {
-    std::size_t i_global, j_global;
-    double covariance;
     // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N * N);
-    for (std::size_t i = 0; i < N; i++)
+    mutable_tile_data<double> tile(N * N);
+    // compute covariance function
+    kernels::dispatch_kernel(hyperparameters.kernel.type, [&](auto policy)
+                             { decltype(policy)::covariance(tile.data(), cov_dists.data(), N * N, hyperparameters[0], hyperparameters[1], hyperparameters.kernel.shape); });
+    if (row == col)
     {
-        i_global = N * row + i;
-        for (std::size_t j = 0; j < N; j++)
+        // noise variance on diagonal
+        for (std::size_t i = 0; i < N; i++)
         {
-            j_global = N * col + j;
-            // compute covariance function
-            covariance = hyperparameters[1] * exp(cov_dists[i * N + j]);
-            if (i_global == j_global)
-            {
-                // noise variance on diagonal
-                covariance += hyperparameters[2];
-            }
-            tile[i * N + j] = covariance;
+            tile[i * N + i] += hyperparameters[2];
         }
     }
-    return std::move(tile);
+    // identity on the padding past the last sample
+    mask_padding(tile.data(), N * row, N * col, N, N, n_samples, n_samples, 1.0);
+    return tile;
 }
 
 /**
  * @brief Generate a derivative tile w.r.t. vertical_lengthscale.
  */
-std::vector<double> gen_tile_grad_v(std::size_t row,
-                                    std::size_t col,
-                                    std::size_t N,
-                                    std::size_t n_regressors,
-                                    double *hyperparameters,
-                                    const std::vector<double> &cov_dists)
+mutable_tile_data<double> gen_tile_grad_v(std::size_t row,
+                                          std::size_t col,
+                                          std::size_t N,
+                                          std::size_t n_regressors,
+                                          std::size_t n_samples,
+                                          const optimizer_parameters &hyperparameters,
+                                          const const_tile_data<double> &cov_dists)
 {
     // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N * N);
+    mutable_tile_data<double> tile(N * N);
     double hyperparam_der =
         compute_sigmoid(to_unconstrained(hyperparameters[1], false));
-    for (std::size_t i = 0; i < N; i++)
-    {
-        for (std::size_t j = 0; j < N; j++)
-        {
-            // compute covariance function
-            tile[i * N + j] = exp(cov_dists[i * N + j]) * hyperparam_der;
-        }
-    }
-    return std::move(tile);
+    // the kernels are linear in the vertical lengthscale: dk/dv = k / v
+    kernels::dispatch_kernel(hyperparameters.kernel.type, [&](auto policy)
+                             { decltype(policy)::covariance(tile.data(), cov_dists.data(), N * N, hyperparameters[0], hyperparam_der, hyperparameters.kernel.shape); });
+    mask_padding(tile.data(), N * row, N * col, N, N, n_samples, n_samples, 0.0);
+    return tile;
 }
 
 /**
  * @brief Generate a derivative tile w.r.t. lengthscale.
  */
-std::vector<double> gen_tile_grad_l(std::size_t row,
-                                    std::size_t col,
-                                    std::size_t N,
-                                    std::size_t n_regressors,
-                                    double *hyperparameters,
-                                    const std::vector<double> &cov_dists)
+mutable_tile_data<double> gen_tile_grad_l(std::size_t row,
+                                          std::size_t col,
+                                          std::size_t N,
+                                          std::size_t n_regressors,
+                                          std::size_t n_samples,
+                                          const optimizer_parameters &hyperparameters,
+                                          const const_tile_data<double> &cov_dists)
 {
     // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N * N);
+    mutable_tile_data<double> tile(N * N);
     double hyperparam_der =
         compute_sigmoid(to_unconstrained(hyperparameters[0], false));
-    for (std::size_t i = 0; i < N; i++)
-    {
-        for (std::size_t j = 0; j < N; j++)
-        {
-            // compute covariance function
-            tile[i * N + j] = -2.0 * (hyperparameters[1] / hyperparameters[0]) * cov_dists[i * N + j] * exp(cov_dists[i * N + j]) * hyperparam_der;
-        }
-    }
-    return std::move(tile);
-}
-
-/**
- * @brief Generate a derivative tile w.r.t. lengthscale.
- */
-std::vector<double>
-gen_tile_grad_v_trans(std::size_t N, const std::vector<double> &grad_l_tile)
-{
-    std::vector<double> transposed;
-    transposed.resize(N * N);
-    for (std::size_t i = 0; i < N; i++)
-    {
-        for (std::size_t j = 0; j < N; j++)
-        {
-            // Mapping (i, j) in the original matrix to (j, i) in the transposed
-            // matrix
-            transposed[j * N + i] = grad_l_tile[i * N + j];
-        }
-    }
-    return std::move(transposed);
-}
-
-/**
- * @brief Generate a derivative tile w.r.t. lengthscale.
- */
-std::vector<double>
-gen_tile_grad_l_trans(std::size_t N, const std::vector<double> &grad_l_tile)
-{
-    std::vector<double> transposed;
-    transposed.resize(N * N);
-    for (std::size_t i = 0; i < N; i++)
-    {
-        for (std::size_t j = 0; j < N; j++)
-        {
-            // Mapping (i, j) in the original matrix to (j, i) in the transposed
-            // matrix
-            transposed[j * N + i] = grad_l_tile[i * N + j];
-        }
-    }
-    return std::move(transposed);
+    kernels::dispatch_kernel(hyperparameters.kernel.type, [&](auto policy)
+                             { decltype(policy)::lengthscale_derivative(tile.data(), cov_dists.data(), N * N, hyperparameters[0], hyperparameters[1], hyperparameters.kernel.shape, hyperparam_der); });
+    mask_padding(tile.data(), N * row, N * col, N, N, n_samples, n_samples, 0.0);
+    return tile;
 }
 
 /**
  * @brief Compute hyper-parameter beta_1 or beta_2 to power t.
  */
-double gen_beta_T(int t, double *hyperparameters, int param_idx)
+double gen_beta_T(int t, const optimizer_parameters &hyperparameters, int param_idx)
 {
     return pow(hyperparameters[param_idx], t);
 }
@@ -244,9 +177,9 @@ double gen_beta_T(int t, double *hyperparameters, int param_idx)
 /**
  * @brief Compute negative-log likelihood tiled.
  */
-double compute_loss(const std::vector<double> &K_diag_tile,
-                    const std::vector<double> &alpha_tile,
-                    const std::vector<double> &y_tile,
+double compute_loss(const const_tile_data<double> &K_diag_tile,
+                    const const_tile_data<double> &alpha_tile,
+                    const const_tile_data<double> &y_tile,
                     std::size_t N)
 {
     double l = 0.0;
@@ -263,16 +196,16 @@ double compute_loss(const std::vector<double> &K_diag_tile,
  * @brief Compute negative-log likelihood.
  */
 double
-add_losses(const std::vector<double> &losses, std::size_t N, std::size_t n)
+add_losses(const std::vector<double> &losses, std::size_t n_samples)
 {
     double l = 0.0;
-    for (std::size_t i = 0; i < n; i++)
+    for (std::size_t i = 0; i < losses.size(); i++)
     {
         // Add the squared difference to the error
         l += losses[i];
     }
-    l += N * n * log(2.0 * M_PI);
-    return 0.5 * l / (N * n);
+    l += n_samples * log(2.0 * M_PI);
+    return 0.5 * l / n_samples;
 }
 
 /**
@@ -281,11 +214,10 @@ add_losses(const std::vector<double> &losses, std::size_t N, std::size_t n)
  */
 double compute_gradient(const double &grad_l,
                         const double &grad_r,
-                        std::size_t N,
-                        std::size_t n_tiles)
+                        std::size_t n_samples)
 {
     double grad = 0.0;
-    grad = 1.0 / (2.0 * N * n_tiles) * (grad_l - grad_r);
+    grad = 1.0 / (2.0 * n_samples) * (grad_l - grad_r);
 
     return std::move(grad);
 }
@@ -297,7 +229,7 @@ double compute_gradient(const double &grad_l,
  * diag tiles multiplied by derivative of noise_variance.
  */
 double compute_gradient_noise(const std::vector<std::vector<double>> &ft_tiles,
-                              double *hyperparameters,
+                              const optimizer_parameters &hyperparameters,
                               std::size_t N,
                               std::size_t n_tiles)
 {
@@ -320,26 +252,66 @@ double compute_gradient_noise(const std::vector<std::vector<double>> &ft_tiles,
 /**
  * @brief Update biased first raw moment estimate.
  */
-double
-update_first_moment(const double &gradient, double m_T, const double &beta_1)
+double update_first_moment(const double &gradient,
+                           double m_T,
+                           const optimizer_parameters &hyperparameters)
 {
+    const double beta_1 = hyperparameters[4];
     return beta_1 * m_T + (1.0 - beta_1) * gradient;
 }
 
 /**
  * @brief Update biased second raw moment estimate.
  */
-double
-update_second_moment(const double &gradient, double v_T, const double &beta_2)
+double update_second_moment(const double &gradient,
+                            double v_T,
+                            const optimizer_parameters &hyperparameters)
 {
+    const double beta_2 = hyperparameters[5];
     return beta_2 * v_T + (1.0 - beta_2) * gradient * gradient;
 }
 
+/**
+ * @brief Returns hyperparameter param_idx transformed to the entire real line.
+ */
+double gen_unconstrained_param(const optimizer_parameters &hyperparameters,
+                               int param_idx)
+{
+    // noise variance is constrained differently
+    return to_unconstrained(hyperparameters[param_idx], param_idx == 2);
+}
+
+/**
+ * @brief Returns hyperparameter param_idx.
+ */
+double get_kernel_param(const optimizer_parameters &hyperparameters,
+                        int param_idx)
+{
+    return hyperparameters[param_idx];
+}
+
+/**
+ * @brief Returns hyperparameters with lengthscale, vertical lengthscale and
+ *        noise variance replaced.
+ */
+optimizer_parameters
+update_kernel_params(const optimizer_parameters &hyperparameters,
+                     double lengthscale,
+                     double vertical_lengthscale,
+                     double noise_variance)
+{
+    optimizer_parameters updated = hyperparameters;
+    updated[0] = lengthscale;
+    updated[1] = vertical_lengthscale;
+    updated[2] = noise_variance;
+    return updated;
+}
+
 /**
  * @brief Update hyperparameter using gradient decent.
  */
 double update_param(const double &unconstrained_hyperparam,
-                    double *hyperparameters,
+                    const optimizer_parameters &hyperparameters,
                     const double &gradient,
                     double m_T,
                     double v_T,
@@ -360,15 +332,117 @@ double update_param(const double &unconstrained_hyperparam,
 }
 
 /**
- * @brief Generate an identity tile if i==j.
+ * @brief Returns the dot product of two vectors of the same size
+ */
+static double dot(const std::vector<double> &a, const std::vector<double> &b)
+{
+    return std::inner_product(a.begin(), a.end(), b.begin(), 0.0);
+}
+
+/**
+ * @brief L-BFGS search direction -H * gradient by the two-loop recursion.
+ *
+ * The initial inverse Hessian is scaled by s^T * y / y^T * y of the newest
+ * pair, see Nocedal & Wright, Numerical Optimization, Algorithm 7.4.
+ *
+ * @param gradient gradient at the current iterate
+ * @param steps steps s_k of the stored iterations, oldest first
+ * @param gradient_changes gradient changes y_k of the stored iterations
+ *
+ * @return search direction
  */
 std::vector<double>
+lbfgs_direction(const std::vector<double> &gradient,
+                const std::vector<std::vector<double>> &steps,
+                const std::vector<std::vector<double>> &gradient_changes)
+{
+    std::vector<double> q = gradient;
+    if (steps.empty())
+    {
+        // steepest descent, bounded such that the first step of the line
+        // search changes no hyperparameter by more than a factor of about e
+        double largest = 0.0;
+        for (double g : q)
+        {
+            largest = std::max(largest, std::fabs(g));
+        }
+        const double scale = largest > 1.0 ? -1.0 / largest : -1.0;
+        for (double &g : q)
+        {
+            g *= scale;
+        }
+        return q;
+    }
+    const std::size_t m = steps.size();
+    std::vector<double> rho(m);
+    std::vector<double> a(m);
+    for (std::size_t k = m; k-- > 0;)
+    {
+        rho[k] = 1.0 / dot(gradient_changes[k], steps[k]);
+        a[k] = rho[k] * dot(steps[k], q);
+        for (std::size_t i = 0; i < q.size(); i++)
+        {
+            q[i] -= a[k] * gradient_changes[k][i];
+        }
+    }
+    const double gamma = dot(steps[m - 1], gradient_changes[m - 1]) / dot(gradient_changes[m - 1], gradient_changes[m - 1]);
+    for (double &r : q)
+    {
+        r *= gamma;
+    }
+    for (std::size_t k = 0; k < m; k++)
+    {
+        const double b = rho[k] * dot(gradient_changes[k], q);
+        for (std::size_t i = 0; i < q.size(); i++)
+        {
+            q[i] += (a[k] - b) * steps[k][i];
+        }
+    }
+    for (double &r : q)
+    {
+        r = -r;
+    }
+    return q;
+}
+
+/**
+ * @brief Store the step and gradient change of an accepted L-BFGS iteration.
+ *
+ * @param steps stored steps, oldest first
+ * @param gradient_changes stored gradient changes
+ * @param step step of the iteration
+ * @param gradient_change gradient change of the iteration
+ * @param history number of pairs to keep
+ */
+void lbfgs_push(std::vector<std::vector<double>> &steps,
+                std::vector<std::vector<double>> &gradient_changes,
+                std::vector<double> step,
+                std::vector<double> gradient_change,
+                std::size_t history)
+{
+    // a pair without positive curvature would make H indefinite
+    if (!(dot(step, gradient_change) > 1e-10 * dot(gradient_change, gradient_change)))
+    {
+        return;
+    }
+    steps.push_back(std::move(step));
+    gradient_changes.push_back(std::move(gradient_change));
+    if (steps.size() > history)
+    {
+        steps.erase(steps.begin());
+        gradient_changes.erase(gradient_changes.begin());
+    }
+}
+
+/**
+ * @brief Generate an identity tile if i==j.
+ */
+mutable_tile_data<double>
 gen_tile_identity(std::size_t row, std::size_t col, std::size_t N)
 {
     std::size_t i_global, j_global;
     // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N * N);
+    mutable_tile_data<double> tile(N * N);
     std::fill(tile.begin(), tile.end(), 0.0);
     for (std::size_t i = 0; i < N; i++)
     {
@@ -388,11 +462,10 @@ gen_tile_identity(std::size_t row, std::size_t col, std::size_t N)
 /**
  * @brief Generate an empty tile NxN.
  */
-std::vector<double> gen_tile_zeros_diag(std::size_t N)
+mutable_tile_data<double> gen_tile_zeros_diag(std::size_t N)
 {
     // Initialize tile
-    std::vector<double> tile;
-    tile.resize(N);
+    mutable_tile_data<double> tile(N);
     std::fill(tile.begin(), tile.end(), 0.0);
     return std::move(tile);
 }
@@ -406,14 +479,14 @@ double gen_zero()
     return z;
 }
 
-double sum_gradleft(const std::vector<double> &diagonal, double grad)
+double sum_gradleft(const const_tile_data<double> &diagonal, double grad)
 {
     grad += std::reduce(diagonal.begin(), diagonal.end());
     return grad;
 }
 
-double sum_gradright(const std::vector<double> &inter_alpha,
-                     const std::vector<double> &alpha,
+double sum_gradright(const const_tile_data<double> &inter_alpha,
+                     const const_tile_data<double> &alpha,
                      double grad,
                      std::size_t N)
 {
@@ -421,24 +494,25 @@ double sum_gradright(const std::vector<double> &inter_alpha,
     return grad;
 }
 
-double sum_noise_gradleft(const std::vector<double> &ft_invK,
+double sum_noise_gradleft(const const_tile_data<double> &ft_invK,
                           double grad,
-                          double *hyperparameters,
+                          const optimizer_parameters &hyperparameters,
                           std::size_t N,
-                          std::size_t n_tiles)
+                          std::size_t n_valid)
 {
     double noise_der =
         compute_sigmoid(to_unconstrained(hyperparameters[2], true));
-    for (std::size_t i = 0; i < N; ++i)
+    // the noise is not added to the padding past the last sample
+    for (std::size_t i = 0; i < n_valid; ++i)
     {
         grad += (ft_invK[i * N + i] * noise_der);
     }
     return std::move(grad);
 }
 
-double sum_noise_gradright(const std::vector<double> &alpha,
+double sum_noise_gradright(const const_tile_data<double> &alpha,
                            double grad,
-                           double *hyperparameters,
+                           const optimizer_parameters &hyperparameters,
                            std::size_t N)
 {
     double noise_der =
@@ -446,3 +520,61 @@ double sum_noise_gradright(const std::vector<double> &alpha,
     grad += (noise_der * dot(N, alpha, alpha));
     return grad;
 }
+
+/**
+ * @brief Generate a tile of n_probes Rademacher probe vectors scaled by
+ *        1/sqrt(n_probes), such that the inner products of two probe tiles
+ *        average over the probes.
+ */
+mutable_tile_data<double> gen_tile_probes(std::size_t row,
+                                          std::size_t N,
+                                          std::size_t n_probes,
+                                          std::size_t n_samples,
+                                          unsigned seed)
+{
+    // independent, reproducible stream per tile row
+    std::seed_seq seq{ seed, static_cast<unsigned>(row) };
+    std::mt19937_64 generator(seq);
+    std::bernoulli_distribution coin(0.5);
+    const double value = 1.0 / sqrt(static_cast<double>(n_probes));
+    mutable_tile_data<double> tile(N * n_probes);
+    for (std::size_t i = 0; i < N * n_probes; i++)
+    {
+        tile[i] = coin(generator) ? value : -value;
+    }
+    // zero rows on the padding past the last sample
+    const std::size_t n_valid = n_valid_samples(N * row, N, n_samples);
+    std::fill(tile.begin() + n_valid * n_probes, tile.end(), 0.0);
+    return tile;
+}
+
+/**
+ * @brief Add the contribution of tile (i, j) to trace(A * B) for symmetric A
+ *        and B stored as lower tiles: off-diagonal tiles count twice.
+ */
+double sum_gradleft_lower(const const_tile_data<double> &A,
+                          const const_tile_data<double> &B,
+                          double grad,
+                          std::size_t N,
+                          bool diagonal)
+{
+    double factor = diagonal ? 1.0 : 2.0;
+    grad += factor * dot(N * N, A, B);
+    return grad;
+}
+
+/**
+ * @brief Add w^T * z * del(K)/del(noise_variance) of one tile row of the probes
+ *        z and w = K^-1 * z: an estimate of trace(inv(K)) * del(K)/del(noise).
+ */
+double sum_noise_gradleft_probes(const const_tile_data<double> &W,
+                                 const const_tile_data<double> &Z,
+                                 double grad,
+                                 const optimizer_parameters &hyperparameters,
+                                 std::size_t N)
+{
+    double noise_der =
+        compute_sigmoid(to_unconstrained(hyperparameters[2], true));
+    grad += noise_der * dot(N, W, Z);
+    return grad;
+}
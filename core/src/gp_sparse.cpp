@@ -0,0 +1,790 @@
+#include "../include/gp_sparse.hpp"
+
+#include "../include/adapter_mkl.hpp"
+#include "../include/covariance_assembly.hpp"
+#include "../include/gp_algorithms_cpu.hpp"
+#include "../include/gp_optimizer.hpp"
+#include "../include/profiling.hpp"
+#include "../include/tiled_algorithms_cpu.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+namespace sparse
+{
+namespace
+{
+// Number of optimizer iterations whose task graphs may be in flight at once
+constexpr int OPTIMIZER_LOOKAHEAD = 2;
+
+// Sums over the training tiles of the products of V = L_uu^-1 * K_uf
+struct inducing_sums
+{
+    // V * V^T
+    mutable_tile_data<double> S;
+    // V * y
+    mutable_tile_data<double> Vy;
+    // y^T * y
+    double yy;
+};
+
+// The m x m terms of the gradient of the loss
+struct gradient_terms
+{
+    // L_uu^-T * (A^-1 - I) * L_uu^-1 / noise_variance
+    mutable_tile_data<double> H;
+    // K_uu^-1 * K_uf * alpha with alpha = (Q + noise_variance * I)^-1 * y
+    mutable_tile_data<double> g;
+    // beta / noise_variance
+    mutable_tile_data<double> scaled_beta;
+    // derivatives of the loss by lengthscale, vertical lengthscale and noise
+    // variance without the terms summed over the K_fu tiles
+    std::array<double, 3> partial;
+};
+
+// Hyperparameters and moments of Adam between iterations
+struct adam_state
+{
+    optimizer_parameters hyperparameters;
+    std::array<double, 3> m_T;
+    std::array<double, 3> v_T;
+};
+
+// Tiles of one evaluation of the sparse GP
+struct evaluation
+{
+    // training x inducing covariance, one tile per training tile
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> K_fu;
+    // K_fu * L_uu^-T, one tile per training tile
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> V_t;
+    hpx::shared_future<inducing_sums> sums;
+    hpx::shared_future<fit_state> state;
+};
+
+// Tile kernels ------------------------------------------------------------ {{{
+
+/**
+ * @brief Squared distances of the lagged features of a tile of rows to all
+ *        inducing points
+ */
+mutable_tile_data<double>
+gen_tile_inducing_distances(std::size_t row,
+                            std::size_t N_row,
+                            std::size_t n_inducing,
+                            std::size_t n_regressors,
+                            const std::vector<double> &row_input,
+                            const std::vector<double> &inducing_input)
+{
+    mutable_tile_data<double> tile(N_row * n_inducing);
+    compute_lagged_distances(tile.data(), N_row * row, 0, N_row, n_inducing, n_regressors, row_input, inducing_input);
+    return tile;
+}
+
+/**
+ * @brief Covariance of the inducing points from their squared distances with
+ *        `jitter` added to the diagonal
+ */
+mutable_tile_data<double>
+gen_tile_inducing_covariance(const const_tile_data<double> &distances,
+                             const optimizer_parameters &hyperparameters,
+                             std::size_t n_inducing,
+                             double jitter)
+{
+    mutable_tile_data<double> tile(n_inducing * n_inducing);
+    std::copy(distances.data(), distances.data() + distances.size(), tile.data());
+    scaled_exp(tile.data(), tile.size(), -1.0 / (2.0 * hyperparameters[0] * hyperparameters[0]), hyperparameters[1]);
+    for (std::size_t i = 0; i < n_inducing; i++)
+    {
+        tile[i * n_inducing + i] += jitter;
+    }
+    return tile;
+}
+
+/**
+ * @brief Training x inducing covariance tile from its squared distances, the
+ *        padded rows past n_samples are zero
+ */
+mutable_tile_data<double>
+gen_tile_training_covariance(std::size_t row,
+                             const const_tile_data<double> &distances,
+                             const optimizer_parameters &hyperparameters,
+                             std::size_t N_row,
+                             std::size_t n_inducing,
+                             std::size_t n_samples)
+{
+    mutable_tile_data<double> tile(N_row * n_inducing);
+    std::copy(distances.data(), distances.data() + distances.size(), tile.data());
+    scaled_exp(tile.data(), tile.size(), -1.0 / (2.0 * hyperparameters[0] * hyperparameters[0]), hyperparameters[1]);
+    mask_padding(tile.data(), N_row * row, 0, N_row, n_inducing, n_samples, n_inducing, 0.0);
+    return tile;
+}
+
+/**
+ * @brief Project a training x inducing covariance tile, V^T = K_fu * L_uu^-T
+ *
+ * Works on a copy since the optimizer reuses K_fu for the gradient.
+ */
+mutable_tile_data<double> gen_tile_projection(const const_tile_data<double> &L_uu,
+                                              const mutable_tile_data<double> &K_fu,
+                                              std::size_t N_row,
+                                              std::size_t n_inducing)
+{
+    return trsm_rect(L_uu, K_fu.copy(), N_row, n_inducing);
+}
+
+/**
+ * @brief Contributions of a training tile to V * V^T, V * y and y^T * y
+ */
+inducing_sums gen_inducing_sums(const const_tile_data<double> &V_t,
+                                const const_tile_data<double> &y,
+                                std::size_t N_row,
+                                std::size_t n_inducing)
+{
+    inducing_sums sums;
+    sums.S = gemm_tn_rect(V_t, V_t, gen_tile_zeros<double>(n_inducing * n_inducing), N_row, n_inducing);
+    sums.Vy = gemv_t(V_t, y, gen_tile_zeros<double>(n_inducing), N_row, n_inducing);
+    sums.yy = dot(N_row, y, y);
+    return sums;
+}
+
+/**
+ * @brief Add the contributions of two sets of training tiles
+ */
+inducing_sums add_inducing_sums(const inducing_sums &a, const inducing_sums &b)
+{
+    inducing_sums sums;
+    sums.S = a.S.copy();
+    for (std::size_t i = 0; i < sums.S.size(); i++)
+    {
+        sums.S[i] += b.S[i];
+    }
+    sums.Vy = a.Vy.copy();
+    for (std::size_t i = 0; i < sums.Vy.size(); i++)
+    {
+        sums.Vy[i] += b.Vy[i];
+    }
+    sums.yy = a.yy + b.yy;
+    return sums;
+}
+
+/**
+ * @brief Factor A = I + V * V^T / noise_variance and compute the weights of
+ *        the predictive mean and the variational free energy
+ */
+fit_state factor_inducing(const mutable_tile_data<double> &L_uu,
+                          const inducing_sums &sums,
+                          const optimizer_parameters &hyperparameters,
+                          std::size_t n_inducing,
+                          std::size_t n_samples)
+{
+    const std::size_t m = n_inducing;
+    const double n = static_cast<double>(n_samples);
+    const double noise = hyperparameters[2];
+    fit_state state;
+    state.n_inducing = m;
+    state.L_uu = L_uu;
+    mutable_tile_data<double> A(m * m);
+    double trace_S = 0.0;
+    for (std::size_t i = 0; i < m; i++)
+    {
+        for (std::size_t j = 0; j < m; j++)
+        {
+            A[i * m + j] = sums.S[i * m + j] / noise + (i == j ? 1.0 : 0.0);
+        }
+        trace_S += sums.S[i * m + i];
+    }
+    state.L_A = potrf(A, m);
+    state.beta = trsv_u(state.L_A, trsv_l(state.L_A, sums.Vy.copy(), m), m);
+    mutable_tile_data<double> weights(m);
+    for (std::size_t i = 0; i < m; i++)
+    {
+        weights[i] = state.beta[i] / noise;
+    }
+    state.weights = trsv_u(L_uu, weights, m);
+    // log|Q + noise * I| = n * log(noise) + log|A|
+    double log_det = n * std::log(noise);
+    for (std::size_t i = 0; i < m; i++)
+    {
+        log_det += 2.0 * std::log(state.L_A[i * m + i]);
+    }
+    // y^T * (Q + noise * I)^-1 * y by the Woodbury identity
+    const double quadratic = sums.yy / noise - dot(m, sums.Vy, state.beta) / (noise * noise);
+    // trace(K_ff - Q) / (2 * noise) with trace(Q) = trace(V * V^T)
+    const double trace = (n * hyperparameters[1] - trace_S) / (2.0 * noise);
+    state.loss = (0.5 * (log_det + quadratic + n * std::log(2.0 * M_PI)) + trace) / n;
+    return state;
+}
+
+/**
+ * @brief Compute the m x m terms of the gradient and the derivatives of the
+ *        loss that do not involve the K_fu tiles
+ *
+ * With W = (Q + noise * I)^-1 - alpha * alpha^T, the derivative of the loss
+ * by a kernel hyperparameter is
+ * <dK_fu, K_fu * H - alpha * g^T> - <dK_uu, G_uu> / 2 + n * dk(x, x) / (2 * noise)
+ * with G_uu = L_uu^-T * (2I - A - A^-1) * L_uu^-1 - g * g^T, where <,> is the
+ * sum of the elementwise products.
+ */
+gradient_terms gen_gradient_terms(const fit_state &state,
+                                  const inducing_sums &sums,
+                                  const const_tile_data<double> &D_uu,
+                                  const optimizer_parameters &hyperparameters,
+                                  std::size_t n_inducing,
+                                  std::size_t n_samples)
+{
+    const std::size_t m = n_inducing;
+    const double n = static_cast<double>(n_samples);
+    const double lengthscale = hyperparameters[0];
+    const double vertical_lengthscale = hyperparameters[1];
+    const double noise = hyperparameters[2];
+    const mutable_tile_data<double> Z_uu = trtri(state.L_uu, m);
+    const mutable_tile_data<double> Z_A = trtri(state.L_A, m);
+    const mutable_tile_data<double> A_inv = gemm_tn_add(Z_A, Z_A, gen_tile_zeros<double>(m * m), m, m);
+
+    // A^-1 - I and 2I - A - A^-1 = I - S / noise - A^-1
+    mutable_tile_data<double> M_H(m * m);
+    mutable_tile_data<double> M_G(m * m);
+    double trace_S = 0.0;
+    double trace_A_inv = 0.0;
+    for (std::size_t i = 0; i < m; i++)
+    {
+        for (std::size_t j = 0; j < m; j++)
+        {
+            const double identity = i == j ? 1.0 : 0.0;
+            M_H[i * m + j] = A_inv[i * m + j] - identity;
+            M_G[i * m + j] = identity - sums.S[i * m + j] / noise - A_inv[i * m + j];
+        }
+        trace_S += sums.S[i * m + i];
+        trace_A_inv += A_inv[i * m + i];
+    }
+    gradient_terms terms;
+    terms.H = gemm_tn_add(Z_uu, gemm_nn_add(M_H, Z_uu, gen_tile_zeros<double>(m * m), m, m), gen_tile_zeros<double>(m * m), m, m);
+    for (std::size_t i = 0; i < m * m; i++)
+    {
+        terms.H[i] /= noise;
+    }
+    mutable_tile_data<double> G_uu =
+        gemm_tn_add(Z_uu, gemm_nn_add(M_G, Z_uu, gen_tile_zeros<double>(m * m), m, m), gen_tile_zeros<double>(m * m), m, m);
+
+    // V * alpha = (V * y - S * beta / noise) / noise
+    terms.scaled_beta = mutable_tile_data<double>(m);
+    mutable_tile_data<double> V_alpha(m);
+    double beta_S_beta = 0.0;
+    for (std::size_t i = 0; i < m; i++)
+    {
+        terms.scaled_beta[i] = state.beta[i] / noise;
+        double S_beta = 0.0;
+        for (std::size_t j = 0; j < m; j++)
+        {
+            S_beta += sums.S[i * m + j] * state.beta[j];
+        }
+        V_alpha[i] = (sums.Vy[i] - S_beta / noise) / noise;
+        beta_S_beta += state.beta[i] * S_beta;
+    }
+    terms.g = gemv_t(Z_uu, V_alpha, gen_tile_zeros<double>(m), m, m);
+    for (std::size_t i = 0; i < m; i++)
+    {
+        for (std::size_t j = 0; j < m; j++)
+        {
+            G_uu[i * m + j] -= terms.g[i] * terms.g[j];
+        }
+    }
+
+    // <dK_uu, G_uu> with dK_uu / dv = K_uu / v and dK_uu / dl = K_uu * D_uu / l^3
+    double grad_l = 0.0;
+    double grad_v = 0.0;
+    const double scale = -1.0 / (2.0 * lengthscale * lengthscale);
+    for (std::size_t i = 0; i < m * m; i++)
+    {
+        const double k = std::exp(scale * D_uu[i]);
+        grad_v += k * G_uu[i];
+        grad_l += k * D_uu[i] * G_uu[i];
+    }
+    grad_l *= vertical_lengthscale / (lengthscale * lengthscale * lengthscale);
+
+    const double alpha_alpha =
+        (sums.yy - 2.0 * dot(m, sums.Vy, state.beta) / noise + beta_S_beta / (noise * noise)) / (noise * noise);
+    const double trace_inv = (n - static_cast<double>(m) + trace_A_inv) / noise;
+    const double trace = (n * vertical_lengthscale - trace_S) / (2.0 * noise);
+    terms.partial[0] = -0.5 * grad_l;
+    terms.partial[1] = -0.5 * grad_v + n / (2.0 * noise);
+    terms.partial[2] = 0.5 * (trace_inv - alpha_alpha) - trace / noise;
+    return terms;
+}
+
+/**
+ * @brief Contribution of a training tile to the derivatives of the loss by
+ *        lengthscale and vertical lengthscale, <dK_fu, K_fu * H - alpha * g^T>
+ */
+std::array<double, 2> gen_tile_gradient(const const_tile_data<double> &D_fu,
+                                        const const_tile_data<double> &K_fu,
+                                        const const_tile_data<double> &V_t,
+                                        const const_tile_data<double> &y,
+                                        const gradient_terms &terms,
+                                        const optimizer_parameters &hyperparameters,
+                                        std::size_t N_row,
+                                        std::size_t n_inducing)
+{
+    const std::size_t m = n_inducing;
+    const double lengthscale = hyperparameters[0];
+    const double noise = hyperparameters[2];
+    // alpha = (y - V^T * beta / noise) / noise
+    const mutable_tile_data<double> V_beta = gemv_p(V_t, terms.scaled_beta, gen_tile_zeros<double>(N_row), N_row, m);
+    const mutable_tile_data<double> E = gemm_nn_rect(K_fu, terms.H, N_row, m);
+    double grad_l = 0.0;
+    double grad_v = 0.0;
+    for (std::size_t i = 0; i < N_row; i++)
+    {
+        const double alpha = (y[i] - V_beta[i]) / noise;
+        for (std::size_t j = 0; j < m; j++)
+        {
+            const double e = E[i * m + j] - alpha * terms.g[j];
+            grad_v += K_fu[i * m + j] * e;
+            grad_l += K_fu[i * m + j] * D_fu[i * m + j] * e;
+        }
+    }
+    return { grad_l / (lengthscale * lengthscale * lengthscale), grad_v / hyperparameters[1] };
+}
+
+/**
+ * @brief Add the gradient contributions of two sets of training tiles
+ */
+std::array<double, 2> add_gradients(const std::array<double, 2> &a, const std::array<double, 2> &b)
+{
+    return { a[0] + b[0], a[1] + b[1] };
+}
+
+/**
+ * @brief Take an Adam step for the trainable hyperparameters
+ */
+adam_state adam_step(const adam_state &state,
+                     const gradient_terms &terms,
+                     const std::array<double, 2> &tile_gradients,
+                     const std::vector<double> &beta1_T,
+                     const std::vector<double> &beta2_T,
+                     const std::vector<bool> &trainable_params,
+                     std::size_t n_samples,
+                     int iter)
+{
+    const optimizer_parameters &hyperparameters = state.hyperparameters;
+    const double derivatives[3] = { tile_gradients[0] + terms.partial[0],
+                                    tile_gradients[1] + terms.partial[1],
+                                    terms.partial[2] };
+    adam_state next = state;
+    for (int param_idx = 0; param_idx < 3; param_idx++)
+    {
+        if (!trainable_params[param_idx])
+        {
+            continue;
+        }
+        // noise variance is constrained differently
+        const bool noise = param_idx == 2;
+        // per sample like the exact loss, by the unconstrained parameter
+        const double gradient = derivatives[param_idx] / static_cast<double>(n_samples)
+                                * compute_sigmoid(to_unconstrained(hyperparameters[param_idx], noise));
+        next.m_T[param_idx] = update_first_moment(gradient, state.m_T[param_idx], hyperparameters);
+        next.v_T[param_idx] = update_second_moment(gradient, state.v_T[param_idx], hyperparameters);
+        const double updated = update_param(gen_unconstrained_param(hyperparameters, param_idx),
+                                            hyperparameters,
+                                            gradient,
+                                            next.m_T[param_idx],
+                                            next.v_T[param_idx],
+                                            beta1_T,
+                                            beta2_T,
+                                            iter);
+        next.hyperparameters[param_idx] = to_constrained(updated, noise);
+    }
+    return next;
+}
+
+/**
+ * @brief Mean and, if `uncertainty` is set, latent variance of a test tile
+ *
+ * The variance is k(x, x) - |L_uu^-1 * k_u|^2 + |L_A^-1 * L_uu^-1 * k_u|^2.
+ */
+std::array<mutable_tile_data<double>, 2>
+gen_tile_sparse_prediction(const mutable_tile_data<double> &K_su,
+                           const fit_state &state,
+                           double vertical_lengthscale,
+                           std::size_t N_row,
+                           bool uncertainty)
+{
+    const std::size_t m = state.n_inducing;
+    std::array<mutable_tile_data<double>, 2> result;
+    result[0] = gemv_p(K_su, state.weights, gen_tile_zeros<double>(N_row), N_row, m);
+    if (!uncertainty)
+    {
+        return result;
+    }
+    const mutable_tile_data<double> X = trsm_rect(state.L_uu, K_su.copy(), N_row, m);
+    const mutable_tile_data<double> Y = trsm_rect(state.L_A, X.copy(), N_row, m);
+    result[1] = mutable_tile_data<double>(N_row);
+    for (std::size_t i = 0; i < N_row; i++)
+    {
+        double variance = vertical_lengthscale;
+        for (std::size_t j = 0; j < m; j++)
+        {
+            variance += Y[i * m + j] * Y[i * m + j] - X[i * m + j] * X[i * m + j];
+        }
+        result[1][i] = variance;
+    }
+    return result;
+}
+
+// }}} ----------------------------------------------------- end of Tile kernels
+
+// Task graphs ------------------------------------------------------------- {{{
+
+/**
+ * @brief Schedule the squared distances of the training tiles and the
+ *        inducing points to each other and the output tiles. Does not block.
+ */
+void schedule_distances(const std::vector<double> &training_input,
+                        const std::vector<double> &training_output,
+                        const std::vector<double> &inducing_input,
+                        std::size_t n_tiles,
+                        std::size_t n_tile_size,
+                        std::size_t n_regressors,
+                        hpx::shared_future<mutable_tile_data<double>> &D_uu,
+                        std::vector<hpx::shared_future<mutable_tile_data<double>>> &D_fu,
+                        std::vector<hpx::shared_future<mutable_tile_data<double>>> &y_tiles)
+{
+    const std::size_t m = inducing_input.size();
+    D_uu = hpx::async(profiling::annotated_function(&gen_tile_inducing_distances, "assemble_sparse"),
+                      0,
+                      m,
+                      m,
+                      n_regressors,
+                      inducing_input,
+                      inducing_input);
+    D_fu.resize(n_tiles);
+    y_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        D_fu[i] = hpx::async(profiling::annotated_function(&gen_tile_inducing_distances, "assemble_sparse"),
+                             i,
+                             n_tile_size,
+                             m,
+                             n_regressors,
+                             training_input,
+                             inducing_input);
+        y_tiles[i] = hpx::async(profiling::annotated_function(&gen_tile_output<double>, "assemble_y"),
+                                i,
+                                n_tile_size,
+                                training_output);
+    }
+}
+
+/**
+ * @brief Schedule the factorization of the sparse GP for `hyperparameters`.
+ *        Does not block.
+ */
+void schedule_evaluation(const hpx::shared_future<optimizer_parameters> &hyperparameters,
+                         const hpx::shared_future<mutable_tile_data<double>> &D_uu,
+                         const std::vector<hpx::shared_future<mutable_tile_data<double>>> &D_fu,
+                         const std::vector<hpx::shared_future<mutable_tile_data<double>>> &y_tiles,
+                         std::size_t n_tile_size,
+                         std::size_t n_inducing,
+                         std::size_t n_samples,
+                         double jitter,
+                         evaluation &eval)
+{
+    const std::size_t n_tiles = D_fu.size();
+    hpx::shared_future<mutable_tile_data<double>> K_uu = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&gen_tile_inducing_covariance), "assemble_sparse"),
+        D_uu,
+        hyperparameters,
+        n_inducing,
+        jitter);
+    hpx::shared_future<mutable_tile_data<double>> L_uu = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&potrf<double>), "cholesky_sparse"),
+        K_uu,
+        n_inducing);
+    eval.K_fu.resize(n_tiles);
+    eval.V_t.resize(n_tiles);
+    std::vector<hpx::shared_future<inducing_sums>> partial_sums(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        eval.K_fu[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_tile_training_covariance), "assemble_sparse"),
+            i,
+            D_fu[i],
+            hyperparameters,
+            n_tile_size,
+            n_inducing,
+            n_samples);
+        eval.V_t[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_tile_projection), "triangular_solve_sparse"),
+            L_uu,
+            eval.K_fu[i],
+            n_tile_size,
+            n_inducing);
+        partial_sums[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_inducing_sums), "gemm_sparse"),
+            eval.V_t[i],
+            y_tiles[i],
+            n_tile_size,
+            n_inducing);
+    }
+    eval.sums = reduce_tiled(std::move(partial_sums), &add_inducing_sums, "reduce_sparse");
+    eval.state = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&factor_inducing), "cholesky_sparse"),
+        L_uu,
+        eval.sums,
+        hyperparameters,
+        n_inducing,
+        n_samples);
+}
+
+// }}} ------------------------------------------------------ end of Task graphs
+}  // namespace
+
+// Fit, predict and optimize ----------------------------------------------- {{{
+
+/**
+ * @brief Factor the sparse GP for the given hyperparameters
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param inducing_input series whose lagged features are the inducing points
+ * @param n_tiles number of training tiles
+ * @param n_tile_size size of the training tiles
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param noise_variance noise variance hyperparameter
+ * @param jitter added to the diagonal of K_uu
+ * @param n_regressors number of regressors
+ */
+hpx::shared_future<fit_state>
+fit_hpx(const std::vector<double> &training_input,
+        const std::vector<double> &training_output,
+        const std::vector<double> &inducing_input,
+        int n_tiles,
+        int n_tile_size,
+        double lengthscale,
+        double vertical_lengthscale,
+        double noise_variance,
+        double jitter,
+        int n_regressors)
+{
+    optimizer_parameters params{};
+    params[0] = lengthscale;
+    params[1] = vertical_lengthscale;
+    params[2] = noise_variance;
+    hpx::shared_future<mutable_tile_data<double>> D_uu;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> D_fu;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles;
+    schedule_distances(training_input, training_output, inducing_input, n_tiles, n_tile_size, n_regressors, D_uu, D_fu, y_tiles);
+    evaluation eval;
+    schedule_evaluation(hpx::make_ready_future(params).share(), D_uu, D_fu, y_tiles, n_tile_size, inducing_input.size(), training_output.size(), jitter, eval);
+    return eval.state;
+}
+
+/**
+ * @brief Predict the mean and, if `uncertainty` is set, the latent variance of
+ *        the test input from a fitted state
+ *
+ * @param state factorization of the sparse GP
+ * @param inducing_input series whose lagged features are the inducing points
+ * @param test_input test input data
+ * @param m_tiles number of test tiles
+ * @param m_tile_size size of the test tiles
+ * @param lengthscale lengthscale hyperparameter
+ * @param vertical_lengthscale vertical lengthscale hyperparameter
+ * @param n_regressors number of regressors
+ * @param uncertainty also compute the variance
+ *
+ * @return mean and, if `uncertainty` is set, variance
+ */
+hpx::shared_future<std::vector<std::vector<double>>>
+predict_hpx(const fit_state &state,
+            const std::vector<double> &inducing_input,
+            const std::vector<double> &test_input,
+            int m_tiles,
+            int m_tile_size,
+            double lengthscale,
+            double vertical_lengthscale,
+            int n_regressors,
+            bool uncertainty)
+{
+    double hyperparameters[3];
+    hyperparameters[0] = lengthscale;
+    hyperparameters[1] = vertical_lengthscale;
+    hyperparameters[2] = 0.0;
+    std::vector<hpx::shared_future<std::array<mutable_tile_data<double>, 2>>> prediction_tiles(m_tiles);
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        hpx::shared_future<mutable_tile_data<double>> K_su =
+            hpx::async(profiling::annotated_function(&gen_tile_cross_covariance<double>, "assemble_pred"),
+                       i,
+                       0,
+                       m_tile_size,
+                       inducing_input.size(),
+                       n_regressors,
+                       hyperparameters,
+                       kernel_function(),
+                       test_input,
+                       inducing_input);
+        prediction_tiles[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_tile_sparse_prediction), "predict_sparse"),
+            K_su,
+            state,
+            vertical_lengthscale,
+            m_tile_size,
+            uncertainty);
+    }
+
+    std::size_t m_samples = test_input.size();
+    return hpx::dataflow(
+        profiling::annotated_function(
+            [m_samples, m_tile_size, uncertainty](const std::vector<hpx::shared_future<std::array<mutable_tile_data<double>, 2>>> &tiles)
+            {
+                std::vector<std::vector<double>> result(uncertainty ? 2 : 1);
+                for (std::vector<double> &values : result)
+                {
+                    values.reserve(tiles.size() * m_tile_size);
+                }
+                for (const hpx::shared_future<std::array<mutable_tile_data<double>, 2>> &ft_tile : tiles)
+                {
+                    const std::array<mutable_tile_data<double>, 2> &tile = ft_tile.get();
+                    for (std::size_t k = 0; k < result.size(); k++)
+                    {
+                        result[k].insert(result[k].end(), tile[k].begin(), tile[k].end());
+                    }
+                }
+                // drop the padding of the last tile
+                for (std::vector<double> &values : result)
+                {
+                    values.resize(m_samples);
+                }
+                return result;
+            },
+            "predict_collect"),
+        prediction_tiles);
+}
+
+/**
+ * @brief Minimize the variational free energy with Adam
+ *
+ * The squared distances to the inducing points are computed once and reused
+ * by all iterations, each of which factors the sparse GP, reduces the
+ * gradient over the training tiles and takes one Adam step.
+ *
+ * @param training_input training input data
+ * @param training_output training output data
+ * @param inducing_input series whose lagged features are the inducing points
+ * @param n_tiles number of training tiles
+ * @param n_tile_size size of the training tiles
+ * @param lengthscale lengthscale hyperparameter, updated
+ * @param vertical_lengthscale vertical lengthscale hyperparameter, updated
+ * @param noise_variance noise variance hyperparameter, updated
+ * @param jitter added to the diagonal of K_uu
+ * @param n_regressors number of regressors
+ * @param hyperparams Adam settings and number of iterations
+ * @param trainable_params flags for lengthscale, vertical lengthscale, noise
+ *
+ * @return loss before each iteration
+ */
+hpx::shared_future<std::vector<double>>
+optimize_hpx(const std::vector<double> &training_input,
+             const std::vector<double> &training_output,
+             const std::vector<double> &inducing_input,
+             int n_tiles,
+             int n_tile_size,
+             double &lengthscale,
+             double &vertical_lengthscale,
+             double &noise_variance,
+             double jitter,
+             int n_regressors,
+             const gpxpy_hyper::Hyperparameters &hyperparams,
+             const std::vector<bool> &trainable_params)
+{
+    if (hyperparams.optimizer != gpxpy_hyper::Optimizer::Adam)
+    {
+        throw std::invalid_argument("sparse optimization supports only the Adam optimizer");
+    }
+    const std::size_t m = inducing_input.size();
+    const std::size_t n_samples = training_output.size();
+    adam_state initial{};
+    initial.hyperparameters = make_optimizer_parameters(lengthscale, vertical_lengthscale, noise_variance, kernel_function(), hyperparams);
+    hpx::shared_future<adam_state> adam = hpx::make_ready_future(initial).share();
+    std::vector<double> beta1_T(hyperparams.opt_iter);
+    std::vector<double> beta2_T(hyperparams.opt_iter);
+    for (int i = 0; i < hyperparams.opt_iter; i++)
+    {
+        beta1_T[i] = gen_beta_T(i + 1, initial.hyperparameters, 4);
+        beta2_T[i] = gen_beta_T(i + 1, initial.hyperparameters, 5);
+    }
+
+    hpx::shared_future<mutable_tile_data<double>> D_uu;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> D_fu;
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> y_tiles;
+    schedule_distances(training_input, training_output, inducing_input, n_tiles, n_tile_size, n_regressors, D_uu, D_fu, y_tiles);
+
+    std::vector<hpx::shared_future<double>> losses(hyperparams.opt_iter);
+    for (int iter = 0; iter < hyperparams.opt_iter; iter++)
+    {
+        // bound the task graph to a few iterations in flight
+        if (iter >= OPTIMIZER_LOOKAHEAD)
+        {
+            losses[iter - OPTIMIZER_LOOKAHEAD].wait();
+        }
+        hpx::shared_future<optimizer_parameters> hyperparameters = hpx::dataflow(
+            hpx::unwrapping([](const adam_state &state)
+                            { return state.hyperparameters; }),
+            adam);
+        evaluation eval;
+        schedule_evaluation(hyperparameters, D_uu, D_fu, y_tiles, n_tile_size, m, n_samples, jitter, eval);
+        hpx::shared_future<gradient_terms> terms = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&gen_gradient_terms), "gradient_sparse"),
+            eval.state,
+            eval.sums,
+            D_uu,
+            hyperparameters,
+            m,
+            n_samples);
+        std::vector<hpx::shared_future<std::array<double, 2>>> tile_gradients(n_tiles);
+        for (std::size_t i = 0; i < n_tiles; i++)
+        {
+            tile_gradients[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gen_tile_gradient), "gradient_sparse"),
+                D_fu[i],
+                eval.K_fu[i],
+                eval.V_t[i],
+                y_tiles[i],
+                terms,
+                hyperparameters,
+                n_tile_size,
+                m);
+        }
+        adam = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&adam_step), "gradient_sparse"),
+            adam,
+            terms,
+            reduce_tiled(std::move(tile_gradients), &add_gradients, "reduce_sparse"),
+            beta1_T,
+            beta2_T,
+            trainable_params,
+            n_samples,
+            iter);
+        losses[iter] = hpx::dataflow(
+            hpx::unwrapping([](const fit_state &state)
+                            { return state.loss; }),
+            eval.state);
+    }
+    // Update hyperparameter attributes in the sparse GP
+    const optimizer_parameters &final_params = adam.get().hyperparameters;
+    lengthscale = final_params[0];
+    vertical_lengthscale = final_params[1];
+    noise_variance = final_params[2];
+    return hpx::dataflow(
+        profiling::annotated_function(
+            hpx::unwrapping([](const std::vector<double> &loss_values)
+                            { return loss_values; }),
+            "collect_losses"),
+        losses);
+}
+
+// }}} ---------------------------------------- end of Fit, predict and optimize
+}  // namespace sparse
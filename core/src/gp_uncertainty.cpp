@@ -12,15 +12,15 @@
  *
  * @return Diagonal elements of posterior covariance matrix
  */
-std::vector<double> diag_posterior(const std::vector<double> &A,
-                                   const std::vector<double> &B,
-                                   std::size_t M)
+mutable_tile_data<double> diag_posterior(const const_tile_data<double> &A,
+                                         const const_tile_data<double> &B,
+                                         std::size_t M)
 {
-    std::vector<double> tile(M);
+    mutable_tile_data<double> tile(M);
 
     for (std::size_t i = 0; i < M; ++i)
     {
-        tile.push_back(A[i] - B[i]);
+        tile[i] = A[i] - B[i];
     }
 
     return std::move(tile);
@@ -34,15 +34,14 @@ std::vector<double> diag_posterior(const std::vector<double> &A,
  *
  * @return Diagonal elements of posterior covariance matrix
  */
-std::vector<double> diag_tile(const std::vector<double> &A, std::size_t M)
+mutable_tile_data<double> diag_tile(const const_tile_data<double> &A, std::size_t M)
 {
     // Initialize tile
-    std::vector<double> tile;
-    tile.reserve(M);
+    mutable_tile_data<double> tile(M);
 
     for (std::size_t i = 0; i < M; ++i)
     {
-        tile.push_back(A[i * M + i]);
+        tile[i] = A[i * M + i];
     }
 
     return std::move(tile);
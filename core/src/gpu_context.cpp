@@ -0,0 +1,124 @@
+#include "../include/gpu_context.hpp"
+
+#include <hpx/future.hpp>
+#include <hpx/modules/async_cuda.hpp>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gpu
+{
+
+namespace
+{
+std::mutex contexts_mutex;
+
+// indexed by worker thread, null until first use
+std::vector<std::unique_ptr<gpu_context>> contexts;
+
+std::unique_ptr<gpu_context> create_context()
+{
+    std::unique_ptr<gpu_context> context(new gpu_context());
+    check(cudaSetDevice(0), "cudaSetDevice");
+    check(cudaStreamCreateWithFlags(&context->stream, cudaStreamNonBlocking), "cudaStreamCreateWithFlags");
+    check(cublasCreate(&context->cublas), "cublasCreate");
+    check(cublasSetStream(context->cublas, context->stream), "cublasSetStream");
+    check(cusolverDnCreate(&context->cusolver), "cusolverDnCreate");
+    check(cusolverDnSetStream(context->cusolver, context->stream), "cusolverDnSetStream");
+    context->workspace = nullptr;
+    context->workspace_size = 0;
+    check(cudaMalloc(reinterpret_cast<void **>(&context->info), sizeof(int)), "cudaMalloc");
+    return context;
+}
+
+void destroy_context(gpu_context &context)
+{
+    cudaStreamSynchronize(context.stream);
+    cudaFree(context.workspace);
+    cudaFree(context.info);
+    cusolverDnDestroy(context.cusolver);
+    cublasDestroy(context.cublas);
+    cudaStreamDestroy(context.stream);
+}
+}  // namespace
+
+gpu_context &local_context()
+{
+    const std::size_t worker = hpx::get_worker_thread_num();
+    std::lock_guard<std::mutex> lock(contexts_mutex);
+    if (contexts.size() <= worker)
+    {
+        contexts.resize(std::max(worker + 1, hpx::get_os_thread_count()));
+    }
+    if (!contexts[worker])
+    {
+        contexts[worker] = create_context();
+    }
+    return *contexts[worker];
+}
+
+void synchronize(gpu_context &context)
+{
+    check(cudaGetLastError(), "kernel launch");
+    hpx::cuda::experimental::get_future_with_callback(context.stream).get();
+}
+
+void *allocate(std::size_t bytes)
+{
+    void *pointer = nullptr;
+    check(cudaMallocAsync(&pointer, bytes, local_context().stream), "cudaMallocAsync");
+    return pointer;
+}
+
+void deallocate(void *pointer)
+{
+    // handles may die outside of HPX worker threads, e.g. in the destructor
+    // of a GP, where no context exists
+    if (hpx::get_worker_thread_num() == std::size_t(-1))
+    {
+        cudaFree(pointer);
+        return;
+    }
+    cudaFreeAsync(pointer, local_context().stream);
+}
+
+void release_contexts()
+{
+    std::lock_guard<std::mutex> lock(contexts_mutex);
+    for (std::unique_ptr<gpu_context> &context : contexts)
+    {
+        if (context)
+        {
+            destroy_context(*context);
+        }
+    }
+    contexts.clear();
+}
+
+void check(cudaError_t status, const char *what)
+{
+    if (status != cudaSuccess)
+    {
+        throw std::runtime_error(std::string(what) + " failed: " + cudaGetErrorString(status));
+    }
+}
+
+void check(cublasStatus_t status, const char *what)
+{
+    if (status != CUBLAS_STATUS_SUCCESS)
+    {
+        throw std::runtime_error(std::string(what) + " failed with cuBLAS status " + std::to_string(static_cast<int>(status)));
+    }
+}
+
+void check(cusolverStatus_t status, const char *what)
+{
+    if (status != CUSOLVER_STATUS_SUCCESS)
+    {
+        throw std::runtime_error(std::string(what) + " failed with cuSOLVER status " + std::to_string(static_cast<int>(status)));
+    }
+}
+
+}  // namespace gpu
@@ -1,18 +1,68 @@
 #include "gpxpy_c.hpp"
 
+#include "gp_algorithms_cpu.hpp"
+#include "gp_iterative.hpp"
+#include "gp_sparse.hpp"
+#include "model_file.hpp"
+#include "tile_tuner.hpp"
+#include "tiled_algorithms_distributed.hpp"
 #include "utils_c.hpp"
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
+#include <deque>
 #include <iomanip>
+#include <limits>
 #include <sstream>
+#ifdef GPXPY_WITH_CUDA
+#include "gp_functions_gpu.hpp"
+#endif
+
+/**
+ * @brief Returns true if GPXPy was built with the GPU backend
+ */
+bool gpu_backend_available()
+{
+#ifdef GPXPY_WITH_CUDA
+    return true;
+#else
+    return false;
+#endif
+}
 
 // namespace for GPXPy library entities
 namespace gpxpy
 {
 
+/**
+ * @brief Throw if `n_tiles` tiles of size `n_tile_size` do not cover
+ *        `n_samples` samples. The last tile is zero-padded if they cover more.
+ *
+ * @param n_samples Number of samples
+ * @param n_tiles Number of tiles
+ * @param n_tile_size Size of each tile
+ * @param data Name of the data for the error message
+ */
+static void check_tiling(std::size_t n_samples, int n_tiles, int n_tile_size, const char *data)
+{
+    if (n_tiles <= 0 || n_tile_size <= 0)
+    {
+        throw std::invalid_argument(std::string("The number and size of the tiles of the ") + data + " must be positive");
+    }
+    const std::size_t covered = static_cast<std::size_t>(n_tiles) * static_cast<std::size_t>(n_tile_size);
+    if (covered < n_samples)
+    {
+        throw std::invalid_argument(std::string("The ") + data + " has " + std::to_string(n_samples)
+                                    + " samples, more than " + std::to_string(n_tiles) + " tiles of size "
+                                    + std::to_string(n_tile_size) + " hold");
+    }
+}
+
 /**
  * @brief Initialize of Gaussian process data by loading data from a file.
  *
- * The file specified by `f_path` must contain `n` samples.
+ * The file specified by `f_path` must contain `n` samples, as text or in the
+ * binary format of data_file.hpp.
  *
  * @param f_path Path to the file
  * @param n Number of samples
@@ -29,14 +79,15 @@ GP_data::GP_data(const std::string &f_path, int n) :
  *
  * @param input Training input data
  * @param output Training output data
- * @param n_tiles Number of tiles
- * @param n_tile_size Size of each tile
+ * @param n_tiles Number of tiles, 0 to pick it with the tile tuner
+ * @param n_tile_size Size of each tile, 0 to pick it with the tile tuner
  * @param l Lengthscale
  * @param v Vertical lengthscale
  * @param n Noise variance
  * @param n_r Number of regressors
  * @param trainable_bool Boolean vector indicating which hyperparameters are
  * trainable
+ * @param policy Distribution of the covariance tiles over the localities
  */
 GP::GP(std::vector<double> input,
        std::vector<double> output,
@@ -46,18 +97,549 @@ GP::GP(std::vector<double> input,
        double v,
        double n,
        int n_r,
-       std::vector<bool> trainable_bool) :
-    _training_input(input),
-    _training_output(output),
+       std::vector<bool> trainable_bool,
+       distribution_policy policy) :
+    _training_input(std::move(input)),
+    _training_output(std::move(output)),
     _n_tiles(n_tiles),
     _n_tile_size(n_tile_size),
+    _m_tile_size(n_tile_size),
+    _policy(policy),
+    _backend(Backend::CPU),
+    _precision(Precision::Double),
+    _refinement_steps(2),
+    _solver(Solver::Cholesky),
+    _iterative_loss(std::numeric_limits<double>::quiet_NaN()),
+    _data_generation(0),
     lengthscale(l),
     vertical_lengthscale(v),
     noise_variance(n),
     n_regressors(n_r),
     trainable_params(trainable_bool)
+{
+    const std::size_t n_samples = _training_input.size();
+    if (_n_tiles == 0 && _n_tile_size == 0 && n_samples > 0)
+    {
+        const bool optimize = std::find(trainable_params.begin(), trainable_params.end(), true) != trainable_params.end();
+        const tile_tuner::tile_config tiles =
+            tile_tuner::tune(n_samples, n_samples, n_regressors, optimize ? tile_tuner::Workload::Optimize : tile_tuner::Workload::Predict);
+        _n_tiles = tiles.n_tiles;
+        _n_tile_size = tiles.n_tile_size;
+        _m_tile_size = tiles.m_tile_size;
+    }
+    else if (_n_tiles == 0 && _n_tile_size > 0)
+    {
+        _n_tiles = utils::compute_train_tiles(static_cast<int>(n_samples), _n_tile_size);
+    }
+    else if (_n_tile_size == 0 && _n_tiles > 0)
+    {
+        _n_tile_size = utils::compute_train_tile_size(static_cast<int>(n_samples), _n_tiles);
+        _m_tile_size = _n_tile_size;
+    }
+    check_tiling(n_samples, _n_tiles, _n_tile_size, "training input");
+    if (_training_output.size() != _training_input.size())
+    {
+        throw std::invalid_argument("The training input and output differ in the number of samples");
+    }
+}
+
+/**
+ * @brief Load a Gaussian process from a snapshot file.
+ *
+ * @param snapshot_path Path to the snapshot file
+ */
+GP::GP(const std::string &snapshot_path) :
+    GP(model_file::read(snapshot_path))
 { }
 
+/**
+ * @brief Initialize a Gaussian process from the contents of a snapshot file.
+ *
+ * @param model Snapshot, its tiles are moved into the GP
+ */
+GP::GP(model_file::snapshot &&model) :
+    GP(std::move(model.training_input), std::move(model.training_output), model.n_tiles, model.n_tile_size, model.params[0], model.params[1], model.params[2], model.n_regressors,
+       model.trainable_params)
+{
+    _m_tile_size = model.m_tile_size;
+    _kernel = model.kernel;
+    if (model.alpha_tiles.empty())
+    {
+        return;
+    }
+    _K_tiles.resize(model.K_tiles.size());
+    for (std::size_t i = 0; i < model.K_tiles.size(); i++)
+    {
+        if (model.K_tiles[i].size() > 0)
+        {
+            _K_tiles[i] = hpx::make_ready_future(std::move(model.K_tiles[i]));
+        }
+    }
+    _alpha_tiles.resize(model.alpha_tiles.size());
+    for (std::size_t i = 0; i < model.alpha_tiles.size(); i++)
+    {
+        _alpha_tiles[i] = hpx::make_ready_future(std::move(model.alpha_tiles[i]));
+    }
+    _fitted_params = model.params;
+    _fitted_n_regressors = model.n_regressors;
+}
+
+/**
+ * @brief Write a snapshot of the GP to a file
+ *
+ * @param file_path Path to the snapshot file
+ * @param include_factor Also store the Cholesky factor and alpha
+ */
+void GP::save(const std::string &file_path, bool include_factor)
+{
+    model_file::snapshot model{ _training_input, _training_output, _n_tiles, _n_tile_size, _m_tile_size, n_regressors, { lengthscale, vertical_lengthscale, noise_variance }, _kernel, trainable_params, {}, {} };
+    if (include_factor)
+    {
+        require_local("save with the factor");
+        require_direct("save with the factor");
+        if (_backend != Backend::CPU || _precision != Precision::Double)
+        {
+            throw std::runtime_error("save with the factor requires the CPU backend in double precision");
+        }
+        hpx::run_as_hpx_thread([this, &model]()
+                               {
+                                   ensure_fitted();
+                                   model.K_tiles.resize(_K_tiles.size());
+                                   for (std::size_t i = 0; i < _n_tiles; i++)
+                                   {
+                                       for (std::size_t j = 0; j <= i; j++)
+                                       {
+                                           model.K_tiles[i * _n_tiles + j] = _K_tiles[i * _n_tiles + j].get();
+                                       }
+                                   }
+                                   for (const hpx::shared_future<mutable_tile_data<double>> &tile : _alpha_tiles)
+                                   {
+                                       model.alpha_tiles.push_back(tile.get());
+                                   }
+                               });
+    }
+    model_file::write(file_path, model);
+}
+
+/**
+ * @brief Compute and cache the Cholesky factor and alpha
+ */
+void GP::fit()
+{
+    hpx::run_as_hpx_thread([this]()
+                           { ensure_fitted(); });
+}
+
+/**
+ * @brief Returns true if the cached Cholesky factor and alpha match the
+ * current hyperparameters and number of regressors
+ */
+bool GP::is_fitted() const
+{
+    return !_alpha_tiles.empty()
+           && _fitted_params == std::array<double, 3>{ lengthscale, vertical_lengthscale, noise_variance }
+           && _fitted_n_regressors == n_regressors;
+}
+
+/**
+ * @brief Drop the cached Cholesky factor and alpha
+ */
+void GP::reset_fit()
+{
+    _K_tiles.clear();
+    _alpha_tiles.clear();
+    _distributed_K.reset();
+    _gpu_state.reset();
+    _single_K_tiles.clear();
+    _refinement_residuals.clear();
+    _iterative_loss = std::numeric_limits<double>::quiet_NaN();
+    _iterative_residuals.clear();
+}
+
+/**
+ * @brief Append new observations to the training data, extending the cached
+ * factor if possible
+ *
+ * @param new_input Input data of the new samples
+ * @param new_output Output data of the new samples
+ * @param max_tiles Maximum number of training tiles, 0 for no limit
+ */
+void GP::append(const std::vector<double> &new_input,
+                const std::vector<double> &new_output,
+                int max_tiles)
+{
+    if (new_input.size() != new_output.size())
+    {
+        throw std::invalid_argument("The new input and output differ in the number of samples");
+    }
+    if (max_tiles < 0)
+    {
+        throw std::invalid_argument("The maximum number of tiles must not be negative");
+    }
+    if (new_input.empty())
+    {
+        return;
+    }
+    const std::size_t n_old_samples = _training_input.size();
+    _training_input.insert(_training_input.end(), new_input.begin(), new_input.end());
+    _training_output.insert(_training_output.end(), new_output.begin(), new_output.end());
+    const int n_tiles = utils::compute_train_tiles(static_cast<int>(_training_input.size()), _n_tile_size);
+    const int n_dropped_tiles = max_tiles > 0 && n_tiles > max_tiles ? n_tiles - max_tiles : 0;
+    // the distances of the old tiles change with the padding and the window
+    _distance_cache.clear();
+    _data_generation++;
+
+    if (is_fitted() && !_policy.is_distributed() && _backend == Backend::CPU && _precision == Precision::Double && _solver == Solver::Cholesky)
+    {
+        bool updated = true;
+        hpx::run_as_hpx_thread([this, n_old_samples, n_dropped_tiles, &updated]()
+                               {
+                                   try
+                                   {
+                                       append_fitted_hpx(_training_input, _training_output, n_old_samples, n_dropped_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _kernel, _K_tiles, _alpha_tiles);
+                                       for (const hpx::shared_future<mutable_tile_data<double>> &alpha : _alpha_tiles)
+                                       {
+                                           alpha.get();
+                                       }
+                                   }
+                                   catch (const std::runtime_error &)
+                                   {
+                                       // a downdate lost positive definiteness
+                                       updated = false;
+                                   }
+                               });
+        if (!updated)
+        {
+            // refit on next use
+            reset_fit();
+        }
+    }
+    else
+    {
+        reset_fit();
+    }
+    const std::size_t n_dropped = static_cast<std::size_t>(n_dropped_tiles) * _n_tile_size;
+    _training_input.erase(_training_input.begin(), _training_input.begin() + n_dropped);
+    _training_output.erase(_training_output.begin(), _training_output.begin() + n_dropped);
+    _n_tiles = n_tiles - n_dropped_tiles;
+}
+
+/**
+ * @brief Compute the Cholesky factor and alpha unless they are cached for the
+ * current hyperparameters. Must be called on an HPX thread.
+ */
+void GP::ensure_fitted()
+{
+    if (is_fitted())
+    {
+        return;
+    }
+    // free the outdated factor before allocating the new one
+    reset_fit();
+    if (_policy.is_distributed())
+    {
+        fit_distributed_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _policy, _distributed_K, _K_tiles, _alpha_tiles);
+    }
+#ifdef GPXPY_WITH_CUDA
+    else if (_backend == Backend::GPU)
+    {
+        _gpu_state = std::make_shared<gpu::fit_state>();
+        gpu::fit_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, *_gpu_state, _K_tiles, _alpha_tiles);
+    }
+#endif
+    else if (_solver == Solver::Iterative)
+    {
+        iterative::fit_state state = iterative::fit_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _kernel, _iterative_settings, false);
+        _alpha_tiles = std::move(state.alpha_tiles);
+        _iterative_residuals = std::move(state.residuals);
+    }
+    else if (_precision == Precision::Mixed)
+    {
+        fit_mixed_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _kernel, _refinement_steps, _single_K_tiles, _K_tiles, _alpha_tiles, _refinement_residuals);
+    }
+    else
+    {
+        fit_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _kernel, _K_tiles, _alpha_tiles);
+    }
+    _fitted_params = { lengthscale, vertical_lengthscale, noise_variance };
+    _fitted_n_regressors = n_regressors;
+}
+
+/**
+ * @brief Throw if the GP is distributed, for operations that need the factor
+ * on one locality
+ */
+void GP::require_local(const char *operation) const
+{
+    if (_policy.is_distributed())
+    {
+        throw std::runtime_error(std::string(operation) + " does not support a distributed GP");
+    }
+}
+
+/**
+ * @brief Throw with Solver::Iterative, for operations that need the Cholesky
+ * factor
+ */
+void GP::require_direct(const char *operation) const
+{
+    if (_solver == Solver::Iterative)
+    {
+        throw std::runtime_error(std::string(operation) + " does not support Solver::Iterative");
+    }
+}
+
+/**
+ * @brief Fit the GP with Solver::Iterative including the loss estimate unless
+ * it is cached. Must be called on an HPX thread.
+ */
+void GP::ensure_iterative_loss()
+{
+    if (is_fitted() && !std::isnan(_iterative_loss))
+    {
+        return;
+    }
+    // the probes extend the right-hand sides of the same iterations
+    reset_fit();
+    iterative::fit_state state = iterative::fit_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _kernel, _iterative_settings, true);
+    _alpha_tiles = std::move(state.alpha_tiles);
+    _iterative_residuals = std::move(state.residuals);
+    _iterative_loss = state.loss;
+    _fitted_params = { lengthscale, vertical_lengthscale, noise_variance };
+    _fitted_n_regressors = n_regressors;
+}
+
+/**
+ * @brief Schedule the prediction of the test input with the cached factor on
+ * the backend and in the precision it was fitted with
+ *
+ * @param test_input Test input data
+ * @param m_tiles Number of tiles
+ * @param m_tile_size Size of each tile
+ * @param uncertainty Also compute the variance
+ *
+ * @return Mean and, if `uncertainty` is set, variance
+ */
+hpx::shared_future<std::vector<std::vector<double>>>
+GP::schedule_prediction(const std::vector<double> &test_input,
+                        int m_tiles,
+                        int m_tile_size,
+                        bool uncertainty)
+{
+    if (!uncertainty)
+    {
+        hpx::shared_future<std::vector<double>> mean;
+#ifdef GPXPY_WITH_CUDA
+        if (_gpu_state)
+        {
+            mean = gpu::predict_fitted_hpx(*_gpu_state, test_input, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors);
+        }
+#endif
+        if (_solver == Solver::Iterative)
+        {
+            mean = iterative::predict_fitted_hpx(_training_input, test_input, _alpha_tiles, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, n_regressors, _kernel);
+        }
+        if (!mean.valid())
+        {
+            mean = predict_fitted_hpx(_training_input, test_input, _K_tiles, _alpha_tiles, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance,
+                                      n_regressors, _kernel);
+        }
+        return mean.then([](const hpx::shared_future<std::vector<double>> &f)
+                         { return std::vector<std::vector<double>>{ f.get() }; });
+    }
+    require_direct("The uncertainty");
+#ifdef GPXPY_WITH_CUDA
+    if (_gpu_state)
+    {
+        return gpu::predict_with_uncertainty_fitted_hpx(*_gpu_state, test_input, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors);
+    }
+#endif
+    if (!_single_K_tiles.empty())
+    {
+        return predict_with_uncertainty_mixed_hpx(_training_input, test_input, _single_K_tiles, _alpha_tiles, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _kernel);
+    }
+    return predict_with_uncertainty_fitted_hpx(_training_input, test_input, _K_tiles, _alpha_tiles, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance,
+                                               n_regressors, _kernel);
+}
+
+/**
+ * @brief Select the device that fits the GP and computes its predictions
+ */
+void GP::set_backend(Backend backend)
+{
+    if (backend == Backend::GPU && !gpu_backend_available())
+    {
+        throw std::runtime_error("GPXPy was built without the GPU backend, configure with GPXPY_WITH_CUDA=ON");
+    }
+    if (backend == Backend::GPU && _policy.is_distributed())
+    {
+        throw std::runtime_error("The GPU backend does not support a distributed GP");
+    }
+    if (backend == Backend::GPU && _precision == Precision::Mixed)
+    {
+        throw std::runtime_error("The GPU backend does not support Precision::Mixed");
+    }
+    if (backend == Backend::GPU && _kernel.type != Kernel::SquaredExponential)
+    {
+        throw std::runtime_error("The GPU backend only supports Kernel::SquaredExponential");
+    }
+    if (backend == Backend::GPU && _solver == Solver::Iterative)
+    {
+        throw std::runtime_error("The GPU backend does not support Solver::Iterative");
+    }
+    if (backend != _backend)
+    {
+        // the cached factor lives on the other device
+        reset_fit();
+        _backend = backend;
+    }
+}
+
+/**
+ * @brief Returns the device that fits the GP
+ */
+Backend GP::backend() const
+{
+    return _backend;
+}
+
+/**
+ * @brief Select the precision of the Cholesky factor
+ */
+void GP::set_precision(Precision precision, int refinement_steps)
+{
+    if (refinement_steps < 0)
+    {
+        throw std::invalid_argument("refinement_steps must not be negative");
+    }
+    if (precision == Precision::Mixed && _policy.is_distributed())
+    {
+        throw std::runtime_error("Precision::Mixed does not support a distributed GP");
+    }
+    if (precision == Precision::Mixed && _backend == Backend::GPU)
+    {
+        throw std::runtime_error("Precision::Mixed does not support the GPU backend");
+    }
+    if (precision == Precision::Mixed && _solver == Solver::Iterative)
+    {
+        throw std::runtime_error("Precision::Mixed does not support Solver::Iterative");
+    }
+    if (precision != _precision || (precision == Precision::Mixed && refinement_steps != _refinement_steps))
+    {
+        // the cached factor has the other precision
+        reset_fit();
+        _precision = precision;
+    }
+    _refinement_steps = refinement_steps;
+}
+
+/**
+ * @brief Returns the precision of the Cholesky factor
+ */
+Precision GP::precision() const
+{
+    return _precision;
+}
+
+/**
+ * @brief Select the covariance function
+ *
+ * @param kernel Kernel of the GP
+ * @param shape Shape alpha of the rational quadratic kernel
+ */
+void GP::set_kernel(Kernel kernel, double shape)
+{
+    if (kernel == Kernel::RationalQuadratic && !(shape > 0.0))
+    {
+        throw std::invalid_argument("The shape of the rational quadratic kernel must be positive");
+    }
+    if (kernel != Kernel::SquaredExponential && _policy.is_distributed())
+    {
+        throw std::runtime_error("A distributed GP only supports Kernel::SquaredExponential");
+    }
+    if (kernel != Kernel::SquaredExponential && _backend == Backend::GPU)
+    {
+        throw std::runtime_error("The GPU backend only supports Kernel::SquaredExponential");
+    }
+    const kernel_function selected{ kernel, shape };
+    if (selected != _kernel)
+    {
+        // the cached factor belongs to the other kernel
+        reset_fit();
+    }
+    _kernel = selected;
+}
+
+/**
+ * @brief Returns the covariance function
+ */
+Kernel GP::kernel() const
+{
+    return _kernel.type;
+}
+
+/**
+ * @brief Returns the shape alpha of the rational quadratic kernel
+ */
+double GP::kernel_shape() const
+{
+    return _kernel.shape;
+}
+
+/**
+ * @brief Returns the relative residuals of the mixed precision fit
+ */
+std::vector<double> GP::refinement_residuals()
+{
+    hpx::run_as_hpx_thread([this]()
+                           { ensure_fitted(); });
+    return _refinement_residuals;
+}
+
+/**
+ * @brief Select the solver of the linear systems
+ *
+ * @param solver Solver of the GP
+ * @param settings Settings of Solver::Iterative
+ */
+void GP::set_solver(Solver solver, const iterative_settings &settings)
+{
+    if (solver == Solver::Iterative)
+    {
+        require_local("Solver::Iterative");
+        if (_backend != Backend::CPU || _precision != Precision::Double)
+        {
+            throw std::runtime_error("Solver::Iterative requires the CPU backend in double precision");
+        }
+        if (settings.max_iter < 0 || settings.tolerance < 0.0 || settings.preconditioner_rank < 0 || settings.n_probes <= 0)
+        {
+            throw std::invalid_argument("Solver::Iterative needs max_iter, tolerance and preconditioner_rank >= 0 and n_probes > 0");
+        }
+    }
+    // the cached factor or alpha belongs to the other solver or settings
+    reset_fit();
+    _solver = solver;
+    _iterative_settings = settings;
+}
+
+/**
+ * @brief Returns the solver of the linear systems
+ */
+Solver GP::solver() const
+{
+    return _solver;
+}
+
+/**
+ * @brief Returns the relative residuals of the conjugate gradients
+ */
+std::vector<double> GP::iterative_residuals()
+{
+    hpx::run_as_hpx_thread([this]()
+                           { ensure_fitted(); });
+    return _iterative_residuals;
+}
+
 /**
  * Returns Gaussian process attributes as string.
  */
@@ -75,6 +657,37 @@ std::string GP::repr() const
     return oss.str();
 }
 
+/**
+ * @brief Returns the number of training tiles
+ */
+int GP::n_tiles() const
+{
+    return _n_tiles;
+}
+
+/**
+ * @brief Returns the size of the training tiles
+ */
+int GP::n_tile_size() const
+{
+    return _n_tile_size;
+}
+
+/**
+ * @brief Returns the number and size of the test tiles for m_samples test
+ * samples
+ *
+ * @param m_samples Number of test samples
+ */
+std::pair<int, int> GP::test_tiles(int m_samples) const
+{
+    if (m_samples < 0)
+    {
+        throw std::invalid_argument("The number of test samples must not be negative");
+    }
+    return { (m_samples + _m_tile_size - 1) / _m_tile_size, _m_tile_size };
+}
+
 /**
  * @brief Returns training input data
  */
@@ -91,6 +704,14 @@ std::vector<double> GP::get_training_output() const
     return _training_output;
 }
 
+/**
+ * @brief Returns the distribution of the covariance tiles
+ */
+const distribution_policy &GP::policy() const
+{
+    return _policy;
+}
+
 /**
  * @brief Predict output for test input
  *
@@ -104,13 +725,12 @@ std::vector<double> GP::predict(const std::vector<double> &test_data,
                                 int m_tiles,
                                 int m_tile_size)
 {
+    check_tiling(test_data.size(), m_tiles, m_tile_size, "test input");
     std::vector<double> result;
     hpx::run_as_hpx_thread([this, &result, &test_data, m_tiles, m_tile_size]()
                            {
-                               result =
-                                   predict_hpx(_training_input, _training_output, test_data, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance,
-                                               n_regressors)
-                                       .get();  // Wait for and get the result from the future
+                               ensure_fitted();
+                               result = schedule_prediction(test_data, m_tiles, m_tile_size, false).get()[0];  // Wait for and get the result from the future
                            });
     return result;
 }
@@ -128,36 +748,235 @@ std::vector<double> GP::predict(const std::vector<double> &test_data,
 std::vector<std::vector<double>> GP::predict_with_uncertainty(
     const std::vector<double> &test_input, int m_tiles, int m_tile_size)
 {
+    require_local("predict_with_uncertainty");
+    require_direct("predict_with_uncertainty");
+    check_tiling(test_input.size(), m_tiles, m_tile_size, "test input");
     std::vector<std::vector<double>> result;
     hpx::run_as_hpx_thread([this, &result, &test_input, m_tiles, m_tile_size]()
                            {
-                               result = predict_with_uncertainty_hpx(
-                                            _training_input, _training_output, test_input, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance,
-                                            n_regressors)
-                                            .get();  // Wait for and get the result from the future
+                               ensure_fitted();
+                               result = schedule_prediction(test_input, m_tiles, m_tile_size, true).get();  // Wait for and get the result from the future
+                           });
+    return result;
+}
+
+/**
+ * @brief Schedule the prediction of the test input without waiting for it
+ *
+ * @param test_data Test input data
+ * @param m_tiles Number of tiles
+ * @param m_tile_size Size of each tile
+ *
+ * @return Future of the predicted output
+ */
+hpx::shared_future<std::vector<double>>
+GP::predict_async(const std::vector<double> &test_data,
+                  int m_tiles,
+                  int m_tile_size)
+{
+    check_tiling(test_data.size(), m_tiles, m_tile_size, "test input");
+    hpx::shared_future<std::vector<double>> result;
+    hpx::run_as_hpx_thread([this, &result, &test_data, m_tiles, m_tile_size]()
+                           {
+                               ensure_fitted();
+                               result = schedule_prediction(test_data, m_tiles, m_tile_size, false)
+                                            .then([](const hpx::shared_future<std::vector<std::vector<double>>> &f)
+                                                  { return f.get()[0]; });
+                           });
+    return result;
+}
+
+/**
+ * @brief Schedule the prediction of the test input and its variance without
+ * waiting for them
+ *
+ * @param test_input Test input data
+ * @param m_tiles Number of tiles
+ * @param m_tile_size Size of each tile
+ *
+ * @return Future of the mean and variance
+ */
+hpx::shared_future<std::vector<std::vector<double>>>
+GP::predict_with_uncertainty_async(const std::vector<double> &test_input,
+                                   int m_tiles,
+                                   int m_tile_size)
+{
+    require_local("predict_with_uncertainty_async");
+    require_direct("predict_with_uncertainty_async");
+    check_tiling(test_input.size(), m_tiles, m_tile_size, "test input");
+    hpx::shared_future<std::vector<std::vector<double>>> result;
+    hpx::run_as_hpx_thread([this, &result, &test_input, m_tiles, m_tile_size]()
+                           {
+                               ensure_fitted();
+                               result = schedule_prediction(test_input, m_tiles, m_tile_size, true);
                            });
     return result;
 }
 
 /**
- * @brief Predict output for test input and additionally compute full
- * posterior covariance matrix.
+ * @brief Predict a stream of test input chunk by chunk with the cached factor
+ *
+ * Each chunk is predicted together with the last n_regressors - 1 samples of
+ * the stream before it, which its first lagged features depend on, and the
+ * predictions of these samples are dropped. Up to `max_in_flight` chunks are
+ * scheduled before the sink receives the oldest one.
+ *
+ * @param next_chunk Source of the test input chunks
+ * @param sink Receives the predictions of each chunk
+ * @param uncertainty Also compute the variance
+ * @param m_tile_size Size of the test tiles, 0 for the tuned size
+ * @param max_in_flight Number of chunks scheduled ahead of the sink
+ */
+void GP::predict_stream(const chunk_source &next_chunk,
+                        const prediction_sink &sink,
+                        bool uncertainty,
+                        int m_tile_size,
+                        int max_in_flight)
+{
+    if (uncertainty)
+    {
+        require_local("predict_stream with uncertainty");
+        require_direct("predict_stream with uncertainty");
+    }
+    if (m_tile_size < 0 || max_in_flight < 1)
+    {
+        throw std::invalid_argument("predict_stream needs m_tile_size >= 0 and max_in_flight >= 1");
+    }
+    const int tile_size = m_tile_size > 0 ? m_tile_size : _m_tile_size;
+    hpx::run_as_hpx_thread([this, &next_chunk, &sink, uncertainty, tile_size, max_in_flight]()
+                           {
+                               ensure_fitted();
+                               struct chunk_in_flight
+                               {
+                                   std::size_t offset;
+                                   std::size_t n_context;
+                                   hpx::shared_future<std::vector<std::vector<double>>> result;
+                               };
+                               std::deque<chunk_in_flight> in_flight;
+                               // samples of the stream the next chunk's lagged features reach back to
+                               std::vector<double> context;
+                               std::size_t offset = 0;
+                               bool exhausted = false;
+                               try
+                               {
+                                   while (true)
+                                   {
+                                       while (!exhausted && in_flight.size() < static_cast<std::size_t>(max_in_flight))
+                                       {
+                                           const std::vector<double> chunk = next_chunk();
+                                           if (chunk.empty())
+                                           {
+                                               exhausted = true;
+                                               break;
+                                           }
+                                           std::vector<double> input(context);
+                                           input.insert(input.end(), chunk.begin(), chunk.end());
+                                           const std::size_t n_context = context.size();
+                                           const std::size_t n_next_context = std::min(input.size(), static_cast<std::size_t>(n_regressors - 1));
+                                           context.assign(input.end() - n_next_context, input.end());
+                                           const int m_tiles = static_cast<int>((input.size() + tile_size - 1) / tile_size);
+                                           // the predictions wait for their tiles, so each chunk runs as a task of its own
+                                           hpx::shared_future<std::vector<std::vector<double>>> result =
+                                               hpx::async([this, input = std::move(input), m_tiles, tile_size, uncertainty]()
+                                                          { return schedule_prediction(input, m_tiles, tile_size, uncertainty).get(); });
+                                           in_flight.push_back({ offset, n_context, result });
+                                           offset += chunk.size();
+                                       }
+                                       if (in_flight.empty())
+                                       {
+                                           break;
+                                       }
+                                       chunk_in_flight front = std::move(in_flight.front());
+                                       in_flight.pop_front();
+                                       std::vector<std::vector<double>> result = front.result.get();
+                                       for (std::vector<double> &values : result)
+                                       {
+                                           values.erase(values.begin(), values.begin() + front.n_context);
+                                       }
+                                       sink(front.offset, result[0], uncertainty ? result[1] : std::vector<double>());
+                                   }
+                               }
+                               catch (...)
+                               {
+                                   // the chunks in flight use the GP, finish them before leaving
+                                   for (chunk_in_flight &chunk : in_flight)
+                                   {
+                                       chunk.result.wait();
+                                   }
+                                   throw;
+                               } });
+}
+
+/**
+ * @brief Predict the test input in chunks of chunk_size samples
+ *
+ * @param test_input Test input data
+ * @param chunk_size Number of samples per chunk
+ * @param sink Receives the predictions of each chunk
+ * @param uncertainty Also compute the variance
+ * @param m_tile_size Size of the test tiles, 0 for the tuned size
+ * @param max_in_flight Number of chunks scheduled ahead of the sink
+ */
+void GP::predict_chunked(const std::vector<double> &test_input,
+                         std::size_t chunk_size,
+                         const prediction_sink &sink,
+                         bool uncertainty,
+                         int m_tile_size,
+                         int max_in_flight)
+{
+    if (chunk_size == 0)
+    {
+        throw std::invalid_argument("predict_chunked needs chunk_size > 0");
+    }
+    std::size_t start = 0;
+    predict_stream([&test_input, chunk_size, &start]()
+                   {
+                       const std::size_t end = std::min(test_input.size(), start + chunk_size);
+                       std::vector<double> chunk(test_input.begin() + start, test_input.begin() + end);
+                       start = end;
+                       return chunk; },
+                   sink,
+                   uncertainty,
+                   m_tile_size,
+                   max_in_flight);
+}
+
+/**
+ * @brief Predict output for test input and additionally compute the
+ * posterior covariance matrix in `format`.
+ *
+ * No format forms the dense M x M matrix: CovarianceFormat::Lower updates
+ * the lower tiles only and CovarianceFormat::LowRank leaves
+ * Sigma = K_MxM - V^T * V to the caller.
  *
  * @param test_input Test input data
  * @param m_tiles Number of tiles
  * @param m_tile_size Size of each tile
+ * @param format Part of the posterior covariance to return
  *
- * @return Full covariance matrix
+ * @return Predictions, variances and the covariance in `format`
  */
 std::vector<std::vector<double>> GP::predict_with_full_cov(
-    const std::vector<double> &test_input, int m_tiles, int m_tile_size)
+    const std::vector<double> &test_input, int m_tiles, int m_tile_size, CovarianceFormat format)
 {
+    require_local("predict_with_full_cov");
+    require_direct("predict_with_full_cov");
+    if (_backend == Backend::GPU)
+    {
+        throw std::runtime_error("predict_with_full_cov does not support the GPU backend");
+    }
+    if (_precision == Precision::Mixed)
+    {
+        throw std::runtime_error("predict_with_full_cov does not support Precision::Mixed");
+    }
+    check_tiling(test_input.size(), m_tiles, m_tile_size, "test input");
     std::vector<std::vector<double>> result;
-    hpx::run_as_hpx_thread([this, &result, &test_input, m_tiles, m_tile_size]()
+    hpx::run_as_hpx_thread([this, &result, &test_input, m_tiles, m_tile_size, format]()
                            {
-                               result = predict_with_full_cov_hpx(
-                                            _training_input, _training_output, test_input, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance,
-                                            n_regressors)
+                               ensure_fitted();
+                               result = predict_with_full_cov_fitted_hpx(
+                                            _training_input, test_input, _K_tiles, _alpha_tiles, _n_tiles, _n_tile_size, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, noise_variance,
+                                            n_regressors, _kernel, format)
                                             .get();  // Wait for and get the result from the future
                            });
     return result;
@@ -174,17 +993,46 @@ std::vector<std::vector<double>> GP::predict_with_full_cov(
 std::vector<double>
 GP::optimize(const gpxpy_hyper::Hyperparameters &hyperparams)
 {
+    require_local("optimize");
+    // hyperparameters change, the cached factor becomes outdated
+    reset_fit();
     std::vector<double> losses;
     hpx::run_as_hpx_thread([this, &losses, &hyperparams]()
                            {
                                losses =
-                                   optimize_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, hyperparams,
-                                                trainable_params)
+                                   optimize_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _kernel,
+                                                hyperparams, trainable_params, _distance_cache)
                                        .get();  // Wait for and get the result from the future
                            });
     return losses;
 }
 
+/**
+ * @brief Run the optimizer as a background task
+ *
+ * @param hyperparams Optimizer settings
+ *
+ * @return Future of the losses
+ */
+hpx::shared_future<std::vector<double>>
+GP::optimize_async(const gpxpy_hyper::Hyperparameters &hyperparams)
+{
+    require_local("optimize_async");
+    // hyperparameters change, the cached factor becomes outdated
+    reset_fit();
+    hpx::shared_future<std::vector<double>> losses;
+    hpx::run_as_hpx_thread([this, &losses, hyperparams]()
+                           {
+                               losses = hpx::async([this, hyperparams]()
+                                                   {
+                                                       return optimize_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors,
+                                                                           _kernel, hyperparams, trainable_params, _distance_cache)
+                                                           .get();
+                                                   });
+                           });
+    return losses;
+}
+
 /**
  * @brief Perform a single optimization step
  *
@@ -197,50 +1045,732 @@ GP::optimize(const gpxpy_hyper::Hyperparameters &hyperparams)
 double GP::optimize_step(gpxpy_hyper::Hyperparameters &hyperparams,
                          int iter)
 {
+    require_local("optimize_step");
+    // hyperparameters change, the cached factor becomes outdated
+    reset_fit();
     double loss;
     hpx::run_as_hpx_thread([this, &loss, &hyperparams, iter]()
                            {
                                loss =
-                                   optimize_step_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, hyperparams, trainable_params,
-                                                     iter)
+                                   optimize_step_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, n_regressors, _kernel, hyperparams,
+                                                     trainable_params, iter, _distance_cache)
                                        .get();  // Wait for and get the result from the future
                            });
     return loss;
 }
 
+/**
+ * @brief Set the memory budget of the distance tile cache in bytes
+ */
+void GP::set_distance_cache_budget(std::size_t bytes)
+{
+    _distance_cache.set_budget(bytes);
+}
+
+/**
+ * @brief Returns the memory budget of the distance tile cache in bytes
+ */
+std::size_t GP::distance_cache_budget() const
+{
+    return _distance_cache.budget();
+}
+
+/**
+ * @brief Drop the cached distance tiles
+ */
+void GP::clear_distance_cache()
+{
+    _distance_cache.clear();
+}
+
 /**
  * @brief Calculate loss for given data and Gaussian process model
  */
 double GP::calculate_loss()
 {
-    double hyperparameters[3];
-    hyperparameters[0] = lengthscale;
-    hyperparameters[1] = vertical_lengthscale;
-    hyperparameters[2] = noise_variance;
-
     double loss;
-    hpx::run_as_hpx_thread([this, &loss, &hyperparameters]()
+    hpx::run_as_hpx_thread([this, &loss]()
                            {
-                               loss = compute_loss_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, n_regressors,
-                                                       hyperparameters)
+                               if (_solver == Solver::Iterative)
+                               {
+                                   ensure_iterative_loss();
+                                   loss = _iterative_loss;
+                                   return;
+                               }
+                               ensure_fitted();
+                               loss = compute_loss_fitted_hpx(_training_output, _K_tiles, _alpha_tiles, _n_tiles, _n_tile_size)
                                           .get();  // Wait for and get the result from the future
                            });
     return loss;
 }
 
+/**
+ * @brief Schedule the loss computation without waiting for it
+ *
+ * @return Future of the loss
+ */
+hpx::shared_future<double> GP::calculate_loss_async()
+{
+    hpx::shared_future<double> loss;
+    hpx::run_as_hpx_thread([this, &loss]()
+                           {
+                               if (_solver == Solver::Iterative)
+                               {
+                                   // the estimate is computed by the fit
+                                   ensure_iterative_loss();
+                                   loss = hpx::make_ready_future(_iterative_loss).share();
+                                   return;
+                               }
+                               ensure_fitted();
+                               loss = compute_loss_fitted_hpx(_training_output, _K_tiles, _alpha_tiles, _n_tiles, _n_tile_size);
+                           });
+    return loss;
+}
+
 /**
  * @brief Computes & returns cholesky decomposition
  */
 std::vector<std::vector<double>> GP::cholesky()
 {
-    std::vector<std::vector<double>> result;
+    require_direct("cholesky");
+    std::vector<std::vector<double>> result(_n_tiles * _n_tiles);
     hpx::run_as_hpx_thread([this, &result]()
                            {
-                               result = cholesky_hpx(_training_input, _training_output, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance,
-                                                     n_regressors)
-                                            .get();  // Wait for and get the result from the future
+                               ensure_fitted();
+                               for (std::size_t i = 0; i < _n_tiles; i++)
+                               {
+                                   for (std::size_t j = 0; j <= i; j++)
+                                   {
+                                       // a distributed, device or single precision factor is gathered tile by tile
+                                       mutable_tile_data<double> tile;
+                                       if (_distributed_K)
+                                       {
+                                           tile = fetch_tile_distributed(*_distributed_K, i, j).get();
+                                       }
+#ifdef GPXPY_WITH_CUDA
+                                       else if (_gpu_state)
+                                       {
+                                           tile = gpu::download(_gpu_state->L_tiles[i * _n_tiles + j].get());
+                                       }
+#endif
+                                       else if (!_single_K_tiles.empty())
+                                       {
+                                           tile = convert_tile<double, float>(_single_K_tiles[i * _n_tiles + j].get());
+                                       }
+                                       else
+                                       {
+                                           tile = _K_tiles[i * _n_tiles + j].get();
+                                       }
+                                       result[i * _n_tiles + j].assign(tile.begin(), tile.end());
+                                   }
+                               }
                            });
     return result;
 }
 
+/**
+ * @brief Start a session at the current GP hyperparameters
+ *
+ * @param gp Gaussian process to optimize
+ * @param hyperparams Optimizer settings
+ */
+OptimizerSession::OptimizerSession(GP &gp,
+                                   const gpxpy_hyper::Hyperparameters &hyperparams) :
+    _gp(gp),
+    _hyperparams(hyperparams),
+    _state(new optimizer_session_state())
+{
+    _gp.require_local("OptimizerSession");
+    hpx::run_as_hpx_thread([this]()
+                           { init_optimizer_session_hpx(*_state, _gp._training_output, _gp._n_tiles, _gp._n_tile_size, _gp.lengthscale, _gp.vertical_lengthscale, _gp.noise_variance, _gp._kernel, _hyperparams); });
+    _state->data_generation = _gp._data_generation;
+}
+
+/**
+ * @brief Perform one optimization step and update the GP hyperparameters
+ *
+ * @return loss before the step
+ */
+double OptimizerSession::step()
+{
+    // hyperparameters change, the cached factor becomes outdated
+    _gp.reset_fit();
+    double loss;
+    hpx::run_as_hpx_thread([this, &loss]()
+                           {
+                               if (_state->data_generation != _gp._data_generation || _state->n_tiles != _gp._n_tiles || _state->n_tile_size != _gp._n_tile_size)
+                               {
+                                   // appended to, the output and the tiles scheduled ahead belong to the old data
+                                   update_optimizer_session_data(*_state, _gp._training_output, _gp._n_tiles, _gp._n_tile_size);
+                                   _state->data_generation = _gp._data_generation;
+                               }
+                               const optimizer_parameters current = _state->hyperparameters.get();
+                               if (std::array<double, 3>{ current[0], current[1], current[2] }
+                                       != std::array<double, 3>{ _gp.lengthscale, _gp.vertical_lengthscale, _gp.noise_variance }
+                                   || current.kernel != _gp._kernel)
+                               {
+                                   // changed by the user, the tiles scheduled ahead are outdated
+                                   discard_optimizer_session_tiles(*_state);
+                                   optimizer_parameters changed = update_kernel_params(current, _gp.lengthscale, _gp.vertical_lengthscale, _gp.noise_variance);
+                                   changed.kernel = _gp._kernel;
+                                   _state->hyperparameters = hpx::make_ready_future(changed);
+                               }
+                               hpx::shared_future<double> step_loss =
+                                   optimizer_session_step_hpx(*_state, _gp._training_input, _gp._training_output, _gp._n_tiles, _gp._n_tile_size, _gp.n_regressors, _hyperparams, _gp.trainable_params,
+                                                              _gp._distance_cache);
+                               const optimizer_parameters &updated = _state->hyperparameters.get();
+                               _gp.lengthscale = updated[0];
+                               _gp.vertical_lengthscale = updated[1];
+                               _gp.noise_variance = updated[2];
+                               loss = step_loss.get();
+                           });
+    return loss;
+}
+
+/**
+ * @brief Returns the number of steps taken
+ */
+int OptimizerSession::iteration() const { return _state->iter; }
+
+/**
+ * @brief Returns the optimizer settings with the current Adam moments
+ */
+gpxpy_hyper::Hyperparameters OptimizerSession::hyperparameters() const
+{
+    gpxpy_hyper::Hyperparameters result = _hyperparams;
+    for (std::size_t i = 0; i < 3; i++)
+    {
+        result.M_T[i] = _state->m_T[i].get();
+        result.V_T[i] = _state->v_T[i].get();
+    }
+    return result;
+}
+
+/**
+ * @brief Initialize of a sparse Gaussian process.
+ *
+ * @param input Training input data
+ * @param output Training output data
+ * @param inducing_input Input series of the inducing points
+ * @param n_tiles Number of tiles
+ * @param n_tile_size Size of each tile
+ * @param l Lengthscale
+ * @param v Vertical lengthscale
+ * @param n Noise variance
+ * @param n_r Number of regressors
+ * @param trainable_bool Boolean vector indicating which hyperparameters are
+ * trainable
+ */
+SparseGP::SparseGP(std::vector<double> input,
+                   std::vector<double> output,
+                   std::vector<double> inducing_input,
+                   int n_tiles,
+                   int n_tile_size,
+                   double l,
+                   double v,
+                   double n,
+                   int n_r,
+                   std::vector<bool> trainable_bool) :
+    _training_input(std::move(input)),
+    _training_output(std::move(output)),
+    _inducing_input(std::move(inducing_input)),
+    _n_tiles(n_tiles),
+    _n_tile_size(n_tile_size),
+    lengthscale(l),
+    vertical_lengthscale(v),
+    noise_variance(n),
+    n_regressors(n_r),
+    trainable_params(trainable_bool),
+    jitter(1e-6)
+{
+    check_tiling(_training_input.size(), _n_tiles, _n_tile_size, "training input");
+    if (_training_output.size() != _training_input.size())
+    {
+        throw std::invalid_argument("The training input and output differ in the number of samples");
+    }
+    if (_inducing_input.empty())
+    {
+        throw std::invalid_argument("The sparse GP needs at least one inducing point");
+    }
+}
+
+/**
+ * Returns sparse Gaussian process attributes as string.
+ */
+std::string SparseGP::repr() const
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(12);
+    oss << "Kernel_Params: [lengthscale=" << lengthscale
+        << ", vertical_lengthscale=" << vertical_lengthscale
+        << ", noise_variance=" << noise_variance
+        << ", n_regressors=" << n_regressors
+        << ", n_inducing=" << _inducing_input.size()
+        << ", trainable_params l=" << trainable_params[0]
+        << ", trainable_params v=" << trainable_params[1]
+        << ", trainable_params n=" << trainable_params[2] << "]";
+    return oss.str();
+}
+
+/**
+ * @brief Returns training input data
+ */
+std::vector<double> SparseGP::get_training_input() const
+{
+    return _training_input;
+}
+
+/**
+ * @brief Returns training output data
+ */
+std::vector<double> SparseGP::get_training_output() const
+{
+    return _training_output;
+}
+
+/**
+ * @brief Returns the input series of the inducing points
+ */
+std::vector<double> SparseGP::get_inducing_input() const
+{
+    return _inducing_input;
+}
+
+/**
+ * @brief Compute and cache the factorization of the sparse GP
+ */
+void SparseGP::fit()
+{
+    hpx::run_as_hpx_thread([this]()
+                           { ensure_fitted(); });
+}
+
+/**
+ * @brief Returns true if the cached factorization matches the current
+ * hyperparameters and number of regressors
+ */
+bool SparseGP::is_fitted() const
+{
+    return _state
+           && _fitted_params == std::array<double, 4>{ lengthscale, vertical_lengthscale, noise_variance, jitter }
+           && _fitted_n_regressors == n_regressors;
+}
+
+/**
+ * @brief Compute the factorization unless it is cached for the current
+ * hyperparameters. Must be called on an HPX thread.
+ */
+void SparseGP::ensure_fitted()
+{
+    if (is_fitted())
+    {
+        return;
+    }
+    // free the outdated factorization before computing the new one
+    _state.reset();
+    _state = std::make_shared<sparse::fit_state>(
+        sparse::fit_hpx(_training_input, _training_output, _inducing_input, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, jitter, n_regressors)
+            .get());
+    _fitted_params = { lengthscale, vertical_lengthscale, noise_variance, jitter };
+    _fitted_n_regressors = n_regressors;
+}
+
+/**
+ * @brief Predict output for test input
+ *
+ * @param test_data Test input data
+ * @param m_tiles Number of tiles
+ * @param m_tile_size Size of each tile
+ *
+ * @return Predicted output
+ */
+std::vector<double> SparseGP::predict(const std::vector<double> &test_data,
+                                      int m_tiles,
+                                      int m_tile_size)
+{
+    check_tiling(test_data.size(), m_tiles, m_tile_size, "test input");
+    std::vector<double> result;
+    hpx::run_as_hpx_thread([this, &result, &test_data, m_tiles, m_tile_size]()
+                           {
+                               ensure_fitted();
+                               result = sparse::predict_hpx(*_state, _inducing_input, test_data, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, n_regressors, false)
+                                            .get()[0];  // Wait for and get the result from the future
+                           });
+    return result;
+}
+
+/**
+ * @brief Predict output for test input and additionally provide the variance
+ * of the predictions
+ *
+ * @param test_input Test input data
+ * @param m_tiles Number of tiles
+ * @param m_tile_size Size of each tile
+ *
+ * @return mean and variance
+ */
+std::vector<std::vector<double>> SparseGP::predict_with_uncertainty(
+    const std::vector<double> &test_input, int m_tiles, int m_tile_size)
+{
+    check_tiling(test_input.size(), m_tiles, m_tile_size, "test input");
+    std::vector<std::vector<double>> result;
+    hpx::run_as_hpx_thread([this, &result, &test_input, m_tiles, m_tile_size]()
+                           {
+                               ensure_fitted();
+                               result = sparse::predict_hpx(*_state, _inducing_input, test_input, m_tiles, m_tile_size, lengthscale, vertical_lengthscale, n_regressors, true)
+                                            .get();  // Wait for and get the result from the future
+                           });
+    return result;
+}
+
+/**
+ * @brief Optimize hyperparameters by minimizing the variational free energy
+ *
+ * @param hyperparams Optimizer settings
+ *
+ * @return losses
+ */
+std::vector<double>
+SparseGP::optimize(const gpxpy_hyper::Hyperparameters &hyperparams)
+{
+    // hyperparameters change, the cached factorization becomes outdated
+    _state.reset();
+    std::vector<double> losses;
+    hpx::run_as_hpx_thread([this, &losses, &hyperparams]()
+                           {
+                               losses =
+                                   sparse::optimize_hpx(_training_input, _training_output, _inducing_input, _n_tiles, _n_tile_size, lengthscale, vertical_lengthscale, noise_variance, jitter,
+                                                        n_regressors, hyperparams, trainable_params)
+                                       .get();  // Wait for and get the result from the future
+                           });
+    return losses;
+}
+
+/**
+ * @brief Calculate the variational free energy per training sample
+ */
+double SparseGP::calculate_loss()
+{
+    double loss;
+    hpx::run_as_hpx_thread([this, &loss]()
+                           {
+                               ensure_fitted();
+                               loss = _state->loss;
+                           });
+    return loss;
+}
+
+/**
+ * @brief Initialize a batch of Gaussian processes.
+ *
+ * @param input Training input data
+ * @param outputs Training outputs
+ * @param n_tiles Number of tiles
+ * @param n_tile_size Size of each tile
+ * @param hyperparameter_sets Lengthscale, vertical lengthscale and noise
+ * variance of each hyperparameter set
+ * @param n_r Number of regressors
+ * @param trainable_bool Boolean vector indicating which hyperparameters are
+ * trainable
+ */
+BatchedGP::BatchedGP(std::vector<double> input,
+                     std::vector<std::vector<double>> outputs,
+                     int n_tiles,
+                     int n_tile_size,
+                     const std::vector<std::array<double, 3>> &hyperparameter_sets,
+                     int n_r,
+                     std::vector<bool> trainable_bool) :
+    _training_input(std::move(input)),
+    _training_outputs(std::move(outputs)),
+    _n_tiles(n_tiles),
+    _n_tile_size(n_tile_size),
+    n_regressors(n_r),
+    trainable_params(trainable_bool)
+{
+    check_tiling(_training_input.size(), _n_tiles, _n_tile_size, "training input");
+    if (_training_outputs.empty() || hyperparameter_sets.empty())
+    {
+        throw std::invalid_argument("The batch needs at least one training output and one hyperparameter set");
+    }
+    for (const std::vector<double> &output : _training_outputs)
+    {
+        if (output.size() != _training_input.size())
+        {
+            throw std::invalid_argument("The training input and output differ in the number of samples");
+        }
+    }
+    for (const std::array<double, 3> &params : hyperparameter_sets)
+    {
+        hyperparameters.insert(hyperparameters.end(), _training_outputs.size(), params);
+    }
+}
+
+/**
+ * Returns batched Gaussian process attributes as string.
+ */
+std::string BatchedGP::repr() const
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(12);
+    oss << "Kernel_Params: [n_members=" << n_members()
+        << ", n_outputs=" << n_outputs()
+        << ", n_regressors=" << n_regressors
+        << ", trainable_params l=" << trainable_params[0]
+        << ", trainable_params v=" << trainable_params[1]
+        << ", trainable_params n=" << trainable_params[2] << "]";
+    return oss.str();
+}
+
+/**
+ * @brief Returns the number of training outputs
+ */
+std::size_t BatchedGP::n_outputs() const
+{
+    return _training_outputs.size();
+}
+
+/**
+ * @brief Returns the number of members
+ */
+std::size_t BatchedGP::n_members() const
+{
+    return hyperparameters.size();
+}
+
+/**
+ * @brief Returns the index of the training output of member `member`
+ */
+std::size_t BatchedGP::member_output(std::size_t member) const
+{
+    return member % _training_outputs.size();
+}
+
+/**
+ * @brief Returns training input data
+ */
+std::vector<double> BatchedGP::get_training_input() const
+{
+    return _training_input;
+}
+
+/**
+ * @brief Returns the training outputs
+ */
+std::vector<std::vector<double>> BatchedGP::get_training_outputs() const
+{
+    return _training_outputs;
+}
+
+/**
+ * @brief Compute and cache the factors of all members
+ */
+void BatchedGP::fit()
+{
+    hpx::run_as_hpx_thread([this]()
+                           { ensure_fitted(); });
+}
+
+/**
+ * @brief Returns true if the cached factors match the current
+ * hyperparameters of all members and number of regressors
+ */
+bool BatchedGP::is_fitted() const
+{
+    return !_fits.empty() && _fitted_params == hyperparameters && _fitted_n_regressors == n_regressors;
+}
+
+/**
+ * @brief Compute the factors unless they are cached for the current
+ * hyperparameters. Must be called on an HPX thread.
+ *
+ * Members with the same hyperparameters are grouped into one fit.
+ */
+void BatchedGP::ensure_fitted()
+{
+    if (is_fitted())
+    {
+        return;
+    }
+    // free the outdated factors before computing the new ones
+    _fits.clear();
+    for (std::size_t m = 0; m < hyperparameters.size(); m++)
+    {
+        auto fit = std::find_if(_fits.begin(), _fits.end(), [&](const batched_fit &f)
+                                { return f.params == hyperparameters[m]; });
+        if (fit == _fits.end())
+        {
+            fit = _fits.insert(_fits.end(), batched_fit{ hyperparameters[m], {}, {}, {} });
+        }
+        fit->outputs.push_back(member_output(m));
+    }
+    fit_batched_hpx(_training_input, _training_outputs, _n_tiles, _n_tile_size, n_regressors, _distance_cache, _fits);
+    _fitted_params = hyperparameters;
+    _fitted_n_regressors = n_regressors;
+}
+
+/**
+ * @brief Returns the index of each member in the results of the fits, which
+ * are ordered by fit and by output within a fit
+ */
+std::vector<std::size_t> BatchedGP::member_slots() const
+{
+    std::vector<std::size_t> slots(hyperparameters.size());
+    for (std::size_t m = 0; m < hyperparameters.size(); m++)
+    {
+        std::size_t slot = 0;
+        for (const batched_fit &fit : _fits)
+        {
+            if (fit.params == hyperparameters[m])
+            {
+                const auto column = std::find(fit.outputs.begin(), fit.outputs.end(), member_output(m));
+                slot += static_cast<std::size_t>(column - fit.outputs.begin());
+                break;
+            }
+            slot += fit.outputs.size();
+        }
+        slots[m] = slot;
+    }
+    return slots;
+}
+
+/**
+ * @brief Predict the output of each member for test input
+ *
+ * @param test_data Test input data
+ * @param m_tiles Number of tiles
+ * @param m_tile_size Size of each tile
+ *
+ * @return Predicted output of each member
+ */
+std::vector<std::vector<double>> BatchedGP::predict(const std::vector<double> &test_data,
+                                                    int m_tiles,
+                                                    int m_tile_size)
+{
+    check_tiling(test_data.size(), m_tiles, m_tile_size, "test input");
+    std::vector<std::vector<double>> result(hyperparameters.size());
+    hpx::run_as_hpx_thread([this, &result, &test_data, m_tiles, m_tile_size]()
+                           {
+                               ensure_fitted();
+                               std::vector<std::vector<std::vector<double>>> predictions =
+                                   predict_batched_hpx(_training_input, test_data, _fits, _n_tiles, _n_tile_size, m_tiles, m_tile_size, n_regressors, false)
+                                       .get();  // Wait for and get the result from the future
+                               const std::vector<std::size_t> slots = member_slots();
+                               for (std::size_t m = 0; m < slots.size(); m++)
+                               {
+                                   result[m] = predictions[slots[m]][0];
+                               }
+                           });
+    return result;
+}
+
+/**
+ * @brief Predict the output of each member for test input and additionally
+ * provide the variance of the predictions
+ *
+ * @param test_input Test input data
+ * @param m_tiles Number of tiles
+ * @param m_tile_size Size of each tile
+ *
+ * @return mean and variance of each member
+ */
+std::vector<std::vector<std::vector<double>>> BatchedGP::predict_with_uncertainty(
+    const std::vector<double> &test_input, int m_tiles, int m_tile_size)
+{
+    check_tiling(test_input.size(), m_tiles, m_tile_size, "test input");
+    std::vector<std::vector<std::vector<double>>> result(hyperparameters.size());
+    hpx::run_as_hpx_thread([this, &result, &test_input, m_tiles, m_tile_size]()
+                           {
+                               ensure_fitted();
+                               std::vector<std::vector<std::vector<double>>> predictions =
+                                   predict_batched_hpx(_training_input, test_input, _fits, _n_tiles, _n_tile_size, m_tiles, m_tile_size, n_regressors, true)
+                                       .get();  // Wait for and get the result from the future
+                               const std::vector<std::size_t> slots = member_slots();
+                               for (std::size_t m = 0; m < slots.size(); m++)
+                               {
+                                   result[m] = predictions[slots[m]];
+                               }
+                           });
+    return result;
+}
+
+/**
+ * @brief Optimize the hyperparameters of every member with Adam
+ *
+ * @param hyperparams Optimizer settings
+ *
+ * @return losses of each member
+ */
+std::vector<std::vector<double>>
+BatchedGP::optimize(const gpxpy_hyper::Hyperparameters &hyperparams)
+{
+    // hyperparameters change, the cached factors become outdated
+    _fits.clear();
+    std::vector<std::size_t> member_outputs(hyperparameters.size());
+    for (std::size_t m = 0; m < member_outputs.size(); m++)
+    {
+        member_outputs[m] = member_output(m);
+    }
+    std::vector<std::vector<double>> losses;
+    hpx::run_as_hpx_thread([this, &losses, &hyperparams, &member_outputs]()
+                           {
+                               losses =
+                                   optimize_batched_hpx(_training_input, _training_outputs, member_outputs, _n_tiles, _n_tile_size, hyperparameters, n_regressors, hyperparams,
+                                                        trainable_params, _distance_cache)
+                                       .get();  // Wait for and get the result from the future
+                           });
+    return losses;
+}
+
+/**
+ * @brief Calculate the loss of each member
+ */
+std::vector<double> BatchedGP::calculate_loss()
+{
+    std::vector<double> result(hyperparameters.size());
+    hpx::run_as_hpx_thread([this, &result]()
+                           {
+                               ensure_fitted();
+                               std::vector<std::vector<double>> losses =
+                                   compute_loss_batched_hpx(_training_outputs, _fits, _n_tiles, _n_tile_size)
+                                       .get();  // Wait for and get the result from the future
+                               for (std::size_t m = 0; m < hyperparameters.size(); m++)
+                               {
+                                   for (std::size_t f = 0; f < _fits.size(); f++)
+                                   {
+                                       if (_fits[f].params == hyperparameters[m])
+                                       {
+                                           const auto column = std::find(_fits[f].outputs.begin(), _fits[f].outputs.end(), member_output(m));
+                                           result[m] = losses[f][column - _fits[f].outputs.begin()];
+                                           break;
+                                       }
+                                   }
+                               }
+                           });
+    return result;
+}
+
+/**
+ * @brief Set the memory budget of the distance tile cache in bytes
+ */
+void BatchedGP::set_distance_cache_budget(std::size_t bytes)
+{
+    _distance_cache.set_budget(bytes);
+}
+
+/**
+ * @brief Returns the memory budget of the distance tile cache in bytes
+ */
+std::size_t BatchedGP::distance_cache_budget() const
+{
+    return _distance_cache.budget();
+}
+
+/**
+ * @brief Drop the cached distance tiles
+ */
+void BatchedGP::clear_distance_cache()
+{
+    _distance_cache.clear();
+}
+
 }  // namespace gpxpy
@@ -0,0 +1,304 @@
+#include "../include/model_file.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace model_file
+{
+namespace
+{
+constexpr char magic[8] = { 'G', 'P', 'X', 'P', 'Y', 'M', 'D', 'L' };
+constexpr std::uint32_t format_version = 1;
+constexpr std::uint32_t flag_factor = 1;
+constexpr std::uint64_t byte_order_mark = 0x0102030405060708;
+constexpr std::size_t header_bytes = 128;
+
+// Memory-Mapped Files ----------------------------------------------------- {{{
+
+// Private writable mapping of a whole file, unmapped on destruction. Writes
+// copy the touched pages and never reach the file.
+class mapped_file
+{
+  public:
+    explicit mapped_file(const std::string &file_path)
+    {
+        int fd = open(file_path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Error: File not found: " + file_path);
+        }
+        struct stat status;
+        if (fstat(fd, &status) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Error: Cannot read file: " + file_path);
+        }
+        _size = static_cast<std::size_t>(status.st_size);
+        if (_size > 0)
+        {
+            void *data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("Error: Cannot map file: " + file_path);
+            }
+            _data = static_cast<char *>(data);
+        }
+        // the mapping outlives the descriptor
+        close(fd);
+    }
+
+    ~mapped_file()
+    {
+        if (_data != nullptr)
+        {
+            munmap(_data, _size);
+        }
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    char *data() const { return _data; }
+
+    std::size_t size() const { return _size; }
+
+  private:
+    char *_data = nullptr;
+    std::size_t _size = 0;
+};
+
+// }}} ---------------------------------------------- end of Memory-Mapped Files
+
+// Layout ------------------------------------------------------------------ {{{
+
+// Bytes of `n` doubles rounded up to the alignment of the sections
+std::size_t section_bytes(std::size_t n)
+{
+    return (n * sizeof(double) + TILE_ALIGNMENT - 1) / TILE_ALIGNMENT * TILE_ALIGNMENT;
+}
+
+// Offsets of the sections of a file, see model_file.hpp
+struct layout
+{
+    std::size_t input;
+    std::size_t output;
+    std::size_t K_tiles;
+    std::size_t K_tile_bytes;
+    std::size_t alpha_tiles;
+    std::size_t alpha_tile_bytes;
+    std::size_t end;
+
+    layout(std::size_t n_samples, std::size_t n_tiles, std::size_t n_tile_size, bool factor) :
+        input(header_bytes),
+        output(input + section_bytes(n_samples)),
+        K_tiles(output + section_bytes(n_samples)),
+        K_tile_bytes(section_bytes(n_tile_size * n_tile_size)),
+        alpha_tiles(K_tiles + (factor ? n_tiles * (n_tiles + 1) / 2 * K_tile_bytes : 0)),
+        alpha_tile_bytes(section_bytes(n_tile_size)),
+        end(alpha_tiles + (factor ? n_tiles * alpha_tile_bytes : 0))
+    { }
+};
+
+template <typename U>
+void store(char *bytes, U value)
+{
+    std::memcpy(bytes, &value, sizeof(U));
+}
+
+template <typename U>
+U load(const char *bytes)
+{
+    U value;
+    std::memcpy(&value, bytes, sizeof(U));
+    return value;
+}
+
+// Write `bytes` bytes of `data` followed by zeros up to `padded` bytes
+bool write_padded(FILE *file, const void *data, std::size_t bytes, std::size_t padded)
+{
+    static const char zeros[TILE_ALIGNMENT] = {};
+    return fwrite(data, 1, bytes, file) == bytes
+           && fwrite(zeros, 1, padded - bytes, file) == padded - bytes;
+}
+
+// }}} ---------------------------------------------------------- end of Layout
+
+}  // namespace
+
+/**
+ * @brief Write a snapshot file
+ *
+ * @param file_path path to the file, overwritten if it exists
+ * @param model snapshot to write, the factor is written if alpha_tiles is
+ *        not empty
+ */
+void write(const std::string &file_path, const snapshot &model)
+{
+    const std::size_t n_samples = model.training_input.size();
+    const std::size_t n_tiles = static_cast<std::size_t>(model.n_tiles);
+    const std::size_t n_tile_size = static_cast<std::size_t>(model.n_tile_size);
+    const bool factor = !model.alpha_tiles.empty();
+    if (model.training_output.size() != n_samples || model.trainable_params.size() != 3
+        || (factor && (model.K_tiles.size() != n_tiles * n_tiles || model.alpha_tiles.size() != n_tiles)))
+    {
+        throw std::invalid_argument("Error: Inconsistent snapshot, cannot write " + file_path);
+    }
+    const layout sections(n_samples, n_tiles, n_tile_size, factor);
+
+    char head[header_bytes] = {};
+    std::memcpy(head, magic, sizeof(magic));
+    store<std::uint32_t>(head + 8, format_version);
+    store<std::uint32_t>(head + 12, factor ? flag_factor : 0);
+    store<std::uint64_t>(head + 16, n_samples);
+    store<std::int32_t>(head + 24, model.n_tiles);
+    store<std::int32_t>(head + 28, model.n_tile_size);
+    store<std::int32_t>(head + 32, model.m_tile_size);
+    store<std::int32_t>(head + 36, model.n_regressors);
+    for (std::size_t i = 0; i < 3; i++)
+    {
+        store<double>(head + 40 + 8 * i, model.params[i]);
+    }
+    std::uint32_t trainable = 0;
+    for (std::size_t i = 0; i < 3; i++)
+    {
+        trainable |= model.trainable_params[i] ? 1u << i : 0u;
+    }
+    store<std::uint32_t>(head + 64, trainable);
+    store<std::uint32_t>(head + 68, static_cast<std::uint32_t>(model.kernel.type));
+    store<std::uint64_t>(head + 72, byte_order_mark);
+    store<double>(head + 80, model.kernel.shape);
+
+    FILE *file = fopen(file_path.c_str(), "wb");
+    if (file == NULL)
+    {
+        throw std::runtime_error("Error: Cannot open file for writing: " + file_path);
+    }
+    bool written = fwrite(head, 1, header_bytes, file) == header_bytes
+                   && write_padded(file, model.training_input.data(), n_samples * sizeof(double), section_bytes(n_samples))
+                   && write_padded(file, model.training_output.data(), n_samples * sizeof(double), section_bytes(n_samples));
+    for (std::size_t i = 0; factor && written && i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; written && j <= i; j++)
+        {
+            const mutable_tile_data<double> &tile = model.K_tiles[i * n_tiles + j];
+            written = tile.size() == n_tile_size * n_tile_size
+                      && write_padded(file, tile.data(), tile.size() * sizeof(double), sections.K_tile_bytes);
+        }
+    }
+    for (std::size_t i = 0; factor && written && i < n_tiles; i++)
+    {
+        const mutable_tile_data<double> &tile = model.alpha_tiles[i];
+        written = tile.size() == n_tile_size
+                  && write_padded(file, tile.data(), tile.size() * sizeof(double), sections.alpha_tile_bytes);
+    }
+    if ((fclose(file) != 0) || !written)
+    {
+        throw std::runtime_error("Error: Cannot write file: " + file_path);
+    }
+}
+
+/**
+ * @brief Read a snapshot file
+ *
+ * The training data is copied out of the mapping. The tiles share the
+ * mapping through aliasing pointers, it is unmapped with the last of them.
+ *
+ * @param file_path path to the file
+ * @param load_factor also load the factor and alpha if they are stored
+ */
+snapshot read(const std::string &file_path, bool load_factor)
+{
+    auto file = std::make_shared<mapped_file>(file_path);
+    const char *bytes = file->data();
+    if (file->size() < header_bytes || std::memcmp(bytes, magic, sizeof(magic)) != 0)
+    {
+        throw std::runtime_error("Error: Not a GP snapshot file: " + file_path);
+    }
+    const std::uint32_t version = load<std::uint32_t>(bytes + 8);
+    if (version != format_version)
+    {
+        throw std::runtime_error("Error: Unsupported GP snapshot version "
+                                 + std::to_string(version) + ": " + file_path);
+    }
+    if (load<std::uint64_t>(bytes + 72) != byte_order_mark)
+    {
+        throw std::runtime_error("Error: GP snapshot written with another byte order: " + file_path);
+    }
+
+    snapshot model;
+    const bool factor = (load<std::uint32_t>(bytes + 12) & flag_factor) != 0;
+    const std::size_t n_samples = static_cast<std::size_t>(load<std::uint64_t>(bytes + 16));
+    model.n_tiles = load<std::int32_t>(bytes + 24);
+    model.n_tile_size = load<std::int32_t>(bytes + 28);
+    model.m_tile_size = load<std::int32_t>(bytes + 32);
+    model.n_regressors = load<std::int32_t>(bytes + 36);
+    for (std::size_t i = 0; i < 3; i++)
+    {
+        model.params[i] = load<double>(bytes + 40 + 8 * i);
+    }
+    const std::uint32_t trainable = load<std::uint32_t>(bytes + 64);
+    for (std::size_t i = 0; i < 3; i++)
+    {
+        model.trainable_params.push_back((trainable >> i) & 1u);
+    }
+    const std::uint32_t kernel = load<std::uint32_t>(bytes + 68);
+    if (kernel > static_cast<std::uint32_t>(Kernel::RationalQuadratic))
+    {
+        throw std::runtime_error("Error: Unknown kernel in GP snapshot: " + file_path);
+    }
+    model.kernel.type = static_cast<Kernel>(kernel);
+    if (model.kernel.type == Kernel::RationalQuadratic)
+    {
+        model.kernel.shape = load<double>(bytes + 80);
+    }
+    if (model.n_tiles <= 0 || model.n_tile_size <= 0)
+    {
+        throw std::runtime_error("Error: Invalid tiling in GP snapshot: " + file_path);
+    }
+    const std::size_t n_tiles = static_cast<std::size_t>(model.n_tiles);
+    const std::size_t n_tile_size = static_cast<std::size_t>(model.n_tile_size);
+    const layout sections(n_samples, n_tiles, n_tile_size, factor);
+    if (file->size() < sections.end)
+    {
+        throw std::runtime_error("Error: GP snapshot is truncated: " + file_path);
+    }
+
+    const double *input = reinterpret_cast<const double *>(bytes + sections.input);
+    const double *output = reinterpret_cast<const double *>(bytes + sections.output);
+    model.training_input.assign(input, input + n_samples);
+    model.training_output.assign(output, output + n_samples);
+    if (!factor || !load_factor)
+    {
+        return model;
+    }
+
+    // views of the mapping, which each of them keeps alive
+    const std::shared_ptr<double[]> mapping(file, reinterpret_cast<double *>(file->data()));
+    model.K_tiles.resize(n_tiles * n_tiles);
+    std::size_t offset = sections.K_tiles;
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            model.K_tiles[i * n_tiles + j] = mutable_tile_data<double>(
+                std::shared_ptr<double[]>(mapping, reinterpret_cast<double *>(file->data() + offset)), n_tile_size * n_tile_size);
+            offset += sections.K_tile_bytes;
+        }
+    }
+    model.alpha_tiles.resize(n_tiles);
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        model.alpha_tiles[i] = mutable_tile_data<double>(
+            std::shared_ptr<double[]>(mapping, reinterpret_cast<double *>(file->data() + sections.alpha_tiles + i * sections.alpha_tile_bytes)), n_tile_size);
+    }
+    return model;
+}
+}  // namespace model_file
@@ -0,0 +1,381 @@
+#include "../include/profiling.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <hpx/include/performance_counters.hpp>
+#include <hpx/include/runtime.hpp>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace profiling
+{
+namespace
+{
+// A recorded task of the timeline
+struct trace_event
+{
+    const char *name;
+
+    std::size_t thread;
+
+    // microseconds since start()
+    double begin;
+
+    double duration;
+};
+
+// Recording state, the counters and the timeline are guarded by the mutex
+std::atomic<bool> active{ false };
+std::mutex mutex;
+bool tracing = false;
+std::chrono::steady_clock::time_point start_time;
+std::chrono::steady_clock::time_point stop_time;
+
+// Kernels in the order of their first task, indexed by the address of their
+// annotation. Equal annotations of different translation units may have
+// different addresses and are merged in get_report().
+std::vector<kernel_stats> kernels;
+std::unordered_map<const char *, std::size_t> kernel_index;
+std::vector<trace_event> events;
+
+// Floating point operations of the BLAS calls on this thread
+thread_local double flops_counter = 0.0;
+
+bool starts_with(const std::string &text, const char *prefix)
+{
+    return text.rfind(prefix, 0) == 0;
+}
+
+double to_seconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+// Append the JSON string literal of text
+void write_json_string(std::ofstream &out, const std::string &text)
+{
+    out << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+// Returns the totals of a phase for the HPX performance counters
+kernel_stats phase_totals(Phase phase)
+{
+    const report r = get_report();
+    return r.phases[static_cast<std::size_t>(phase)];
+}
+}  // namespace
+
+/**
+ * @brief Returns flops / time in GFLOP/s, 0 without time
+ */
+double kernel_stats::gflops() const
+{
+    return time > 0.0 ? flops / time * 1e-9 : 0.0;
+}
+
+/**
+ * @brief Returns the name of a phase
+ */
+const char *phase_name(Phase phase)
+{
+    switch (phase)
+    {
+        case Phase::Assembly: return "assembly";
+        case Phase::Cholesky: return "cholesky";
+        case Phase::Solve: return "solve";
+        case Phase::Predict: return "predict";
+        case Phase::Gradient: return "gradient";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Returns the phase of a kernel annotation
+ *
+ * Kernels are assigned by the prefix of their annotation: `assemble_*` to
+ * the assembly, `cholesky_*` to the Cholesky factorization, `grad*`,
+ * `loss_*` and `collect_losses` to the gradient, `predict*`, `posterior_*`,
+ * `uncertainty_*` and `download_*` to the prediction, and all others, such
+ * as `triangular_solve_*` and `inverse_tiled`, to the solve.
+ *
+ * @param annotation annotation of the kernel
+ */
+Phase phase_of(const std::string &annotation)
+{
+    if (starts_with(annotation, "assemble"))
+    {
+        return Phase::Assembly;
+    }
+    if (starts_with(annotation, "cholesky"))
+    {
+        return Phase::Cholesky;
+    }
+    if (starts_with(annotation, "grad") || starts_with(annotation, "loss")
+        || starts_with(annotation, "collect_losses"))
+    {
+        return Phase::Gradient;
+    }
+    if (starts_with(annotation, "predict") || starts_with(annotation, "posterior")
+        || starts_with(annotation, "uncertainty") || starts_with(annotation, "download"))
+    {
+        return Phase::Predict;
+    }
+    return Phase::Solve;
+}
+
+/**
+ * @brief Clear all counters and the timeline and start recording
+ *
+ * @param trace also record every task for write_trace()
+ */
+void start(bool trace)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    kernels.clear();
+    kernel_index.clear();
+    events.clear();
+    tracing = trace;
+    start_time = std::chrono::steady_clock::now();
+    active.store(true);
+}
+
+/**
+ * @brief Stop recording, tasks still running are recorded when they finish
+ */
+void stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (active.exchange(false))
+    {
+        stop_time = std::chrono::steady_clock::now();
+    }
+}
+
+/**
+ * @brief Returns true while recording
+ */
+bool is_active()
+{
+    return active.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the counters recorded since start()
+ *
+ * The wall time runs up to stop(), or up to now while recording.
+ */
+report get_report()
+{
+    report r;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto end = active.load() ? std::chrono::steady_clock::now() : stop_time;
+        r.wall_time = std::max(0.0, to_seconds(end - start_time));
+        for (const kernel_stats &kernel : kernels)
+        {
+            auto it = std::find_if(r.kernels.begin(), r.kernels.end(), [&](const kernel_stats &k)
+                                   { return k.name == kernel.name; });
+            if (it == r.kernels.end())
+            {
+                r.kernels.push_back(kernel);
+                continue;
+            }
+            it->count += kernel.count;
+            it->time += kernel.time;
+            it->flops += kernel.flops;
+        }
+    }
+    std::sort(r.kernels.begin(), r.kernels.end(), [](const kernel_stats &a, const kernel_stats &b)
+              { return a.time > b.time; });
+
+    for (std::size_t p = 0; p < n_phases; p++)
+    {
+        kernel_stats phase;
+        phase.phase = static_cast<Phase>(p);
+        phase.name = phase_name(phase.phase);
+        r.phases.push_back(phase);
+    }
+    for (const kernel_stats &kernel : r.kernels)
+    {
+        kernel_stats &phase = r.phases[static_cast<std::size_t>(kernel.phase)];
+        phase.count += kernel.count;
+        phase.time += kernel.time;
+        phase.flops += kernel.flops;
+        r.busy_time += kernel.time;
+        r.flops += kernel.flops;
+    }
+
+    r.n_threads = hpx::get_num_worker_threads();
+    const double capacity = r.wall_time * static_cast<double>(r.n_threads);
+    r.idle_rate = capacity > 0.0 ? std::max(0.0, 1.0 - r.busy_time / capacity) : 0.0;
+    return r;
+}
+
+/**
+ * @brief Write the recorded tasks as Chrome trace events
+ *
+ * Each task is a complete ("X") event named by its annotation with its phase
+ * as category. The locality is the process and the worker thread the thread
+ * of the event, tasks run outside of an HPX worker thread are put on a row
+ * "external".
+ *
+ * @param file_path path of the JSON file
+ */
+void write_trace(const std::string &file_path)
+{
+    const std::uint32_t pid = hpx::get_locality_id();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!tracing)
+    {
+        throw std::runtime_error("Error: No trace recorded, call start(true) first");
+    }
+    std::ofstream out(file_path);
+    if (!out)
+    {
+        throw std::runtime_error("Error: Cannot write file: " + file_path);
+    }
+    std::vector<std::size_t> threads;
+    for (const trace_event &event : events)
+    {
+        threads.push_back(event.thread);
+    }
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (std::size_t thread : threads)
+    {
+        const bool external = thread == std::size_t(-1);
+        out << (first ? "\n" : ",\n");
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+            << ",\"tid\":" << (external ? -1 : static_cast<long long>(thread))
+            << ",\"args\":{\"name\":\""
+            << (external ? std::string("external") : "worker " + std::to_string(thread)) << "\"}}";
+        first = false;
+    }
+    for (const trace_event &event : events)
+    {
+        const std::string name(event.name);
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        write_json_string(out, name);
+        out << ",\"cat\":\"" << phase_name(phase_of(name)) << "\",\"ph\":\"X\",\"ts\":" << event.begin
+            << ",\"dur\":" << event.duration << ",\"pid\":" << pid << ",\"tid\":"
+            << (event.thread == std::size_t(-1) ? -1 : static_cast<long long>(event.thread)) << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+    if (!out)
+    {
+        throw std::runtime_error("Error: Cannot write file: " + file_path);
+    }
+}
+
+/**
+ * @brief Register the HPX performance counters of the phases
+ *
+ * The counters read the totals since the last start(), their reset flag is
+ * ignored: /gpxpy/<phase>/count, /gpxpy/<phase>/time in nanoseconds and
+ * /gpxpy/<phase>/flops for each phase, and /gpxpy/busy-time in nanoseconds.
+ * Query them like any HPX counter, e.g.
+ * `--hpx:print-counter=/gpxpy/cholesky/time`.
+ */
+void register_counters()
+{
+    using hpx::performance_counters::install_counter_type;
+    for (std::size_t p = 0; p < n_phases; p++)
+    {
+        const Phase phase = static_cast<Phase>(p);
+        const std::string prefix = std::string("/gpxpy/") + phase_name(phase);
+        install_counter_type(
+            prefix + "/count",
+            [phase](bool) -> std::int64_t
+            { return static_cast<std::int64_t>(phase_totals(phase).count); },
+            "number of tasks of the phase");
+        install_counter_type(
+            prefix + "/time",
+            [phase](bool) -> std::int64_t
+            { return static_cast<std::int64_t>(phase_totals(phase).time * 1e9); },
+            "run time of the tasks of the phase",
+            "ns");
+        install_counter_type(
+            prefix + "/flops",
+            [phase](bool) -> std::int64_t
+            { return static_cast<std::int64_t>(phase_totals(phase).flops); },
+            "floating point operations of the tasks of the phase");
+    }
+    install_counter_type(
+        "/gpxpy/busy-time",
+        [](bool) -> std::int64_t
+        { return static_cast<std::int64_t>(get_report().busy_time * 1e9); },
+        "run time of all recorded tasks",
+        "ns");
+}
+
+/**
+ * @brief Add floating point operations to the task on the calling thread
+ */
+void add_flops(double flops)
+{
+    flops_counter += flops;
+}
+
+namespace detail
+{
+/**
+ * @brief Returns the floating point operations counted on the calling thread
+ */
+double thread_flops()
+{
+    return flops_counter;
+}
+
+/**
+ * @brief Add a task to the counters and, when tracing, the timeline
+ *
+ * @param name annotation of the task
+ * @param begin start of the task
+ * @param end end of the task
+ * @param flops floating point operations of the task
+ */
+void record(const char *name,
+            std::chrono::steady_clock::time_point begin,
+            std::chrono::steady_clock::time_point end,
+            double flops)
+{
+    const double seconds = to_seconds(end - begin);
+    const std::size_t thread = hpx::get_worker_thread_num();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = kernel_index.find(name);
+    if (it == kernel_index.end())
+    {
+        kernel_stats kernel;
+        kernel.name = name;
+        kernel.phase = phase_of(kernel.name);
+        it = kernel_index.emplace(name, kernels.size()).first;
+        kernels.push_back(kernel);
+    }
+    kernel_stats &kernel = kernels[it->second];
+    kernel.count++;
+    kernel.time += seconds;
+    kernel.flops += flops;
+    if (tracing)
+    {
+        events.push_back({ name, thread, to_seconds(begin - start_time) * 1e6, seconds * 1e6 });
+    }
+}
+}  // namespace detail
+}  // namespace profiling
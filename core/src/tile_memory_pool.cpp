@@ -0,0 +1,164 @@
+#include "../include/tile_memory_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <hpx/runtime.hpp>
+#include <hpx/synchronization/spinlock.hpp>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tile_memory_pool
+{
+namespace
+{
+// free lists of one worker, padded to a cache line to avoid false sharing
+struct alignas(TILE_ALIGNMENT) slot
+{
+    // held for a few instructions on every tile allocation, a spinlock does
+    // not suspend the HPX task
+    hpx::spinlock mutex;
+    std::unordered_map<std::size_t, std::vector<void *>> free_buffers;
+    std::size_t cached = 0;
+};
+
+struct pool
+{
+    // one slot per hardware thread plus one for non-HPX threads
+    std::vector<slot> slots;
+
+    // limit of the cached bytes of each slot
+    std::atomic<std::size_t> slot_limit;
+
+    pool() :
+        slots(std::max(1u, std::thread::hardware_concurrency()) + 1),
+        slot_limit(TILE_CACHE_LIMIT / slots.size())
+    { }
+};
+
+pool &instance()
+{
+    // never destroyed, tiles may outlive static destruction
+    static pool *p = new pool();
+    return *p;
+}
+
+std::size_t current_slot(const pool &p)
+{
+    std::size_t n_workers = p.slots.size() - 1;
+    std::size_t worker = hpx::get_worker_thread_num();
+    if (worker == std::size_t(-1))
+    {
+        return n_workers;
+    }
+    return worker % n_workers;
+}
+
+std::size_t round_up(std::size_t bytes)
+{
+    return (bytes + TILE_ALIGNMENT - 1) / TILE_ALIGNMENT * TILE_ALIGNMENT;
+}
+
+// free cached buffers of a locked slot until at most `limit` bytes remain
+void trim(slot &s, std::size_t limit)
+{
+    for (auto it = s.free_buffers.begin(); it != s.free_buffers.end() && s.cached > limit;)
+    {
+        std::vector<void *> &buffers = it->second;
+        while (!buffers.empty() && s.cached > limit)
+        {
+            std::free(buffers.back());
+            buffers.pop_back();
+            s.cached -= it->first;
+        }
+        it = buffers.empty() ? s.free_buffers.erase(it) : std::next(it);
+    }
+}
+}  // namespace
+
+void *allocate(std::size_t bytes, std::size_t &slot_idx)
+{
+    pool &p = instance();
+    bytes = round_up(bytes);
+    slot_idx = current_slot(p);
+    slot &s = p.slots[slot_idx];
+    {
+        std::lock_guard<hpx::spinlock> lock(s.mutex);
+        auto it = s.free_buffers.find(bytes);
+        if (it != s.free_buffers.end() && !it->second.empty())
+        {
+            void *buffer = it->second.back();
+            it->second.pop_back();
+            s.cached -= bytes;
+            return buffer;
+        }
+    }
+    // first touch happens on the calling worker
+    void *buffer = std::aligned_alloc(TILE_ALIGNMENT, bytes);
+    if (buffer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return buffer;
+}
+
+void deallocate(void *buffer, std::size_t bytes, std::size_t slot_idx)
+{
+    pool &p = instance();
+    bytes = round_up(bytes);
+    slot &s = p.slots[slot_idx];
+    {
+        std::lock_guard<hpx::spinlock> lock(s.mutex);
+        if (s.cached + bytes <= p.slot_limit.load(std::memory_order_relaxed))
+        {
+            s.free_buffers[bytes].push_back(buffer);
+            s.cached += bytes;
+            return;
+        }
+    }
+    // over the share of this slot
+    std::free(buffer);
+}
+
+void release()
+{
+    for (slot &s : instance().slots)
+    {
+        std::lock_guard<hpx::spinlock> lock(s.mutex);
+        trim(s, 0);
+    }
+}
+
+std::size_t cached_bytes()
+{
+    std::size_t total = 0;
+    for (slot &s : instance().slots)
+    {
+        std::lock_guard<hpx::spinlock> lock(s.mutex);
+        total += s.cached;
+    }
+    return total;
+}
+
+void set_cache_limit(std::size_t bytes)
+{
+    pool &p = instance();
+    const std::size_t slot_limit = bytes / p.slots.size();
+    p.slot_limit.store(slot_limit, std::memory_order_relaxed);
+    for (slot &s : p.slots)
+    {
+        std::lock_guard<hpx::spinlock> lock(s.mutex);
+        trim(s, slot_limit);
+    }
+}
+
+std::size_t cache_limit()
+{
+    pool &p = instance();
+    return p.slot_limit.load(std::memory_order_relaxed) * p.slots.size();
+}
+}  // namespace tile_memory_pool
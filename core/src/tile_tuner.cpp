@@ -0,0 +1,466 @@
+#include "../include/tile_tuner.hpp"
+
+#include "../include/adapter_mkl.hpp"
+#include "../include/gp_algorithms_cpu.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <hpx/include/runtime.hpp>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+namespace tile_tuner
+{
+namespace
+{
+// scheduling overhead of one HPX task in seconds
+constexpr double task_overhead = 2e-6;
+
+// first line of a cache file, lines starting with '#' are comments
+constexpr const char *cache_header =
+    "# gpxpy tile timings: n_regressors tile_size potrf trsm syrk gemm assembly [s]";
+
+// Total work and critical path of a task graph in seconds
+struct cost
+{
+    double work;
+    double critical_path;
+};
+
+// Run time of a task graph on n_threads threads
+double run_time(const cost &c, std::size_t n_threads)
+{
+    return std::max(c.work / static_cast<double>(std::max<std::size_t>(n_threads, 1)), c.critical_path);
+}
+
+// Number of tiles of size tile_size that hold n samples
+double n_tiles_for(std::size_t n, int tile_size)
+{
+    const std::size_t size = static_cast<std::size_t>(tile_size);
+    return static_cast<double>((n + size - 1) / size);
+}
+
+// Cost of the covariance assembly and the right-looking tiled Cholesky
+// factorization, whose critical path runs through potrf, trsm and syrk of
+// the diagonal
+cost cholesky_cost(const kernel_timings &t, std::size_t n_samples)
+{
+    const double T = n_tiles_for(n_samples, t.tile_size);
+    const double n_offdiag = T * (T - 1) / 2;
+    const double n_gemm = T * (T - 1) * (T - 2) / 6;
+    const double n_tasks = T + 2 * n_offdiag + n_gemm + T * (T + 1) / 2;
+    cost c;
+    c.work = T * t.potrf + n_offdiag * (t.trsm + t.syrk) + n_gemm * t.gemm
+             + T * (T + 1) / 2 * t.assembly + n_tasks * task_overhead;
+    c.critical_path = t.assembly + T * t.potrf + (T - 1) * (t.trsm + t.syrk)
+                      + (2 * T - 1) * task_overhead;
+    return c;
+}
+
+// Best-of-repetitions time of run(prepare()), prepare is not timed
+template <typename Prepare, typename Run>
+double time_kernel(int repetitions, Prepare &&prepare, Run &&run)
+{
+    double best = std::numeric_limits<double>::infinity();
+    for (int r = 0; r < std::max(repetitions, 1); r++)
+    {
+        mutable_tile_data<double> tile = prepare();
+        const auto start = std::chrono::steady_clock::now();
+        run(tile);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// Name of the host for the default cache file
+std::string host_name()
+{
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) != 0 || name[0] == '\0')
+    {
+        return "localhost";
+    }
+    return name;
+}
+}  // namespace
+
+/**
+ * @brief Returns the candidate tile sizes tried by tune(): powers of two
+ *        from 32 to 2048
+ */
+std::vector<int> default_candidates()
+{
+    return { 32, 64, 128, 256, 512, 1024, 2048 };
+}
+
+/**
+ * @brief Returns the path of the timing cache: the file named by
+ *        GPXPY_TUNING_CACHE if set, otherwise
+ *        `gpxpy/tile_timings_<hostname>.txt` in $XDG_CACHE_HOME or
+ *        $HOME/.cache
+ */
+std::string default_cache_path()
+{
+    if (const char *path = std::getenv("GPXPY_TUNING_CACHE"))
+    {
+        return path;
+    }
+    std::string directory;
+    if (const char *cache = std::getenv("XDG_CACHE_HOME"))
+    {
+        directory = cache;
+    }
+    else if (const char *home = std::getenv("HOME"))
+    {
+        directory = std::string(home) + "/.cache";
+    }
+    else
+    {
+        directory = ".";
+    }
+    return directory + "/gpxpy/tile_timings_" + host_name() + ".txt";
+}
+
+// Kernel Benchmarks ------------------------------------------------------- {{{
+
+/**
+ * @brief Time the tile kernels at each of the tile sizes on the calling
+ *        thread
+ *
+ * The tiles are assembled from random inputs, the covariance tile is
+ * symmetric positive definite thanks to the noise variance on its diagonal.
+ *
+ * @param tile_sizes tile sizes to time
+ * @param n_regressors number of regressors of the covariance tiles
+ * @param repetitions number of runs per kernel, the fastest one counts
+ */
+std::vector<kernel_timings> benchmark_kernels(const std::vector<int> &tile_sizes,
+                                              int n_regressors,
+                                              int repetitions)
+{
+    if (n_regressors <= 0)
+    {
+        throw std::invalid_argument("n_regressors must be positive");
+    }
+    std::vector<kernel_timings> timings;
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int tile_size : tile_sizes)
+    {
+        if (tile_size <= 0)
+        {
+            throw std::invalid_argument("Tile sizes must be positive");
+        }
+        const std::size_t N = static_cast<std::size_t>(tile_size);
+        // two tiles worth of inputs for a diagonal and an off-diagonal tile
+        std::vector<double> input(2 * N);
+        for (double &value : input)
+        {
+            value = uniform(generator);
+        }
+        double hyperparameters[3] = { 1.0, 1.0, 0.1 };
+        const mutable_tile_data<double> K = gen_tile_covariance<double>(0, 0, N, n_regressors, hyperparameters, kernel_function(), input);
+        const mutable_tile_data<double> A = gen_tile_covariance<double>(1, 0, N, n_regressors, hyperparameters, kernel_function(), input);
+        const mutable_tile_data<double> L = potrf(K.copy(), N);
+        auto copy_of = [](const mutable_tile_data<double> &tile)
+        { return [&tile]()
+          { return tile.copy(); }; };
+
+        kernel_timings t;
+        t.tile_size = tile_size;
+        t.potrf = time_kernel(repetitions, copy_of(K), [N](mutable_tile_data<double> &tile)
+                              { potrf(tile, N); });
+        t.trsm = time_kernel(repetitions, copy_of(A), [&L, N](mutable_tile_data<double> &tile)
+                             { trsm(L, tile, N); });
+        t.syrk = time_kernel(repetitions, copy_of(K), [&A, N](mutable_tile_data<double> &tile)
+                             { syrk(tile, A, N); });
+        t.gemm = time_kernel(repetitions, copy_of(K), [&A, N](mutable_tile_data<double> &tile)
+                             { gemm(A, A, tile, N); });
+        t.assembly = time_kernel(repetitions, copy_of(K), [&](mutable_tile_data<double> &tile)
+                                 { tile = gen_tile_covariance<double>(1, 0, N, n_regressors, hyperparameters, kernel_function(), input); });
+        timings.push_back(t);
+    }
+    return timings;
+}
+
+// }}} ------------------------------------------------ end of Kernel Benchmarks
+
+// Timing Cache ------------------------------------------------------------ {{{
+
+/**
+ * @brief Read the timings of a cache file measured with n_regressors
+ *        regressors
+ *
+ * @param cache_path path to the cache file, which need not exist
+ * @param n_regressors number of regressors
+ */
+std::vector<kernel_timings> load_timings(const std::string &cache_path, int n_regressors)
+{
+    std::vector<kernel_timings> timings;
+    std::ifstream file(cache_path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        int regressors;
+        kernel_timings t;
+        if (!(fields >> regressors >> t.tile_size >> t.potrf >> t.trsm >> t.syrk >> t.gemm >> t.assembly)
+            || regressors != n_regressors || t.tile_size <= 0)
+        {
+            continue;
+        }
+        // later lines replace earlier ones
+        auto same_size = [&t](const kernel_timings &other)
+        { return other.tile_size == t.tile_size; };
+        timings.erase(std::remove_if(timings.begin(), timings.end(), same_size), timings.end());
+        timings.push_back(t);
+    }
+    return timings;
+}
+
+/**
+ * @brief Add timings measured with n_regressors regressors to a cache file,
+ *        replacing older timings of the same tile sizes
+ *
+ * @param cache_path path to the cache file, its directory is created if
+ *        needed
+ * @param n_regressors number of regressors
+ * @param timings timings to add
+ */
+void store_timings(const std::string &cache_path,
+                   int n_regressors,
+                   const std::vector<kernel_timings> &timings)
+{
+    // keep the lines of other regressor counts and tile sizes
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(cache_path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            int regressors, tile_size;
+            if (line.empty() || line[0] == '#' || !(fields >> regressors >> tile_size))
+            {
+                continue;
+            }
+            auto same_size = [tile_size](const kernel_timings &t)
+            { return t.tile_size == tile_size; };
+            if (regressors != n_regressors || std::none_of(timings.begin(), timings.end(), same_size))
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+    for (const kernel_timings &t : timings)
+    {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%d %d %.6e %.6e %.6e %.6e %.6e", n_regressors, t.tile_size, t.potrf, t.trsm, t.syrk, t.gemm, t.assembly);
+        lines.push_back(line);
+    }
+
+    // write a temporary file and rename it, such that concurrent readers
+    // never see a partial file
+    const std::filesystem::path path(cache_path);
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    const std::string temporary = cache_path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << cache_header << '\n';
+        for (const std::string &line : lines)
+        {
+            file << line << '\n';
+        }
+        if (!file)
+        {
+            throw std::runtime_error("Error: Cannot write file: " + temporary);
+        }
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+// }}} ----------------------------------------------------- end of Timing Cache
+
+// Cost Model -------------------------------------------------------------- {{{
+
+/**
+ * @brief Estimated run time of the covariance assembly and Cholesky
+ *        factorization of n_samples samples
+ *
+ * @param timings kernel timings at the tile size
+ * @param n_samples number of training samples
+ * @param n_threads number of HPX worker threads
+ */
+double estimate_fit_time(const kernel_timings &timings, std::size_t n_samples, std::size_t n_threads)
+{
+    return run_time(cholesky_cost(timings, n_samples), n_threads);
+}
+
+/**
+ * @brief Estimated run time of one optimizer iteration on n_samples samples
+ *
+ * @param timings kernel timings at the tile size
+ * @param n_samples number of training samples
+ * @param n_threads number of HPX worker threads
+ */
+double estimate_optimize_time(const kernel_timings &timings, std::size_t n_samples, std::size_t n_threads)
+{
+    const cost factor = cholesky_cost(timings, n_samples);
+    const double T = n_tiles_for(n_samples, timings.tile_size);
+    const double assembly = T * (T + 1) / 2 * timings.assembly;
+    // the derivatives add two assemblies, the inverse and the trace products
+    // about three factorizations
+    cost c;
+    c.work = 4 * (factor.work - assembly) + 3 * assembly;
+    c.critical_path = 4 * (factor.critical_path - timings.assembly) + timings.assembly;
+    return run_time(c, n_threads);
+}
+
+/**
+ * @brief Estimated run time of predict_with_uncertainty for n_test samples
+ *        with test tiles of size m_tile_size
+ *
+ * @param timings kernel timings at the training tile size
+ * @param n_samples number of training samples
+ * @param n_test number of test samples
+ * @param m_tile_size size of the test tiles
+ * @param n_threads number of HPX worker threads
+ */
+double estimate_predict_time(const kernel_timings &timings,
+                             std::size_t n_samples,
+                             std::size_t n_test,
+                             int m_tile_size,
+                             std::size_t n_threads)
+{
+    const double T = n_tiles_for(n_samples, timings.tile_size);
+    const double M = n_tiles_for(n_test, m_tile_size);
+    // kernels on m_tile_size x n_tile_size tiles scale with the rows
+    const double scale = static_cast<double>(m_tile_size) / timings.tile_size;
+    // per test tile: assembly, triangular solve and posterior product per
+    // training tile, updates of the solve per pair of training tiles
+    const double n_tasks = M * (3 * T + T * (T - 1) / 2);
+    cost c;
+    c.work = M * scale * (T * (timings.assembly + timings.trsm + timings.gemm) + T * (T - 1) / 2 * timings.gemm)
+             + n_tasks * task_overhead;
+    c.critical_path = scale * (timings.assembly + T * (timings.trsm + timings.gemm))
+                      + 2 * T * task_overhead;
+    return run_time(c, n_threads);
+}
+
+// }}} ------------------------------------------------------- end of Cost Model
+
+/**
+ * @brief Pick the training and test tiling for a problem
+ *
+ * @param n_train number of training samples
+ * @param n_test number of test samples
+ * @param n_regressors number of regressors
+ * @param workload operation to tune for
+ * @param n_threads number of HPX worker threads, 0 for the threads of the
+ *        running HPX runtime or the hardware concurrency
+ * @param cache_path timing cache, empty for default_cache_path()
+ */
+tile_config tune(std::size_t n_train,
+                 std::size_t n_test,
+                 int n_regressors,
+                 Workload workload,
+                 std::size_t n_threads,
+                 const std::string &cache_path)
+{
+    if (n_train == 0)
+    {
+        throw std::invalid_argument("Cannot tune the tiles of an empty training input");
+    }
+    if (n_threads == 0)
+    {
+        n_threads = hpx::is_running() ? hpx::get_os_thread_count()
+                                      : std::max(1u, std::thread::hardware_concurrency());
+    }
+    const std::string path = cache_path.empty() ? default_cache_path() : cache_path;
+
+    // candidates up to the first one that holds all samples in one tile
+    const std::size_t n_max = std::max(n_train, n_test);
+    std::vector<int> candidates;
+    for (int size : default_candidates())
+    {
+        if (candidates.empty() || static_cast<std::size_t>(candidates.back()) < n_max)
+        {
+            candidates.push_back(size);
+        }
+    }
+
+    std::vector<kernel_timings> cached = load_timings(path, n_regressors);
+    std::vector<int> missing;
+    for (int size : candidates)
+    {
+        auto same_size = [size](const kernel_timings &t)
+        { return t.tile_size == size; };
+        if (std::none_of(cached.begin(), cached.end(), same_size))
+        {
+            missing.push_back(size);
+        }
+    }
+    if (!missing.empty())
+    {
+        const std::vector<kernel_timings> measured = benchmark_kernels(missing, n_regressors);
+        try
+        {
+            store_timings(path, n_regressors, measured);
+        }
+        catch (const std::exception &)
+        {
+            // tuning works without the cache, it is just slower next time
+        }
+        cached.insert(cached.end(), measured.begin(), measured.end());
+    }
+
+    tile_config best = { 0, 0, 0, 0 };
+    double best_time = std::numeric_limits<double>::infinity();
+    for (const kernel_timings &t : cached)
+    {
+        if (std::find(candidates.begin(), candidates.end(), t.tile_size) == candidates.end())
+        {
+            continue;
+        }
+        // test tile size with the fastest prediction for this training tiling
+        int m_tile_size = t.tile_size;
+        double predict_time = std::numeric_limits<double>::infinity();
+        for (int size : candidates)
+        {
+            const double time = estimate_predict_time(t, n_train, std::max<std::size_t>(n_test, 1), size, n_threads);
+            if (time < predict_time)
+            {
+                predict_time = time;
+                m_tile_size = size;
+            }
+        }
+        const double time = workload == Workload::Optimize
+                                ? estimate_optimize_time(t, n_train, n_threads)
+                                : estimate_fit_time(t, n_train, n_threads) + predict_time;
+        if (time < best_time)
+        {
+            best_time = time;
+            best.n_tile_size = t.tile_size;
+            best.n_tiles = static_cast<int>(n_tiles_for(n_train, t.tile_size));
+            best.m_tile_size = m_tile_size;
+            best.m_tiles = static_cast<int>(n_tiles_for(n_test, m_tile_size));
+        }
+    }
+    return best;
+}
+}  // namespace tile_tuner
@@ -1,40 +1,71 @@
 #include "../include/tiled_algorithms_cpu.hpp"
 
 #include "../include/adapter_mkl.hpp"
+#include "../include/covariance_assembly.hpp"
+#include "../include/gp_algorithms_cpu.hpp"
 #include "../include/gp_optimizer.hpp"
 #include "../include/gp_uncertainty.hpp"
+#include "../include/profiling.hpp"
+#include <atomic>
 #include <cmath>
+#include <hpx/execution.hpp>
 #include <hpx/future.hpp>
+#include <stdexcept>
+#include <utility>
 
 // Tiled Cholesky Algorithm ------------------------------------------------ {{{
 
+// Variant used by cholesky_tiled, set per process
+static std::atomic<CholeskyVariant> cholesky_variant{ CholeskyVariant::Lookahead };
+
+void set_cholesky_variant(CholeskyVariant variant) { cholesky_variant.store(variant); }
+
+CholeskyVariant get_cholesky_variant() { return cholesky_variant.load(); }
+
+// Executor of a task on (priority) or off (!priority) the critical path
+static hpx::execution::parallel_executor cholesky_executor(bool priority)
+{
+    return hpx::execution::parallel_executor(
+        priority ? hpx::threads::thread_priority::high
+                 : hpx::threads::thread_priority::normal);
+}
+
 /**
- * @brief Perform right-looking Cholesky decomposition.
+ * @brief Right-looking Cholesky decomposition whose panel POTRF and TRSM, as
+ *        well as the updates of the next `depth` panels, run with high
+ *        priority.
  *
  * @param ft_tiles Matrix represented as a vector of tiles, containing the
  *        covariance matrix, afterwards the Cholesky decomposition.
  * @param N Size of the matrix.
  * @param n_tiles Number of tiles.
+ * @param prioritize Schedule the panel kernels with high priority
+ * @param depth Number of panels after the current one whose updates are
+ *        scheduled with high priority as well.
  */
-void right_looking_cholesky_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
+template <typename T>
+static void right_looking_cholesky_prioritized(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
     std::size_t N,
-    std::size_t n_tiles)
-
+    std::size_t n_tiles,
+    bool prioritize,
+    std::size_t depth)
 {
     for (std::size_t k = 0; k < n_tiles; k++)
     {
         // POTRF
         ft_tiles[k * n_tiles + k] = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&potrf), "cholesky_tiled"),
+            cholesky_executor(prioritize),
+            profiling::annotated_function(hpx::unwrapping(&potrf<T>), "cholesky_tiled"),
             ft_tiles[k * n_tiles + k],
             N);
         for (std::size_t m = k + 1; m < n_tiles; m++)
         {
             // TRSM
             ft_tiles[m * n_tiles + k] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&trsm),
-                                        "cholesky_tiled"),
+                cholesky_executor(prioritize),
+                profiling::annotated_function(hpx::unwrapping(&trsm<T>),
+                                              "cholesky_tiled"),
                 ft_tiles[k * n_tiles + k],
                 ft_tiles[m * n_tiles + k],
                 N);
@@ -43,8 +74,9 @@ void right_looking_cholesky_tiled(
         {
             // SYRK
             ft_tiles[m * n_tiles + m] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&syrk),
-                                        "cholesky_tiled"),
+                cholesky_executor(prioritize && m <= k + depth),
+                profiling::annotated_function(hpx::unwrapping(&syrk<T>),
+                                              "cholesky_tiled"),
                 ft_tiles[m * n_tiles + m],
                 ft_tiles[m * n_tiles + k],
                 N);
@@ -52,8 +84,9 @@ void right_looking_cholesky_tiled(
             {
                 // GEMM
                 ft_tiles[m * n_tiles + n] = hpx::dataflow(
-                    hpx::annotated_function(hpx::unwrapping(&gemm),
-                                            "cholesky_tiled"),
+                    cholesky_executor(prioritize && n <= k + depth),
+                    profiling::annotated_function(hpx::unwrapping(&gemm<T>),
+                                                  "cholesky_tiled"),
                     ft_tiles[m * n_tiles + k],
                     ft_tiles[n * n_tiles + k],
                     ft_tiles[m * n_tiles + n],
@@ -63,13 +96,117 @@ void right_looking_cholesky_tiled(
     }
 }
 
+template <typename T>
+void right_looking_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles)
+{
+    right_looking_cholesky_prioritized(ft_tiles, N, n_tiles, false, 0);
+}
+
+template <typename T>
+void priority_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles)
+{
+    right_looking_cholesky_prioritized(ft_tiles, N, n_tiles, true, 0);
+}
+
+template <typename T>
+void lookahead_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles,
+    std::size_t depth)
+{
+    right_looking_cholesky_prioritized(ft_tiles, N, n_tiles, true, depth);
+}
+
+template <typename T>
+void left_looking_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles)
+{
+    for (std::size_t k = 0; k < n_tiles; k++)
+    {
+        // update column k with the finished columns j < k
+        for (std::size_t j = 0; j < k; j++)
+        {
+            // SYRK
+            ft_tiles[k * n_tiles + k] = hpx::dataflow(
+                cholesky_executor(true),
+                profiling::annotated_function(hpx::unwrapping(&syrk<T>),
+                                              "cholesky_tiled"),
+                ft_tiles[k * n_tiles + k],
+                ft_tiles[k * n_tiles + j],
+                N);
+            for (std::size_t m = k + 1; m < n_tiles; m++)
+            {
+                // GEMM
+                ft_tiles[m * n_tiles + k] = hpx::dataflow(
+                    cholesky_executor(false),
+                    profiling::annotated_function(hpx::unwrapping(&gemm<T>),
+                                                  "cholesky_tiled"),
+                    ft_tiles[m * n_tiles + j],
+                    ft_tiles[k * n_tiles + j],
+                    ft_tiles[m * n_tiles + k],
+                    N);
+            }
+        }
+        // POTRF
+        ft_tiles[k * n_tiles + k] = hpx::dataflow(
+            cholesky_executor(true),
+            profiling::annotated_function(hpx::unwrapping(&potrf<T>), "cholesky_tiled"),
+            ft_tiles[k * n_tiles + k],
+            N);
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            // TRSM
+            ft_tiles[m * n_tiles + k] = hpx::dataflow(
+                cholesky_executor(true),
+                profiling::annotated_function(hpx::unwrapping(&trsm<T>),
+                                              "cholesky_tiled"),
+                ft_tiles[k * n_tiles + k],
+                ft_tiles[m * n_tiles + k],
+                N);
+        }
+    }
+}
+
+template <typename T>
+void cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles)
+{
+    switch (get_cholesky_variant())
+    {
+        case CholeskyVariant::RightLooking:
+            right_looking_cholesky_tiled(ft_tiles, N, n_tiles);
+            break;
+        case CholeskyVariant::Priority:
+            priority_cholesky_tiled(ft_tiles, N, n_tiles);
+            break;
+        case CholeskyVariant::Lookahead:
+            lookahead_cholesky_tiled(ft_tiles, N, n_tiles);
+            break;
+        case CholeskyVariant::LeftLooking:
+            left_looking_cholesky_tiled(ft_tiles, N, n_tiles);
+            break;
+    }
+}
+
 // }}} ----------------------------------------- end of Tiled Cholesky Algorithm
 
 // Tiled Triangular Solve Algorithms --------------------------------------- {{{
 
+template <typename T>
 void forward_solve_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_rhs,
     std::size_t N,
     std::size_t n_tiles)
 {
@@ -77,8 +214,8 @@ void forward_solve_tiled(
     {
         // TRSM
         ft_rhs[k] =
-            hpx::dataflow(hpx::annotated_function(hpx::unwrapping(&trsv_l),
-                                                  "triangular_solve_tiled"),
+            hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&trsv_l<T>),
+                                                        "triangular_solve_tiled"),
                           ft_tiles[k * n_tiles + k],
                           ft_rhs[k],
                           N);
@@ -86,8 +223,8 @@ void forward_solve_tiled(
         {
             // GEMV
             ft_rhs[m] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&gemv_l),
-                                        "triangular_solve_tiled"),
+                profiling::annotated_function(hpx::unwrapping(&gemv_l<T>),
+                                              "triangular_solve_tiled"),
                 ft_tiles[m * n_tiles + k],
                 ft_rhs[k],
                 ft_rhs[m],
@@ -96,9 +233,10 @@ void forward_solve_tiled(
     }
 }
 
+template <typename T>
 void backward_solve_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_rhs,
     std::size_t N,
     std::size_t n_tiles)
 {
@@ -107,8 +245,8 @@ void backward_solve_tiled(
     {
         // TRSM
         ft_rhs[k] =
-            hpx::dataflow(hpx::annotated_function(hpx::unwrapping(&trsv_u),
-                                                  "triangular_solve_tiled"),
+            hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&trsv_u<T>),
+                                                        "triangular_solve_tiled"),
                           ft_tiles[k * n_tiles + k],
                           ft_rhs[k],
                           N);
@@ -117,8 +255,8 @@ void backward_solve_tiled(
         {
             // GEMV
             ft_rhs[m] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&gemv_u),
-                                        "triangular_solve_tiled"),
+                profiling::annotated_function(hpx::unwrapping(&gemv_u<T>),
+                                              "triangular_solve_tiled"),
                 ft_tiles[k * n_tiles + m],
                 ft_rhs[k],
                 ft_rhs[m],
@@ -129,8 +267,8 @@ void backward_solve_tiled(
 
 // Tiled Triangular Solve Algorithms for matrices (K * X = B)
 void forward_solve_tiled_matrix(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
@@ -142,8 +280,8 @@ void forward_solve_tiled_matrix(
         {
             // TRSM
             ft_rhs[k * m_tiles + c] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&trsm_l_matrix),
-                                        "triangular_solve_tiled_matrix"),
+                profiling::annotated_function(hpx::unwrapping(&trsm_l_matrix<double>),
+                                              "triangular_solve_tiled_matrix"),
                 ft_tiles[k * n_tiles + k],
                 ft_rhs[k * m_tiles + c],
                 N,
@@ -152,8 +290,8 @@ void forward_solve_tiled_matrix(
             {
                 // GEMV
                 ft_rhs[m * m_tiles + c] = hpx::dataflow(
-                    hpx::annotated_function(hpx::unwrapping(&gemm_l_matrix),
-                                            "triangular_solve_tiled_matrix"),
+                    profiling::annotated_function(hpx::unwrapping(&gemm_l_matrix<double>),
+                                                  "triangular_solve_tiled_matrix"),
                     ft_tiles[m * n_tiles + k],
                     ft_rhs[k * m_tiles + c],
                     ft_rhs[m * m_tiles + c],
@@ -165,8 +303,8 @@ void forward_solve_tiled_matrix(
 }
 
 void backward_solve_tiled_matrix(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
@@ -179,8 +317,8 @@ void backward_solve_tiled_matrix(
         {
             // TRSM
             ft_rhs[k * m_tiles + c] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&trsm_u_matrix),
-                                        "triangular_solve_tiled_matrix"),
+                profiling::annotated_function(hpx::unwrapping(&trsm_u_matrix<double>),
+                                              "triangular_solve_tiled_matrix"),
                 ft_tiles[k * n_tiles + k],
                 ft_rhs[k * m_tiles + c],
                 N,
@@ -190,8 +328,8 @@ void backward_solve_tiled_matrix(
             {
                 // GEMV
                 ft_rhs[m * m_tiles + c] = hpx::dataflow(
-                    hpx::annotated_function(hpx::unwrapping(&gemm_u_matrix),
-                                            "triangular_solve_tiled_matrix"),
+                    profiling::annotated_function(hpx::unwrapping(&gemm_u_matrix<double>),
+                                                  "triangular_solve_tiled_matrix"),
                     ft_tiles[k * n_tiles + m],
                     ft_rhs[k * m_tiles + c],
                     ft_rhs[m * m_tiles + c],
@@ -204,11 +342,272 @@ void backward_solve_tiled_matrix(
 
 // }}} -------------------------------- end of Tiled Triangular Solve Algorithms
 
+// Tiled Reduction --------------------------------------------------------- {{{
+
+static double add_partial_sums(double a, double b) { return a + b; }
+
+/**
+ * @brief Sum scalar futures pairwise in a binary tree, see reduce_tiled.
+ *
+ * @param ft_partials Partial sums, e.g. one per tile.
+ *
+ * @return Future of the sum, zero if there are no partial sums.
+ */
+hpx::shared_future<double>
+reduce_sum_tiled(std::vector<hpx::shared_future<double>> ft_partials)
+{
+    if (ft_partials.empty())
+    {
+        return hpx::make_ready_future(0.0).share();
+    }
+    return reduce_tiled(std::move(ft_partials), &add_partial_sums, "reduce_tiled");
+}
+
+/**
+ * @brief Returns the first `size` elements of the concatenated vector tiles,
+ *        which must be ready, dropping the padding of the last tile.
+ */
+std::vector<double>
+concat_tiles(const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+             std::size_t size)
+{
+    std::vector<double> values;
+    values.reserve(size);  // preallocate memory
+    for (const hpx::shared_future<mutable_tile_data<double>> &tile : ft_tiles)
+    {
+        values.insert(values.end(), tile.get().begin(), tile.get().end());
+    }
+    values.resize(size);
+    return values;
+}
+
+// }}} -------------------------------------------------- end of Tiled Reduction
+
+// Tiled Cholesky Update --------------------------------------------------- {{{
+
+void extend_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::size_t N,
+    std::size_t first_row,
+    std::size_t n_tiles)
+{
+    for (std::size_t m = first_row; m < n_tiles; m++)
+    {
+        for (std::size_t k = 0; k < m; k++)
+        {
+            // update tile (m, k) with the finished columns j < k
+            for (std::size_t j = 0; j < k; j++)
+            {
+                // GEMM
+                ft_tiles[m * n_tiles + k] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gemm<double>),
+                                                  "cholesky_update_tiled"),
+                    ft_tiles[m * n_tiles + j],
+                    ft_tiles[k * n_tiles + j],
+                    ft_tiles[m * n_tiles + k],
+                    N);
+            }
+            // TRSM
+            ft_tiles[m * n_tiles + k] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&trsm<double>),
+                                              "cholesky_update_tiled"),
+                ft_tiles[k * n_tiles + k],
+                ft_tiles[m * n_tiles + k],
+                N);
+            // SYRK
+            ft_tiles[m * n_tiles + m] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&syrk<double>),
+                                              "cholesky_update_tiled"),
+                ft_tiles[m * n_tiles + m],
+                ft_tiles[m * n_tiles + k],
+                N);
+        }
+        // POTRF
+        ft_tiles[m * n_tiles + m] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&potrf<double>),
+                                          "cholesky_update_tiled"),
+            ft_tiles[m * n_tiles + m],
+            N);
+    }
+}
+
+void cholesky_panel_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_columns,
+    std::size_t n_tiles)
+{
+    for (std::size_t k = 0; k < n_columns; k++)
+    {
+        // update column k with the finished columns j < k
+        for (std::size_t j = 0; j < k; j++)
+        {
+            // SYRK
+            ft_tiles[k * n_tiles + k] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&syrk<double>),
+                                              "cholesky_update_tiled"),
+                ft_tiles[k * n_tiles + k],
+                ft_tiles[k * n_tiles + j],
+                N);
+            for (std::size_t m = k + 1; m < n_tiles; m++)
+            {
+                // GEMM
+                ft_tiles[m * n_tiles + k] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gemm<double>),
+                                                  "cholesky_update_tiled"),
+                    ft_tiles[m * n_tiles + j],
+                    ft_tiles[k * n_tiles + j],
+                    ft_tiles[m * n_tiles + k],
+                    N);
+            }
+        }
+        // POTRF
+        ft_tiles[k * n_tiles + k] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&potrf<double>),
+                                          "cholesky_update_tiled"),
+            ft_tiles[k * n_tiles + k],
+            N);
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            // TRSM
+            ft_tiles[m * n_tiles + k] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&trsm<double>),
+                                              "cholesky_update_tiled"),
+                ft_tiles[k * n_tiles + k],
+                ft_tiles[m * n_tiles + k],
+                N);
+        }
+    }
+}
+
+using tile_pair = std::pair<mutable_tile_data<double>, mutable_tile_data<double>>;
+
+static mutable_tile_data<double> first_of_pair(const tile_pair &tiles) { return tiles.first; }
+
+static mutable_tile_data<double> second_of_pair(const tile_pair &tiles) { return tiles.second; }
+
+/**
+ * @brief Rotate a diagonal tile of L with the vectors of its tile row.
+ *
+ * Returns the rotated tile and the cosine and sine of the rotation of each
+ * column and vector, which rotate the tiles below it.
+ */
+static tile_pair rotate_diagonal_tile(const mutable_tile_data<double> &L,
+                                      const mutable_tile_data<double> &X,
+                                      std::size_t N,
+                                      std::size_t n_update)
+{
+    mutable_tile_data<double> L_out = L.writable();
+    mutable_tile_data<double> X_out = X.writable();
+    const std::size_t n_vectors = X.size() / N;
+    mutable_tile_data<double> rotations(2 * N * n_vectors);
+    for (std::size_t c = 0; c < N; c++)
+    {
+        for (std::size_t v = 0; v < n_vectors; v++)
+        {
+            const double sign = v < n_update ? 1.0 : -1.0;
+            const double diagonal = L_out[c * N + c];
+            const double x = X_out[c * n_vectors + v];
+            const double r_squared = diagonal * diagonal + sign * x * x;
+            if (!(r_squared > 0.0))
+            {
+                throw std::runtime_error("Cholesky downdate: the matrix is not positive definite");
+            }
+            const double r = std::sqrt(r_squared);
+            const double cosine = r / diagonal;
+            const double sine = x / diagonal;
+            L_out[c * N + c] = r;
+            for (std::size_t i = c + 1; i < N; i++)
+            {
+                const double l = (L_out[i * N + c] + sign * sine * X_out[i * n_vectors + v]) / cosine;
+                X_out[i * n_vectors + v] = cosine * X_out[i * n_vectors + v] - sine * l;
+                L_out[i * N + c] = l;
+            }
+            rotations[2 * (c * n_vectors + v)] = cosine;
+            rotations[2 * (c * n_vectors + v) + 1] = sine;
+        }
+    }
+    return { L_out, rotations };
+}
+
+/**
+ * @brief Rotate an off-diagonal tile of L and the vectors of its tile row with
+ *        the rotations of the diagonal tile of its column.
+ */
+static tile_pair rotate_tile(const mutable_tile_data<double> &L,
+                             const mutable_tile_data<double> &X,
+                             const mutable_tile_data<double> &rotations,
+                             std::size_t N,
+                             std::size_t n_update)
+{
+    mutable_tile_data<double> L_out = L.writable();
+    mutable_tile_data<double> X_out = X.writable();
+    const std::size_t n_vectors = X.size() / N;
+    // the rows are independent, each applies the rotations in order
+    for (std::size_t i = 0; i < N; i++)
+    {
+        double *x = X_out.data() + i * n_vectors;
+        for (std::size_t c = 0; c < N; c++)
+        {
+            double l = L_out[i * N + c];
+            for (std::size_t v = 0; v < n_vectors; v++)
+            {
+                const double sign = v < n_update ? 1.0 : -1.0;
+                const double cosine = rotations[2 * (c * n_vectors + v)];
+                const double sine = rotations[2 * (c * n_vectors + v) + 1];
+                l = (l + sign * sine * x[v]) / cosine;
+                x[v] = cosine * x[v] - sine * l;
+            }
+            L_out[i * N + c] = l;
+        }
+    }
+    return { L_out, X_out };
+}
+
+void update_cholesky_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_vectors,
+    std::size_t N,
+    std::size_t n_update,
+    std::size_t first,
+    std::size_t n_tiles)
+{
+    for (std::size_t k = first; k < n_tiles; k++)
+    {
+        hpx::shared_future<tile_pair> diagonal = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&rotate_diagonal_tile),
+                                          "cholesky_update_tiled"),
+            ft_tiles[k * n_tiles + k],
+            ft_vectors[k],
+            N,
+            n_update);
+        ft_tiles[k * n_tiles + k] = hpx::dataflow(hpx::unwrapping(&first_of_pair), diagonal);
+        hpx::shared_future<mutable_tile_data<double>> rotations =
+            hpx::dataflow(hpx::unwrapping(&second_of_pair), diagonal);
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            hpx::shared_future<tile_pair> rotated = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&rotate_tile),
+                                              "cholesky_update_tiled"),
+                ft_tiles[m * n_tiles + k],
+                ft_vectors[m],
+                rotations,
+                N,
+                n_update);
+            ft_tiles[m * n_tiles + k] = hpx::dataflow(hpx::unwrapping(&first_of_pair), rotated);
+            ft_vectors[m] = hpx::dataflow(hpx::unwrapping(&second_of_pair), rotated);
+        }
+    }
+}
+
+// }}} -------------------------------------------- end of Tiled Cholesky Update
+
 // Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
 // Tiled Triangular Solve Algorithms for Matrices (K * X = B)
+template <typename T>
 void forward_solve_KcK_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_rhs,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
@@ -220,8 +619,8 @@ void forward_solve_KcK_tiled(
         {
             // TRSM
             ft_rhs[c * m_tiles + r] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&trsm_l_KcK),
-                                        "triangular_solve_tiled_matrix_KK"),
+                profiling::annotated_function(hpx::unwrapping(&trsm_l_KcK<T>),
+                                              "triangular_solve_tiled_matrix_KK"),
                 ft_tiles[c * n_tiles + c],
                 ft_rhs[c * m_tiles + r],
                 N,
@@ -230,8 +629,8 @@ void forward_solve_KcK_tiled(
             {
                 // GEMV
                 ft_rhs[m * m_tiles + r] = hpx::dataflow(
-                    hpx::annotated_function(hpx::unwrapping(&gemm_l_KcK),
-                                            "triangular_solve_tiled_matrix_KK"),
+                    profiling::annotated_function(hpx::unwrapping(&gemm_l_KcK<T>),
+                                                  "triangular_solve_tiled_matrix_KK"),
                     ft_tiles[m * n_tiles + c],
                     ft_rhs[c * m_tiles + r],
                     ft_rhs[m * m_tiles + r],
@@ -243,9 +642,9 @@ void forward_solve_KcK_tiled(
 }
 
 void compute_gemm_of_invK_y(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_invK,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_y,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_alpha,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_invK,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_y,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_alpha,
     std::size_t N,
     std::size_t n_tiles)
 {
@@ -254,8 +653,8 @@ void compute_gemm_of_invK_y(
         for (std::size_t j = 0; j < n_tiles; j++)
         {
             ft_alpha[i] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&gemv_p),
-                                        "prediction_tiled"),
+                profiling::annotated_function(hpx::unwrapping(&gemv_p<double>),
+                                              "prediction_tiled"),
                 ft_invK[i * n_tiles + j],
                 ft_y[j],
                 ft_alpha[i],
@@ -267,19 +666,20 @@ void compute_gemm_of_invK_y(
 
 // Tiled Loss
 void compute_loss_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_alpha,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_y,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_alpha,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_y,
     hpx::shared_future<double> &loss,
     std::size_t N,
-    std::size_t n_tiles)
+    std::size_t n_tiles,
+    std::size_t n_samples)
 {
     std::vector<hpx::shared_future<double>> loss_tiled;
     loss_tiled.resize(n_tiles);
     for (std::size_t k = 0; k < n_tiles; k++)
     {
         loss_tiled[k] =
-            hpx::dataflow(hpx::annotated_function(
+            hpx::dataflow(profiling::annotated_function(
                               hpx::unwrapping(&compute_loss), "loss_tiled"),
                           ft_tiles[k * n_tiles + k],
                           ft_alpha[k],
@@ -288,17 +688,17 @@ void compute_loss_tiled(
     }
 
     loss = hpx::dataflow(
-        hpx::annotated_function(hpx::unwrapping(&add_losses), "loss_tiled"),
+        profiling::annotated_function(hpx::unwrapping(&add_losses), "loss_tiled"),
         loss_tiled,
-        N,
-        n_tiles);
+        n_samples);
 }
 
 // Tiled Prediction
+template <typename T>
 void prediction_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_vector,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_rhs,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_vector,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_rhs,
     std::size_t N_row,
     std::size_t N_col,
     std::size_t n_tiles,
@@ -309,8 +709,8 @@ void prediction_tiled(
         for (std::size_t m = 0; m < n_tiles; m++)
         {
             ft_rhs[k] =
-                hpx::dataflow(hpx::annotated_function(hpx::unwrapping(&gemv_p),
-                                                      "prediction_tiled"),
+                hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&gemv_p<T>),
+                                                            "prediction_tiled"),
                               ft_tiles[k * n_tiles + m],
                               ft_vector[m],
                               ft_rhs[k],
@@ -320,10 +720,40 @@ void prediction_tiled(
     }
 }
 
+// Tiled Prediction of several outputs: rhs(N_row, M) tiles += tiles * X
+// with X(N_col, M) tiles
+void prediction_tiled_matrix(
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_X,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs,
+    std::size_t N_row,
+    std::size_t N_col,
+    std::size_t M,
+    std::size_t n_tiles,
+    std::size_t m_tiles)
+{
+    for (std::size_t k = 0; k < m_tiles; k++)
+    {
+        for (std::size_t m = 0; m < n_tiles; m++)
+        {
+            ft_rhs[k] =
+                hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&gemm_p<double>),
+                                                            "prediction_tiled_matrix"),
+                              ft_tiles[k * n_tiles + m],
+                              ft_X[m],
+                              ft_rhs[k],
+                              N_row,
+                              N_col,
+                              M);
+        }
+    }
+}
+
 // Tiled Diagonal of Posterior Covariance Matrix
+template <typename T>
 void posterior_covariance_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tCC_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_inter_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_tCC_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<T>>> &ft_inter_tiles,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
@@ -336,8 +766,8 @@ void posterior_covariance_tiled(
         {  // Compute inner product to obtain diagonal elements of
            // (K_MxN * (K^-1_NxN * K_NxM))
             ft_inter_tiles[i] = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&dot_uncertainty),
-                                        "posterior_tiled"),
+                profiling::annotated_function(hpx::unwrapping(&dot_uncertainty<T>),
+                                              "posterior_tiled"),
                 ft_tCC_tiles[n * m_tiles + i],
                 ft_inter_tiles[i],
                 N,
@@ -346,10 +776,11 @@ void posterior_covariance_tiled(
     }
 }
 
-// Tiled Diagonal of Posterior Covariance Matrix
+// Tiled Posterior Covariance Matrix, only the lower tiles of ft_priorK are
+// updated: SYRK on the diagonal tiles, GEMM below
 void full_cov_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tCC_tiles,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_priorK,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tCC_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_priorK,
     std::size_t N,
     std::size_t M,
     std::size_t n_tiles,
@@ -357,15 +788,27 @@ void full_cov_tiled(
 {
     for (std::size_t c = 0; c < m_tiles; c++)
     {
-        for (std::size_t k = 0; k < m_tiles; k++)
+        for (std::size_t m = 0; m < n_tiles; m++)
+        {
+            // SYRK
+            ft_priorK[c * m_tiles + c] = hpx::dataflow(
+                profiling::annotated_function(
+                    hpx::unwrapping(&syrk_tcross_matrix<double>),
+                    "posterior_full_cov_tiled"),
+                ft_tCC_tiles[m * m_tiles + c],
+                ft_priorK[c * m_tiles + c],
+                N,
+                M);
+        }
+        for (std::size_t k = 0; k < c; k++)
         {
             for (std::size_t m = 0; m < n_tiles; m++)
             {
-                // GEMV
+                // GEMM
                 ft_priorK[c * m_tiles + k] = hpx::dataflow(
-                    hpx::annotated_function(
-                        hpx::unwrapping(&gemm_cross_tcross_matrix),
-                        "triangular_solve_tiled_matrix"),
+                    profiling::annotated_function(
+                        hpx::unwrapping(&gemm_cross_tcross_matrix<double>),
+                        "posterior_full_cov_tiled"),
                     ft_tCC_tiles[m * m_tiles + c],
                     ft_tCC_tiles[m * m_tiles + k],
                     ft_priorK[c * m_tiles + k],
@@ -378,17 +821,17 @@ void full_cov_tiled(
 
 // Tiled Prediction Uncertainty
 void prediction_uncertainty_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_priorK,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_inter,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_vector,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_priorK,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_inter,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_vector,
     std::size_t M,
     std::size_t m_tiles)
 {
     for (std::size_t i = 0; i < m_tiles; i++)
     {
         ft_vector[i] = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&diag_posterior),
-                                    "uncertainty_tiled"),
+            profiling::annotated_function(hpx::unwrapping(&diag_posterior),
+                                          "uncertainty_tiled"),
             ft_priorK[i],
             ft_inter[i],
             M);
@@ -397,16 +840,16 @@ void prediction_uncertainty_tiled(
 
 // Tiled Prediction Uncertainty
 void pred_uncer_tiled(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_priorK,
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_vector,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_priorK,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_vector,
     std::size_t M,
     std::size_t m_tiles)
 {
     for (std::size_t i = 0; i < m_tiles; i++)
     {
         ft_vector[i] =
-            hpx::dataflow(hpx::annotated_function(hpx::unwrapping(&diag_tile),
-                                                  "uncertainty_tiled"),
+            hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&diag_tile),
+                                                        "uncertainty_tiled"),
                           ft_priorK[i * m_tiles + i],
                           M);
     }
@@ -414,9 +857,9 @@ void pred_uncer_tiled(
 
 // Compute I-y*y^T*inv(K)
 void update_grad_K_tiled_mkl(
-    std::vector<hpx::shared_future<std::vector<double>>> &ft_tiles,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_v1,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_v2,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_v1,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_v2,
     std::size_t N,
     std::size_t n_tiles)
 
@@ -426,8 +869,8 @@ void update_grad_K_tiled_mkl(
         for (std::size_t j = 0; j < n_tiles; j++)
         {
             ft_tiles[i * n_tiles + j] =
-                hpx::dataflow(hpx::annotated_function(hpx::unwrapping(&ger),
-                                                      "gradient_tiled"),
+                hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&ger<double>),
+                                                            "gradient_tiled"),
                               ft_tiles[i * n_tiles + j],
                               ft_v1[i],
                               ft_v2[j],
@@ -436,15 +879,13 @@ void update_grad_K_tiled_mkl(
     }
 }
 
-// Perform a gradient scent step for selected hyperparameter using Adam
-// algorithm
-void update_hyperparameter(
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_invK,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_gradparam,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_alpha,
-    double *hyperparameters,
-    std::size_t N,
-    std::size_t n_tiles,
+// Perform an Adam step for the selected hyperparameter given the two terms of
+// its gradient, returns the updated hyperparameter without waiting for it
+hpx::shared_future<double> update_hyperparameter_adam(
+    const hpx::shared_future<double> &grad_left,
+    const hpx::shared_future<double> &grad_right,
+    const hpx::shared_future<optimizer_parameters> &hyperparameters,
+    std::size_t n_samples,
     std::vector<hpx::shared_future<double>> &m_T,
     std::vector<hpx::shared_future<double>> &v_T,
     const std::vector<hpx::shared_future<double>> &beta1_T,
@@ -452,233 +893,272 @@ void update_hyperparameter(
     int iter,
     int param_idx)
 {
-    ////////////////////////////////////
-    /// part 1: trace(inv(K)*grad_param)
-    if (param_idx == 0 || param_idx == 1)  // 0: lengthscale; 1: vertical-lengthscale
+    if (param_idx < 0 || param_idx > 2)
     {
-        std::vector<hpx::shared_future<std::vector<double>>> diag_tiles;
-        diag_tiles.resize(n_tiles);
-        for (std::size_t d = 0; d < n_tiles; d++)
-        {
-            diag_tiles[d] = hpx::async(
-                hpx::annotated_function(&gen_tile_zeros_diag, "assemble_tiled"),
-                N);
-        }
+        throw std::invalid_argument("Invalid param_idx");
+    }
+    // noise variance is constrained differently
+    bool noise = param_idx == 2;
+    // compute gradient = grad_left + grad_r
+    hpx::shared_future<double> gradient = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&compute_gradient),
+                                      "gradient_tiled"),
+        grad_left,
+        grad_right,
+        n_samples);
 
-        // Compute diagonal elements of inv(K) * grad_hyperparam
-        for (std::size_t i = 0; i < n_tiles; ++i)
+    // transform hyperparameter to unconstrained form
+    hpx::shared_future<double> unconstrained_param = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&gen_unconstrained_param),
+                                      "gradient_tiled"),
+        hyperparameters,
+        param_idx);
+    // update moments
+    m_T[param_idx] = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&update_first_moment),
+                                      "gradient_tiled"),
+        gradient,
+        m_T[param_idx],
+        hyperparameters);
+    v_T[param_idx] = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&update_second_moment),
+                                      "gradient_tiled"),
+        gradient,
+        v_T[param_idx],
+        hyperparameters);
+    // update unconstrained parameter
+    hpx::shared_future<double> updated_param = hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&update_param),
+                                      "gradient_tiled"),
+        unconstrained_param,
+        hyperparameters,
+        gradient,
+        m_T[param_idx],
+        v_T[param_idx],
+        beta1_T,
+        beta2_T,
+        iter);
+    // transform hyperparameter to constrained form
+    return hpx::dataflow(
+        profiling::annotated_function(hpx::unwrapping(&to_constrained),
+                                      "gradient_tiled"),
+        updated_param,
+        noise);
+}
+
+// Tiled Algorithms for the Trace Terms ------------------------------------ {{{
+
+/**
+ * @brief Compute the lower tiles of K^-1 from its Cholesky factor L without
+ *        forming the full inverse: Z = L^-1 tile by tile, then
+ *        K^-1 = Z^T * Z overwriting Z.
+ *
+ * @param ft_tiles Lower tiles of the Cholesky factor L.
+ * @param ft_invK Afterwards contains the lower tiles of K^-1.
+ * @param N Size of the tiles.
+ * @param n_tiles Number of tiles.
+ */
+void compute_inverse_lower_tiled(
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_invK,
+    std::size_t N,
+    std::size_t n_tiles)
+{
+    ft_invK.resize(n_tiles * n_tiles);
+    // Z = L^-1: L_ii * Z_ij = - sum_{k=j}^{i-1} L_ik * Z_kj
+    for (std::size_t j = 0; j < n_tiles; j++)
+    {
+        // TRTRI
+        ft_invK[j * n_tiles + j] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&trtri<double>), "inverse_tiled"),
+            ft_tiles[j * n_tiles + j],
+            N);
+        for (std::size_t i = j + 1; i < n_tiles; i++)
         {
-            for (std::size_t j = 0; j < n_tiles; ++j)
+            ft_invK[i * n_tiles + j] = hpx::async(
+                profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+                N * N);
+            for (std::size_t k = j; k < i; k++)
             {
-                diag_tiles[i] = hpx::dataflow(
-                    hpx::annotated_function(hpx::unwrapping(&gemm_grad),
-                                            "grad_left_tiled"),
+                // GEMM
+                ft_invK[i * n_tiles + j] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gemm_l_matrix<double>),
+                                                  "inverse_tiled"),
+                    ft_tiles[i * n_tiles + k],
+                    ft_invK[k * n_tiles + j],
                     ft_invK[i * n_tiles + j],
-                    ft_gradparam[j * n_tiles + i],
-                    diag_tiles[i],
                     N,
                     N);
             }
-        }
-
-        // compute trace(inv(K) * grad_hyperparam)
-        hpx::shared_future<double> grad_left =
-            hpx::make_ready_future(0.0).share();
-        for (std::size_t j = 0; j < n_tiles; ++j)
-        {
-            grad_left = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&sum_gradleft),
-                                        "grad_left_tiled"),
-                diag_tiles[j],
-                grad_left);
-        }
-        ///////////////////////////////////////
-        /// part 2: alpha^T * grad_param * alpha
-        std::vector<hpx::shared_future<std::vector<double>>> inter_alpha;
-        inter_alpha.resize(n_tiles);
-        for (std::size_t d = 0; d < n_tiles; d++)
-        {
-            inter_alpha[d] = hpx::async(
-                hpx::annotated_function(&gen_tile_zeros_diag, "assemble_tiled"),
+            // TRSM
+            ft_invK[i * n_tiles + j] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&trsm_l_matrix<double>),
+                                              "inverse_tiled"),
+                ft_tiles[i * n_tiles + i],
+                ft_invK[i * n_tiles + j],
+                N,
                 N);
         }
-
-        for (std::size_t k = 0; k < n_tiles; k++)
+    }
+    // K^-1_ij = sum_{k>=i} Z_ki^T * Z_kj. Row i only reads rows k >= i and
+    // tile (i, i) is written last, so Z can be overwritten in place.
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
         {
-            for (std::size_t m = 0; m < n_tiles; m++)
+            hpx::shared_future<mutable_tile_data<double>> inv_tile = hpx::async(
+                profiling::annotated_function(&gen_tile_zeros<double>, "assemble_tiled"),
+                N * N);
+            for (std::size_t k = i; k < n_tiles; k++)
             {
-                inter_alpha[k] = hpx::dataflow(
-                    hpx::annotated_function(hpx::unwrapping(&gemv_p),
-                                            "prediction_tiled"),
-                    ft_gradparam[k * n_tiles + m],
-                    ft_alpha[m],
-                    inter_alpha[k],
+                // GEMM
+                inv_tile = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gemm_tn_add<double>),
+                                                  "inverse_tiled"),
+                    ft_invK[k * n_tiles + i],
+                    ft_invK[k * n_tiles + j],
+                    inv_tile,
                     N,
                     N);
             }
+            ft_invK[i * n_tiles + j] = inv_tile;
         }
-
-        hpx::shared_future<double> grad_right =
-            hpx::make_ready_future(0.0).share();
-        for (std::size_t j = 0; j < n_tiles;
-             ++j)
-        {  // Compute inner product to obtain diagonal elements of
-           // (K_MxN * (K^-1_NxN * K_NxM))
-            grad_right = hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&sum_gradright),
-                                        "grad_right_tiled"),
-                inter_alpha[j],
-                ft_alpha[j],
-                grad_right,
-                N);
-        }
-
-        //////////////////////////////
-        /// part 3: update parameter
-
-        // compute gradient = grad_left + grad_r
-        hpx::shared_future<double> gradient = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&compute_gradient),
-                                    "gradient_tiled"),
-            grad_left,
-            grad_right,
-            N,
-            n_tiles);
-
-        // transform hyperparameter to unconstrained form
-        hpx::shared_future<double> unconstrained_param = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&to_unconstrained),
-                                    "gradient_tiled"),
-            hyperparameters[param_idx],
-            false);
-        // update moments
-        m_T[param_idx] = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&update_first_moment),
-                                    "gradient_tiled"),
-            gradient,
-            m_T[param_idx],
-            hyperparameters[4]);
-        v_T[param_idx] = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&update_second_moment),
-                                    "gradient_tiled"),
-            gradient,
-            v_T[param_idx],
-            hyperparameters[5]);
-        // update unconstrained parameter
-        hpx::shared_future<double> updated_param = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&update_param),
-                                    "gradient_tiled"),
-            unconstrained_param,
-            hyperparameters,
-            gradient,
-            m_T[param_idx],
-            v_T[param_idx],
-            beta1_T,
-            beta2_T,
-            iter);
-        // transform hyperparameter to constrained form
-        hyperparameters[param_idx] =
-            hpx::dataflow(
-                hpx::annotated_function(hpx::unwrapping(&to_constrained),
-                                        "gradient_tiled"),
-                updated_param,
-                false)
-                .get();
     }
-    else
+}
+
+/**
+ * @brief Compute Y = A * X for a symmetric matrix A given by its lower tiles.
+ *
+ * @param ft_tiles Lower tiles of A.
+ * @param ft_X Tiles of X, each N x M.
+ * @param ft_Y Tiles of Y, each N x M, initialized to zero.
+ * @param N Size of the tiles of A.
+ * @param M Number of columns of X and Y.
+ * @param n_tiles Number of tiles.
+ */
+void symmetric_matrix_product_tiled(
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_tiles,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_X,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_Y,
+    std::size_t N,
+    std::size_t M,
+    std::size_t n_tiles)
+{
+    for (std::size_t i = 0; i < n_tiles; i++)
     {
-        // Throw an exception for invalid param_idx
-        throw std::invalid_argument("Invalid param_idx");
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            // Y_i += A_ij * X_j
+            ft_Y[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gemm_nn_add<double>),
+                                              "symmetric_product_tiled"),
+                ft_tiles[i * n_tiles + j],
+                ft_X[j],
+                ft_Y[i],
+                N,
+                M);
+            if (i != j)
+            {
+                // Y_j += A_ij^T * X_i
+                ft_Y[j] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gemm_tn_add<double>),
+                                                  "symmetric_product_tiled"),
+                    ft_tiles[i * n_tiles + j],
+                    ft_X[i],
+                    ft_Y[j],
+                    N,
+                    M);
+            }
+        }
     }
 }
 
-// Update noise variance using gradient decent + Adam
-void update_noise_variance(
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_invK,
-    const std::vector<hpx::shared_future<std::vector<double>>> &ft_alpha,
-    double *hyperparameters,
+/**
+ * @brief Compute trace(A * B) for symmetric matrices A and B given by their
+ *        lower tiles.
+ *
+ * @param ft_A Lower tiles of A.
+ * @param ft_B Lower tiles of B.
+ * @param trace Afterwards contains trace(A * B).
+ * @param N Size of the tiles.
+ * @param n_tiles Number of tiles.
+ */
+void trace_of_product_lower_tiled(
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_A,
+    const std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_B,
+    hpx::shared_future<double> &trace,
     std::size_t N,
-    std::size_t n_tiles,
-    std::vector<hpx::shared_future<double>> &m_T,
-    std::vector<hpx::shared_future<double>> &v_T,
-    const std::vector<hpx::shared_future<double>> &beta1_T,
-    const std::vector<hpx::shared_future<double>> &beta2_T,
-    int iter)
+    std::size_t n_tiles)
 {
-    ///////////////////////////////////////
-    // part1: compute trace(inv(K) * grad_hyperparam)
-    hpx::shared_future<double> grad_left = hpx::make_ready_future(0.0).share();
-    for (std::size_t j = 0; j < n_tiles; ++j)
+    std::vector<hpx::shared_future<double>> trace_tiled;
+    trace_tiled.reserve(n_tiles * (n_tiles + 1) / 2);
+    for (std::size_t i = 0; i < n_tiles; i++)
     {
-        grad_left = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&sum_noise_gradleft),
-                                    "grad_left_tiled"),
-            ft_invK[j * n_tiles + j],
-            grad_left,
-            hyperparameters,
-            N,
-            n_tiles);
-    }
-    ///////////////////////////////////////
-    /// part 2: alpha^T * grad_param * alpha
-    hpx::shared_future<double> grad_right = hpx::make_ready_future(0.0).share();
-    for (std::size_t j = 0; j < n_tiles;
-         ++j)
-    {  // Compute inner product to obtain diagonal elements of (K_MxN *
-       // (K^-1_NxN * K_NxM))
-        grad_right = hpx::dataflow(
-            hpx::annotated_function(hpx::unwrapping(&sum_noise_gradright),
-                                    "grad_right_tiled"),
-            ft_alpha[j],
-            grad_right,
-            hyperparameters,
-            N);
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            trace_tiled.push_back(hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&sum_gradleft_lower),
+                                              "grad_left_tiled"),
+                ft_A[i * n_tiles + j],
+                ft_B[i * n_tiles + j],
+                0.0,
+                N,
+                i == j));
+        }
     }
-    ////////////////////////////
-    /// part 3: update parameter
-    hpx::shared_future<double> gradient =
-        hpx::dataflow(hpx::annotated_function(
-                          hpx::unwrapping(&compute_gradient), "gradient_tiled"),
-                      grad_left,
-                      grad_right,
-                      N,
-                      n_tiles);
-    // transform hyperparameter to unconstrained form
-    hpx::shared_future<double> unconstrained_param =
-        hpx::dataflow(hpx::annotated_function(
-                          hpx::unwrapping(&to_unconstrained), "gradient_tiled"),
-                      hyperparameters[2],
-                      true);
-    // update moments
-    m_T[2] = hpx::dataflow(
-        hpx::annotated_function(hpx::unwrapping(&update_first_moment),
-                                "gradient_tiled"),
-        gradient,
-        m_T[2],
-        hyperparameters[4]);
-    v_T[2] = hpx::dataflow(
-        hpx::annotated_function(hpx::unwrapping(&update_second_moment),
-                                "gradient_tiled"),
-        gradient,
-        v_T[2],
-        hyperparameters[5]);
-    // update unconstrained parameter
-    hpx::shared_future<double> updated_param =
-        hpx::dataflow(hpx::annotated_function(hpx::unwrapping(&update_param),
-                                              "gradient_tiled"),
-                      unconstrained_param,
-                      hyperparameters,
-                      gradient,
-                      m_T[2],
-                      v_T[2],
-                      beta1_T,
-                      beta2_T,
-                      iter);
-    // transform hyperparameter to constrained form
-    hyperparameters[2] =
-        hpx::dataflow(hpx::annotated_function(hpx::unwrapping(&to_constrained),
-                                              "gradient_tiled"),
-                      updated_param,
-                      true)
-            .get();
+    trace = reduce_sum_tiled(trace_tiled);
 }
+
+// }}} ----------------------------- end of Tiled Algorithms for the Trace Terms
+
+// Instantiations for Single and Double Precision -------------------------- {{{
+
+#define INSTANTIATE_TILED_ALGORITHMS(T)                                                                    \
+    template void right_looking_cholesky_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &, \
+                                                  std::size_t,                                             \
+                                                  std::size_t);                                            \
+    template void priority_cholesky_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,      \
+                                             std::size_t,                                                  \
+                                             std::size_t);                                                 \
+    template void lookahead_cholesky_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,     \
+                                              std::size_t,                                                 \
+                                              std::size_t,                                                 \
+                                              std::size_t);                                                \
+    template void left_looking_cholesky_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,  \
+                                                 std::size_t,                                              \
+                                                 std::size_t);                                             \
+    template void cholesky_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,               \
+                                    std::size_t,                                                           \
+                                    std::size_t);                                                          \
+    template void forward_solve_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,          \
+                                         std::vector<hpx::shared_future<mutable_tile_data<T>>> &,          \
+                                         std::size_t,                                                      \
+                                         std::size_t);                                                     \
+    template void backward_solve_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,         \
+                                          std::vector<hpx::shared_future<mutable_tile_data<T>>> &,         \
+                                          std::size_t,                                                     \
+                                          std::size_t);                                                    \
+    template void forward_solve_KcK_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,      \
+                                             std::vector<hpx::shared_future<mutable_tile_data<T>>> &,      \
+                                             std::size_t,                                                  \
+                                             std::size_t,                                                  \
+                                             std::size_t,                                                  \
+                                             std::size_t);                                                 \
+    template void prediction_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,             \
+                                      std::vector<hpx::shared_future<mutable_tile_data<T>>> &,             \
+                                      std::vector<hpx::shared_future<mutable_tile_data<T>>> &,             \
+                                      std::size_t,                                                         \
+                                      std::size_t,                                                         \
+                                      std::size_t,                                                         \
+                                      std::size_t);                                                        \
+    template void posterior_covariance_tiled<T>(std::vector<hpx::shared_future<mutable_tile_data<T>>> &,   \
+                                                std::vector<hpx::shared_future<mutable_tile_data<T>>> &,   \
+                                                std::size_t,                                               \
+                                                std::size_t,                                               \
+                                                std::size_t,                                               \
+                                                std::size_t);
+
+INSTANTIATE_TILED_ALGORITHMS(float)
+INSTANTIATE_TILED_ALGORITHMS(double)
+
+// }}} ------------------- end of Instantiations for Single and Double Precision
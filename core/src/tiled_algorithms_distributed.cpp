@@ -0,0 +1,549 @@
+#include "../include/tiled_algorithms_distributed.hpp"
+
+#include "../include/adapter_mkl.hpp"
+#include "../include/gp_algorithms_cpu.hpp"
+#include <algorithm>
+#include <atomic>
+#include <hpx/include/actions.hpp>
+#include <hpx/include/runtime.hpp>
+#include <hpx/include/serialization.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Tile Store -------------------------------------------------------------- {{{
+
+namespace
+{
+/**
+ * @brief Tiles and training inputs of the distributed matrices on this
+ *        locality, keyed by matrix id and tile index.
+ */
+struct tile_store
+{
+    std::mutex mutex;
+
+    // owned tiles and received panel copies
+    std::map<std::pair<std::uint64_t, std::size_t>, mutable_tile_data<double>> tiles;
+
+    std::map<std::uint64_t, std::shared_ptr<const std::vector<double>>> inputs;
+};
+
+tile_store &local_store()
+{
+    static tile_store store;
+    return store;
+}
+
+// Take a tile out of the store, such that the kernel may update it in place
+mutable_tile_data<double> take_tile(std::uint64_t id, std::size_t index)
+{
+    tile_store &store = local_store();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    auto it = store.tiles.find({ id, index });
+    if (it == store.tiles.end())
+    {
+        throw std::runtime_error("distributed tile " + std::to_string(index) + " of matrix " + std::to_string(id) + " not found on this locality");
+    }
+    mutable_tile_data<double> tile = std::move(it->second);
+    store.tiles.erase(it);
+    return tile;
+}
+
+// Read a finished tile, the store keeps it
+const_tile_data<double> get_tile(std::uint64_t id, std::size_t index)
+{
+    tile_store &store = local_store();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    auto it = store.tiles.find({ id, index });
+    if (it == store.tiles.end())
+    {
+        throw std::runtime_error("distributed tile " + std::to_string(index) + " of matrix " + std::to_string(id) + " not found on this locality");
+    }
+    return it->second;
+}
+
+void put_tile(std::uint64_t id, std::size_t index, mutable_tile_data<double> tile)
+{
+    tile_store &store = local_store();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    store.tiles[{ id, index }] = std::move(tile);
+}
+
+std::vector<double> to_vector(const const_tile_data<double> &tile)
+{
+    return std::vector<double>(tile.begin(), tile.end());
+}
+
+mutable_tile_data<double> to_tile(const std::vector<double> &data)
+{
+    mutable_tile_data<double> tile(data.size());
+    std::copy(data.begin(), data.end(), tile.begin());
+    return tile;
+}
+
+// Push a finished tile to the localities that need a copy of it
+void push_tile(std::uint64_t id,
+               std::size_t index,
+               const const_tile_data<double> &tile,
+               const std::vector<hpx::id_type> &targets);
+}  // namespace
+
+// }}} ------------------------------------------------------- end of Tile Store
+
+// Actions ----------------------------------------------------------------- {{{
+
+void remote_store_input(std::uint64_t id, std::vector<double> input)
+{
+    tile_store &store = local_store();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    store.inputs[id] = std::make_shared<const std::vector<double>>(std::move(input));
+}
+
+void remote_put_tile(std::uint64_t id, std::size_t index, std::vector<double> data)
+{
+    put_tile(id, index, to_tile(data));
+}
+
+void remote_drop_tiles(std::uint64_t id, std::vector<std::size_t> indices)
+{
+    tile_store &store = local_store();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    for (std::size_t index : indices)
+    {
+        store.tiles.erase({ id, index });
+    }
+}
+
+void remote_release(std::uint64_t id)
+{
+    tile_store &store = local_store();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    store.inputs.erase(id);
+    store.tiles.erase(store.tiles.lower_bound({ id, 0 }),
+                      store.tiles.lower_bound({ id + 1, 0 }));
+}
+
+std::vector<double> remote_get_tile(std::uint64_t id, std::size_t index)
+{
+    return to_vector(get_tile(id, index));
+}
+
+void remote_assemble_covariance(std::uint64_t id,
+                                std::size_t index,
+                                std::size_t row,
+                                std::size_t col,
+                                std::size_t N,
+                                std::size_t n_regressors,
+                                std::vector<double> hyperparameters)
+{
+    std::shared_ptr<const std::vector<double>> input;
+    {
+        tile_store &store = local_store();
+        std::lock_guard<std::mutex> lock(store.mutex);
+        input = store.inputs.at(id);
+    }
+    put_tile(id, index, gen_tile_covariance<double>(row, col, N, n_regressors, hyperparameters.data(), kernel_function(), *input));
+}
+
+void remote_potrf(std::uint64_t id,
+                  std::size_t index,
+                  std::size_t N,
+                  std::vector<hpx::id_type> targets)
+{
+    mutable_tile_data<double> L = potrf(take_tile(id, index), N);
+    put_tile(id, index, L);
+    push_tile(id, index, L, targets);
+}
+
+void remote_trsm(std::uint64_t id,
+                 std::size_t index,
+                 std::size_t index_diag,
+                 std::size_t N,
+                 std::vector<hpx::id_type> targets)
+{
+    const const_tile_data<double> L_diag = get_tile(id, index_diag);
+    mutable_tile_data<double> L = trsm(L_diag, take_tile(id, index), N);
+    put_tile(id, index, L);
+    push_tile(id, index, L, targets);
+}
+
+void remote_syrk(std::uint64_t id,
+                 std::size_t index,
+                 std::size_t index_panel,
+                 std::size_t N)
+{
+    const const_tile_data<double> L = get_tile(id, index_panel);
+    put_tile(id, index, syrk(take_tile(id, index), L, N));
+}
+
+void remote_gemm(std::uint64_t id,
+                 std::size_t index,
+                 std::size_t index_row_panel,
+                 std::size_t index_col_panel,
+                 std::size_t N)
+{
+    const const_tile_data<double> L_m = get_tile(id, index_row_panel);
+    const const_tile_data<double> L_n = get_tile(id, index_col_panel);
+    put_tile(id, index, gemm(L_m, L_n, take_tile(id, index), N));
+}
+
+std::vector<double> remote_trsv_l(std::uint64_t id,
+                                  std::size_t index,
+                                  std::vector<double> rhs,
+                                  std::size_t N)
+{
+    return to_vector(trsv_l(get_tile(id, index), to_tile(rhs), N));
+}
+
+std::vector<double> remote_gemv_l(std::uint64_t id,
+                                  std::size_t index,
+                                  std::vector<double> a,
+                                  std::vector<double> b,
+                                  std::size_t N)
+{
+    return to_vector(gemv_l(get_tile(id, index), to_tile(a), to_tile(b), N));
+}
+
+std::vector<double> remote_trsv_u(std::uint64_t id,
+                                  std::size_t index,
+                                  std::vector<double> rhs,
+                                  std::size_t N)
+{
+    return to_vector(trsv_u(get_tile(id, index), to_tile(rhs), N));
+}
+
+std::vector<double> remote_gemv_u(std::uint64_t id,
+                                  std::size_t index,
+                                  std::vector<double> a,
+                                  std::vector<double> b,
+                                  std::size_t N)
+{
+    return to_vector(gemv_u(get_tile(id, index), to_tile(a), to_tile(b), N));
+}
+
+HPX_PLAIN_ACTION(remote_store_input, remote_store_input_action)
+HPX_PLAIN_ACTION(remote_put_tile, remote_put_tile_action)
+HPX_PLAIN_ACTION(remote_drop_tiles, remote_drop_tiles_action)
+HPX_PLAIN_ACTION(remote_release, remote_release_action)
+HPX_PLAIN_ACTION(remote_get_tile, remote_get_tile_action)
+HPX_PLAIN_ACTION(remote_assemble_covariance, remote_assemble_covariance_action)
+HPX_PLAIN_ACTION(remote_potrf, remote_potrf_action)
+HPX_PLAIN_ACTION(remote_trsm, remote_trsm_action)
+HPX_PLAIN_ACTION(remote_syrk, remote_syrk_action)
+HPX_PLAIN_ACTION(remote_gemm, remote_gemm_action)
+HPX_PLAIN_ACTION(remote_trsv_l, remote_trsv_l_action)
+HPX_PLAIN_ACTION(remote_gemv_l, remote_gemv_l_action)
+HPX_PLAIN_ACTION(remote_trsv_u, remote_trsv_u_action)
+HPX_PLAIN_ACTION(remote_gemv_u, remote_gemv_u_action)
+
+namespace
+{
+void push_tile(std::uint64_t id,
+               std::size_t index,
+               const const_tile_data<double> &tile,
+               const std::vector<hpx::id_type> &targets)
+{
+    if (targets.empty())
+    {
+        return;
+    }
+    const std::vector<double> data = to_vector(tile);
+    std::vector<hpx::future<void>> puts;
+    puts.reserve(targets.size());
+    for (const hpx::id_type &target : targets)
+    {
+        puts.push_back(hpx::async<remote_put_tile_action>(target, id, index, data));
+    }
+    hpx::wait_all(puts);
+}
+
+// Run `Action` on `locality` once all `dependencies` are ready
+template <typename Action, typename... Ts>
+hpx::shared_future<void>
+remote_after(const hpx::id_type &locality,
+             std::vector<hpx::shared_future<void>> dependencies,
+             Ts... ts)
+{
+    return hpx::dataflow(
+        hpx::annotated_function(
+            [locality, ts...](auto &&)
+            { hpx::async<Action>(locality, ts...).get(); },
+            "cholesky_distributed"),
+        hpx::when_all(dependencies));
+}
+
+// Add the owner of (row, col) to `targets` unless it is `source` or listed
+void add_target(const distributed_tiles &tiles,
+                std::size_t row,
+                std::size_t col,
+                std::size_t source,
+                std::vector<std::size_t> &targets)
+{
+    const std::size_t owner = tiles.policy().owner(row, col);
+    if (owner != source
+        && std::find(targets.begin(), targets.end(), owner) == targets.end())
+    {
+        targets.push_back(owner);
+    }
+}
+}  // namespace
+
+// }}} ---------------------------------------------------------- end of Actions
+
+// Distributed Matrix ------------------------------------------------------ {{{
+
+distributed_tiles::distributed_tiles(const distribution_policy &policy,
+                                     std::size_t n_tiles,
+                                     std::size_t n_tile_size) :
+    _policy(policy),
+    _n_tiles(n_tiles),
+    _n_tile_size(n_tile_size),
+    _versions(n_tiles * n_tiles)
+{
+    static std::atomic<std::uint64_t> next_id{ 0 };
+    _id = next_id++;
+
+    const std::vector<hpx::id_type> localities = hpx::find_all_localities();
+    if (policy.n_localities() == 0 || policy.n_localities() > localities.size())
+    {
+        throw std::invalid_argument("distribution policy needs " + std::to_string(policy.n_localities()) + " localities, the HPX runtime has " + std::to_string(localities.size()));
+    }
+    _localities.assign(localities.begin(), localities.begin() + policy.n_localities());
+}
+
+distributed_tiles::~distributed_tiles()
+{
+    // the runtime may already be stopped if the owner outlives it
+    if (!hpx::is_running())
+    {
+        return;
+    }
+    for (const hpx::shared_future<void> &version : _versions)
+    {
+        if (version.valid())
+        {
+            version.wait();
+        }
+    }
+    std::vector<hpx::future<void>> releases;
+    for (const hpx::id_type &locality : _localities)
+    {
+        releases.push_back(hpx::async<remote_release_action>(locality, _id));
+    }
+    hpx::wait_all(releases);
+}
+
+// }}} ----------------------------------------------- end of Distributed Matrix
+
+// Distributed Assembly ---------------------------------------------------- {{{
+
+void assemble_covariance_distributed(distributed_tiles &tiles,
+                                     std::size_t n_regressors,
+                                     const double *hyperparameters,
+                                     const std::vector<double> &input)
+{
+    const std::size_t n_tiles = tiles.n_tiles();
+    const std::vector<double> params(hyperparameters, hyperparameters + 3);
+
+    std::vector<hpx::shared_future<void>> inputs;
+    for (const hpx::id_type &locality : tiles.localities())
+    {
+        inputs.push_back(hpx::async<remote_store_input_action>(locality, tiles.id(), input));
+    }
+    for (std::size_t i = 0; i < n_tiles; i++)
+    {
+        for (std::size_t j = 0; j <= i; j++)
+        {
+            tiles.version(i, j) =
+                remote_after<remote_assemble_covariance_action>(
+                    tiles.owner(i, j), inputs, tiles.id(), i * n_tiles + j, i, j, tiles.n_tile_size(), n_regressors, params);
+        }
+    }
+}
+
+hpx::shared_future<mutable_tile_data<double>>
+fetch_tile_distributed(const distributed_tiles &tiles,
+                       std::size_t row,
+                       std::size_t col)
+{
+    const hpx::id_type locality = tiles.owner(row, col);
+    const std::uint64_t id = tiles.id();
+    const std::size_t index = row * tiles.n_tiles() + col;
+    return tiles.version(row, col).then(
+        [locality, id, index](auto &&)
+        { return to_tile(hpx::async<remote_get_tile_action>(locality, id, index).get()); });
+}
+
+// }}} --------------------------------------------- end of Distributed Assembly
+
+// Distributed Cholesky Algorithm ------------------------------------------ {{{
+
+void cholesky_distributed(distributed_tiles &tiles)
+{
+    const std::size_t n_tiles = tiles.n_tiles();
+    const std::size_t N = tiles.n_tile_size();
+    const std::uint64_t id = tiles.id();
+    const distribution_policy &policy = tiles.policy();
+
+    auto target_ids = [&tiles](const std::vector<std::size_t> &targets)
+    {
+        std::vector<hpx::id_type> ids;
+        for (std::size_t target : targets)
+        {
+            ids.push_back(tiles.localities()[target]);
+        }
+        return ids;
+    };
+
+    for (std::size_t k = 0; k < n_tiles; k++)
+    {
+        // panel copies received in this step, per locality
+        std::map<std::size_t, std::vector<std::size_t>> received;
+        // tasks that read the panel copies
+        std::vector<hpx::shared_future<void>> readers;
+
+        // POTRF, L_kk is needed by the owners of the TRSMs
+        const std::size_t owner_kk = policy.owner(k, k);
+        std::vector<std::size_t> targets;
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            add_target(tiles, m, k, owner_kk, targets);
+        }
+        for (std::size_t target : targets)
+        {
+            received[target].push_back(k * n_tiles + k);
+        }
+        tiles.version(k, k) = remote_after<remote_potrf_action>(
+            tiles.owner(k, k), { tiles.version(k, k) }, id, k * n_tiles + k, N, target_ids(targets));
+
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            // TRSM, L_mk is needed by the owners of the updates in row and
+            // column m
+            const std::size_t owner_mk = policy.owner(m, k);
+            targets.clear();
+            add_target(tiles, m, m, owner_mk, targets);
+            for (std::size_t n = k + 1; n < m; n++)
+            {
+                add_target(tiles, m, n, owner_mk, targets);
+            }
+            for (std::size_t p = m + 1; p < n_tiles; p++)
+            {
+                add_target(tiles, p, m, owner_mk, targets);
+            }
+            for (std::size_t target : targets)
+            {
+                received[target].push_back(m * n_tiles + k);
+            }
+            tiles.version(m, k) = remote_after<remote_trsm_action>(
+                tiles.owner(m, k), { tiles.version(m, k), tiles.version(k, k) }, id, m * n_tiles + k, k * n_tiles + k, N, target_ids(targets));
+            readers.push_back(tiles.version(m, k));
+        }
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            // SYRK
+            tiles.version(m, m) = remote_after<remote_syrk_action>(
+                tiles.owner(m, m), { tiles.version(m, m), tiles.version(m, k) }, id, m * n_tiles + m, m * n_tiles + k, N);
+            readers.push_back(tiles.version(m, m));
+            for (std::size_t n = k + 1; n < m; n++)
+            {
+                // GEMM
+                tiles.version(m, n) = remote_after<remote_gemm_action>(
+                    tiles.owner(m, n), { tiles.version(m, n), tiles.version(m, k), tiles.version(n, k) }, id, m * n_tiles + n, m * n_tiles + k, n * n_tiles + k, N);
+                readers.push_back(tiles.version(m, n));
+            }
+        }
+
+        // drop the panel copies once all their readers have run. Matrix ids
+        // are not reused, so a drop that runs after the release is a no-op.
+        for (auto &copies : received)
+        {
+            remote_after<remote_drop_tiles_action>(
+                tiles.localities()[copies.first], readers, id, copies.second);
+        }
+    }
+}
+
+// }}} ----------------------------------- end of Distributed Cholesky Algorithm
+
+// Distributed Triangular Solve Algorithms --------------------------------- {{{
+
+void forward_solve_distributed(
+    const distributed_tiles &tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs)
+{
+    const std::size_t n_tiles = tiles.n_tiles();
+    const std::size_t N = tiles.n_tile_size();
+    const std::uint64_t id = tiles.id();
+    for (std::size_t k = 0; k < n_tiles; k++)
+    {
+        // TRSV
+        const hpx::id_type owner_kk = tiles.owner(k, k);
+        const std::size_t index_kk = k * n_tiles + k;
+        ft_rhs[k] = hpx::dataflow(
+            hpx::annotated_function(
+                [owner_kk, id, index_kk, N](auto &&, auto &&rhs)
+                { return to_tile(hpx::async<remote_trsv_l_action>(owner_kk, id, index_kk, to_vector(rhs.get()), N).get()); },
+                "triangular_solve_distributed"),
+            tiles.version(k, k),
+            ft_rhs[k]);
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            // GEMV
+            const hpx::id_type owner_mk = tiles.owner(m, k);
+            const std::size_t index_mk = m * n_tiles + k;
+            ft_rhs[m] = hpx::dataflow(
+                hpx::annotated_function(
+                    [owner_mk, id, index_mk, N](auto &&, auto &&a, auto &&b)
+                    { return to_tile(hpx::async<remote_gemv_l_action>(owner_mk, id, index_mk, to_vector(a.get()), to_vector(b.get()), N).get()); },
+                    "triangular_solve_distributed"),
+                tiles.version(m, k),
+                ft_rhs[k],
+                ft_rhs[m]);
+        }
+    }
+}
+
+void backward_solve_distributed(
+    const distributed_tiles &tiles,
+    std::vector<hpx::shared_future<mutable_tile_data<double>>> &ft_rhs)
+{
+    const std::size_t n_tiles = tiles.n_tiles();
+    const std::size_t N = tiles.n_tile_size();
+    const std::uint64_t id = tiles.id();
+    for (int k = n_tiles - 1; k >= 0;
+         k--)  // int instead of std::size_t for last comparison
+    {
+        // TRSV
+        const hpx::id_type owner_kk = tiles.owner(k, k);
+        const std::size_t index_kk = k * n_tiles + k;
+        ft_rhs[k] = hpx::dataflow(
+            hpx::annotated_function(
+                [owner_kk, id, index_kk, N](auto &&, auto &&rhs)
+                { return to_tile(hpx::async<remote_trsv_u_action>(owner_kk, id, index_kk, to_vector(rhs.get()), N).get()); },
+                "triangular_solve_distributed"),
+            tiles.version(k, k),
+            ft_rhs[k]);
+        for (int m = k - 1; m >= 0;
+             m--)  // int instead of std::size_t for last comparison
+        {
+            // GEMV
+            const hpx::id_type owner_km = tiles.owner(k, m);
+            const std::size_t index_km = k * n_tiles + m;
+            ft_rhs[m] = hpx::dataflow(
+                hpx::annotated_function(
+                    [owner_km, id, index_km, N](auto &&, auto &&a, auto &&b)
+                    { return to_tile(hpx::async<remote_gemv_u_action>(owner_km, id, index_km, to_vector(a.get()), to_vector(b.get()), N).get()); },
+                    "triangular_solve_distributed"),
+                tiles.version(k, m),
+                ft_rhs[k],
+                ft_rhs[m]);
+        }
+    }
+}
+
+// }}} -------------------------- end of Distributed Triangular Solve Algorithms
@@ -0,0 +1,252 @@
+#include "../include/tiled_algorithms_gpu.hpp"
+
+#include "../include/adapter_cublas.hpp"
+#include "../include/gp_algorithms_gpu.hpp"
+#include "../include/profiling.hpp"
+#include <hpx/execution.hpp>
+
+// The task graphs of tiled_algorithms_cpu.cpp on device tiles. The kernels
+// suspend their HPX thread while the GPU works, so the workers keep several
+// streams busy at once.
+
+namespace gpu
+{
+
+// Tiled Cholesky Algorithm ------------------------------------------------ {{{
+
+// Executor of a task on (priority) or off (!priority) the critical path
+static hpx::execution::parallel_executor cholesky_executor(bool priority)
+{
+    return hpx::execution::parallel_executor(
+        priority ? hpx::threads::thread_priority::high
+                 : hpx::threads::thread_priority::normal);
+}
+
+void cholesky_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::size_t N,
+    std::size_t n_tiles)
+{
+    for (std::size_t k = 0; k < n_tiles; k++)
+    {
+        // POTRF
+        ft_tiles[k * n_tiles + k] = hpx::dataflow(
+            cholesky_executor(true),
+            profiling::annotated_function(hpx::unwrapping(&potrf), "cholesky_tiled_gpu"),
+            ft_tiles[k * n_tiles + k],
+            N);
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            // TRSM
+            ft_tiles[m * n_tiles + k] = hpx::dataflow(
+                cholesky_executor(true),
+                profiling::annotated_function(hpx::unwrapping(&trsm),
+                                              "cholesky_tiled_gpu"),
+                ft_tiles[k * n_tiles + k],
+                ft_tiles[m * n_tiles + k],
+                N);
+        }
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            // SYRK
+            ft_tiles[m * n_tiles + m] = hpx::dataflow(
+                cholesky_executor(m == k + 1),
+                profiling::annotated_function(hpx::unwrapping(&syrk),
+                                              "cholesky_tiled_gpu"),
+                ft_tiles[m * n_tiles + m],
+                ft_tiles[m * n_tiles + k],
+                N);
+            for (std::size_t n = k + 1; n < m; n++)
+            {
+                // GEMM
+                ft_tiles[m * n_tiles + n] = hpx::dataflow(
+                    cholesky_executor(n == k + 1),
+                    profiling::annotated_function(hpx::unwrapping(&gemm),
+                                                  "cholesky_tiled_gpu"),
+                    ft_tiles[m * n_tiles + k],
+                    ft_tiles[n * n_tiles + k],
+                    ft_tiles[m * n_tiles + n],
+                    N);
+            }
+        }
+    }
+}
+
+// }}} ----------------------------------------- end of Tiled Cholesky Algorithm
+
+// Tiled Triangular Solve Algorithms --------------------------------------- {{{
+
+void forward_solve_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_rhs,
+    std::size_t N,
+    std::size_t n_tiles)
+{
+    for (std::size_t k = 0; k < n_tiles; k++)
+    {
+        // TRSM
+        ft_rhs[k] =
+            hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&trsv_l),
+                                                        "triangular_solve_tiled"),
+                          ft_tiles[k * n_tiles + k],
+                          ft_rhs[k],
+                          N);
+        for (std::size_t m = k + 1; m < n_tiles; m++)
+        {
+            // GEMV
+            ft_rhs[m] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gemv_l),
+                                              "triangular_solve_tiled"),
+                ft_tiles[m * n_tiles + k],
+                ft_rhs[k],
+                ft_rhs[m],
+                N);
+        }
+    }
+}
+
+void backward_solve_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_rhs,
+    std::size_t N,
+    std::size_t n_tiles)
+{
+    for (int k = n_tiles - 1; k >= 0;
+         k--)  // int instead of std::size_t for last comparison
+    {
+        // TRSM
+        ft_rhs[k] =
+            hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&trsv_u),
+                                                        "triangular_solve_tiled"),
+                          ft_tiles[k * n_tiles + k],
+                          ft_rhs[k],
+                          N);
+        for (int m = k - 1; m >= 0;
+             m--)  // int instead of std::size_t for last comparison
+        {
+            // GEMV
+            ft_rhs[m] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&gemv_u),
+                                              "triangular_solve_tiled"),
+                ft_tiles[k * n_tiles + m],
+                ft_rhs[k],
+                ft_rhs[m],
+                N);
+        }
+    }
+}
+
+// Triangular solve A_M,N * K_NxN = K_MxN -> A_MxN = K_MxN * K^-1_NxN
+void forward_solve_KcK_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_rhs,
+    std::size_t N,
+    std::size_t M,
+    std::size_t n_tiles,
+    std::size_t m_tiles)
+{
+    for (std::size_t r = 0; r < m_tiles; r++)
+    {
+        for (std::size_t c = 0; c < n_tiles; c++)
+        {
+            // TRSM
+            ft_rhs[c * m_tiles + r] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&trsm_l_KcK),
+                                              "triangular_solve_tiled_matrix_KK"),
+                ft_tiles[c * n_tiles + c],
+                ft_rhs[c * m_tiles + r],
+                N,
+                M);
+            for (std::size_t m = c + 1; m < n_tiles; m++)
+            {
+                // GEMV
+                ft_rhs[m * m_tiles + r] = hpx::dataflow(
+                    profiling::annotated_function(hpx::unwrapping(&gemm_l_KcK),
+                                                  "triangular_solve_tiled_matrix_KK"),
+                    ft_tiles[m * n_tiles + c],
+                    ft_rhs[c * m_tiles + r],
+                    ft_rhs[m * m_tiles + r],
+                    N,
+                    M);
+            }
+        }
+    }
+}
+
+// }}} -------------------------------- end of Tiled Triangular Solve Algorithms
+
+// Tiled Prediction -------------------------------------------------------- {{{
+
+void prediction_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_vector,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_rhs,
+    std::size_t N_row,
+    std::size_t N_col,
+    std::size_t n_tiles,
+    std::size_t m_tiles)
+{
+    for (std::size_t k = 0; k < m_tiles; k++)
+    {
+        for (std::size_t m = 0; m < n_tiles; m++)
+        {
+            ft_rhs[k] =
+                hpx::dataflow(profiling::annotated_function(hpx::unwrapping(&gemv_p),
+                                                            "prediction_tiled"),
+                              ft_tiles[k * n_tiles + m],
+                              ft_vector[m],
+                              ft_rhs[k],
+                              N_row,
+                              N_col);
+        }
+    }
+}
+
+// Tiled Diagonal of Posterior Covariance Matrix
+void posterior_covariance_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_tCC_tiles,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_inter_tiles,
+    std::size_t N,
+    std::size_t M,
+    std::size_t n_tiles,
+    std::size_t m_tiles)
+{
+    for (std::size_t i = 0; i < m_tiles; ++i)
+    {
+        for (std::size_t n = 0; n < n_tiles;
+             ++n)
+        {  // Compute inner product to obtain diagonal elements of
+           // (K_MxN * (K^-1_NxN * K_NxM))
+            ft_inter_tiles[i] = hpx::dataflow(
+                profiling::annotated_function(hpx::unwrapping(&dot_uncertainty),
+                                              "posterior_tiled"),
+                ft_tCC_tiles[n * m_tiles + i],
+                ft_inter_tiles[i],
+                N,
+                M);
+        }
+    }
+}
+
+// Tiled Prediction Uncertainty
+void prediction_uncertainty_tiled(
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_priorK,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_inter,
+    std::vector<hpx::shared_future<device_tile_data<double>>> &ft_vector,
+    std::size_t M,
+    std::size_t m_tiles)
+{
+    for (std::size_t i = 0; i < m_tiles; i++)
+    {
+        ft_vector[i] = hpx::dataflow(
+            profiling::annotated_function(hpx::unwrapping(&diag_posterior),
+                                          "uncertainty_tiled"),
+            ft_priorK[i],
+            ft_inter[i],
+            M);
+    }
+}
+
+// }}} ------------------------------------------------- end of Tiled Prediction
+
+}  // namespace gpu
@@ -1,6 +1,13 @@
 #include "../include/utils_c.hpp"
 
-#include <cstdio>
+#include "../include/adapter_mkl.hpp"
+#include "../include/data_file.hpp"
+#include "../include/profiling.hpp"
+#include "../include/tile_memory_pool.hpp"
+#include <hpx/include/runtime.hpp>
+#ifdef GPXPY_WITH_CUDA
+#include "../include/gpu_context.hpp"
+#endif
 
 namespace utils
 {
@@ -9,6 +16,8 @@ namespace utils
  * @brief Compute the number of tiles for training data, given the number of
  * samples and the size of each tile.
  *
+ * The last tile is zero-padded if n_samples is not divisible by n_tile_size.
+ *
  * @param n_samples Number of samples
  * @param n_tile_size Size of each tile
  */
@@ -18,7 +27,7 @@ int compute_train_tiles(int n_samples, int n_tile_size)
     {
         std::size_t _n_samples = static_cast<std::size_t>(n_samples);
         std::size_t _n_tile_size = static_cast<std::size_t>(n_tile_size);
-        std::size_t _n_tiles = _n_samples / _n_tile_size;
+        std::size_t _n_tiles = (_n_samples + _n_tile_size - 1) / _n_tile_size;
         return static_cast<int>(_n_tiles);
     }
     else
@@ -28,11 +37,13 @@ int compute_train_tiles(int n_samples, int n_tile_size)
 }
 
 /**
- * @brief Compute the number of tiles for training data, given the number of
- * samples and the size of each tile.
+ * @brief Compute the size of the tiles for training data, given the number of
+ * samples and the number of tiles.
+ *
+ * The last tile is zero-padded if n_samples is not divisible by n_tiles.
  *
  * @param n_samples Number of samples
- * @param n_tile_size Size of each tile
+ * @param n_tiles Number of tiles
  */
 int compute_train_tile_size(int n_samples, int n_tiles)
 {
@@ -40,7 +51,7 @@ int compute_train_tile_size(int n_samples, int n_tiles)
     {
         std::size_t _n_samples = static_cast<std::size_t>(n_samples);
         std::size_t _n_tiles = static_cast<std::size_t>(n_tiles);
-        std::size_t _n_tile_size = _n_samples / n_tiles;
+        std::size_t _n_tile_size = (_n_samples + _n_tiles - 1) / _n_tiles;
         return static_cast<int>(_n_tile_size);
     }
     else
@@ -52,69 +63,89 @@ int compute_train_tile_size(int n_samples, int n_tiles)
 /**
  * @brief Compute the number of test tiles and the size of a test tile.
  *
- * Uses n_tiles_size if n_test is divisible by n_tile_size. Otherwise uses
- * n_tiles for calculation.
+ * Test tiles have the size of the training tiles, the last tile is
+ * zero-padded if n_test is not divisible by n_tile_size.
  *
  * @param n_test Number of test samples
- * @param n_tiles Number of tiles
+ * @param n_tiles Number of training tiles, not needed since test tiles are
+ *        padded, kept for compatibility
  * @param n_tile_size Size of each tile
  */
 std::pair<int, int> compute_test_tiles(int n_test, int n_tiles, int n_tile_size)
 {
-    std::size_t _n_test = static_cast<std::size_t>(n_test);
-    std::size_t _n_tiles = static_cast<std::size_t>(n_tiles);
-    std::size_t _n_tile_size = static_cast<std::size_t>(n_tile_size);
-    std::size_t m_tiles;
-    std::size_t m_tile_size;
-
-    if ((_n_test % _n_tile_size) > 0)
-    {
-        m_tiles = _n_tiles;
-        m_tile_size = _n_test / m_tiles;
-    }
-    else
+    if (n_tile_size <= 0)
     {
-        m_tiles = _n_test / _n_tile_size;
-        m_tile_size = _n_tile_size;
+        throw std::runtime_error("Error: Please specify a valid value for train_tile_size.\n");
     }
+    std::size_t _n_test = static_cast<std::size_t>(n_test);
+    std::size_t _n_tile_size = static_cast<std::size_t>(n_tile_size);
+    std::size_t m_tiles = (_n_test + _n_tile_size - 1) / _n_tile_size;
+    std::size_t m_tile_size = _n_tile_size;
     return { static_cast<int>(m_tiles), static_cast<int>(m_tile_size) };
 }
 
 /**
  * @brief Load data from file
  *
+ * Binary data files are recognized by their header and memory-mapped, any
+ * other file is parsed as text with one value per whitespace separated token.
+ * See data_file.hpp for both formats.
+ *
  * @param file_path Path to the file
  * @param n_samples Number of samples to load
  */
 std::vector<double> load_data(const std::string &file_path, int n_samples)
 {
-    std::vector<double> _data;
-    _data.resize(n_samples);
-
-    FILE *input_file = fopen(file_path.c_str(), "r");
-    if (input_file == NULL)
+    if (n_samples < 0)
     {
-        throw std::runtime_error("Error: File not found: " + file_path);
+        throw std::runtime_error("Error: Please specify a valid number of samples.\n");
     }
-
-    // load data
-    std::size_t scanned_elements = 0;
-    for (int i = 0; i < n_samples; i++)
+    if (data_file::is_binary(file_path))
     {
-        scanned_elements += fscanf(input_file, "%lf", &_data[i]);  // scanned_elements++;
+        return data_file::read_binary(file_path, static_cast<std::size_t>(n_samples));
     }
+    return data_file::read_text(file_path, static_cast<std::size_t>(n_samples));
+}
 
-    fclose(input_file);
-
-    if (scanned_elements != n_samples)
+/**
+ * @brief Write samples to a data file
+ *
+ * @param file_path Path to the file, overwritten if it exists
+ * @param data Samples to write
+ * @param binary Write the binary format instead of text
+ * @param single_precision Store the samples of a binary file as floats
+ */
+void save_data(const std::string &file_path, const std::vector<double> &data, bool binary, bool single_precision)
+{
+    if (binary)
+    {
+        data_file::write_binary(file_path, data, single_precision ? data_file::data_type::Float32 : data_file::data_type::Float64);
+    }
+    else
     {
-        throw std::runtime_error("Error: Data not correctly read. Expected "
-                                 + std::to_string(n_samples)
-                                 + " elements, but read "
-                                 + std::to_string(scanned_elements));
+        data_file::write_text(file_path, data);
     }
+}
 
-    return std::move(_data);
+/**
+ * @brief Convert all samples of a data file to the other format
+ *
+ * A text file is converted to a binary file and vice versa.
+ *
+ * @param source_path Path to the file to convert
+ * @param target_path Path to the converted file, overwritten if it exists
+ * @param single_precision Store the samples of a binary target as floats
+ */
+void convert_data(const std::string &source_path, const std::string &target_path, bool single_precision)
+{
+    if (data_file::is_binary(source_path))
+    {
+        save_data(target_path, data_file::read_binary(source_path, data_file::all_samples), false);
+    }
+    else
+    {
+        save_data(target_path, data_file::read_text(source_path, data_file::all_samples), true, single_precision);
+    }
 }
 
 /**
@@ -168,9 +199,49 @@ void print(const std::vector<double> &vec, int start, int end, const std::string
 // Start HPX runtime
 void start_hpx_runtime(int argc, char **argv)
 {
+    hpx::register_startup_function(&profiling::register_counters);
     hpx::start(nullptr, argc, argv);
 }
 
+// Split large kernels over HPX threads
+void set_kernel_threads(std::size_t n_threads, std::size_t min_tile_size)
+{
+    kernel_parallelism policy = get_kernel_parallelism();
+    policy.n_threads = n_threads;
+    policy.min_tile_size = min_tile_size;
+    set_kernel_parallelism(policy);
+}
+
+// Maximum number of HPX threads of a split kernel
+std::size_t kernel_threads()
+{
+    return get_kernel_parallelism().n_threads;
+}
+
+// Limit the bytes of freed tile buffers kept for reuse
+void set_tile_cache_limit(std::size_t bytes)
+{
+    tile_memory_pool::set_cache_limit(bytes);
+}
+
+// Limit of the bytes of freed tile buffers kept for reuse
+std::size_t tile_cache_limit()
+{
+    return tile_memory_pool::cache_limit();
+}
+
+// Bytes of freed tile buffers currently kept for reuse
+std::size_t tile_cache_bytes()
+{
+    return tile_memory_pool::cached_bytes();
+}
+
+// Return the freed tile buffers kept for reuse to the system
+void release_tile_cache()
+{
+    tile_memory_pool::release();
+}
+
 // Resume HPX runtime
 void resume_hpx_runtime()
 {
@@ -189,5 +260,22 @@ void stop_hpx_runtime()
     hpx::post([]()
               { hpx::finalize(); });
     hpx::stop();
+    // return cached tile buffers to the system
+    tile_memory_pool::release();
+#ifdef GPXPY_WITH_CUDA
+    gpu::release_contexts();
+#endif
+}
+
+// Index of the calling locality, 0 on the root locality
+std::size_t locality_id()
+{
+    return hpx::get_locality_id();
+}
+
+// Number of localities of the HPX runtime
+std::size_t n_localities()
+{
+    return hpx::get_num_localities(hpx::launch::sync);
 }
 }  // namespace utils
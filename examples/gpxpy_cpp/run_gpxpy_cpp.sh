@@ -39,3 +39,5 @@ make -j VERBOSE=1 all
 # Run code
 ################################################################################
 ./gpxpy_cpp
+# Strong scaling of the Cholesky variants, written to ../cholesky_scaling.csv
+./cholesky_scaling
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include "../install/include/gpxpy_c.hpp"
+#include "../install/include/tiled_algorithms_cpu.hpp"
+#include "../install/include/utils_c.hpp"
+
+// Strong scaling of the tiled Cholesky decomposition: a fixed problem is
+// factorized with every variant on 1, 2, 4, ..., 2^N_CORES threads.
+int main(int argc, char *argv[])
+{
+    /////////////////////
+    /////// configuration
+    const int n_train = 8192;
+    const int LOOP = 5;
+    const std::size_t N_CORES = 6;  // Up to 2^N_CORES threads
+    const int n_tiles = 32;
+    const int n_reg = 128;
+
+    std::string train_path = "../../../data/training/training_input.txt";
+    std::string out_path = "../../../data/training/training_output.txt";
+
+    const std::vector<std::pair<CholeskyVariant, std::string>> variants = {
+        { CholeskyVariant::RightLooking, "right_looking" },
+        { CholeskyVariant::Priority, "priority" },
+        { CholeskyVariant::Lookahead, "lookahead" },
+        { CholeskyVariant::LeftLooking, "left_looking" }
+    };
+
+    gpxpy::GP_data training_input(train_path, n_train);
+    gpxpy::GP_data training_output(out_path, n_train);
+    int tile_size = utils::compute_train_tile_size(n_train, n_tiles);
+    std::vector<bool> trainable = { false, false, true };
+
+    for (std::size_t core = 1; core <= pow(2, N_CORES); core = core * 2)
+    {
+        // Create new argc and argv to include the --hpx:threads argument
+        std::vector<std::string> args(argv, argv + argc);
+        args.push_back("--hpx:threads=" + std::to_string(core));
+
+        // Convert the arguments to char* array
+        std::vector<char *> cstr_args;
+        for (auto &arg : args)
+        {
+            cstr_args.push_back(const_cast<char *>(arg.c_str()));
+        }
+
+        int new_argc = static_cast<int>(cstr_args.size());
+        char **new_argv = cstr_args.data();
+
+        // Initialize HPX with the new arguments, don't run hpx_main
+        utils::start_hpx_runtime(new_argc, new_argv);
+
+        gpxpy::GP gp(training_input.data, training_output.data, n_tiles, tile_size, 1.0, 1.0, 0.1, n_reg, trainable);
+        for (const auto &variant : variants)
+        {
+            set_cholesky_variant(variant.first);
+            for (std::size_t l = 0; l < LOOP; l++)
+            {
+                // fit() assembles K and factorizes it, the solves for alpha
+                // are of lower order
+                gp.reset_fit();
+                auto start_cholesky = std::chrono::high_resolution_clock::now();
+                gp.fit();
+                auto end_cholesky = std::chrono::high_resolution_clock::now();
+                std::chrono::duration<double> cholesky_time = end_cholesky - start_cholesky;
+
+                std::ofstream outfile("../cholesky_scaling.csv", std::ios::app);  // Append mode
+                if (outfile.tellp() == 0)
+                {
+                    // If file is empty, write the header
+                    outfile << "Cores,N_train,N_tiles,N_regressor,Variant,Cholesky_time,N_loop\n";
+                }
+                outfile << core << "," << n_train << "," << n_tiles << "," << n_reg << "," << variant.second << ","
+                        << cholesky_time.count() << "," << l << "\n";
+                outfile.close();
+                std::cout << core << " cores, " << variant.second << ": " << cholesky_time.count() << " s" << std::endl;
+            }
+        }
+
+        // Stop the HPX runtime
+        utils::stop_hpx_runtime();
+    }
+    return 0;
+}
@@ -65,7 +65,7 @@ int main(int argc, char *argv[])
                 ///// GP
                 auto start_init = std::chrono::high_resolution_clock::now();
                 std::vector<bool> trainable = { false, false, true };
-                gpxpy::GP gp(training_input.data, training_output.data, n_tiles, tile_size, 1.0, 1.0, 0.1, n_reg, trainable);
+                gpxpy::GP gp(std::move(training_input.data), std::move(training_output.data), n_tiles, tile_size, 1.0, 1.0, 0.1, n_reg, trainable);
                 auto end_init = std::chrono::high_resolution_clock::now();
                 std::chrono::duration<double> init_time = end_init - start_init;
 
@@ -90,7 +90,7 @@ int main(int argc, char *argv[])
                 std::chrono::duration<double> pred_uncer_time = end_pred_uncer - start_pred_uncer;
 
                 auto start_pred_full_cov = std::chrono::high_resolution_clock::now();
-                std::vector<std::vector<double>> full = gp.predict_with_full_cov(test_input.data, result.first, result.second);
+                std::vector<std::vector<double>> full = gp.predict_with_full_cov(test_input.data, result.first, result.second, CovarianceFormat::Lower);
                 auto end_pred_full_cov = std::chrono::high_resolution_clock::now();
                 std::chrono::duration<double> pred_full_cov_time = end_pred_full_cov - start_pred_full_cov;
 
@@ -26,7 +26,7 @@ def gpx_run(config, output_csv_obj, n_train, l, cores):
 
     ###### GP object ######
     init_t = time.time()
-    gp = gpx.GP(train_in.data, train_out.data, config["N_TILES"], n_tile_size, trainable=[True, True, True])
+    gp = gpx.GP(train_in, train_out, config["N_TILES"], n_tile_size, trainable=[True, True, True])
     init_t = time.time() - init_t
 
     # Init hpx runtime but do not start it yet
@@ -49,7 +49,7 @@ def gpx_run(config, output_csv_obj, n_train, l, cores):
 
     # Predict
     pred_full_t = time.time()
-    pr__, var__ = gp.predict_with_full_cov(test_in.data, m_tiles, m_tile_size)
+    pr__, var__, cov__ = gp.predict_with_full_cov(test_in.data, m_tiles, m_tile_size, gpx.CovarianceFormat.Lower)
     pred_full_t = time.time() - pred_full_t
     logger.info("Finished predictions with full cov.")
 